@@ -403,6 +403,10 @@ static void reset_handle(fec_handle *f)
 
     f->ecc = {};
     f->verity = {};
+
+    f->verified.reset();
+    f->verified_hits = 0;
+    f->verified_misses = 0;
 }
 
 /* closes and flushes `f->fd' and releases any memory allocated for `f' */
@@ -418,6 +422,8 @@ int fec_close(struct fec_handle *f)
         close(f->fd);
     }
 
+    /* stop worker threads before the mutex used to create them goes away */
+    f->pool.reset();
     pthread_mutex_destroy(&f->mutex);
 
     reset_handle(f);
@@ -490,6 +496,8 @@ int fec_get_status(struct fec_handle *f, struct fec_status *s)
     s->errors = f->errors;
     s->data_size = f->data_size;
     s->size = f->size;
+    s->verified_hits = f->verified_hits;
+    s->verified_misses = f->verified_misses;
 
     return 0;
 }
@@ -556,6 +564,10 @@ int fec_open(struct fec_handle **handle, const char *path, int mode, int flags,
             return -1;
         }
 
+        if (verity_init_verified(f.get()) == -1) {
+            return -1;
+        }
+
         *handle = f.release();
         return 0;
     }
@@ -572,6 +584,10 @@ int fec_open(struct fec_handle **handle, const char *path, int mode, int flags,
         debug("verity metadata not found from '%s'", path);
     }
 
+    if (verity_init_verified(f.get()) == -1) {
+        return -1;
+    }
+
     *handle = f.release();
     return 0;
 }
@@ -25,8 +25,14 @@
 #include <sys/syscall.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <android-base/threads.h>
@@ -40,10 +46,12 @@
 /* processing parameters */
 #define WORK_MIN_THREADS 1
 #define WORK_MAX_THREADS 64
+#define WORK_MIN_BLOCKS 32 /* minimum blocks per thread */
 
 /* verity parameters */
 #define VERITY_CACHE_BLOCKS 4096
 #define VERITY_NO_CACHE UINT64_MAX
+#define VERITY_READ_BLOCKS 64 /* maximum blocks read with a single pread */
 
 /* verity definitions */
 #define VERITY_METADATA_SIZE (8 * FEC_BLOCKSIZE)
@@ -93,7 +101,8 @@ struct hashtree_info {
 
     // Checks if the bytes in 'block' has the expected hash. And the 'index' is
     // the block number of is the input block in the filesystem.
-    bool check_block_hash_with_index(uint64_t index, const uint8_t *block);
+    bool check_block_hash_with_index(uint64_t index,
+                                     const uint8_t *block) const;
 
     // Reads the verity hash tree, validates it against the root hash in `root',
     // corrects errors if necessary, and copies valid data blocks for later use
@@ -106,10 +115,10 @@ struct hashtree_info {
 
     // Computes the hash for FEC_BLOCKSIZE bytes from buffer 'block' and
     // compares it to the expected value in 'expected'.
-    bool check_block_hash(const uint8_t *expected, const uint8_t *block);
+    bool check_block_hash(const uint8_t *expected, const uint8_t *block) const;
 
     // Computes the hash of 'block' and put the result in 'hash'.
-    int get_hash(const uint8_t *block, uint8_t *hash);
+    int get_hash(const uint8_t *block, uint8_t *hash) const;
 
     int nid_;  // NID for the hash algorithm.
     uint32_t digest_length_;
@@ -131,6 +140,37 @@ struct avb_info {
     hashtree_info hashtree;
 };
 
+/* worker threads shared by all reads from a handle */
+class fec_thread_pool {
+   public:
+    // Starts 'workers' threads. Callers of run() also process tasks, so
+    // up to workers + 1 tasks run in parallel.
+    explicit fec_thread_pool(int workers);
+    ~fec_thread_pool();
+
+    int threads() const { return (int)workers_.size() + 1; }
+
+    // Runs all 'tasks' and returns after they have completed.
+    void run(std::vector<std::function<void()>> &tasks);
+
+   private:
+    struct task {
+        std::function<void()> *func;
+        size_t *pending;
+    };
+
+    void worker();
+    // Runs the first queued task, called with 'lock' held.
+    void run_one(std::unique_lock<std::mutex> &lock);
+
+    std::mutex mutex_;
+    std::condition_variable queued_;
+    std::condition_variable completed_;
+    std::deque<task> queue_;
+    std::vector<std::thread> workers_;
+    bool stop_ = false;
+};
+
 struct fec_handle {
     ecc_info ecc;
     int fd;
@@ -144,8 +184,13 @@ struct fec_handle {
     // TODO(xunchang) switch to std::optional
     verity_info verity;
     avb_info avb;
+    std::unique_ptr<fec_thread_pool> pool; /* created by the first large read */
+    /* a bit per data block that has been verified, if FEC_VERIFIED_CACHE */
+    std::unique_ptr<std::atomic<uint64_t>[]> verified;
+    std::atomic<uint64_t> verified_hits;
+    std::atomic<uint64_t> verified_misses;
 
-    hashtree_info hashtree() const {
+    const hashtree_info &hashtree() const {
         return avb.valid ? avb.hashtree : verity.hashtree;
     }
 };
@@ -168,6 +213,8 @@ extern uint64_t verity_get_size(uint64_t file_size, uint32_t *verity_levels,
 
 extern int verity_parse_header(fec_handle *f, uint64_t offset);
 
+extern int verity_init_verified(fec_handle *f);
+
 /* helper macros */
 #ifndef unlikely
     #define unlikely(x) __builtin_expect(!!(x), 0)
@@ -14,7 +14,6 @@
  * limitations under the License.
  */
 
-#include <future>
 #include "fec_private.h"
 
 struct process_info {
@@ -28,6 +27,104 @@ struct process_info {
     size_t errors;
 };
 
+fec_thread_pool::fec_thread_pool(int workers) {
+    for (int i = 0; i < workers; ++i) {
+        workers_.emplace_back(&fec_thread_pool::worker, this);
+    }
+}
+
+fec_thread_pool::~fec_thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    queued_.notify_all();
+
+    for (auto& thread : workers_) {
+        thread.join();
+    }
+}
+
+void fec_thread_pool::run_one(std::unique_lock<std::mutex>& lock) {
+    task t = queue_.front();
+    queue_.pop_front();
+
+    lock.unlock();
+    (*t.func)();
+    lock.lock();
+
+    if (--*t.pending == 0) {
+        completed_.notify_all();
+    }
+}
+
+void fec_thread_pool::worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        queued_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+
+        if (queue_.empty()) {
+            return;
+        }
+
+        run_one(lock);
+    }
+}
+
+void fec_thread_pool::run(std::vector<std::function<void()>>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+
+    size_t pending = tasks.size() - 1;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 1; i < tasks.size(); ++i) {
+            queue_.push_back({&tasks[i], &pending});
+        }
+    }
+    queued_.notify_all();
+
+    tasks[0]();
+
+    /* help with queued tasks instead of idling until ours are done */
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (pending > 0) {
+        if (!queue_.empty()) {
+            run_one(lock);
+        } else {
+            completed_.wait(lock);
+        }
+    }
+}
+
+/* returns the thread pool for `f', or NULL if reads should not be processed
+   in parallel */
+static fec_thread_pool* get_pool(fec_handle* f) {
+    pthread_mutex_lock(&f->mutex);
+
+    if (!f->pool) {
+        int threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+        if (threads < WORK_MIN_THREADS) {
+            threads = WORK_MIN_THREADS;
+        } else if (threads > WORK_MAX_THREADS) {
+            threads = WORK_MAX_THREADS;
+        }
+
+        /* the calling thread counts as one of them */
+        if (threads > 1) {
+            f->pool.reset(new (std::nothrow) fec_thread_pool(threads - 1));
+        }
+    }
+
+    pthread_mutex_unlock(&f->mutex);
+    return f->pool.get();
+}
+
 /* thread function  */
 static process_info* __process(process_info* p) {
     debug("thread %d: [%" PRIu64 ", %" PRIu64 ")", p->id, p->offset, p->offset + p->count);
@@ -36,7 +133,8 @@ static process_info* __process(process_info* p) {
     return p;
 }
 
-/* launches a maximum number of threads to process a read */
+/* splits a read between the threads in the handle's pool; reads that are too
+   small to benefit from it are processed by the calling thread */
 ssize_t process(fec_handle* f, uint8_t* buf, size_t count, uint64_t offset, read_func func) {
     check(f);
     check(buf);
@@ -46,20 +144,17 @@ ssize_t process(fec_handle* f, uint8_t* buf, size_t count, uint64_t offset, read
         return 0;
     }
 
-    int threads = sysconf(_SC_NPROCESSORS_ONLN);
-
-    if (threads < WORK_MIN_THREADS) {
-        threads = WORK_MIN_THREADS;
-    } else if (threads > WORK_MAX_THREADS) {
-        threads = WORK_MAX_THREADS;
-    }
-
     uint64_t start = (offset / FEC_BLOCKSIZE) * FEC_BLOCKSIZE;
     size_t blocks = fec_div_round_up(offset + count - start, FEC_BLOCKSIZE);
+    fec_thread_pool* pool = NULL;
+    int threads = 1;
+
+    if (blocks >= 2 * WORK_MIN_BLOCKS && (pool = get_pool(f)) != NULL) {
+        threads = pool->threads();
 
-    /* start at most one thread per block we're accessing */
-    if ((size_t)threads > blocks) {
-        threads = (int)blocks;
+        if ((size_t)threads > blocks / WORK_MIN_BLOCKS) {
+            threads = (int)(blocks / WORK_MIN_BLOCKS);
+        }
     }
 
     size_t count_per_thread = fec_div_round_up(blocks, threads) * FEC_BLOCKSIZE;
@@ -70,11 +165,10 @@ ssize_t process(fec_handle* f, uint8_t* buf, size_t count, uint64_t offset, read
     debug("max %d threads, %zu bytes per thread (total %zu spanning %zu blocks)", threads,
           count_per_thread, count, blocks);
 
-    std::vector<std::future<process_info*>> handles;
-    process_info info[threads];
+    std::vector<process_info> info(threads);
+    std::vector<std::function<void()>> tasks;
     ssize_t rc = 0;
 
-    /* start threads to process queue */
     for (int i = 0; i < threads && left > 0; ++i) {
         info[i].id = i;
         info[i].f = f;
@@ -89,23 +183,28 @@ ssize_t process(fec_handle* f, uint8_t* buf, size_t count, uint64_t offset, read
             info[i].count = left;
         }
 
-        handles.push_back(std::async(std::launch::async, __process, &info[i]));
+        process_info* p = &info[i];
+        tasks.push_back([p] { __process(p); });
 
         pos = end;
         end += count_per_thread;
         left -= info[i].count;
     }
 
+    if (pool) {
+        pool->run(tasks);
+    } else {
+        tasks[0]();
+    }
+
     ssize_t nread = 0;
 
-    /* wait for all threads to complete */
-    for (auto&& future : handles) {
-        process_info* p = future.get();
-        if (!p || p->rc == -1) {
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        if (info[i].rc == -1) {
             rc = -1;
         } else {
-            nread += p->rc;
-            f->errors += p->errors;
+            nread += info[i].rc;
+            f->errors += info[i].errors;
         }
     }
 
@@ -102,6 +102,32 @@ static inline bool is_zero(fec_handle *f, uint64_t offset)
                    SHA256_DIGEST_LENGTH);
 }
 
+/* checks if block `n' is known to be valid, and counts the lookup */
+static inline bool is_verified(fec_handle *f, uint64_t n)
+{
+    if (!f->verified) {
+        return false;
+    }
+
+    if (f->verified[n / 64].load(std::memory_order_relaxed) &
+            (1ULL << (n % 64))) {
+        f->verified_hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    f->verified_misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+/* marks block `n' as valid on the disk */
+static inline void set_verified(fec_handle *f, uint64_t n)
+{
+    if (f->verified) {
+        f->verified[n / 64].fetch_or(1ULL << (n % 64),
+                                     std::memory_order_relaxed);
+    }
+}
+
 /* reads and decodes a single block starting from `offset', returns the number
    of bytes corrected in `errors' */
 static int __ecc_read(fec_handle *f, void *rs, uint8_t *dest, uint64_t offset,
@@ -304,8 +330,30 @@ static ssize_t verity_read(fec_handle *f, uint8_t *dest, size_t count,
     uint64_t curr = offset / FEC_BLOCKSIZE;
     size_t coff = (size_t)(offset - curr * FEC_BLOCKSIZE);
     size_t left = count;
-    uint8_t data[FEC_BLOCKSIZE];
+    uint64_t last = (offset + count - 1) / FEC_BLOCKSIZE;
+    uint8_t block[FEC_BLOCKSIZE];
+    uint8_t *data;
+
+    /* raw data for blocks [batch_start, batch_end) read with a single pread;
+       batching stops after an I/O error so that errors are isolated to the
+       blocks they affect */
+    std::unique_ptr<uint8_t[]> batch;
+    uint64_t batch_start = 0;
+    uint64_t batch_end = 0;
+    bool batching = false;
+
+    if (last > curr) {
+        uint64_t batch_blocks = last - curr + 1;
+
+        if (batch_blocks > VERITY_READ_BLOCKS) {
+            batch_blocks = VERITY_READ_BLOCKS;
+        }
 
+        batch.reset(new (std::nothrow) uint8_t[batch_blocks * FEC_BLOCKSIZE]);
+        batching = !!batch;
+    }
+
+    bool read_only = (f->mode & O_ACCMODE) == O_RDONLY;
     uint64_t max_hash_block =
         (f->hashtree().hash_data.size() - SHA256_DIGEST_LENGTH) /
         SHA256_DIGEST_LENGTH;
@@ -315,25 +363,55 @@ static ssize_t verity_read(fec_handle *f, uint8_t *dest, size_t count,
         uint64_t curr_offset = curr * FEC_BLOCKSIZE;
 
         bool expect_zeros = is_zero(f, curr_offset);
+        bool read_error = false;
+        data = block;
 
         /* if we are in read-only mode and expect to read a zero block,
            skip reading and just return zeros */
-        if ((f->mode & O_ACCMODE) == O_RDONLY && expect_zeros) {
+        if (read_only && expect_zeros) {
             memset(data, 0, FEC_BLOCKSIZE);
             goto valid;
         }
 
-        /* copy raw data without error correction */
-        if (!raw_pread(f->fd, data, FEC_BLOCKSIZE, curr_offset)) {
+        if (batching && (curr < batch_start || curr >= batch_end)) {
+            /* read ahead up to the next block we don't need to read */
+            batch_start = curr;
+            batch_end = curr + 1;
+
+            while (batch_end <= last &&
+                   batch_end - batch_start < VERITY_READ_BLOCKS &&
+                   !(read_only && is_zero(f, batch_end * FEC_BLOCKSIZE))) {
+                ++batch_end;
+            }
+
+            if (!raw_pread(f->fd, batch.get(),
+                           (batch_end - batch_start) * FEC_BLOCKSIZE,
+                           curr_offset)) {
+                batch_end = batch_start;
+                batching = false;
+            }
+        }
+
+        if (curr >= batch_start && curr < batch_end) {
+            data = &batch[(curr - batch_start) * FEC_BLOCKSIZE];
+        } else if (!raw_pread(f->fd, data, FEC_BLOCKSIZE, curr_offset)) {
+            /* copy raw data without error correction */
             if (errno == EIO) {
                 warn("I/O error encounter when reading, attempting to recover using fec");
+                read_error = true;
             } else {
                 error("failed to read: %s", strerror(errno));
                 return -1;
             }
         }
 
+        /* the hash of the data we read was checked before */
+        if (!read_error && is_verified(f, curr)) {
+            goto valid;
+        }
+
         if (likely(f->hashtree().check_block_hash_with_index(curr, data))) {
+            set_verified(f, curr);
             goto valid;
         }
 
@@ -379,10 +457,13 @@ static ssize_t verity_read(fec_handle *f, uint8_t *dest, size_t count,
 
 corrected:
         /* update the corrected block to the file if we are in r/w mode */
-        if (f->mode & O_RDWR &&
-            !raw_pwrite(f->fd, data, FEC_BLOCKSIZE, curr_offset)) {
-            error("failed to write: %s", strerror(errno));
-            return -1;
+        if (f->mode & O_RDWR) {
+            if (!raw_pwrite(f->fd, data, FEC_BLOCKSIZE, curr_offset)) {
+                error("failed to write: %s", strerror(errno));
+                return -1;
+            }
+
+            set_verified(f, curr);
         }
 
 valid:
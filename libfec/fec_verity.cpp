@@ -121,7 +121,7 @@ uint64_t verity_get_size(uint64_t file_size, uint32_t *verity_levels,
     return total * FEC_BLOCKSIZE;
 }
 
-int hashtree_info::get_hash(const uint8_t *block, uint8_t *hash) {
+int hashtree_info::get_hash(const uint8_t *block, uint8_t *hash) const {
     auto md = EVP_get_digestbynid(nid_);
     check(md);
     auto mdctx = EVP_MD_CTX_new();
@@ -155,7 +155,7 @@ int hashtree_info::initialize(uint64_t hash_start, uint64_t data_blocks,
 }
 
 bool hashtree_info::check_block_hash(const uint8_t *expected,
-                                     const uint8_t *block) {
+                                     const uint8_t *block) const {
     check(block);
     std::vector<uint8_t> hash(digest_length_, 0);
 
@@ -169,7 +169,7 @@ bool hashtree_info::check_block_hash(const uint8_t *expected,
 }
 
 bool hashtree_info::check_block_hash_with_index(uint64_t index,
-                                                const uint8_t *block) {
+                                                const uint8_t *block) const {
     check(index < data_blocks);
 
     const uint8_t *expected = &hash_data[index * padded_digest_length_];
@@ -624,6 +624,62 @@ int verity_parse_header(fec_handle *f, uint64_t offset)
     return 0;
 }
 
+/* allocates the verified block bitmap if `f->flags' has `FEC_VERIFIED_CACHE'
+   set and a hash tree was loaded */
+int verity_init_verified(fec_handle *f)
+{
+    check(f);
+
+    const hashtree_info &hashtree = f->hashtree();
+
+    if (!(f->flags & FEC_VERIFIED_CACHE) || hashtree.hash_data.empty()) {
+        return 0;
+    }
+
+    uint64_t words = fec_div_round_up(hashtree.data_blocks, 64);
+
+    f->verified.reset(new (std::nothrow) std::atomic<uint64_t>[words]());
+
+    if (unlikely(!f->verified)) {
+        error("failed to allocate verified block bitmap");
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+/* forgets that blocks in [`offset', `offset' + `count') have been verified,
+   so that they are hashed again on the next read */
+int fec_invalidate_verified(struct fec_handle *f, uint64_t offset,
+        uint64_t count)
+{
+    check(f);
+
+    if (!f->verified || count == 0) {
+        return 0;
+    }
+
+    if (unlikely(offset > UINT64_MAX - count)) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    uint64_t first = offset / FEC_BLOCKSIZE;
+    uint64_t last = (offset + count - 1) / FEC_BLOCKSIZE;
+
+    if (last >= f->hashtree().data_blocks) {
+        last = f->hashtree().data_blocks - 1;
+    }
+
+    for (uint64_t n = first; n <= last; ++n) {
+        f->verified[n / 64].fetch_and(~(1ULL << (n % 64)),
+                                      std::memory_order_relaxed);
+    }
+
+    return 0;
+}
+
 int fec_verity_set_status(struct fec_handle *f, bool enabled)
 {
     check(f);
@@ -58,6 +58,8 @@ struct fec_status {
     uint64_t errors;
     uint64_t data_size;
     uint64_t size;
+    uint64_t verified_hits; /* blocks read without hashing them again */
+    uint64_t verified_misses; /* blocks hashed with FEC_VERIFIED_CACHE set */
 };
 
 struct fec_ecc_metadata {
@@ -81,7 +83,10 @@ struct fec_verity_metadata {
 enum {
     FEC_FS_EXT4 = 1 << 0,
     FEC_FS_SQUASH = 1 << 1,
-    FEC_VERITY_DISABLE = 1 << 8
+    FEC_VERITY_DISABLE = 1 << 8,
+    /* remember which blocks have been verified and skip hashing them again;
+       call fec_invalidate_verified after modifying data blocks */
+    FEC_VERIFIED_CACHE = 1 << 9
 };
 
 struct fec_handle;
@@ -102,6 +107,9 @@ extern int fec_ecc_get_metadata(struct fec_handle *f,
 
 extern int fec_get_status(struct fec_handle *f, struct fec_status *s);
 
+extern int fec_invalidate_verified(struct fec_handle *f, uint64_t offset,
+        uint64_t count);
+
 extern int fec_seek(struct fec_handle *f, int64_t offset, int whence);
 
 extern ssize_t fec_read(struct fec_handle *f, void *buf, size_t count);
@@ -163,6 +171,10 @@ namespace fec {
             return !fec_get_status(handle_.get(), &status);
         }
 
+        bool invalidate_verified(uint64_t offset, uint64_t count) {
+            return !fec_invalidate_verified(handle_.get(), offset, count);
+        }
+
         bool get_verity_metadata(fec_verity_metadata& data) {
             return !fec_verity_get_metadata(handle_.get(), &data);
         }
@@ -227,6 +227,88 @@ TEST_F(FecUnitTest, VerityImage_FecRead) {
     ASSERT_EQ(53388, fec_pread(handle, large_data.data(), 53388, 385132));
 }
 
+TEST_F(FecUnitTest, VerityImage_FecReadLarge) {
+    TemporaryFile verity_image;
+    BuildAndAppendsVerityMetadata();
+    std::vector<uint8_t> expected(image_.begin(), image_.begin() + 1024 * 1024);
+    ASSERT_TRUE(android::base::WriteFully(verity_image.fd, image_.data(),
+                                          image_.size()));
+    TemporaryFile ecc_image;
+    BuildAndAppendsEccImage(verity_image.path, ecc_image.path);
+    std::string ecc_content;
+    ASSERT_TRUE(android::base::ReadFileToString(ecc_image.path, &ecc_content));
+    ASSERT_TRUE(android::base::WriteStringToFd(ecc_content, verity_image.fd));
+
+    // Corrupt a block in the middle of a batched read.
+    uint64_t corrupt_offset = 4096 * 100;
+    ASSERT_EQ(corrupt_offset, lseek64(verity_image.fd, corrupt_offset, 0));
+    std::vector<uint8_t> corruption(100, 10);
+    ASSERT_TRUE(android::base::WriteFully(verity_image.fd, corruption.data(),
+                                          corruption.size()));
+
+    struct fec_handle *handle = nullptr;
+    ASSERT_EQ(0,
+              fec_open(&handle, verity_image.path, O_RDONLY, FEC_FS_EXT4, 2));
+    std::unique_ptr<fec_handle> guard(handle);
+
+    // Reads large enough to be split between threads, and reads that span
+    // more blocks than a single pread.
+    std::vector<uint8_t> read_data(expected.size(), 0);
+    for (auto [offset, size] : std::vector<std::pair<size_t, size_t>>{
+             {0, 1024 * 1024}, {123, 1024 * 1024 - 123}, {4096 * 30, 4096 * 100},
+             {4097, 4096 * 65 + 17}, {4096 * 99 + 1, 4096 * 2}}) {
+        ASSERT_EQ(static_cast<ssize_t>(size),
+                  fec_pread(handle, read_data.data(), size, offset));
+        ASSERT_EQ(std::vector<uint8_t>(expected.begin() + offset,
+                                       expected.begin() + offset + size),
+                  std::vector<uint8_t>(read_data.begin(),
+                                       read_data.begin() + size));
+    }
+}
+
+TEST_F(FecUnitTest, VerityImage_VerifiedCache) {
+    TemporaryFile verity_image;
+    BuildAndAppendsVerityMetadata();
+    ASSERT_TRUE(android::base::WriteFully(verity_image.fd, image_.data(),
+                                          image_.size()));
+
+    struct fec_handle *handle = nullptr;
+    ASSERT_EQ(0, fec_open(&handle, verity_image.path, O_RDONLY,
+                          FEC_FS_EXT4 | FEC_VERIFIED_CACHE, 2));
+    std::unique_ptr<fec_handle> guard(handle);
+
+    // Block 0 is expected to contain zeros and isn't read, so read the
+    // other 255 blocks twice.
+    std::vector<uint8_t> read_data(4096 * 255, 0);
+    fec_status status;
+    ASSERT_EQ(4096 * 255, fec_pread(handle, read_data.data(), 4096 * 255, 4096));
+    ASSERT_EQ(0, fec_get_status(handle, &status));
+    ASSERT_EQ(0u, status.verified_hits);
+    ASSERT_EQ(255u, status.verified_misses);
+
+    ASSERT_EQ(4096 * 255, fec_pread(handle, read_data.data(), 4096 * 255, 4096));
+    ASSERT_EQ(std::vector<uint8_t>(image_.begin() + 4096,
+                                   image_.begin() + 4096 * 256),
+              read_data);
+    ASSERT_EQ(0, fec_get_status(handle, &status));
+    ASSERT_EQ(255u, status.verified_hits);
+    ASSERT_EQ(255u, status.verified_misses);
+
+    // Blocks modified after they have been verified are hashed again once
+    // invalidated. There are no error-correcting codes, so the read fails.
+    uint64_t corrupt_offset = 4096 * 10;
+    ASSERT_EQ(corrupt_offset, lseek64(verity_image.fd, corrupt_offset, 0));
+    std::vector<uint8_t> corruption(50, 99);
+    ASSERT_TRUE(android::base::WriteFully(verity_image.fd, corruption.data(),
+                                          corruption.size()));
+    ASSERT_EQ(0, fec_invalidate_verified(handle, corrupt_offset, 50));
+    ASSERT_EQ(-1, fec_pread(handle, read_data.data(), 4096, corrupt_offset));
+    ASSERT_EQ(4096, fec_pread(handle, read_data.data(), 4096, 4096 * 11));
+    ASSERT_EQ(0, fec_get_status(handle, &status));
+    ASSERT_EQ(256u, status.verified_hits);
+    ASSERT_EQ(256u, status.verified_misses);
+}
+
 TEST_F(FecUnitTest, LoadAvbImage_HashtreeFooter) {
     TemporaryFile avb_image;
     ASSERT_TRUE(
@@ -308,3 +390,35 @@ TEST_F(FecUnitTest, AvbImage_FecRead) {
     ASSERT_EQ(1024, fec_pread(handle, read_data.data(), 1024, corrupt_offset));
     ASSERT_EQ(std::vector<uint8_t>(1024, 10), read_data);
 }
+
+TEST_F(FecUnitTest, EncodeWithMemoryLimit) {
+    TemporaryFile input_image;
+    ASSERT_TRUE(android::base::WriteFully(input_image.fd, image_.data(),
+                                          image_.size()));
+    TemporaryFile ecc_image;
+    BuildAndAppendsEccImage(input_image.path, ecc_image.path);
+    std::string expected_ecc;
+    ASSERT_TRUE(android::base::ReadFileToString(ecc_image.path, &expected_ecc));
+
+    // With the minimum limit of 255 * 4096 bytes, the input is encoded in two
+    // windows. The output should be the same as encoding in memory.
+    for (const char *memory_limit : {"1044480", "16777216"}) {
+        TemporaryFile stream_ecc_image;
+        std::vector<std::string> cmd = {
+            "fec", "--encode", "--roots", "2", "--memory-limit", memory_limit,
+            input_image.path, stream_ecc_image.path,
+        };
+        ASSERT_EQ(0, std::system(android::base::Join(cmd, ' ').c_str()));
+        std::string ecc;
+        ASSERT_TRUE(
+            android::base::ReadFileToString(stream_ecc_image.path, &ecc));
+        ASSERT_EQ(expected_ecc, ecc);
+    }
+
+    // The limit is too small to hold one window.
+    std::vector<std::string> cmd = {
+        "fec", "--encode", "--memory-limit", "4096", input_image.path,
+        ecc_image.path,
+    };
+    ASSERT_NE(0, std::system(android::base::Join(cmd, ' ').c_str()));
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CallChainDictionary.h"
+
+#include <string.h>
+
+#include <android-base/logging.h>
+
+#include "utils.h"
+
+namespace simpleperf {
+
+// Each node in the feature section takes a uint64_t ip and a uint32_t parent id.
+static constexpr size_t kNodeBinarySize = sizeof(uint64_t) + sizeof(uint32_t);
+
+CallChainDictionary::CallChainDictionary() {
+  nodes_.push_back(Node{0, kRootNodeId, 0});
+}
+
+bool CallChainDictionary::Intern(const uint64_t* ips, size_t ip_nr, uint32_t* node_id) {
+  uint32_t parent = kRootNodeId;
+  // Intern from the outermost caller, so callchains sharing callers share nodes.
+  for (size_t i = ip_nr; i > 0; i--) {
+    NodeKey key{ips[i - 1], parent};
+    auto it = node_map_.find(key);
+    if (it != node_map_.end()) {
+      parent = it->second;
+      continue;
+    }
+    if (nodes_.size() == UINT32_MAX) {
+      return false;
+    }
+    uint32_t id = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(Node{key.ip, parent, nodes_[parent].depth + 1});
+    node_map_.emplace(key, id);
+    parent = id;
+  }
+  *node_id = parent;
+  return true;
+}
+
+bool CallChainDictionary::EncodeSample(SampleRecord& r) {
+  if ((r.sample_type & PERF_SAMPLE_CALLCHAIN) == 0 || r.callchain_data.ip_nr == 0) {
+    return false;
+  }
+  uint32_t node_id;
+  if (!Intern(r.callchain_data.ips, r.callchain_data.ip_nr, &node_id)) {
+    return false;
+  }
+  r.ReplaceCallChain({PERF_CONTEXT_CALLCHAIN_NODE, node_id});
+  return true;
+}
+
+bool CallChainDictionary::GetEncodedNodeId(const SampleRecord& r, uint32_t* node_id) {
+  if ((r.sample_type & PERF_SAMPLE_CALLCHAIN) == 0 || r.callchain_data.ip_nr != 2 ||
+      r.callchain_data.ips[0] != PERF_CONTEXT_CALLCHAIN_NODE) {
+    return false;
+  }
+  *node_id = static_cast<uint32_t>(r.callchain_data.ips[1]);
+  return true;
+}
+
+bool CallChainDictionary::DecodeSample(SampleRecord& r) const {
+  uint32_t node_id;
+  if (!GetEncodedNodeId(r, &node_id)) {
+    return true;
+  }
+  std::vector<uint64_t> ips;
+  if (!GetCallChain(node_id, &ips)) {
+    return false;
+  }
+  r.ReplaceCallChain(ips);
+  return true;
+}
+
+bool CallChainDictionary::GetCallChain(uint32_t node_id, std::vector<uint64_t>* ips) const {
+  if (!IsValidNode(node_id)) {
+    LOG(ERROR) << "invalid callchain node id " << node_id;
+    return false;
+  }
+  ips->clear();
+  ips->reserve(nodes_[node_id].depth);
+  while (node_id != kRootNodeId) {
+    ips->push_back(nodes_[node_id].ip);
+    node_id = nodes_[node_id].parent;
+  }
+  return true;
+}
+
+std::vector<char> CallChainDictionary::ToBinary() const {
+  uint64_t node_count = nodes_.size() - 1;
+  std::vector<char> data(sizeof(uint64_t) + node_count * kNodeBinarySize);
+  char* p = data.data();
+  MoveToBinaryFormat(node_count, p);
+  for (size_t i = 1; i < nodes_.size(); i++) {
+    MoveToBinaryFormat(nodes_[i].ip, p);
+    MoveToBinaryFormat(nodes_[i].parent, p);
+  }
+  return data;
+}
+
+bool CallChainDictionary::FromBinary(const char* data, size_t size) {
+  const char* end = data + size;
+  uint64_t node_count;
+  if (size < sizeof(uint64_t)) {
+    LOG(ERROR) << "invalid callchain_nodes feature section";
+    return false;
+  }
+  MoveFromBinaryFormat(node_count, data);
+  if (node_count > (end - data) / kNodeBinarySize || node_count >= UINT32_MAX) {
+    LOG(ERROR) << "invalid callchain_nodes feature section";
+    return false;
+  }
+  nodes_.resize(1);
+  node_map_.clear();
+  nodes_.reserve(node_count + 1);
+  node_map_.reserve(node_count);
+  for (uint64_t i = 1; i <= node_count; i++) {
+    NodeKey key;
+    MoveFromBinaryFormat(key.ip, data);
+    MoveFromBinaryFormat(key.parent, data);
+    if (key.parent >= i) {
+      LOG(ERROR) << "invalid parent in callchain node " << i;
+      nodes_.resize(1);
+      node_map_.clear();
+      return false;
+    }
+    nodes_.push_back(Node{key.ip, key.parent, nodes_[key.parent].depth + 1});
+    node_map_.emplace(key, static_cast<uint32_t>(i));
+  }
+  return true;
+}
+
+}  // namespace simpleperf
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "record.h"
+
+namespace simpleperf {
+
+// A context value not used by the kernel. It marks a sample whose callchain is replaced by the id
+// of its leaf node in a CallChainDictionary.
+constexpr uint64_t PERF_CONTEXT_CALLCHAIN_NODE = static_cast<uint64_t>(-3072);
+
+// Samples recorded with call graphs repeat the same callers again and again. CallChainDictionary
+// interns callchains into a tree of nodes. Each node has an ip and the id of its parent node,
+// which is the next frame toward the outermost caller. Node 0 is the root, representing an empty
+// callchain. So a callchain can be stored as the id of its leaf node, and callchains sharing
+// callers share nodes. `simpleperf record --intern-callchains` stores the dictionary in the
+// callchain_nodes feature section.
+class CallChainDictionary {
+ public:
+  static constexpr uint32_t kRootNodeId = 0;
+
+  CallChainDictionary();
+
+  // Return the id of the leaf node of a callchain. ips[0] is the leaf. Return false if there are
+  // too many nodes.
+  bool Intern(const uint64_t* ips, size_t ip_nr, uint32_t* node_id);
+  // Replace the callchain of r with {PERF_CONTEXT_CALLCHAIN_NODE, leaf_node_id}.
+  bool EncodeSample(SampleRecord& r);
+  // Restore the callchain of r if it is encoded.
+  bool DecodeSample(SampleRecord& r) const;
+  static bool GetEncodedNodeId(const SampleRecord& r, uint32_t* node_id);
+
+  // Return the ips from node_id up to the root.
+  bool GetCallChain(uint32_t node_id, std::vector<uint64_t>* ips) const;
+  size_t NodeCount() const { return nodes_.size(); }
+  bool IsValidNode(uint32_t node_id) const { return node_id < nodes_.size(); }
+  uint64_t GetIp(uint32_t node_id) const { return nodes_[node_id].ip; }
+  uint32_t GetParent(uint32_t node_id) const { return nodes_[node_id].parent; }
+  uint32_t GetDepth(uint32_t node_id) const { return nodes_[node_id].depth; }
+
+  // Binary format is described in the callchain_nodes feature section of record_file_format.h.
+  std::vector<char> ToBinary() const;
+  bool FromBinary(const char* data, size_t size);
+
+ private:
+  struct Node {
+    uint64_t ip;
+    uint32_t parent;
+    uint32_t depth;
+  };
+
+  struct NodeKey {
+    uint64_t ip;
+    uint32_t parent;
+
+    bool operator==(const NodeKey& other) const {
+      return ip == other.ip && parent == other.parent;
+    }
+  };
+
+  struct NodeKeyHash {
+    size_t operator()(const NodeKey& key) const {
+      return std::hash<uint64_t>()(key.ip ^ (static_cast<uint64_t>(key.parent) << 40));
+    }
+  };
+
+  std::vector<Node> nodes_;
+  std::unordered_map<NodeKey, uint32_t, NodeKeyHash> node_map_;
+};
+
+}  // namespace simpleperf
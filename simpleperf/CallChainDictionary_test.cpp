@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CallChainDictionary.h"
+
+#include <gtest/gtest.h>
+
+#include "record_equal_test.h"
+
+using namespace simpleperf;
+
+TEST(CallChainDictionary, intern) {
+  CallChainDictionary dict;
+  ASSERT_EQ(dict.NodeCount(), 1u);
+  std::vector<uint64_t> ips1 = {3, 2, 1};
+  std::vector<uint64_t> ips2 = {4, 2, 1};
+  uint32_t id1;
+  uint32_t id2;
+  uint32_t id3;
+  ASSERT_TRUE(dict.Intern(ips1.data(), ips1.size(), &id1));
+  ASSERT_TRUE(dict.Intern(ips2.data(), ips2.size(), &id2));
+  ASSERT_TRUE(dict.Intern(ips1.data(), ips1.size(), &id3));
+  // Callers 1 and 2 are shared.
+  ASSERT_EQ(dict.NodeCount(), 5u);
+  ASSERT_NE(id1, id2);
+  ASSERT_EQ(id1, id3);
+  ASSERT_EQ(dict.GetParent(id1), dict.GetParent(id2));
+  ASSERT_EQ(dict.GetDepth(id1), 3u);
+
+  std::vector<uint64_t> ips;
+  ASSERT_TRUE(dict.GetCallChain(id1, &ips));
+  ASSERT_EQ(ips, ips1);
+  ASSERT_TRUE(dict.GetCallChain(id2, &ips));
+  ASSERT_EQ(ips, ips2);
+  ASSERT_TRUE(dict.GetCallChain(CallChainDictionary::kRootNodeId, &ips));
+  ASSERT_TRUE(ips.empty());
+  ASSERT_FALSE(dict.GetCallChain(100, &ips));
+}
+
+TEST(CallChainDictionary, encode_and_decode_sample) {
+  perf_event_attr attr = {};
+  attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+  std::vector<uint64_t> ips = {PERF_CONTEXT_KERNEL, 1, PERF_CONTEXT_USER, 2, 3};
+  SampleRecord r(attr, 0, 1, 2, 3, 0, 0, 0, {}, ips, {}, 0);
+  SampleRecord expected(attr, 0, 1, 2, 3, 0, 0, 0, {}, ips, {}, 0);
+
+  CallChainDictionary dict;
+  ASSERT_TRUE(dict.EncodeSample(r));
+  uint32_t node_id;
+  ASSERT_TRUE(CallChainDictionary::GetEncodedNodeId(r, &node_id));
+  ASSERT_EQ(r.callchain_data.ip_nr, 2u);
+
+  // Decode the sample with a dictionary read from binary.
+  std::vector<char> data = dict.ToBinary();
+  CallChainDictionary dict2;
+  ASSERT_TRUE(dict2.FromBinary(data.data(), data.size()));
+  ASSERT_EQ(dict2.NodeCount(), dict.NodeCount());
+  ASSERT_TRUE(dict2.DecodeSample(r));
+  CheckRecordEqual(r, expected);
+  ASSERT_FALSE(CallChainDictionary::GetEncodedNodeId(r, &node_id));
+  // A sample not encoded isn't changed.
+  ASSERT_TRUE(dict2.DecodeSample(r));
+  CheckRecordEqual(r, expected);
+}
+
+TEST(CallChainDictionary, invalid_binary) {
+  CallChainDictionary dict;
+  std::vector<uint64_t> ips = {2, 1};
+  uint32_t node_id;
+  ASSERT_TRUE(dict.Intern(ips.data(), ips.size(), &node_id));
+  std::vector<char> data = dict.ToBinary();
+
+  CallChainDictionary dict2;
+  ASSERT_FALSE(dict2.FromBinary(data.data(), data.size() - 1));
+  // Make the parent of node 1 point to itself.
+  data[sizeof(uint64_t) * 2] = 1;
+  ASSERT_FALSE(dict2.FromBinary(data.data(), data.size()));
+  ASSERT_EQ(dict2.NodeCount(), 1u);
+}
@@ -16,6 +16,12 @@
 
 #include "ETMBranchListFile.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include "ETMDecoder.h"
 #include "system/extras/simpleperf/etm_branch_list.pb.h"
 
@@ -380,6 +386,188 @@ std::unique_ptr<ETMBranchListGenerator> ETMBranchListGenerator::Create(bool dump
       new ETMBranchListGeneratorImpl(dump_maps_from_proc));
 }
 
+// Run an ETMBranchListGenerator on a separate thread, so decoding ETM data doesn't block reading
+// records from kernel buffers.
+class ETMDecodeThreadGenerator : public ETMBranchListGenerator {
+ public:
+  ETMDecodeThreadGenerator(std::unique_ptr<ETMBranchListGenerator> generator,
+                           const perf_event_attr& attr, size_t max_queue_size)
+      : generator_(std::move(generator)), attr_(attr), max_queue_size_(max_queue_size) {
+    decode_thread_ = std::thread([this]() { DecodeThreadMain(); });
+  }
+
+  ~ETMDecodeThreadGenerator() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    queue_cond_.notify_one();
+    decode_thread_.join();
+  }
+
+  // The wrapped generator is only used by the decode thread when it is processing records. So
+  // wait for the decode thread to be idle before accessing it.
+  void SetExcludePid(pid_t pid) override {
+    WaitForIdle();
+    generator_->SetExcludePid(pid);
+  }
+
+  void SetBinaryFilter(const RegEx* binary_name_regex) override {
+    WaitForIdle();
+    generator_->SetBinaryFilter(binary_name_regex);
+  }
+
+  bool ProcessRecord(const Record& r, bool& consumed) override;
+
+  bool Finish() override { return WaitForIdle(); }
+
+  BranchListBinaryMap GetBranchListBinaryMap() override {
+    WaitForIdle();
+    return generator_->GetBranchListBinaryMap();
+  }
+
+  const ETMDecodeQueueStat* GetDecodeQueueStat() const override { return &stat_; }
+
+ private:
+  struct QueueEntry {
+    std::unique_ptr<Record> record;
+    size_t size;
+  };
+
+  std::unique_ptr<Record> CopyRecord(const Record& r, size_t& size);
+  bool WaitForIdle();
+  void DecodeThreadMain();
+
+  std::unique_ptr<ETMBranchListGenerator> generator_;
+  const perf_event_attr attr_;
+  const size_t max_queue_size_;
+  std::thread decode_thread_;
+
+  std::mutex mutex_;
+  // Notified when a record is added to the queue, or when stopping the decode thread.
+  std::condition_variable queue_cond_;
+  // Notified when the decode thread finishes processing a record.
+  std::condition_variable done_cond_;
+  std::deque<QueueEntry> queue_;
+  size_t queue_size_ = 0;
+  bool decoding_ = false;
+  bool failed_ = false;
+  bool stop_ = false;
+
+  // Only accessed by the record thread.
+  ETMDecodeQueueStat stat_;
+};
+
+bool ETMDecodeThreadGenerator::ProcessRecord(const Record& r, bool& consumed) {
+  consumed = true;  // No need to store any records.
+  if (r.type() == PERF_RECORD_SAMPLE) {
+    // Samples don't change the thread tree or ETM data.
+    return true;
+  }
+  size_t size;
+  std::unique_ptr<Record> copy = CopyRecord(r, size);
+  if (!copy) {
+    return false;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto has_room = [&]() {
+    return failed_ || queue_.empty() || queue_size_ + size <= max_queue_size_;
+  };
+  if (!has_room()) {
+    stat_.blocked_count++;
+    auto start_time = std::chrono::steady_clock::now();
+    done_cond_.wait(lock, has_room);
+    stat_.blocked_time_in_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - start_time)
+                                    .count();
+  }
+  if (failed_) {
+    return false;
+  }
+  queue_.push_back(QueueEntry{std::move(copy), size});
+  queue_size_ += size;
+  stat_.max_queue_size = std::max<uint64_t>(stat_.max_queue_size, queue_size_);
+  lock.unlock();
+  queue_cond_.notify_one();
+
+  stat_.record_count++;
+  if (r.type() == PERF_RECORD_AUXTRACE) {
+    stat_.aux_data_size += static_cast<const AuxTraceRecord*>(&r)->data->aux_size;
+  }
+  return true;
+}
+
+// Records passed to ProcessRecord() don't own their buffers. So copy them, including aux data
+// following AuxTraceRecords.
+std::unique_ptr<Record> ETMDecodeThreadGenerator::CopyRecord(const Record& r, size_t& size) {
+  size_t aux_size = 0;
+  if (r.type() == PERF_RECORD_AUXTRACE) {
+    auto& auxtrace = *static_cast<const AuxTraceRecord*>(&r);
+    CHECK(auxtrace.location.addr != nullptr);
+    aux_size = auxtrace.data->aux_size;
+  }
+  size = r.size() + aux_size;
+  char* buf = new char[size];
+  memcpy(buf, r.Binary(), r.size());
+  if (aux_size != 0) {
+    memcpy(buf + r.size(), static_cast<const AuxTraceRecord*>(&r)->location.addr, aux_size);
+  }
+  std::unique_ptr<Record> copy = ReadRecordFromBuffer(attr_, buf, buf + r.size());
+  if (!copy) {
+    delete[] buf;
+    return nullptr;
+  }
+  copy->OwnBinary();
+  if (aux_size != 0) {
+    static_cast<AuxTraceRecord*>(copy.get())->location.addr = buf + r.size();
+  }
+  return copy;
+}
+
+bool ETMDecodeThreadGenerator::WaitForIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cond_.wait(lock, [&]() { return queue_.empty() && !decoding_; });
+  return !failed_;
+}
+
+void ETMDecodeThreadGenerator::DecodeThreadMain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    queue_cond_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      break;
+    }
+    QueueEntry entry = std::move(queue_.front());
+    queue_.pop_front();
+    decoding_ = true;
+    lock.unlock();
+
+    bool consumed;
+    bool result = generator_->ProcessRecord(*entry.record, consumed);
+    entry.record.reset();
+
+    lock.lock();
+    decoding_ = false;
+    queue_size_ -= entry.size;
+    if (!result) {
+      failed_ = true;
+      // Drop remaining records, the record thread stops when seeing the failure.
+      for (auto& e : queue_) {
+        queue_size_ -= e.size;
+      }
+      queue_.clear();
+    }
+    done_cond_.notify_all();
+  }
+}
+
+std::unique_ptr<ETMBranchListGenerator> ETMBranchListGenerator::CreateWithDecodeThread(
+    std::unique_ptr<ETMBranchListGenerator> generator, const perf_event_attr& attr,
+    size_t max_queue_size) {
+  return std::unique_ptr<ETMBranchListGenerator>(
+      new ETMDecodeThreadGenerator(std::move(generator), attr, max_queue_size));
+}
+
 ETMBranchListGenerator::~ETMBranchListGenerator() {}
 
 }  // namespace simpleperf
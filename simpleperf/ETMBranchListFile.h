@@ -133,16 +133,37 @@ class BinaryFilter {
   std::unordered_map<Dso*, bool> dso_filter_cache_;
 };
 
+// Statistics of the queue used to pass records to the ETM decode thread.
+struct ETMDecodeQueueStat {
+  uint64_t record_count = 0;
+  uint64_t aux_data_size = 0;
+  // Max bytes of records waiting in the queue.
+  uint64_t max_queue_size = 0;
+  // How many times and how long the record thread waited for a full queue.
+  uint64_t blocked_count = 0;
+  uint64_t blocked_time_in_ns = 0;
+};
+
 // Convert ETM data into branch lists while recording.
 class ETMBranchListGenerator {
  public:
   static std::unique_ptr<ETMBranchListGenerator> Create(bool dump_maps_from_proc);
+  // Return a generator running `generator` on a separate decode thread. Records are copied into a
+  // queue of at most max_queue_size bytes, and are processed in order. So the thread tree used
+  // to decode each AUX chunk is in the same state as decoding inline. When the queue is full,
+  // ProcessRecord() waits instead of dropping data.
+  static std::unique_ptr<ETMBranchListGenerator> CreateWithDecodeThread(
+      std::unique_ptr<ETMBranchListGenerator> generator, const perf_event_attr& attr,
+      size_t max_queue_size);
 
   virtual ~ETMBranchListGenerator();
   virtual void SetExcludePid(pid_t pid) = 0;
   virtual void SetBinaryFilter(const RegEx* binary_name_regex) = 0;
   virtual bool ProcessRecord(const Record& r, bool& consumed) = 0;
+  // Wait until all records passed to ProcessRecord() are processed.
+  virtual bool Finish() { return true; }
   virtual BranchListBinaryMap GetBranchListBinaryMap() = 0;
+  virtual const ETMDecodeQueueStat* GetDecodeQueueStat() const { return nullptr; }
 };
 
 // for testing
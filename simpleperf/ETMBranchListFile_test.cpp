@@ -17,6 +17,8 @@
 #include <gtest/gtest.h>
 
 #include "ETMBranchListFile.h"
+#include "event_attr.h"
+#include "event_type.h"
 
 using namespace simpleperf;
 
@@ -33,3 +35,66 @@ TEST(ETMBranchListFile, branch_to_proto_string) {
     ASSERT_EQ(branch, branch2);
   }
 }
+
+namespace {
+
+// Save a summary of each processed record, to check the decode thread processes copies of
+// records in order.
+class FakeETMBranchListGenerator : public ETMBranchListGenerator {
+ public:
+  FakeETMBranchListGenerator(std::vector<std::string>& processed) : processed_(processed) {}
+  void SetExcludePid(pid_t) override {}
+  void SetBinaryFilter(const RegEx*) override {}
+
+  bool ProcessRecord(const Record& r, bool& consumed) override {
+    consumed = true;
+    if (r.type() == PERF_RECORD_COMM) {
+      processed_.push_back(std::string("comm ") + static_cast<const CommRecord*>(&r)->comm);
+    } else if (r.type() == PERF_RECORD_AUXTRACE) {
+      auto& auxtrace = *static_cast<const AuxTraceRecord*>(&r);
+      processed_.push_back("auxtrace " +
+                           std::string(auxtrace.location.addr, auxtrace.data->aux_size));
+    }
+    return true;
+  }
+
+  BranchListBinaryMap GetBranchListBinaryMap() override { return {}; }
+
+ private:
+  std::vector<std::string>& processed_;
+};
+
+}  // namespace
+
+TEST(ETMBranchListFile, decode_thread) {
+  const EventType* type = FindEventTypeByName("cpu-clock");
+  ASSERT_TRUE(type != nullptr);
+  perf_event_attr attr = CreateDefaultPerfEventAttr(*type);
+  attr.sample_id_all = 1;
+  std::vector<std::string> processed;
+  std::vector<std::string> expected;
+  // Use a tiny queue to make the record thread wait for decoding.
+  auto generator = ETMBranchListGenerator::CreateWithDecodeThread(
+      std::make_unique<FakeETMBranchListGenerator>(processed), attr, 1);
+  for (int i = 0; i < 100; i++) {
+    bool consumed = false;
+    std::string name = "t" + std::to_string(i);
+    CommRecord comm_r(attr, 1, 1, name, 0, 0);
+    ASSERT_TRUE(generator->ProcessRecord(comm_r, consumed));
+    ASSERT_TRUE(consumed);
+    expected.push_back("comm " + name);
+
+    std::string data = "data" + std::to_string(i);
+    AuxTraceRecord auxtrace_r(data.size(), 0, 0, 1, 0);
+    auxtrace_r.location.addr = data.data();
+    ASSERT_TRUE(generator->ProcessRecord(auxtrace_r, consumed));
+    expected.push_back("auxtrace " + data);
+    // The record buffers can be reused after ProcessRecord() returns.
+    data.assign(data.size(), 'x');
+  }
+  ASSERT_TRUE(generator->Finish());
+  ASSERT_EQ(processed, expected);
+  const ETMDecodeQueueStat* stat = generator->GetDecodeQueueStat();
+  ASSERT_TRUE(stat != nullptr);
+  ASSERT_EQ(stat->record_count, 200u);
+}
@@ -16,7 +16,9 @@
 
 #include "ETMDecoder.h"
 
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 #include <android-base/expected.h>
 #include <android-base/logging.h>
@@ -849,11 +851,19 @@ std::unique_ptr<ETMDecoder> ETMDecoder::Create(const AuxTraceInfoRecord& auxtrac
 }
 
 // Use OpenCSD instruction decoder to convert branches to instruction addresses.
+// Branch lists of a binary usually go through the same basic blocks many times. So the result of
+// decoding a basic block (from its start address to the first branch instruction) is cached.
 class BranchDecoder {
  public:
   android::base::expected<void, std::string> Init(Dso* dso) {
     ElfStatus status;
-    elf_ = ElfFile::Open(dso->GetDebugFilePath(), &status);
+    {
+      // Binaries are decoded in parallel by `inject`. But opening ELF files in apks isn't thread
+      // safe.
+      static std::mutex open_elf_mutex;
+      std::lock_guard<std::mutex> lock(open_elf_mutex);
+      elf_ = ElfFile::Open(dso->GetDebugFilePath(), &status);
+    }
     if (!elf_) {
       std::stringstream ss;
       ss << status;
@@ -895,6 +905,35 @@ class BranchDecoder {
   }
 
   bool FindNextBranch() {
+    // Thumb instructions are 2-byte aligned, so bit 0 of the key is free to tell the isa.
+    uint64_t key = instr_info_.instr_addr | (instr_info_.isa == ocsd_isa_thumb2 ? 1 : 0);
+    auto it = basic_block_cache_.find(key);
+    if (it == basic_block_cache_.end()) {
+      it = basic_block_cache_.emplace(key, DecodeBasicBlock()).first;
+    } else {
+      const BasicBlock& block = it->second;
+      instr_info_.instr_addr = block.branch_instr_addr;
+      instr_info_.instr_size = block.branch_instr_size;
+      instr_info_.type = block.branch_type;
+      instr_info_.branch_addr = block.branch_addr;
+    }
+    return it->second.found_branch;
+  };
+
+  ocsd_instr_info& InstrInfo() { return instr_info_; }
+
+ private:
+  struct BasicBlock {
+    bool found_branch;
+    ocsd_instr_type branch_type;
+    uint32_t branch_instr_size;
+    uint64_t branch_instr_addr;
+    uint64_t branch_addr;
+  };
+
+  BasicBlock DecodeBasicBlock() {
+    BasicBlock block;
+    block.found_branch = false;
     // Loop until we find a branch instruction.
     while (ReadMem(instr_info_.instr_addr, 4, &instr_info_.opcode)) {
       ocsd_err_t err = instruction_decoder_.DecodeInstruction(&instr_info_);
@@ -902,32 +941,48 @@ class BranchDecoder {
         break;
       }
       if (instr_info_.type != OCSD_INSTR_OTHER) {
-        return true;
+        block.found_branch = true;
+        break;
       }
       instr_info_.instr_addr += instr_info_.instr_size;
     }
-    return false;
-  };
-
-  ocsd_instr_info& InstrInfo() { return instr_info_; }
+    block.branch_type = instr_info_.type;
+    block.branch_instr_size = instr_info_.instr_size;
+    block.branch_instr_addr = instr_info_.instr_addr;
+    block.branch_addr = instr_info_.branch_addr;
+    return block;
+  }
 
- private:
   bool ReadMem(uint64_t vaddr, size_t size, void* data) {
-    for (auto& segment : segments_) {
-      if (vaddr >= segment.vaddr && vaddr + size <= segment.vaddr + segment.file_size) {
-        uint64_t offset = vaddr - segment.vaddr + segment.file_offset;
-        memcpy(data, buffer_->getBufferStart() + offset, size);
+    // Instructions are read sequentially, so check the last used segment first.
+    if (ReadMemInSegment(segments_[last_segment_], vaddr, size, data)) {
+      return true;
+    }
+    for (size_t i = 0; i < segments_.size(); i++) {
+      if (ReadMemInSegment(segments_[i], vaddr, size, data)) {
+        last_segment_ = i;
         return true;
       }
     }
     return false;
   }
 
+  bool ReadMemInSegment(const ElfSegment& segment, uint64_t vaddr, size_t size, void* data) {
+    if (vaddr >= segment.vaddr && vaddr + size <= segment.vaddr + segment.file_size) {
+      uint64_t offset = vaddr - segment.vaddr + segment.file_offset;
+      memcpy(data, buffer_->getBufferStart() + offset, size);
+      return true;
+    }
+    return false;
+  }
+
   std::unique_ptr<ElfFile> elf_;
   std::vector<ElfSegment> segments_;
+  size_t last_segment_ = 0;
   llvm::MemoryBuffer* buffer_ = nullptr;
   ocsd_instr_info instr_info_;
   InstructionDecoder instruction_decoder_;
+  std::unordered_map<uint64_t, BasicBlock> basic_block_cache_;
 };
 
 android::base::expected<void, std::string> ConvertBranchMapToInstrRanges(
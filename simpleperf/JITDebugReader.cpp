@@ -683,20 +683,28 @@ TempSymFile* JITDebugReader::GetTempSymFile(Process& process, const CodeEntry& j
   }
   if (is_zygote) {
     if (!zygote_symfile_) {
-      std::string path = symfile_prefix_ + "_" + kJITZygoteCacheFile;
-      zygote_symfile_ =
-          TempSymFile::Create(std::move(path), symfile_option_ == SymFileOption::kDropSymFiles);
+      zygote_symfile_ = CreateTempSymFile(symfile_prefix_ + "_" + kJITZygoteCacheFile);
     }
     return zygote_symfile_.get();
   }
   if (!app_symfile_) {
-    std::string path = symfile_prefix_ + "_" + kJITAppCacheFile;
-    app_symfile_ =
-        TempSymFile::Create(std::move(path), symfile_option_ == SymFileOption::kDropSymFiles);
+    app_symfile_ = CreateTempSymFile(symfile_prefix_ + "_" + kJITAppCacheFile);
   }
   return app_symfile_.get();
 }
 
+std::unique_ptr<TempSymFile> JITDebugReader::CreateTempSymFile(const std::string& path) {
+  // Dropped symfiles are only used while recording, so keep them in memory. Kept symfiles are
+  // used after recording, so write them to disk.
+  if (symfile_option_ == SymFileOption::kDropSymFiles) {
+    if (auto symfile = TempSymFile::CreateInMemory(std::string(path)); symfile) {
+      return symfile;
+    }
+  }
+  return TempSymFile::Create(std::string(path),
+                             symfile_option_ == SymFileOption::kDropSymFiles);
+}
+
 void JITDebugReader::ReadDexFileDebugInfo(Process& process,
                                           const std::vector<CodeEntry>& dex_entries,
                                           std::vector<JITDebugInfo>* debug_info) {
@@ -21,6 +21,7 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <stack>
 #include <unordered_map>
@@ -134,6 +135,24 @@ class JITDebugReader {
            path.find(std::string("_") + kJITZygoteCacheFile + ":") != path.npos;
   }
 
+  // Symfiles kept in memory don't exist at their paths used in records. Instead, they are opened
+  // through /proc/self/fd paths registered here. An empty open_path removes the registration.
+  static void SetSymFileOpenPath(const std::string& path, const std::string& open_path) {
+    std::lock_guard<std::mutex> lock(symfile_open_paths_mutex_);
+    if (open_path.empty()) {
+      symfile_open_paths_.erase(path);
+    } else {
+      symfile_open_paths_[path] = open_path;
+    }
+  }
+
+  // Return the path to open a symfile. path shouldn't contain the location suffix.
+  static std::string GetSymFileOpenPath(const std::string& path) {
+    std::lock_guard<std::mutex> lock(symfile_open_paths_mutex_);
+    auto it = symfile_open_paths_.find(path);
+    return it != symfile_open_paths_.end() ? it->second : path;
+  }
+
  private:
   enum class DescriptorType {
     kDEX,
@@ -208,6 +227,7 @@ class JITDebugReader {
   bool ReadJITCodeDebugInfo(Process& process, const std::vector<CodeEntry>& jit_entries,
                             std::vector<JITDebugInfo>* debug_info);
   TempSymFile* GetTempSymFile(Process& process, const CodeEntry& jit_entry);
+  std::unique_ptr<TempSymFile> CreateTempSymFile(const std::string& path);
   void ReadDexFileDebugInfo(Process& process, const std::vector<CodeEntry>& dex_entries,
                             std::vector<JITDebugInfo>* debug_info);
   bool AddDebugInfo(const std::vector<JITDebugInfo>& debug_info, bool sync_kernel_records);
@@ -231,6 +251,9 @@ class JITDebugReader {
   // temporary files used to store jit symfiles created by the app process and the zygote process.
   std::unique_ptr<TempSymFile> app_symfile_;
   std::unique_ptr<TempSymFile> zygote_symfile_;
+
+  static inline std::mutex symfile_open_paths_mutex_;
+  static inline std::unordered_map<std::string, std::string> symfile_open_paths_;
 };
 
 }  // namespace simpleperf
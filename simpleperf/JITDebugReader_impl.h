@@ -16,13 +16,18 @@
 
 #pragma once
 
+#include <linux/memfd.h>
 #include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include <memory>
 #include <string>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 
+#include "JITDebugReader.h"
 #include "environment.h"
 
 namespace simpleperf {
@@ -45,6 +50,40 @@ class TempSymFile {
     return symfile;
   }
 
+  // Create a symfile in memory using memfd, to avoid file I/O while recording. It is opened
+  // through a /proc/self/fd path, see JITDebugReader::GetSymFileOpenPath(). Return nullptr if
+  // memfd isn't supported.
+  static std::unique_ptr<TempSymFile> CreateInMemory(std::string&& path) {
+#if defined(__NR_memfd_create)
+    int fd = syscall(__NR_memfd_create, android::base::Basename(path).c_str(), MFD_CLOEXEC);
+    if (fd == -1) {
+      PLOG(DEBUG) << "memfd_create() failed";
+      return nullptr;
+    }
+    FILE* fp = fdopen(fd, "w");
+    if (fp == nullptr) {
+      PLOG(ERROR) << "fdopen() failed";
+      close(fd);
+      return nullptr;
+    }
+    std::unique_ptr<TempSymFile> symfile(new TempSymFile(std::move(path), fp));
+    symfile->open_path_ = "/proc/self/fd/" + std::to_string(fd);
+    JITDebugReader::SetSymFileOpenPath(symfile->path_, symfile->open_path_);
+    if (!symfile->WriteHeader()) {
+      return nullptr;
+    }
+    return symfile;
+#else
+    return nullptr;
+#endif
+  }
+
+  ~TempSymFile() {
+    if (!open_path_.empty()) {
+      JITDebugReader::SetSymFileOpenPath(path_, "");
+    }
+  }
+
   bool WriteEntry(const char* data, size_t size) {
     if (fwrite(data, size, 1, fp_.get()) != 1) {
       PLOG(ERROR) << "failed to write to " << path_;
@@ -66,6 +105,7 @@ class TempSymFile {
     return true;
   }
 
+  // The path used in records to refer to the symfile.
   const std::string& GetPath() const { return path_; }
   uint64_t GetOffset() const { return file_offset_; }
 
@@ -84,6 +124,8 @@ class TempSymFile {
   }
 
   const std::string path_;
+  // Path to open the symfile, if it is kept in memory.
+  std::string open_path_;
   std::unique_ptr<FILE, decltype(&fclose)> fp_;
   uint64_t file_offset_ = 0;
   bool need_flush_ = false;
@@ -41,3 +41,26 @@ TEST(TempSymFile, smoke) {
   ASSERT_TRUE(android::base::ReadFullyAtOffset(tmpfile.fd, buf, test_data.size(), offset));
   ASSERT_EQ(strncmp(test_data.c_str(), buf, test_data.size()), 0);
 }
+
+TEST(TempSymFile, in_memory) {
+  const std::string path = "/data/local/tmp/test_jit_app_cache";
+  std::unique_ptr<TempSymFile> symfile = TempSymFile::CreateInMemory(std::string(path));
+  ASSERT_TRUE(symfile);
+  ASSERT_EQ(symfile->GetPath(), path);
+  std::string open_path = JITDebugReader::GetSymFileOpenPath(path);
+  ASSERT_NE(open_path, path);
+  uint64_t offset = symfile->GetOffset();
+  ASSERT_NE(offset, 0u);
+
+  // Write data and read it back through the open path.
+  const std::string test_data = "test_data";
+  ASSERT_TRUE(symfile->WriteEntry(test_data.c_str(), test_data.size()));
+  ASSERT_TRUE(symfile->Flush());
+  std::string content;
+  ASSERT_TRUE(android::base::ReadFileToString(open_path, &content));
+  ASSERT_EQ(content.substr(offset), test_data);
+
+  // The open path is unregistered when the symfile is destroyed.
+  symfile.reset();
+  ASSERT_EQ(JITDebugReader::GetSymFileOpenPath(path), path);
+}
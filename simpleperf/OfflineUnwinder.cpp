@@ -204,7 +204,7 @@ static std::shared_ptr<unwindstack::MapInfo> CreateMapInfo(const MapEntry* entry
     if (JITDebugReader::IsPathInJITSymFile(path)) {
       size_t colon_pos = path.rfind(':');
       CHECK_NE(colon_pos, std::string::npos);
-      name_holder = path.substr(0, colon_pos);
+      name_holder = JITDebugReader::GetSymFileOpenPath(path.substr(0, colon_pos));
       name = name_holder.data();
     }
   }
@@ -213,7 +213,13 @@ static std::shared_ptr<unwindstack::MapInfo> CreateMapInfo(const MapEntry* entry
 }
 
 void UnwindMaps::UpdateMaps(const MapSet& map_set) {
-  if (version_ == map_set.version) {
+  if (reclaim_generation_ != map_set.reclaim_generation) {
+    // Cached entries may have been freed by ThreadTree::ReclaimStorage(). So don't compare with
+    // them.
+    reclaim_generation_ = map_set.reclaim_generation;
+    entries_.clear();
+    maps_.clear();
+  } else if (version_ == map_set.version) {
     return;
   }
   version_ = map_set.version;
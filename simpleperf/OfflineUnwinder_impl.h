@@ -29,6 +29,7 @@ class UnwindMaps : public unwindstack::Maps {
 
  private:
   uint64_t version_ = 0u;
+  uint64_t reclaim_generation_ = 0u;
   std::vector<const MapEntry*> entries_;
 };
 
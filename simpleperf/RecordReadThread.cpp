@@ -286,6 +286,10 @@ bool RecordReadThread::SyncKernelBuffer() {
   return SendCmdToReadThread(CMD_SYNC_KERNEL_BUFFER, nullptr);
 }
 
+bool RecordReadThread::GetStatWhileReading(RecordStat* stat) {
+  return SendCmdToReadThread(CMD_GET_STAT, stat);
+}
+
 bool RecordReadThread::StopReadThread() {
   bool result = true;
   if (read_thread_ != nullptr) {
@@ -374,6 +378,9 @@ bool RecordReadThread::HandleCmd(IOEventLoop& loop) {
     case CMD_SYNC_KERNEL_BUFFER:
       result = ReadRecordsFromKernelBuffer();
       break;
+    case CMD_GET_STAT:
+      *static_cast<RecordStat*>(cmd_arg_) = stat_;
+      break;
     case CMD_STOP_THREAD:
       result = loop.ExitLoop();
       break;
@@ -155,7 +155,13 @@ class RecordReadThread {
   // If available, return the next record in the RecordBuffer, otherwise return nullptr.
   std::unique_ptr<Record> GetRecord();
 
+  // Only used after the read thread is stopped.
   const RecordStat& GetStat() const { return stat_; }
+  // Copy the stat updated by the read thread.
+  bool GetStatWhileReading(RecordStat* stat);
+  double GetFreeBufferRatio() const {
+    return static_cast<double>(record_buffer_.GetFreeSize()) / record_buffer_.size();
+  }
 
  private:
   enum Cmd {
@@ -163,6 +169,7 @@ class RecordReadThread {
     CMD_ADD_EVENT_FDS,
     CMD_REMOVE_EVENT_FDS,
     CMD_SYNC_KERNEL_BUFFER,
+    CMD_GET_STAT,
     CMD_STOP_THREAD,
   };
 
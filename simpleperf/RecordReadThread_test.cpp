@@ -373,6 +373,10 @@ TEST_F(RecordReadThreadTest, process_sample_record) {
   ASSERT_EQ(thread.GetStat().userspace_lost_samples, 1u);
   ASSERT_EQ(thread.GetStat().userspace_lost_non_samples, 0u);
   ASSERT_EQ(thread.GetStat().userspace_truncated_stack_samples, 1u);
+  RecordStat stat;
+  ASSERT_TRUE(thread.GetStatWhileReading(&stat));
+  ASSERT_EQ(stat.userspace_lost_samples, 1u);
+  ASSERT_EQ(stat.userspace_truncated_stack_samples, 1u);
 }
 
 // Test that the data notification exists until the RecordBuffer is empty. So we can read all
@@ -114,33 +114,37 @@ class CallgraphDisplayer {
   virtual ~CallgraphDisplayer() {}
 
   void operator()(FILE* fp, const SampleT* sample) {
-    if (sample->callchain.children.empty()) {
+    const auto& callchain = sample->callchain;
+    if (!callchain.HasChildren()) {
       return;
     }
     std::string prefix = "       ";
-    if (brief_callgraph_ && sample->callchain.duplicated) {
+    if (brief_callgraph_ && callchain.duplicated) {
       fprintf(fp, "%s[skipped in brief callgraph mode]\n", prefix.c_str());
       return;
     }
     fprintf(fp, "%s|\n", prefix.c_str());
     fprintf(fp, "%s-- %s\n", prefix.c_str(), PrintSampleName(sample).c_str());
     prefix.append(3, ' ');
-    for (size_t i = 0; i < sample->callchain.children.size(); ++i) {
-      DisplayCallGraphEntry(fp, 1, prefix, sample->callchain.children[i],
-                            sample->callchain.children_period + sample->GetPeriod(),
-                            (i + 1 == sample->callchain.children.size()));
+    for (uint32_t i = callchain.FirstChild(); i != CallChainNodeT::NO_NODE;) {
+      const CallChainNodeT& node = callchain.GetNode(i);
+      DisplayCallGraphEntry(fp, 1, prefix, callchain, node,
+                            callchain.children_period + sample->GetPeriod(),
+                            node.next_sibling == CallChainNodeT::NO_NODE);
+      i = node.next_sibling;
     }
   }
 
+  template <typename CallChainRootT>
   void DisplayCallGraphEntry(FILE* fp, size_t depth, std::string prefix,
-                             const std::unique_ptr<CallChainNodeT>& node, uint64_t parent_period,
-                             bool last) {
+                             const CallChainRootT& callchain, const CallChainNodeT& node,
+                             uint64_t parent_period, bool last) {
     if (depth > max_stack_) {
       return;
     }
     std::string percentage_s = "-- ";
-    if (node->period + node->children_period != parent_period) {
-      double percentage = 100.0 * (node->period + node->children_period) / parent_period;
+    if (node.period + node.children_period != parent_period) {
+      double percentage = 100.0 * (node.period + node.children_period) / parent_period;
       if (percentage < percent_limit_) {
         return;
       }
@@ -152,19 +156,22 @@ class CallgraphDisplayer {
       prefix.back() = ' ';
     }
     fprintf(fp, "%s%s%s\n", prefix.c_str(), percentage_s.c_str(),
-            PrintSampleName(node->chain[0]).c_str());
-    for (size_t i = 1; i < node->chain.size(); ++i) {
+            PrintSampleName(callchain.GetChainEntry(node, 0)).c_str());
+    for (size_t i = 1; i < node.chain_size; ++i) {
       fprintf(fp, "%s%*s%s\n", prefix.c_str(), static_cast<int>(percentage_s.size()), "",
-              PrintSampleName(node->chain[i]).c_str());
+              PrintSampleName(callchain.GetChainEntry(node, i)).c_str());
     }
     prefix.append(SPACES_BETWEEN_CALLGRAPH_ENTRIES, ' ');
-    if (!node->children.empty() && node->period != 0) {
+    if (node.HasChildren() && node.period != 0) {
       fprintf(fp, "%s|--%.2f%%-- [hit in function]\n", prefix.c_str(),
-              100.0 * node->period / (node->period + node->children_period));
+              100.0 * node.period / (node.period + node.children_period));
     }
-    for (size_t i = 0; i < node->children.size(); ++i) {
-      DisplayCallGraphEntry(fp, depth + 1, prefix, node->children[i],
-                            node->children_period + node->period, (i + 1 == node->children.size()));
+    for (uint32_t i = node.first_child; i != CallChainNodeT::NO_NODE;) {
+      const CallChainNodeT& child = callchain.GetNode(i);
+      DisplayCallGraphEntry(fp, depth + 1, prefix, callchain, child,
+                            node.children_period + node.period,
+                            child.next_sibling == CallChainNodeT::NO_NODE);
+      i = child.next_sibling;
     }
   }
 
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "UserStackDelta.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <android-base/logging.h>
+
+#include "perf_regs.h"
+
+namespace simpleperf {
+
+namespace {
+
+// Blocks are aligned to block_size by address, so the same stack frames fall into the same block
+// no matter where the stack pointer is. The first and the last block may be partial.
+class StackBlocks {
+ public:
+  StackBlocks(uint64_t addr, uint64_t size, uint64_t block_size)
+      : addr_(addr), end_(addr + size), block_size_(block_size) {
+    base_ = addr - addr % block_size;
+    count_ = size == 0 ? 0 : (end_ - base_ + block_size - 1) / block_size;
+  }
+
+  size_t Count() const { return count_; }
+  uint64_t Start(size_t i) const { return std::max(addr_, base_ + i * block_size_); }
+  uint64_t End(size_t i) const { return std::min(end_, base_ + (i + 1) * block_size_); }
+
+ private:
+  const uint64_t addr_;
+  const uint64_t end_;
+  const uint64_t block_size_;
+  uint64_t base_;
+  size_t count_;
+};
+
+bool GetStackAddr(const SampleRecord& r, uint64_t* addr) {
+  if (!(r.sample_type & PERF_SAMPLE_REGS_USER)) {
+    return false;
+  }
+  RegSet regs(r.regs_user_data.abi, r.regs_user_data.reg_mask, r.regs_user_data.regs);
+  return regs.GetSpRegValue(addr);
+}
+
+}  // namespace
+
+std::unique_ptr<StackDeltaRecord> UserStackDeltaEncoder::Encode(SampleRecord& r) {
+  if (!r.IsUserStackAtEnd() || r.stack_user_data.size == 0) {
+    return nullptr;
+  }
+  uint64_t stack_addr;
+  if (!GetStackAddr(r, &stack_addr)) {
+    return nullptr;
+  }
+  const char* stack = r.stack_user_data.data;
+  uint64_t stack_size = r.stack_user_data.size;
+  UserStackSnapshot& snapshot = snapshots_[r.tid_data.tid];
+  uint64_t snapshot_end = snapshot.addr + snapshot.data.size();
+
+  StackBlocks blocks(stack_addr, stack_size, block_size_);
+  std::vector<uint64_t> reused_blocks;
+  std::vector<char> new_blocks;
+  new_blocks.reserve(stack_size);
+  for (size_t i = 0; i < blocks.Count(); i++) {
+    uint64_t start = blocks.Start(i);
+    uint64_t end = blocks.End(i);
+    const char* data = stack + (start - stack_addr);
+    if (start >= snapshot.addr && end <= snapshot_end &&
+        memcmp(data, snapshot.data.data() + (start - snapshot.addr), end - start) == 0) {
+      reused_blocks.resize(i / 64 + 1, 0);
+      reused_blocks[i / 64] |= 1ULL << (i % 64);
+    } else {
+      new_blocks.insert(new_blocks.end(), data, data + (end - start));
+    }
+  }
+  snapshot.addr = stack_addr;
+  snapshot.data.assign(stack, stack + stack_size);
+
+  if (reused_blocks.empty()) {
+    // Nothing to remove. The sample is written as is, and the decoder keeps its stack.
+    return nullptr;
+  }
+  uint64_t dyn_stack_size = r.stack_user_data.dyn_size;
+  auto delta = std::make_unique<StackDeltaRecord>(r.tid_data.pid, r.tid_data.tid, stack_addr,
+                                                  stack_size, dyn_stack_size, block_size_,
+                                                  reused_blocks);
+  r.ReplaceUserStack(new_blocks.data(), new_blocks.size(), dyn_stack_size);
+  return delta;
+}
+
+bool UserStackDeltaDecoder::AddStackDelta(std::unique_ptr<StackDeltaRecord> r) {
+  if (pending_delta_) {
+    LOG(ERROR) << "stack delta record isn't followed by a sample, tid " << pending_delta_->tid;
+    return false;
+  }
+  if (r->block_size == 0) {
+    LOG(ERROR) << "invalid stack delta record";
+    return false;
+  }
+  pending_delta_ = std::move(r);
+  return true;
+}
+
+bool UserStackDeltaDecoder::Decode(SampleRecord& r) {
+  if (!pending_delta_) {
+    // A sample without a stack delta record carries its whole stack. Keep it like the encoder.
+    uint64_t stack_addr;
+    if (r.IsUserStackAtEnd() && r.stack_user_data.size != 0 && GetStackAddr(r, &stack_addr)) {
+      UserStackSnapshot& snapshot = snapshots_[r.tid_data.tid];
+      snapshot.addr = stack_addr;
+      snapshot.data.assign(r.stack_user_data.data,
+                           r.stack_user_data.data + r.stack_user_data.size);
+    }
+    return true;
+  }
+  std::unique_ptr<StackDeltaRecord> delta = std::move(pending_delta_);
+  if (delta->tid != r.tid_data.tid || !r.IsUserStackAtEnd()) {
+    LOG(ERROR) << "stack delta record doesn't match the following sample, tid " << delta->tid;
+    return false;
+  }
+  UserStackSnapshot& snapshot = snapshots_[delta->tid];
+  uint64_t snapshot_end = snapshot.addr + snapshot.data.size();
+
+  StackBlocks blocks(delta->stack_addr, delta->stack_size, delta->block_size);
+  std::vector<char> stack(delta->stack_size);
+  const char* new_blocks = r.stack_user_data.data;
+  uint64_t new_blocks_size = r.stack_user_data.size;
+  for (size_t i = 0; i < blocks.Count(); i++) {
+    uint64_t start = blocks.Start(i);
+    uint64_t end = blocks.End(i);
+    char* dest = stack.data() + (start - delta->stack_addr);
+    if (delta->IsBlockReused(i)) {
+      if (start < snapshot.addr || end > snapshot_end) {
+        LOG(ERROR) << "stack delta refers to missing stack data, tid " << delta->tid;
+        return false;
+      }
+      memcpy(dest, snapshot.data.data() + (start - snapshot.addr), end - start);
+    } else {
+      if (new_blocks_size < end - start) {
+        LOG(ERROR) << "stack delta doesn't match the user stack in sample, tid " << delta->tid;
+        return false;
+      }
+      memcpy(dest, new_blocks, end - start);
+      new_blocks += end - start;
+      new_blocks_size -= end - start;
+    }
+  }
+  if (new_blocks_size != 0) {
+    LOG(ERROR) << "stack delta doesn't match the user stack in sample, tid " << delta->tid;
+    return false;
+  }
+  if (delta->reused_blocks_nr != 0) {
+    r.ReplaceUserStack(stack.data(), stack.size(), delta->dyn_stack_size);
+  }
+  snapshot.addr = delta->stack_addr;
+  snapshot.data = std::move(stack);
+  return true;
+}
+
+}  // namespace simpleperf
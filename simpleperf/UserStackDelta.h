@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "record.h"
+
+namespace simpleperf {
+
+// Consecutive samples of a thread usually share most of their user stack: only the frames near
+// the stack pointer change. To reduce the size of perf.data recorded with `--call-graph dwarf`,
+// UserStackDeltaEncoder keeps the last user stack of each thread, and removes blocks of the new
+// user stack that are unchanged. Each encoded sample is preceded by a StackDeltaRecord describing
+// which blocks are removed. Samples without unchanged blocks are written as is.
+// UserStackDeltaDecoder reverses the encoding when reading perf.data. It sees every sample of an
+// encoded recording, so it keeps the same stacks as the encoder.
+struct UserStackSnapshot {
+  uint64_t addr = 0;
+  std::vector<char> data;
+};
+
+class UserStackDeltaEncoder {
+ public:
+  static constexpr uint64_t kBlockSize = 512;
+
+  UserStackDeltaEncoder(uint64_t block_size = kBlockSize) : block_size_(block_size) {}
+
+  // Encode the user stack of r in place. Return a StackDeltaRecord that should be written right
+  // before r, or nullptr if r isn't changed.
+  std::unique_ptr<StackDeltaRecord> Encode(SampleRecord& r);
+  void RemoveThread(uint32_t tid) { snapshots_.erase(tid); }
+
+ private:
+  const uint64_t block_size_;
+  std::unordered_map<uint32_t, UserStackSnapshot> snapshots_;
+};
+
+class UserStackDeltaDecoder {
+ public:
+  bool AddStackDelta(std::unique_ptr<StackDeltaRecord> r);
+  // Restore the user stack of r if it is preceded by a StackDeltaRecord. Otherwise keep the user
+  // stack of r for following stack delta records.
+  bool Decode(SampleRecord& r);
+  void RemoveThread(uint32_t tid) { snapshots_.erase(tid); }
+
+ private:
+  std::unique_ptr<StackDeltaRecord> pending_delta_;
+  std::unordered_map<uint32_t, UserStackSnapshot> snapshots_;
+};
+
+}  // namespace simpleperf
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "UserStackDelta.h"
+
+#include <gtest/gtest.h>
+
+#include <android-base/file.h>
+
+#include "perf_regs.h"
+#include "record_file.h"
+#include "utils.h"
+
+using namespace simpleperf;
+
+class UserStackDeltaTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    scoped_arch_.reset(new ScopedCurrentArch(ARCH_ARM64));
+    attr_.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER;
+    attr_.sample_regs_user = 1ULL << PERF_REG_ARM64_SP;
+  }
+
+  std::unique_ptr<SampleRecord> CreateSample(uint32_t tid, uint64_t sp,
+                                             const std::vector<char>& stack) {
+    uint32_t size = Record::header_size() + 4 * sizeof(uint64_t);
+    if (!stack.empty()) {
+      size += stack.size() + sizeof(uint64_t);
+    }
+    char* binary = new char[size];
+    char* p = binary;
+    perf_event_header header;
+    header.type = PERF_RECORD_SAMPLE;
+    header.misc = PERF_RECORD_MISC_USER;
+    header.size = size;
+    MoveToBinaryFormat(header, p);
+    uint32_t pid = 1;
+    MoveToBinaryFormat(pid, p);
+    MoveToBinaryFormat(tid, p);
+    uint64_t abi = PERF_SAMPLE_REGS_ABI_64;
+    MoveToBinaryFormat(abi, p);
+    MoveToBinaryFormat(sp, p);
+    uint64_t stack_size = stack.size();
+    MoveToBinaryFormat(stack_size, p);
+    if (!stack.empty()) {
+      MoveToBinaryFormat(stack.data(), stack.size(), p);
+      MoveToBinaryFormat(stack_size, p);
+    }
+    auto r = std::make_unique<SampleRecord>();
+    EXPECT_TRUE(r->Parse(attr_, binary, binary + size));
+    r->OwnBinary();
+    return r;
+  }
+
+  // Encode a sample, then decode it after passing both records through binary format.
+  void EncodeAndDecode(uint32_t tid, uint64_t sp, const std::vector<char>& stack,
+                       uint64_t* encoded_stack_size) {
+    std::unique_ptr<SampleRecord> r = CreateSample(tid, sp, stack);
+    std::unique_ptr<StackDeltaRecord> delta = encoder_.Encode(*r);
+    *encoded_stack_size = r->stack_user_data.size;
+
+    if (delta) {
+      auto delta_copy = ReadRecordFromBuffer(attr_, delta->BinaryForTestingOnly(),
+                                           delta->BinaryForTestingOnly() + delta->size());
+      ASSERT_TRUE(delta_copy);
+      ASSERT_EQ(delta_copy->type(), SIMPLE_PERF_RECORD_STACK_DELTA);
+      ASSERT_TRUE(decoder_.AddStackDelta(std::unique_ptr<StackDeltaRecord>(
+          static_cast<StackDeltaRecord*>(delta_copy.release()))));
+    } else {
+      // Only samples without reused blocks are written without a stack delta record.
+      ASSERT_EQ(*encoded_stack_size, stack.size());
+    }
+    SampleRecord decoded;
+    ASSERT_TRUE(decoded.Parse(attr_, r->BinaryForTestingOnly(),
+                              r->BinaryForTestingOnly() + r->size()));
+    ASSERT_TRUE(decoder_.Decode(decoded));
+    ASSERT_EQ(decoded.stack_user_data.size, stack.size());
+    ASSERT_EQ(decoded.stack_user_data.dyn_size, stack.size());
+    ASSERT_EQ(memcmp(decoded.stack_user_data.data, stack.data(), stack.size()), 0);
+    ASSERT_EQ(decoded.tid_data.tid, tid);
+    uint64_t decoded_sp;
+    RegSet regs(decoded.regs_user_data.abi, decoded.regs_user_data.reg_mask,
+                decoded.regs_user_data.regs);
+    ASSERT_TRUE(regs.GetSpRegValue(&decoded_sp));
+    ASSERT_EQ(decoded_sp, sp);
+  }
+
+  std::unique_ptr<ScopedCurrentArch> scoped_arch_;
+  perf_event_attr attr_ = {};
+  UserStackDeltaEncoder encoder_{64};
+  UserStackDeltaDecoder decoder_;
+};
+
+TEST_F(UserStackDeltaTest, reuse_unchanged_blocks) {
+  // Stack of thread 1: [0x1020, 0x1200).
+  std::vector<char> stack(0x1e0);
+  for (size_t i = 0; i < stack.size(); i++) {
+    stack[i] = static_cast<char>(i);
+  }
+  uint64_t encoded_size;
+  ASSERT_NO_FATAL_FAILURE(EncodeAndDecode(1, 0x1020, stack, &encoded_size));
+  ASSERT_EQ(encoded_size, stack.size());
+
+  // Same stack: all blocks are reused.
+  ASSERT_NO_FATAL_FAILURE(EncodeAndDecode(1, 0x1020, stack, &encoded_size));
+  ASSERT_EQ(encoded_size, 0u);
+
+  // Grow the stack by 0x30 bytes, and change data in block [0x1100, 0x1140).
+  std::vector<char> new_stack(0x30, 'a');
+  new_stack.insert(new_stack.end(), stack.begin(), stack.end());
+  new_stack[0x1110 - 0xff0] = 'b';
+  // Blocks [0xfc0, 0x1000), [0x1000, 0x1040) and [0x1100, 0x1140) are changed.
+  ASSERT_NO_FATAL_FAILURE(EncodeAndDecode(1, 0xff0, new_stack, &encoded_size));
+  ASSERT_EQ(encoded_size, 0x10 + 0x40 + 0x40);
+
+  // Another thread doesn't share the stack of thread 1.
+  ASSERT_NO_FATAL_FAILURE(EncodeAndDecode(2, 0xff0, new_stack, &encoded_size));
+  ASSERT_EQ(encoded_size, new_stack.size());
+
+  // Stack of thread 1 is dropped after it exits.
+  encoder_.RemoveThread(1);
+  decoder_.RemoveThread(1);
+  ASSERT_NO_FATAL_FAILURE(EncodeAndDecode(1, 0xff0, new_stack, &encoded_size));
+  ASSERT_EQ(encoded_size, new_stack.size());
+}
+
+TEST_F(UserStackDeltaTest, no_stack_delta_without_reused_blocks) {
+  std::vector<char> stack(0x100, 'a');
+  // The first sample of a thread has nothing to reuse, and is kept as is.
+  std::unique_ptr<SampleRecord> r = CreateSample(1, 0x1000, stack);
+  ASSERT_FALSE(encoder_.Encode(*r));
+  ASSERT_EQ(r->stack_user_data.size, stack.size());
+  ASSERT_TRUE(decoder_.Decode(*r));
+  ASSERT_EQ(r->stack_user_data.size, stack.size());
+
+  // The following sample reuses the stack kept from the plain sample.
+  uint64_t encoded_size;
+  ASSERT_NO_FATAL_FAILURE(EncodeAndDecode(1, 0x1000, stack, &encoded_size));
+  ASSERT_EQ(encoded_size, 0u);
+
+  // A completely changed stack isn't encoded either.
+  std::vector<char> new_stack(0x100, 'b');
+  r = CreateSample(1, 0x1000, new_stack);
+  ASSERT_FALSE(encoder_.Encode(*r));
+  ASSERT_TRUE(decoder_.Decode(*r));
+  ASSERT_NO_FATAL_FAILURE(EncodeAndDecode(1, 0x1000, new_stack, &encoded_size));
+  ASSERT_EQ(encoded_size, 0u);
+}
+
+TEST_F(UserStackDeltaTest, skip_samples_without_stack) {
+  std::unique_ptr<SampleRecord> r = CreateSample(1, 0x1000, {});
+  ASSERT_FALSE(encoder_.Encode(*r));
+  // A sample without a preceding stack delta record isn't changed.
+  ASSERT_TRUE(decoder_.Decode(*r));
+  ASSERT_EQ(r->stack_user_data.size, 0u);
+}
+
+TEST_F(UserStackDeltaTest, read_delta_encoded_file) {
+  TemporaryFile tmpfile;
+  close(tmpfile.release());
+  std::vector<char> stack(0x100, 'a');
+  std::vector<char> changed_stack = stack;
+  changed_stack[0x80] = 'b';
+  std::vector<std::vector<char>> stacks = {stack, stack, changed_stack};
+
+  std::unique_ptr<RecordFileWriter> writer = RecordFileWriter::CreateInstance(tmpfile.path);
+  ASSERT_TRUE(writer);
+  ASSERT_TRUE(writer->WriteAttrSection({EventAttrWithId{attr_, {}}}));
+  size_t delta_count = 0;
+  for (const auto& s : stacks) {
+    std::unique_ptr<SampleRecord> r = CreateSample(1, 0x1000, s);
+    std::unique_ptr<StackDeltaRecord> delta = encoder_.Encode(*r);
+    if (delta) {
+      delta_count++;
+      ASSERT_TRUE(writer->WriteRecord(*delta));
+    }
+    ASSERT_TRUE(writer->WriteRecord(*r));
+  }
+  // The first sample is written without a stack delta record.
+  ASSERT_EQ(delta_count, 2u);
+  ASSERT_TRUE(writer->BeginWriteFeatures(1));
+  ASSERT_TRUE(writer->WriteMetaInfoFeature({{"delta_encode_stack", "true"}}));
+  ASSERT_TRUE(writer->EndWriteFeatures());
+  ASSERT_TRUE(writer->Close());
+
+  std::unique_ptr<RecordFileReader> reader = RecordFileReader::CreateInstance(tmpfile.path);
+  ASSERT_TRUE(reader);
+  std::vector<std::unique_ptr<Record>> records = reader->DataSection();
+  ASSERT_EQ(records.size(), stacks.size());
+  for (size_t i = 0; i < records.size(); i++) {
+    ASSERT_EQ(records[i]->type(), PERF_RECORD_SAMPLE);
+    auto& r = *static_cast<SampleRecord*>(records[i].get());
+    ASSERT_EQ(r.stack_user_data.size, stacks[i].size());
+    ASSERT_EQ(memcmp(r.stack_user_data.data, stacks[i].data(), stacks[i].size()), 0);
+  }
+}
@@ -17,44 +17,62 @@
 #ifndef SIMPLE_PERF_CALLCHAIN_H_
 #define SIMPLE_PERF_CALLCHAIN_H_
 
+#include <stdint.h>
 #include <string.h>
 
 #include <algorithm>
 #include <functional>
-#include <memory>
-#include <queue>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <android-base/logging.h>
 
 namespace simpleperf {
 
+// A node in a call tree. Nodes of a tree are stored in CallChainRoot::nodes_, and refer to each
+// other by 32-bit indexes. The chain of a node is a range in CallChainRoot::chain_entries_.
 template <typename EntryT>
 struct CallChainNode {
-  uint64_t period;
-  uint64_t children_period;
-  std::vector<EntryT*> chain;
-  std::vector<std::unique_ptr<CallChainNode>> children;
+  static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+  uint64_t period = 0;
+  uint64_t children_period = 0;
+  uint32_t chain_start = 0;
+  uint32_t chain_size = 0;
+  uint32_t parent = NO_NODE;
+  uint32_t first_child = NO_NODE;
+  uint32_t last_child = NO_NODE;
+  uint32_t next_sibling = NO_NODE;
+  uint32_t children_count = 0;
+
+  bool HasChildren() const { return first_child != NO_NODE; }
 };
 
 template <typename EntryT>
 struct CallChainRoot {
   typedef CallChainNode<EntryT> NodeT;
+  static constexpr uint32_t NO_NODE = NodeT::NO_NODE;
+  // Children of a node are looked up in child_map_ when the node has at least this many children.
+  static constexpr uint32_t MIN_CHILDREN_FOR_CHILD_MAP = 8;
+
   // If duplicated = true, this call tree is part of another call tree.
   // And we don't need to show it in brief callgraph report mode.
   bool duplicated;
   uint64_t children_period;
-  std::vector<std::unique_ptr<NodeT>> children;
 
   CallChainRoot() : duplicated(false), children_period(0) {}
 
   void AddCallChain(const std::vector<EntryT*>& callchain, uint64_t period,
                     std::function<bool(const EntryT*, const EntryT*)> is_same_sample) {
+    if (nodes_.empty()) {
+      // nodes_[0] is a virtual node with an empty chain, whose children are the top nodes.
+      nodes_.emplace_back();
+    }
     children_period += period;
-    NodeT* p = FindMatchingNode(children, callchain[0], is_same_sample);
-    if (p == nullptr) {
-      std::unique_ptr<NodeT> new_node = AllocateNode(callchain, 0, period, 0);
-      children.push_back(std::move(new_node));
+    uint32_t p = FindMatchingNode(0, callchain[0], is_same_sample);
+    if (p == NO_NODE) {
+      AddChild(0, AllocateNode(callchain, 0, period));
       return;
     }
     size_t callchain_pos = 0;
@@ -63,93 +81,177 @@ struct CallChainRoot {
       CHECK_GT(match_length, 0u);
       callchain_pos += match_length;
       bool find_child = true;
-      if (match_length < p->chain.size()) {
+      if (match_length < nodes_[p].chain_size) {
         SplitNode(p, match_length);
-        find_child = false;  // No need to find matching node in p->children.
+        find_child = false;  // No need to find matching node in p's children.
       }
       if (callchain_pos == callchain.size()) {
-        p->period += period;
+        nodes_[p].period += period;
         return;
       }
-      p->children_period += period;
+      nodes_[p].children_period += period;
       if (find_child) {
-        NodeT* np = FindMatchingNode(p->children, callchain[callchain_pos], is_same_sample);
-        if (np != nullptr) {
+        uint32_t np = FindMatchingNode(p, callchain[callchain_pos], is_same_sample);
+        if (np != NO_NODE) {
           p = np;
           continue;
         }
       }
-      std::unique_ptr<NodeT> new_node = AllocateNode(callchain, callchain_pos, period, 0);
-      p->children.push_back(std::move(new_node));
+      AddChild(p, AllocateNode(callchain, callchain_pos, period));
       break;
     }
   }
 
   void SortByPeriod() {
-    std::queue<std::vector<std::unique_ptr<NodeT>>*> queue;
-    queue.push(&children);
-    while (!queue.empty()) {
-      std::vector<std::unique_ptr<NodeT>>* v = queue.front();
-      queue.pop();
-      std::sort(v->begin(), v->end(), CallChainRoot::CompareNodeByPeriod);
-      for (auto& node : *v) {
-        if (!node->children.empty()) {
-          queue.push(&node->children);
-        }
+    std::vector<uint32_t> children;
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+      NodeT& node = nodes_[i];
+      if (node.children_count < 2) {
+        continue;
+      }
+      children.clear();
+      for (uint32_t c = node.first_child; c != NO_NODE; c = nodes_[c].next_sibling) {
+        children.push_back(c);
       }
+      std::sort(children.begin(), children.end(), [this](uint32_t n1, uint32_t n2) {
+        return nodes_[n1].period + nodes_[n1].children_period >
+               nodes_[n2].period + nodes_[n2].children_period;
+      });
+      node.first_child = children.front();
+      node.last_child = children.back();
+      for (size_t j = 0; j + 1 < children.size(); ++j) {
+        nodes_[children[j]].next_sibling = children[j + 1];
+      }
+      nodes_[children.back()].next_sibling = NO_NODE;
     }
+    // The tree is complete, so the lookup table is no longer needed.
+    std::unordered_map<ChildKey, uint32_t, ChildKeyHash>().swap(child_map_);
+  }
+
+  // Return the index of the first top node, or NO_NODE if the tree is empty.
+  uint32_t FirstChild() const { return nodes_.empty() ? NO_NODE : nodes_[0].first_child; }
+  bool HasChildren() const { return FirstChild() != NO_NODE; }
+  const NodeT& GetNode(uint32_t index) const { return nodes_[index]; }
+  const EntryT* GetChainEntry(const NodeT& node, size_t i) const {
+    return chain_entries_[node.chain_start + i];
+  }
+
+  size_t NodeCount() const { return nodes_.empty() ? 0 : nodes_.size() - 1; }
+  size_t MemoryUsage() const {
+    return nodes_.capacity() * sizeof(NodeT) + chain_entries_.capacity() * sizeof(EntryT*) +
+           child_map_.size() * (sizeof(ChildKey) + sizeof(uint32_t) + 2 * sizeof(void*)) +
+           child_map_.bucket_count() * sizeof(void*);
   }
 
  private:
-  NodeT* FindMatchingNode(const std::vector<std::unique_ptr<NodeT>>& nodes, const EntryT* sample,
-                          std::function<bool(const EntryT*, const EntryT*)> is_same_sample) {
-    for (auto& node : nodes) {
-      if (is_same_sample(node->chain.front(), sample)) {
-        return node.get();
+  struct ChildKey {
+    uint32_t parent;
+    const EntryT* sample;
+
+    bool operator==(const ChildKey& other) const {
+      return parent == other.parent && sample == other.sample;
+    }
+  };
+
+  struct ChildKeyHash {
+    size_t operator()(const ChildKey& key) const {
+      return std::hash<const EntryT*>()(key.sample) ^ (static_cast<size_t>(key.parent) << 1);
+    }
+  };
+
+  uint32_t FindMatchingNode(uint32_t parent, const EntryT* sample,
+                            std::function<bool(const EntryT*, const EntryT*)> is_same_sample) {
+    // Samples are compared by is_same_sample(), which can treat different pointers as the same
+    // sample. So child_map_ only caches results of previous lookups. An entry is valid as long as
+    // the child hasn't been moved to another parent by SplitNode().
+    bool use_child_map = nodes_[parent].children_count >= MIN_CHILDREN_FOR_CHILD_MAP;
+    if (use_child_map) {
+      auto it = child_map_.find(ChildKey{parent, sample});
+      if (it != child_map_.end() && nodes_[it->second].parent == parent) {
+        return it->second;
+      }
+    }
+    for (uint32_t c = nodes_[parent].first_child; c != NO_NODE; c = nodes_[c].next_sibling) {
+      if (is_same_sample(chain_entries_[nodes_[c].chain_start], sample)) {
+        if (use_child_map) {
+          child_map_[ChildKey{parent, sample}] = c;
+        }
+        return c;
       }
     }
-    return nullptr;
+    return NO_NODE;
   }
 
-  size_t GetMatchingLengthInNode(NodeT* node, const std::vector<EntryT*>& chain, size_t chain_start,
+  size_t GetMatchingLengthInNode(uint32_t node_index, const std::vector<EntryT*>& chain,
+                                 size_t chain_start,
                                  std::function<bool(const EntryT*, const EntryT*)> is_same_sample) {
+    const NodeT& node = nodes_[node_index];
+    EntryT* const* node_chain = chain_entries_.data() + node.chain_start;
     size_t i, j;
-    for (i = 0, j = chain_start; i < node->chain.size() && j < chain.size(); ++i, ++j) {
-      if (!is_same_sample(node->chain[i], chain[j])) {
+    for (i = 0, j = chain_start; i < node.chain_size && j < chain.size(); ++i, ++j) {
+      if (!is_same_sample(node_chain[i], chain[j])) {
         break;
       }
     }
     return i;
   }
 
-  void SplitNode(NodeT* parent, size_t parent_length) {
-    std::unique_ptr<NodeT> child =
-        AllocateNode(parent->chain, parent_length, parent->period, parent->children_period);
-    child->children = std::move(parent->children);
-    parent->period = 0;
-    parent->children_period = child->period + child->children_period;
-    parent->chain.resize(parent_length);
-    parent->children.clear();
-    parent->children.push_back(std::move(child));
+  // Split the chain of a node at parent_length. The node keeps the first part, and a new child
+  // node takes the remaining part and the children of the node. The chain entries aren't copied.
+  void SplitNode(uint32_t parent, size_t parent_length) {
+    uint32_t child = NewNode();
+    NodeT& p = nodes_[parent];
+    NodeT& c = nodes_[child];
+    c.chain_start = p.chain_start + parent_length;
+    c.chain_size = p.chain_size - parent_length;
+    c.period = p.period;
+    c.children_period = p.children_period;
+    c.first_child = p.first_child;
+    c.last_child = p.last_child;
+    c.children_count = p.children_count;
+    for (uint32_t i = c.first_child; i != NO_NODE; i = nodes_[i].next_sibling) {
+      nodes_[i].parent = child;
+    }
+    p.chain_size = parent_length;
+    p.period = 0;
+    p.children_period = c.period + c.children_period;
+    p.first_child = p.last_child = NO_NODE;
+    p.children_count = 0;
+    AddChild(parent, child);
   }
 
-  std::unique_ptr<NodeT> AllocateNode(const std::vector<EntryT*>& chain, size_t chain_start,
-                                      uint64_t period, uint64_t children_period) {
-    std::unique_ptr<NodeT> node(new NodeT);
-    for (size_t i = chain_start; i < chain.size(); ++i) {
-      node->chain.push_back(chain[i]);
-    }
-    node->period = period;
-    node->children_period = children_period;
-    return node;
+  uint32_t AllocateNode(const std::vector<EntryT*>& chain, size_t chain_start, uint64_t period) {
+    CHECK_LE(chain_entries_.size() + chain.size() - chain_start, static_cast<size_t>(UINT32_MAX));
+    uint32_t index = NewNode();
+    NodeT& node = nodes_[index];
+    node.chain_start = static_cast<uint32_t>(chain_entries_.size());
+    node.chain_size = static_cast<uint32_t>(chain.size() - chain_start);
+    node.period = period;
+    chain_entries_.insert(chain_entries_.end(), chain.begin() + chain_start, chain.end());
+    return index;
+  }
+
+  uint32_t NewNode() {
+    CHECK_LT(nodes_.size(), static_cast<size_t>(NO_NODE));
+    nodes_.emplace_back();
+    return static_cast<uint32_t>(nodes_.size() - 1);
   }
 
-  static bool CompareNodeByPeriod(const std::unique_ptr<NodeT>& n1,
-                                  const std::unique_ptr<NodeT>& n2) {
-    uint64_t period1 = n1->period + n1->children_period;
-    uint64_t period2 = n2->period + n2->children_period;
-    return period1 > period2;
+  void AddChild(uint32_t parent, uint32_t child) {
+    NodeT& p = nodes_[parent];
+    nodes_[child].parent = parent;
+    if (p.last_child == NO_NODE) {
+      p.first_child = child;
+    } else {
+      nodes_[p.last_child].next_sibling = child;
+    }
+    p.last_child = child;
+    p.children_count++;
   }
+
+  std::vector<NodeT> nodes_;
+  std::vector<EntryT*> chain_entries_;
+  std::unordered_map<ChildKey, uint32_t, ChildKeyHash> child_map_;
 };
 
 }  // namespace simpleperf
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "callchain.h"
+
+#include <vector>
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+
+using namespace simpleperf;
+
+namespace {
+
+struct Entry {
+  int id;
+};
+
+using Root = CallChainRoot<Entry>;
+
+bool IsSameEntry(const Entry* e1, const Entry* e2) {
+  return e1->id == e2->id;
+}
+
+// Entries are shared by callchains, like symbols shared by samples.
+Entry* GetEntry(int id) {
+  static std::vector<Entry> entries = []() {
+    std::vector<Entry> entries(10000);
+    for (size_t i = 0; i < entries.size(); ++i) {
+      entries[i].id = static_cast<int>(i);
+    }
+    return entries;
+  }();
+  return &entries[id];
+}
+
+std::vector<Entry*> Chain(const std::vector<int>& ids) {
+  std::vector<Entry*> chain;
+  for (int id : ids) {
+    chain.push_back(GetEntry(id));
+  }
+  return chain;
+}
+
+// Add callchains to a new call graph in each iteration, and report nodes and bytes used.
+void BuildCallGraph(benchmark::State& state, const std::vector<std::vector<Entry*>>& chains,
+                    size_t expected_nodes) {
+  size_t memory_usage = 0;
+  for (auto _ : state) {
+    Root root;
+    for (const auto& chain : chains) {
+      root.AddCallChain(chain, 1, IsSameEntry);
+    }
+    root.SortByPeriod();
+    CHECK_EQ(root.NodeCount(), expected_nodes);
+    memory_usage = root.MemoryUsage();
+  }
+  state.SetItemsProcessed(state.iterations() * chains.size());
+  state.counters["nodes"] = expected_nodes;
+  state.counters["bytes"] = memory_usage;
+}
+
+}  // namespace
+
+// Wide: a caller calling 5000 different functions, each called repeatedly.
+static void BM_BuildWideCallGraph(benchmark::State& state) {
+  std::vector<std::vector<Entry*>> chains;
+  for (int repeat = 0; repeat < 10; ++repeat) {
+    for (int i = 0; i < 5000; ++i) {
+      chains.push_back(Chain({0, 1, 1000 + i}));
+    }
+  }
+  BuildCallGraph(state, chains, 5001);
+}
+BENCHMARK(BM_BuildWideCallGraph)->Unit(benchmark::kMicrosecond);
+
+// Deep: recursive callchains of 512 frames, splitting at every depth.
+static void BM_BuildDeepCallGraph(benchmark::State& state) {
+  std::vector<std::vector<Entry*>> chains;
+  std::vector<int> ids;
+  for (int depth = 0; depth < 512; ++depth) {
+    ids.push_back(depth);
+    std::vector<int> chain_ids = ids;
+    chain_ids.push_back(5000 + depth);
+    for (int i = 0; i < 10; ++i) {
+      chains.push_back(Chain(chain_ids));
+    }
+  }
+  BuildCallGraph(state, chains, 512 * 2 - 1);
+}
+BENCHMARK(BM_BuildDeepCallGraph)->Unit(benchmark::kMicrosecond);
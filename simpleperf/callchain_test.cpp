@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "callchain.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace simpleperf;
+
+namespace {
+
+struct Entry {
+  int id;
+};
+
+using Root = CallChainRoot<Entry>;
+using Node = CallChainNode<Entry>;
+
+bool IsSameEntry(const Entry* e1, const Entry* e2) {
+  return e1->id == e2->id;
+}
+
+class CallChainTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    entries_.resize(10000);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      entries_[i].id = static_cast<int>(i);
+    }
+  }
+
+  std::vector<Entry*> Chain(const std::vector<int>& ids) {
+    std::vector<Entry*> chain;
+    for (int id : ids) {
+      chain.push_back(&entries_[id]);
+    }
+    return chain;
+  }
+
+  // Print the tree as "id1,id2(period)[child1 child2]".
+  std::string ToString(const Root& root, uint32_t index) {
+    const Node& node = root.GetNode(index);
+    std::string s;
+    for (size_t i = 0; i < node.chain_size; ++i) {
+      s += (i == 0 ? "" : ",") + std::to_string(root.GetChainEntry(node, i)->id);
+    }
+    s += "(" + std::to_string(node.period) + ")";
+    if (node.HasChildren()) {
+      s += "[";
+      for (uint32_t c = node.first_child; c != Node::NO_NODE; c = root.GetNode(c).next_sibling) {
+        s += (c == node.first_child ? "" : " ") + ToString(root, c);
+      }
+      s += "]";
+    }
+    return s;
+  }
+
+  std::string ToString(const Root& root) {
+    std::string s;
+    for (uint32_t c = root.FirstChild(); c != Node::NO_NODE; c = root.GetNode(c).next_sibling) {
+      s += (c == root.FirstChild() ? "" : " ") + ToString(root, c);
+    }
+    return s;
+  }
+
+  std::vector<Entry> entries_;
+};
+
+}  // namespace
+
+TEST_F(CallChainTest, add_callchain) {
+  Root root;
+  ASSERT_FALSE(root.HasChildren());
+  root.AddCallChain(Chain({1, 2, 3}), 1, IsSameEntry);
+  ASSERT_EQ(ToString(root), "1,2,3(1)");
+  // Split a node.
+  root.AddCallChain(Chain({1, 2, 4}), 2, IsSameEntry);
+  ASSERT_EQ(ToString(root), "1,2(0)[3(1) 4(2)]");
+  // End in the middle of a node.
+  root.AddCallChain(Chain({1}), 4, IsSameEntry);
+  ASSERT_EQ(ToString(root), "1(4)[2(0)[3(1) 4(2)]]");
+  root.AddCallChain(Chain({5}), 8, IsSameEntry);
+  ASSERT_EQ(ToString(root), "1(4)[2(0)[3(1) 4(2)]] 5(8)");
+  ASSERT_EQ(root.children_period, 15u);
+  ASSERT_EQ(root.GetNode(root.FirstChild()).children_period, 3u);
+  root.SortByPeriod();
+  ASSERT_EQ(ToString(root), "5(8) 1(4)[2(0)[4(2) 3(1)]]");
+}
+
+TEST_F(CallChainTest, wide_node_uses_child_map) {
+  Root root;
+  // Add a wide node, then split it, and check children are still found after being moved.
+  for (int i = 0; i < 20; ++i) {
+    root.AddCallChain(Chain({1, 2, 100 + i}), 1, IsSameEntry);
+  }
+  for (int i = 0; i < 20; ++i) {
+    root.AddCallChain(Chain({1, 2, 100 + i}), 1, IsSameEntry);
+  }
+  root.AddCallChain(Chain({1, 3}), 1, IsSameEntry);
+  for (int i = 0; i < 20; ++i) {
+    root.AddCallChain(Chain({1, 2, 100 + i}), 1, IsSameEntry);
+  }
+  // Different pointers to the same sample are matched by is_same_sample.
+  Entry same_as_100 = {100};
+  root.AddCallChain({&entries_[1], &entries_[2], &same_as_100}, 1, IsSameEntry);
+  ASSERT_EQ(root.NodeCount(), 23u);
+  const Node& node1 = root.GetNode(root.FirstChild());
+  ASSERT_EQ(node1.chain_size, 1u);
+  ASSERT_EQ(node1.children_count, 2u);
+  const Node& node2 = root.GetNode(node1.first_child);
+  ASSERT_EQ(node2.children_count, 20u);
+  ASSERT_EQ(node2.children_period, 61u);
+  const Node& node100 = root.GetNode(node2.first_child);
+  ASSERT_EQ(root.GetChainEntry(node100, 0)->id, 100);
+  ASSERT_EQ(node100.period, 4u);
+}
@@ -17,7 +17,9 @@
 #include <stdio.h>
 
 #include <algorithm>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -81,6 +83,8 @@ struct UnwindingStat {
   uint64_t unwinding_sample_count = 0u;
   uint64_t total_unwinding_time_in_ns = 0u;
   uint64_t max_unwinding_time_in_ns = 0u;
+  // Map from error code to the count of samples having it.
+  std::map<uint64_t, uint64_t> error_code_counts;
 
   // For memory consumption
   MemStat mem_before_unwinding;
@@ -90,6 +94,7 @@ struct UnwindingStat {
     unwinding_sample_count++;
     total_unwinding_time_in_ns += result.used_time;
     max_unwinding_time_in_ns = std::max(max_unwinding_time_in_ns, result.used_time);
+    error_code_counts[result.error_code]++;
   }
 
   void Dump(FILE* fp) {
@@ -100,6 +105,9 @@ struct UnwindingStat {
     fprintf(fp, "average_unwinding_time: %.3f us\n",
             total_unwinding_time_in_ns / 1e3 / unwinding_sample_count);
     fprintf(fp, "max_unwinding_time: %.3f us\n", max_unwinding_time_in_ns / 1e3);
+    for (const auto& [error_code, count] : error_code_counts) {
+      fprintf(fp, "unwinding_error_code_%" PRIu64 "_count: %" PRIu64 "\n", error_code, count);
+    }
 
     if (!mem_before_unwinding.vm_peak.empty()) {
       fprintf(fp, "memory_change_VmPeak: %s -> %s\n", mem_before_unwinding.vm_peak.c_str(),
@@ -224,6 +232,20 @@ class SampleUnwinder : public RecordFileProcessor {
         skip_sample_print_(skip_sample_print) {}
 
  protected:
+  // A selected sample waiting to be unwound. regs and stack point into record or
+  // unwinding_result_record.
+  struct PendingSample {
+    std::unique_ptr<SampleRecord> record;
+    std::unique_ptr<UnwindingResultRecord> unwinding_result_record;
+    ThreadEntry* thread = nullptr;
+    const PerfSampleRegsUserType* regs = nullptr;
+    const PerfSampleStackUserType* stack = nullptr;
+    bool success = false;
+    std::vector<uint64_t> ips;
+    std::vector<uint64_t> sps;
+    UnwindingResult unwinding_result;
+  };
+
   bool CheckRecordCmd(const std::string& record_cmd) override {
     if (record_cmd.find("--no-unwind") == std::string::npos &&
         record_cmd.find("--keep-failed-unwinding-debug-info") == std::string::npos) {
@@ -242,6 +264,9 @@ class SampleUnwinder : public RecordFileProcessor {
             [&](std::unique_ptr<Record> r) { return ProcessRecord(std::move(r)); })) {
       return false;
     }
+    if (!UnwindPendingSamples()) {
+      return false;
+    }
     if (!GetMemStat(&stat_.mem_after_unwinding)) {
       return false;
     }
@@ -250,27 +275,41 @@ class SampleUnwinder : public RecordFileProcessor {
   }
 
   bool ProcessRecord(std::unique_ptr<Record> r) {
-    UpdateRecord(r.get());
-    thread_tree_.Update(*r);
     if (r->type() == SIMPLE_PERF_RECORD_UNWINDING_RESULT) {
       last_unwinding_result_.reset(static_cast<UnwindingResultRecord*>(r.release()));
-    } else if (r->type() == PERF_RECORD_SAMPLE) {
+      return true;
+    }
+    if (r->type() == PERF_RECORD_SAMPLE) {
+      std::unique_ptr<UnwindingResultRecord> unwinding_result = std::move(last_unwinding_result_);
       if (sample_times_.empty() || sample_times_.count(r->Timestamp())) {
         auto& sr = *static_cast<SampleRecord*>(r.get());
         const PerfSampleStackUserType* stack = &sr.stack_user_data;
         const PerfSampleRegsUserType* regs = &sr.regs_user_data;
-        if (last_unwinding_result_ && last_unwinding_result_->Timestamp() == sr.Timestamp()) {
-          stack = &last_unwinding_result_->stack_user_data;
-          regs = &last_unwinding_result_->regs_user_data;
+        if (unwinding_result && unwinding_result->Timestamp() == sr.Timestamp()) {
+          stack = &unwinding_result->stack_user_data;
+          regs = &unwinding_result->regs_user_data;
         }
         if (stack->size > 0 || regs->reg_mask > 0) {
-          if (!UnwindRecord(sr, *regs, *stack)) {
-            return false;
+          PendingSample& sample = pending_samples_.emplace_back();
+          sample.thread = thread_tree_.FindThreadOrNew(sr.tid_data.pid, sr.tid_data.tid);
+          sample.regs = regs;
+          sample.stack = stack;
+          sample.record.reset(static_cast<SampleRecord*>(r.release()));
+          sample.unwinding_result_record = std::move(unwinding_result);
+          if (pending_samples_.size() == kMaxPendingSamples) {
+            return UnwindPendingSamples();
           }
         }
       }
-      last_unwinding_result_.reset();
+      return true;
     }
+    // Other records may change the thread tree, which is read by unwinding threads. So finish
+    // pending samples first.
+    if (!UnwindPendingSamples()) {
+      return false;
+    }
+    UpdateRecord(r.get());
+    thread_tree_.Update(*r);
     return true;
   }
 
@@ -300,22 +339,73 @@ class SampleUnwinder : public RecordFileProcessor {
     }
   }
 
-  bool UnwindRecord(const SampleRecord& r, const PerfSampleRegsUserType& regs,
-                    const PerfSampleStackUserType& stack) {
-    ThreadEntry* thread = thread_tree_.FindThreadOrNew(r.tid_data.pid, r.tid_data.tid);
+  // Unwind pending samples in parallel, then report them in recording order. The thread tree
+  // isn't changed while unwinding, so each unwinding thread reads it without locks, using its own
+  // OfflineUnwinder.
+  bool UnwindPendingSamples() {
+    if (pending_samples_.empty()) {
+      return true;
+    }
+    // Dso::GetDebugFilePath() is evaluated lazily. Evaluate it for mapped files before it is read
+    // by unwinding threads.
+    std::unordered_set<const MapSet*> map_sets;
+    for (const PendingSample& sample : pending_samples_) {
+      if (map_sets.insert(sample.thread->maps.get()).second) {
+        for (const auto& [_, map] : sample.thread->maps->maps) {
+          map->dso->GetDebugFilePath();
+        }
+      }
+    }
+    RunInParallel(pending_samples_.size(), kMinSamplesPerJob, [&](size_t begin, size_t end) {
+      std::unique_ptr<OfflineUnwinder> unwinder = GetUnwinder();
+      for (size_t i = begin; i < end; i++) {
+        PendingSample& sample = pending_samples_[i];
+        RegSet reg_set(sample.regs->abi, sample.regs->reg_mask, sample.regs->regs);
+        sample.success = unwinder->UnwindCallChain(*sample.thread, reg_set, sample.stack->data,
+                                                   sample.stack->size, &sample.ips, &sample.sps);
+        sample.unwinding_result = unwinder->GetUnwindingResult();
+      }
+      PutUnwinder(std::move(unwinder));
+    });
+    bool result = true;
+    for (const PendingSample& sample : pending_samples_) {
+      if (!sample.success || !ReportSample(sample)) {
+        result = false;
+        break;
+      }
+    }
+    pending_samples_.clear();
+    return result;
+  }
 
-    RegSet reg_set(regs.abi, regs.reg_mask, regs.regs);
-    std::vector<uint64_t> ips;
-    std::vector<uint64_t> sps;
-    if (!unwinder_->UnwindCallChain(*thread, reg_set, stack.data, stack.size, &ips, &sps)) {
-      return false;
+  std::unique_ptr<OfflineUnwinder> GetUnwinder() {
+    std::lock_guard<std::mutex> lock(unwinder_mutex_);
+    if (free_unwinders_.empty()) {
+      std::unique_ptr<OfflineUnwinder> unwinder = OfflineUnwinder::Create(true);
+      unwinder->LoadMetaInfo(reader_->GetMetaInfoFeature());
+      return unwinder;
     }
-    stat_.AddUnwindingResult(unwinder_->GetUnwindingResult());
+    std::unique_ptr<OfflineUnwinder> unwinder = std::move(free_unwinders_.back());
+    free_unwinders_.pop_back();
+    return unwinder;
+  }
+
+  void PutUnwinder(std::unique_ptr<OfflineUnwinder> unwinder) {
+    std::lock_guard<std::mutex> lock(unwinder_mutex_);
+    free_unwinders_.emplace_back(std::move(unwinder));
+  }
+
+  bool ReportSample(const PendingSample& sample) {
+    const SampleRecord& r = *sample.record;
+    ThreadEntry* thread = sample.thread;
+    const std::vector<uint64_t>& ips = sample.ips;
+    const std::vector<uint64_t>& sps = sample.sps;
+    stat_.AddUnwindingResult(sample.unwinding_result);
 
     if (!skip_sample_print_) {
       // Print unwinding result.
       fprintf(out_fp_, "sample_time: %" PRIu64 "\n", r.Timestamp());
-      DumpUnwindingResult(unwinder_->GetUnwindingResult(), out_fp_);
+      DumpUnwindingResult(sample.unwinding_result, out_fp_);
       std::vector<CallChainReportEntry> entries = callchain_report_builder_.Build(thread, ips, 0);
       for (size_t i = 0; i < entries.size(); i++) {
         size_t id = i + 1;
@@ -348,12 +438,19 @@ class SampleUnwinder : public RecordFileProcessor {
   }
 
  private:
+  // Each sample can carry up to 64K stack data. So limit memory used by pending samples.
+  static constexpr size_t kMaxPendingSamples = 1024;
+  static constexpr size_t kMinSamplesPerJob = 16;
+
   const std::unordered_set<uint64_t> sample_times_;
   bool skip_sample_print_;
   // Map from offset in recording file to the corresponding debug_unwind_file.
   std::unordered_map<uint64_t, std::pair<Dso*, uint64_t>> debug_unwind_dsos_;
   UnwindingStat stat_;
   std::unique_ptr<UnwindingResultRecord> last_unwinding_result_;
+  std::vector<PendingSample> pending_samples_;
+  std::mutex unwinder_mutex_;
+  std::vector<std::unique_ptr<OfflineUnwinder>> free_unwinders_;
 };
 
 class TestFileGenerator : public RecordFileProcessor {
@@ -18,11 +18,14 @@
 
 #include <unistd.h>
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
 
 #include "command.h"
 #include "get_test_data.h"
@@ -128,6 +131,34 @@ TEST(cmd_debug_unwind, skip_sample_print_option) {
   ASSERT_NE(output.find("unwinding_sample_count: 8"), std::string::npos);
 }
 
+TEST(cmd_debug_unwind, samples_are_reported_in_order) {
+  // Samples are unwound in parallel, but reported in recording order.
+  std::string input_data = GetTestData(PERF_DATA_NO_UNWIND);
+  CaptureStdout capture;
+
+  ASSERT_TRUE(capture.Start());
+  ASSERT_TRUE(DebugUnwindCmd()->Run({"-i", input_data, "--unwind-sample"}));
+
+  std::string output = capture.Finish();
+  std::vector<uint64_t> sample_times;
+  uint64_t error_code_sample_count = 0;
+  for (const std::string& line : android::base::Split(output, "\n")) {
+    uint64_t value;
+    if (android::base::StartsWith(line, "sample_time: ")) {
+      ASSERT_TRUE(android::base::ParseUint(line.substr(strlen("sample_time: ")), &value));
+      sample_times.push_back(value);
+    } else if (android::base::StartsWith(line, "unwinding_error_code_")) {
+      size_t pos = line.find("_count: ");
+      ASSERT_NE(pos, std::string::npos);
+      ASSERT_TRUE(android::base::ParseUint(line.substr(pos + strlen("_count: ")), &value));
+      error_code_sample_count += value;
+    }
+  }
+  ASSERT_EQ(sample_times.size(), 8u);
+  ASSERT_TRUE(std::is_sorted(sample_times.begin(), sample_times.end()));
+  ASSERT_EQ(error_code_sample_count, 8u);
+}
+
 TEST(cmd_debug_unwind, generate_test_file) {
   TemporaryFile tmpfile;
   close(tmpfile.release());
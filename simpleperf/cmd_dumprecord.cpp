@@ -574,6 +574,13 @@ bool DumpRecordCommand::DumpFeatureSection() {
           }
         }
       }
+    } else if (feature == FEAT_CALLCHAIN_NODES) {
+      const CallChainDictionary* dict = record_file_reader_->GetCallChainDictionary();
+      PrintIndented(1, "callchain_nodes: count %zu\n", dict->NodeCount() - 1);
+      for (uint32_t id = 1; id < dict->NodeCount(); id++) {
+        PrintIndented(2, "node %u: ip 0x%" PRIx64 ", parent %u\n", id, dict->GetIp(id),
+                      dict->GetParent(id));
+      }
     }
   }
   return true;
@@ -18,7 +18,10 @@
 #include <stdio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <numeric>
 #include <optional>
 #include <string>
 
@@ -372,26 +375,69 @@ class BranchListReader {
 // Convert BranchListBinaryInfo into AutoFDOBinaryInfo.
 class BranchListToAutoFDOConverter {
  public:
-  std::unique_ptr<AutoFDOBinaryInfo> Convert(const BinaryKey& key, BranchListBinaryInfo& binary) {
+  // Convert all binaries. Decoding instructions takes most of the time, so binaries are decoded
+  // in parallel, while Dsos are created on the calling thread.
+  void ConvertAll(BranchListBinaryMap& binary_map,
+                  const std::function<void(const BinaryKey&, AutoFDOBinaryInfo&)>& callback) {
+    struct Job {
+      const BinaryKey* key;
+      BranchListBinaryInfo* binary;
+      std::unique_ptr<Dso> dso;
+      std::unique_ptr<AutoFDOBinaryInfo> autofdo_binary;
+    };
+    std::vector<Job> jobs;
+    for (auto& [key, binary] : binary_map) {
+      if (std::unique_ptr<Dso> dso = CreateDso(key, binary); dso) {
+        jobs.emplace_back(Job{&key, &binary, std::move(dso), nullptr});
+      }
+    }
+    // A few big binaries (like libart.so and vmlinux) take most of the time. So start them first,
+    // and let each thread take the next job when it finishes one, instead of splitting jobs into
+    // fixed ranges.
+    std::vector<size_t> job_order(jobs.size());
+    std::iota(job_order.begin(), job_order.end(), 0);
+    std::stable_sort(job_order.begin(), job_order.end(), [&](size_t a, size_t b) {
+      return jobs[a].binary->branch_map.size() > jobs[b].binary->branch_map.size();
+    });
+    std::atomic<size_t> next_job(0);
+    RunInParallel(jobs.size(), 1, [&](size_t, size_t) {
+      for (size_t i; (i = next_job++) < job_order.size();) {
+        Job& job = jobs[job_order[i]];
+        job.autofdo_binary = Convert(job.dso.get(), *job.binary);
+      }
+    });
+    for (auto& job : jobs) {
+      if (job.autofdo_binary) {
+        job.autofdo_binary->first_load_segment_addr = GetFirstLoadSegmentVaddr(job.dso.get());
+        callback(*job.key, *job.autofdo_binary);
+      }
+    }
+  }
+
+  std::unique_ptr<Dso> CreateDso(const BinaryKey& key, BranchListBinaryInfo& binary) {
     BuildId build_id = key.build_id;
     std::unique_ptr<Dso> dso = Dso::CreateDsoWithBuildId(binary.dso_type, key.path, build_id);
     if (!dso || !CheckBuildId(dso.get(), key.build_id)) {
       return nullptr;
     }
-    std::unique_ptr<AutoFDOBinaryInfo> autofdo_binary(new AutoFDOBinaryInfo);
-    autofdo_binary->first_load_segment_addr = GetFirstLoadSegmentVaddr(dso.get());
-
+    // Find the debug file before decoding in parallel.
+    dso->GetDebugFilePath();
     if (dso->type() == DSO_KERNEL) {
       ModifyBranchMapForKernel(dso.get(), key.kernel_start_addr, binary);
     }
+    return dso;
+  }
 
+  // Can run on multiple threads for different binaries.
+  std::unique_ptr<AutoFDOBinaryInfo> Convert(Dso* dso, const BranchListBinaryInfo& binary) {
+    std::unique_ptr<AutoFDOBinaryInfo> autofdo_binary(new AutoFDOBinaryInfo);
     auto process_instr_range = [&](const ETMInstrRange& range) {
-      CHECK_EQ(range.dso, dso.get());
+      CHECK_EQ(range.dso, dso);
       autofdo_binary->AddInstrRange(range);
     };
 
-    auto result =
-        ConvertBranchMapToInstrRanges(dso.get(), binary.GetOrderedBranchMap(), process_instr_range);
+    auto result = ConvertBranchMapToInstrRanges(dso, binary.GetOrderedBranchMap(),
+                                                process_instr_range);
     if (!result.ok()) {
       LOG(WARNING) << "failed to build instr ranges for binary " << dso->Path() << ": "
                    << result.error();
@@ -734,16 +780,13 @@ class InjectCommand : public Command {
     // Step2: Convert BranchListBinaryInfo to AutoFDOBinaryInfo.
     AutoFDOWriter autofdo_writer;
     BranchListToAutoFDOConverter converter;
-    for (auto& p : branch_list_merger.binary_map) {
-      const BinaryKey& key = p.first;
-      BranchListBinaryInfo& binary = p.second;
-      std::unique_ptr<AutoFDOBinaryInfo> autofdo_binary = converter.Convert(key, binary);
-      if (autofdo_binary) {
-        // Create new BinaryKey with kernel_start_addr = 0. Because AutoFDO output doesn't care
-        // kernel_start_addr.
-        autofdo_writer.AddAutoFDOBinary(BinaryKey(key.path, key.build_id), *autofdo_binary);
-      }
-    }
+    converter.ConvertAll(branch_list_merger.binary_map,
+                         [&](const BinaryKey& key, AutoFDOBinaryInfo& autofdo_binary) {
+                           // Create new BinaryKey with kernel_start_addr = 0. Because AutoFDO
+                           // output doesn't care kernel_start_addr.
+                           autofdo_writer.AddAutoFDOBinary(BinaryKey(key.path, key.build_id),
+                                                           autofdo_binary);
+                         });
 
     // Step3: Write AutoFDOBinaryInfo.
     return autofdo_writer.Write(output_filename_);
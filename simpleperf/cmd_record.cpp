@@ -22,10 +22,13 @@
 #include <sys/utsname.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 #include <filesystem>
+#include <map>
 #include <optional>
 #include <set>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -48,6 +51,7 @@
 #endif
 #include <unwindstack/Error.h>
 
+#include "CallChainDictionary.h"
 #include "CallChainJoiner.h"
 #include "ETMBranchListFile.h"
 #include "ETMRecorder.h"
@@ -57,12 +61,14 @@
 #include "OfflineUnwinder.h"
 #include "ProbeEvents.h"
 #include "RecordFilter.h"
+#include "UserStackDelta.h"
 #include "cmd_record_impl.h"
 #include "command.h"
 #include "environment.h"
 #include "event_selection_set.h"
 #include "event_type.h"
 #include "kallsyms.h"
+#include "live_report.h"
 #include "read_apk.h"
 #include "read_elf.h"
 #include "read_symbol_map.h"
@@ -114,6 +120,14 @@ static constexpr size_t kDefaultAuxBufferSize = 4 * kMegabyte;
 // On Pixel 3, it takes about 1ms to enable ETM, and 16-40ms to disable ETM and copy 4M ETM data.
 // So make default period to 100ms.
 static constexpr double kDefaultEtmDataFlushPeriodInSec = 0.1;
+static constexpr uint64_t kDefaultEtmDecodeQueueSize = 16 * 1024 * 1024;
+
+// Default period to check recording overhead with --adaptive-sampling.
+static constexpr double kDefaultAdaptiveSamplingPeriodInSec = 1;
+
+// Max JIT debug infos kept to dump at the start of each segment. When exceeded, the oldest ones
+// are dropped.
+static constexpr size_t kMaxSegmentJITDebugInfos = 65536;
 
 struct TimeStat {
   uint64_t prepare_recording_time = 0;
@@ -243,6 +257,13 @@ class RecordCommand : public Command {
 "--no-inherit  Don't record created child threads/processes.\n"
 "--cpu-percent <percent>  Set the max percent of cpu time used for recording.\n"
 "                         percent is in range [1-100], default is 25.\n"
+"--adaptive-sampling  Adjust sample rates while recording to control the overhead. Sample\n"
+"                     rates are reduced when samples are lost, the record buffer is filling\n"
+"                     up, or simpleperf uses more cpu time than set by --cpu-percent. They\n"
+"                     are restored when the overhead is low again. Tracepoint events and\n"
+"                     events sampled every time (like with --trace-offcpu) aren't scaled.\n"
+"--adaptive-sampling-period <sec>  Check the overhead every <sec> seconds with\n"
+"                                  --adaptive-sampling. Default is 1.\n"
 "\n"
 "--tp-filter filter_string    Set filter_string for the previous tracepoint event.\n"
 "                             Format is in Documentation/trace/events.rst in the kernel.\n"
@@ -256,6 +277,10 @@ class RecordCommand : public Command {
 "--no-unwind   If `--call-graph dwarf` option is used, then the user's stack\n"
 "              will be unwound by default. Use this option to disable the\n"
 "              unwinding of the user's stack.\n"
+"--delta-encode-stack  When the user's stack is kept in perf.data (with --no-unwind or\n"
+"                      --post-unwind=yes), only store stack blocks changed since the\n"
+"                      previous sample of the same thread. It reduces the size of\n"
+"                      perf.data, but older simpleperf versions can't read it.\n"
 "--no-callchain-joiner  If `--call-graph dwarf` option is used, then by default\n"
 "                       callchain joiner is used to break the 64k stack limit\n"
 "                       and build more complete call graphs. However, the built\n"
@@ -276,6 +301,10 @@ class RecordCommand : public Command {
 RECORD_FILTER_OPTION_HELP_MSG_FOR_RECORDING
 "\n"
 "Recording file options:\n"
+"--intern-callchains  Store each distinct callchain frame once in perf.data, and make samples\n"
+"                     refer to their leaf frames. It reduces the size of perf.data recorded\n"
+"                     with call graphs, but older simpleperf versions can't read it.\n"
+"                     It can't be used with ETM recording.\n"
 "--no-dump-kernel-symbols  Don't dump kernel symbols in perf.data. By default\n"
 "                          kernel symbols will be dumped when needed.\n"
 "--no-dump-symbols       Don't dump symbols in perf.data. By default symbols are\n"
@@ -284,6 +313,14 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_RECORDING
 "-o record_file_name    Set record file name, default is perf.data.\n"
 "--size-limit SIZE[K|M|G]      Stop recording after SIZE bytes of records.\n"
 "                              Default is unlimited.\n"
+"--segment-size SIZE[K|M|G]    Split records into self-contained segments of about SIZE bytes.\n"
+"                              Segments are named <record_file_name>.0, <record_file_name>.1,\n"
+"                              etc. Each segment has its own maps, symbols and features, and\n"
+"                              can be reported once it is finished. It can't be used with\n"
+"                              --post-unwind=yes, ETM recording, or --app on non-rooted\n"
+"                              devices. It disables callchain joiner.\n"
+"--segment-duration <seconds>  Start a new segment every <seconds>. It can be used together\n"
+"                              with --segment-size.\n"
 "--symfs <dir>    Look for files with symbols relative to this directory.\n"
 "                 This option is used to provide files with symbol table and\n"
 "                 debug information, which are used for unwinding and dumping symbols.\n"
@@ -311,9 +348,30 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_RECORDING
 "                                 Used memory size is (buffer_size * (cpu_count + 1).\n"
 "                                 Default is 4M.\n"
 "--decode-etm                     Convert ETM data into branch lists while recording.\n"
+"--decode-etm-queue-size <size>   Used with --decode-etm. ETM data is decoded on a separate\n"
+"                                 thread, using a queue of at most <size> bytes. When the queue\n"
+"                                 is full, reading records waits for decoding. Default is 16M.\n"
+"                                 If it is 0, ETM data is decoded on the record reading thread.\n"
 "--binary binary_name             Used with --decode-etm to only generate data for binaries\n"
 "                                 matching binary_name regex.\n"
 "\n"
+"Live report options:\n"
+"--live-report    Aggregate samples while recording, and periodically print functions taking\n"
+"                 the most samples of each event. Samples are symbolized on a separate thread.\n"
+"                 When the thread can't keep up, samples are dropped from the live report (but\n"
+"                 not from the record file). perf.data isn't written unless -o is used.\n"
+"                 It can't be used with ETM recording, segmented output, or\n"
+"                 `--call-graph dwarf` without --no-unwind. With -g or `--call-graph fp`,\n"
+"                 children overhead is also shown.\n"
+"--live-report-interval <seconds>   Print the live report every <seconds>. Default is 1.\n"
+"--live-report-top <n>              Show at most <n> functions of each event. Default is 20.\n"
+"--live-report-half-life <seconds>  Decay samples in the live report, so a sample's weight\n"
+"                                   is halved every <seconds>. By default, samples don't\n"
+"                                   decay.\n"
+"--live-report-fd <fd>    Instead of printing text reports, write a json snapshot per line\n"
+"                         to <fd>. Each snapshot has the top functions of each event, with\n"
+"                         self (and children) overhead as ratios of the event count.\n"
+"\n"
 "Other options:\n"
 "--exit-with-parent            Stop recording when the thread starting simpleperf dies.\n"
 "--use-cmd-exit-code           Exit with the same exit code as the monitored cmdline.\n"
@@ -358,6 +416,9 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_RECORDING
     // to stdout/stderr, which is a problem when we use '--app' option. So ignore SIGPIPE to
     // finish properly.
     signal(SIGPIPE, SIG_IGN);
+    // MapEntries and thread names are only used while processing a record. So free replaced
+    // ones, which can be many for JIT-heavy apps in long recordings.
+    thread_tree_.EnableStorageReclaim();
   }
 
   std::string LongHelpString() const override;
@@ -379,12 +440,16 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_RECORDING
   bool TraceOffCpu();
   bool SetEventSelectionFlags();
   bool CreateAndInitRecordFile();
+  bool IsSegmented() const { return segment_size_in_bytes_ > 0 || segment_duration_in_sec_ > 0; }
+  std::string GetSegmentFilename() const;
+  bool StartNewSegment();
   std::unique_ptr<RecordFileWriter> CreateRecordFile(const std::string& filename,
                                                      const EventAttrIds& attrs);
   bool DumpKernelSymbol();
   bool DumpTracingData();
   bool DumpMaps();
   bool DumpAuxTraceInfo();
+  bool AdjustSampleRates();
 
   // recording functions
   bool ProcessRecord(Record* record);
@@ -393,18 +458,32 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_RECORDING
   bool SaveRecordForPostUnwinding(Record* record);
   bool SaveRecordAfterUnwinding(Record* record);
   bool SaveRecordWithoutUnwinding(Record* record);
+  bool WriteRecordWithStackDelta(Record& record);
   bool ProcessJITDebugInfo(const std::vector<JITDebugInfo>& debug_info, bool sync_kernel_records);
+  void KeepJITDebugInfoForSegments(const std::vector<JITDebugInfo>& debug_info);
+  std::vector<JITDebugInfo> GetJITDebugInfoForSegment();
   bool ProcessControlCmd(IOEventLoop* loop);
   void UpdateRecord(Record* record);
   bool UnwindRecord(SampleRecord& r);
   bool KeepFailedUnwindingResult(const SampleRecord& r, const std::vector<uint64_t>& ips,
                                  const std::vector<uint64_t>& sps);
 
+  // Information collected from records to dump features.
+  struct HitFileInfo {
+    std::unordered_set<int> loaded_symbol_maps;
+    std::unordered_set<Dso*> debug_unwinding_files;
+    bool failed_unwinding_sample = false;
+  };
+
+  void StartCollectingHitFileInfo();
+  void AddHitFileInfo(const Record& r, HitFileInfo* info);
+
   // post recording functions
   std::unique_ptr<RecordFileReader> MoveRecordFile(const std::string& old_filename);
   bool MergeMapRecords();
   bool PostUnwindRecords();
   bool JoinCallChains();
+  bool InternCallChains();
   bool DumpAdditionalFeatures(const std::vector<std::string>& args);
   bool DumpBuildIdFeature();
   bool DumpFileFeature();
@@ -422,6 +501,10 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_RECORDING
   bool post_unwind_;
   bool keep_failed_unwinding_result_ = false;
   bool keep_failed_unwinding_debug_info_ = false;
+  bool delta_encode_stack_ = false;
+  std::unique_ptr<UserStackDeltaEncoder> stack_delta_encoder_;
+  bool intern_callchains_ = false;
+  std::unique_ptr<CallChainDictionary> callchain_dict_;
   std::unique_ptr<OfflineUnwinder> offline_unwinder_;
   bool child_inherit_;
   double duration_in_sec_;
@@ -453,6 +536,13 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_RECORDING
   uint64_t max_sample_freq_ = DEFAULT_SAMPLE_FREQ_FOR_NONTRACEPOINT_EVENT;
   size_t cpu_time_max_percent_ = 25;
 
+  // For --adaptive-sampling
+  std::unique_ptr<SampleRateGovernor> sample_rate_governor_;
+  double adaptive_sampling_period_in_sec_ = kDefaultAdaptiveSamplingPeriodInSec;
+  uint64_t governor_lost_records_ = 0;
+  uint64_t governor_cpu_time_ = 0;
+  uint64_t governor_wall_time_ = 0;
+
   // For CallChainJoiner
   bool allow_callchain_joiner_;
   size_t callchain_joiner_min_matching_nodes_;
@@ -465,6 +555,21 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_RECORDING
   EventAttrWithId dumping_attr_id_;
   // In system wide recording, record if we have dumped map info for a process.
   std::unordered_set<pid_t> dumped_processes_;
+
+  // For --segment-size and --segment-duration
+  uint64_t segment_size_in_bytes_ = 0;
+  double segment_duration_in_sec_ = 0;
+  size_t segment_index_ = 0;
+  uint64_t finished_segments_size_ = 0;
+  std::vector<std::string> record_args_;
+  // JIT debug info is dumped again at the start of each segment. Only the latest info of each
+  // JIT code address or dex file is kept, with keys (pid, type, jit_code_addr or
+  // dex_file_offset, file_path of dex files).
+  std::map<std::tuple<pid_t, int, uint64_t, std::string>, JITDebugInfo> jit_debug_infos_;
+  // Segments collect hit file info while writing records, so finishing a segment doesn't need to
+  // read it again.
+  std::optional<HitFileInfo> segment_hit_file_info_;
+  bool segment_kernel_symbols_available_ = false;
   bool exclude_perf_ = false;
   RecordFilter record_filter_;
 
@@ -476,7 +581,15 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_RECORDING
   std::vector<std::string> add_counters_;
 
   std::unique_ptr<ETMBranchListGenerator> etm_branch_list_generator_;
+  uint64_t etm_decode_queue_size_ = kDefaultEtmDecodeQueueSize;
   std::unique_ptr<RegEx> binary_name_regex_;
+
+  // For --live-report
+  bool live_report_ = false;
+  LiveReportOptions live_report_options_;
+  std::unique_ptr<LiveReporter> live_reporter_;
+  // With --live-report, perf.data is only written when -o or --out-fd is used.
+  bool write_record_file_ = true;
 };
 
 std::string RecordCommand::LongHelpString() const {
@@ -553,6 +666,7 @@ void RecordCommand::Run(const std::vector<std::string>& args, int* exit_code) {
       return;
     }
   }
+  record_args_ = args;
   if (!PrepareRecording(workload.get())) {
     return;
   }
@@ -670,12 +784,28 @@ bool RecordCommand::PrepareRecording(Workload* workload) {
                                            allow_truncating_samples_, exclude_perf_)) {
     return false;
   }
-  auto callback = std::bind(&RecordCommand::ProcessRecord, this, std::placeholders::_1);
+  auto callback = [this](Record* record) {
+    // Only switch segments between records read from the kernel, so records dumped for a record
+    // (like maps for a sample) are in the same segment.
+    if (segment_size_in_bytes_ > 0 &&
+        record_file_writer_->GetDataSectionSize() >= segment_size_in_bytes_ &&
+        !StartNewSegment()) {
+      return false;
+    }
+    return ProcessRecord(record);
+  };
   if (!event_selection_set_.PrepareToReadMmapEventData(callback)) {
     return false;
   }
 
-  // 6. Create perf.data.
+  // 6. Create perf.data, and the live reporter receiving records dumped with it.
+  if (live_report_) {
+    live_reporter_ =
+        LiveReporter::Create(live_report_options_, event_selection_set_.GetEventAttrWithId());
+    if (!live_reporter_) {
+      return false;
+    }
+  }
   if (!CreateAndInitRecordFile()) {
     return false;
   }
@@ -714,8 +844,17 @@ bool RecordCommand::PrepareRecording(Workload* workload) {
       return false;
     }
   }
+  if (segment_duration_in_sec_ > 0) {
+    if (!loop->AddPeriodicEvent(SecondToTimeval(segment_duration_in_sec_),
+                                [this]() { return StartNewSegment(); })) {
+      return false;
+    }
+  }
   if (jit_debug_reader_) {
     auto callback = [this](const std::vector<JITDebugInfo>& debug_info, bool sync_kernel_records) {
+      if (IsSegmented()) {
+        KeepJITDebugInfoForSegments(debug_info);
+      }
       return ProcessJITDebugInfo(debug_info, sync_kernel_records);
     };
     if (!jit_debug_reader_->RegisterDebugInfoCallback(loop, callback)) {
@@ -739,6 +878,14 @@ bool RecordCommand::PrepareRecording(Workload* workload) {
       }
     }
   }
+  if (sample_rate_governor_) {
+    governor_cpu_time_ = GetProcessCpuTime();
+    governor_wall_time_ = GetSystemClock();
+    if (!loop->AddPeriodicEvent(SecondToTimeval(adaptive_sampling_period_in_sec_),
+                                [this]() { return AdjustSampleRates(); })) {
+      return false;
+    }
+  }
   if (event_selection_set_.HasAuxTrace()) {
     // ETM data is dumped to kernel buffer only when there is no thread traced by ETM. It happens
     // either when all monitored threads are scheduled off cpu, or when all etm perf events are
@@ -761,6 +908,11 @@ bool RecordCommand::PrepareRecording(Workload* workload) {
       if (binary_name_regex_) {
         etm_branch_list_generator_->SetBinaryFilter(binary_name_regex_.get());
       }
+      if (etm_decode_queue_size_ != 0) {
+        etm_branch_list_generator_ = ETMBranchListGenerator::CreateWithDecodeThread(
+            std::move(etm_branch_list_generator_), dumping_attr_id_.attr,
+            static_cast<size_t>(etm_decode_queue_size_));
+      }
     }
   }
   return true;
@@ -826,6 +978,16 @@ bool RecordCommand::PostProcessRecording(const std::vector<std::string>& args) {
   if (!event_selection_set_.FinishReadMmapEventData()) {
     return false;
   }
+  if (live_reporter_) {
+    bool result = live_reporter_->Finish();
+    if (uint64_t dropped = live_reporter_->DroppedSamples(); dropped != 0) {
+      LOG(INFO) << "Samples dropped by the live report: " << ReadableCount(dropped);
+    }
+    live_reporter_.reset();
+    if (!result) {
+      return false;
+    }
+  }
 
   // 2. Merge map records dumped while recording by map record thread.
   if (map_record_thread_) {
@@ -847,14 +1009,16 @@ bool RecordCommand::PostProcessRecording(const std::vector<std::string>& args) {
   }
 
   // 5. Dump additional features, and close record file.
-  if (!DumpAdditionalFeatures(args)) {
-    return false;
-  }
-  if (!record_file_writer_->Close()) {
-    return false;
-  }
-  if (out_fd_ != -1 && !WriteRecordDataToOutFd(record_filename_, std::move(out_fd_))) {
-    return false;
+  if (record_file_writer_) {
+    if (!DumpAdditionalFeatures(args)) {
+      return false;
+    }
+    if (!record_file_writer_->Close()) {
+      return false;
+    }
+    if (out_fd_ != -1 && !WriteRecordDataToOutFd(record_filename_, std::move(out_fd_))) {
+      return false;
+    }
   }
   time_stat_.post_process_time = GetSystemClock();
 
@@ -866,6 +1030,19 @@ bool RecordCommand::PostProcessRecording(const std::vector<std::string>& args) {
       LOG(INFO) << "Aux data lost in user space: " << ReadableCount(record_stat.lost_aux_data_size)
                 << ", consider increasing userspace buffer size(--user-buffer-size).";
     }
+    if (etm_branch_list_generator_) {
+      if (const ETMDecodeQueueStat* stat = etm_branch_list_generator_->GetDecodeQueueStat();
+          stat != nullptr) {
+        LOG(INFO) << "ETM decode queue: " << stat->record_count << " records, "
+                  << ReadableCount(stat->aux_data_size) << " aux data, max queued "
+                  << ReadableCount(stat->max_queue_size);
+        if (stat->blocked_count != 0) {
+          LOG(INFO) << "Waited for ETM decoding " << stat->blocked_count << " times, "
+                    << stat->blocked_time_in_ns / 1000000 << " ms in total"
+                    << ", consider increasing --decode-etm-queue-size.";
+        }
+      }
+    }
   } else {
     // Here we report all lost records as samples. This isn't accurate. Because records like
     // MmapRecords are not samples. But It's easier for users to understand.
@@ -958,6 +1135,12 @@ bool RecordCommand::ParseOptions(const std::vector<std::string>& args,
     add_counters_ = android::base::Split(*value->str_value, ",");
   }
 
+  bool adaptive_sampling = options.PullBoolValue("--adaptive-sampling");
+  if (!options.PullDoubleValue("--adaptive-sampling-period", &adaptive_sampling_period_in_sec_,
+                               1e-3)) {
+    return false;
+  }
+
   for (const OptionValue& value : options.PullValues("--add-meta-info")) {
     const std::string& s = *value.str_value;
     auto split_pos = s.find('=');
@@ -1034,6 +1217,12 @@ bool RecordCommand::ParseOptions(const std::vector<std::string>& args,
   if (options.PullBoolValue("--decode-etm")) {
     etm_branch_list_generator_ = ETMBranchListGenerator::Create(system_wide_collection_);
   }
+  if (!options.PullUintValue("--decode-etm-queue-size", &etm_decode_queue_size_, 0,
+                             std::numeric_limits<size_t>::max())) {
+    return false;
+  }
+
+  delta_encode_stack_ = options.PullBoolValue("--delta-encode-stack");
 
   if (!options.PullDoubleValue("--duration", &duration_in_sec_, 1e-9)) {
     return false;
@@ -1049,6 +1238,7 @@ bool RecordCommand::ParseOptions(const std::vector<std::string>& args,
   }
 
   in_app_context_ = options.PullBoolValue("--in-app");
+  intern_callchains_ = options.PullBoolValue("--intern-callchains");
 
   for (const OptionValue& value : options.PullValues("-j")) {
     std::vector<std::string> branch_sampling_types = android::base::Split(*value.str_value, ",");
@@ -1076,6 +1266,22 @@ bool RecordCommand::ParseOptions(const std::vector<std::string>& args,
     }
   }
 
+  live_report_ = options.PullBoolValue("--live-report");
+  if (auto value = options.PullValue("--live-report-fd"); value) {
+    live_report_options_.snapshot_fd = static_cast<int>(value->uint_value);
+  }
+  if (!options.PullDoubleValue("--live-report-half-life", &live_report_options_.half_life_in_sec,
+                               1e-3)) {
+    return false;
+  }
+  if (!options.PullDoubleValue("--live-report-interval", &live_report_options_.interval_in_sec,
+                               1e-3)) {
+    return false;
+  }
+  if (!options.PullUintValue("--live-report-top", &live_report_options_.top_n, 1)) {
+    return false;
+  }
+
   if (auto value = options.PullValue("-m"); value) {
     if (!IsPowerOfTwo(value->uint_value) ||
         value->uint_value > std::numeric_limits<size_t>::max()) {
@@ -1098,12 +1304,15 @@ bool RecordCommand::ParseOptions(const std::vector<std::string>& args,
   }
   unwind_dwarf_callchain_ = !options.PullBoolValue("--no-unwind");
 
+  bool record_file_requested = false;
   if (auto value = options.PullValue("-o"); value) {
     record_filename_ = *value->str_value;
+    record_file_requested = true;
   }
 
   if (auto value = options.PullValue("--out-fd"); value) {
     out_fd_.reset(static_cast<int>(value->uint_value));
+    record_file_requested = true;
   }
 
   if (auto strs = options.PullStringValues("-p"); !strs.empty()) {
@@ -1137,6 +1346,12 @@ bool RecordCommand::ParseOptions(const std::vector<std::string>& args,
   if (!options.PullUintValue("--size-limit", &size_limit_in_bytes_, 1)) {
     return false;
   }
+  if (!options.PullUintValue("--segment-size", &segment_size_in_bytes_, 1)) {
+    return false;
+  }
+  if (!options.PullDoubleValue("--segment-duration", &segment_duration_in_sec_, 1e-9)) {
+    return false;
+  }
 
   if (auto value = options.PullValue("--start_profiling_fd"); value) {
     start_profiling_fd_.reset(static_cast<int>(value->uint_value));
@@ -1272,6 +1487,83 @@ bool RecordCommand::ParseOptions(const std::vector<std::string>& args,
       post_unwind_ = false;
     }
   }
+  if (delta_encode_stack_) {
+    if (!dwarf_callchain_sampling_ || (unwind_dwarf_callchain_ && !post_unwind_)) {
+      LOG(ERROR) << "--delta-encode-stack is only used with `--call-graph dwarf` and "
+                 << "--no-unwind or --post-unwind=yes.";
+      return false;
+    }
+    stack_delta_encoder_.reset(new UserStackDeltaEncoder);
+  }
+  if (intern_callchains_ && !fp_callchain_sampling_ && !dwarf_callchain_sampling_) {
+    LOG(ERROR) << "--intern-callchains is only used with --call-graph or -g.";
+    return false;
+  }
+  if (intern_callchains_ && event_selection_set_.HasAuxTrace()) {
+    // Interning callchains rewrites the data section, which moves AUXTRACE records.
+    LOG(ERROR) << "--intern-callchains can't be used with ETM recording.";
+    return false;
+  }
+  if (IsSegmented()) {
+    if (post_unwind_) {
+      LOG(ERROR) << "--segment-size/--segment-duration can't be used with --post-unwind=yes.";
+      return false;
+    }
+    if (intern_callchains_) {
+      LOG(ERROR) << "--segment-size/--segment-duration can't be used with --intern-callchains.";
+      return false;
+    }
+    if (event_selection_set_.HasAuxTrace()) {
+      LOG(ERROR) << "--segment-size/--segment-duration can't be used with ETM recording.";
+      return false;
+    }
+    // Recording in app context writes to a single output fd.
+    if (out_fd_ != -1 || (!app_package_name_.empty() && !IsRoot())) {
+      LOG(ERROR) << "--segment-size/--segment-duration can't be used with --out-fd, or with "
+                 << "--app on non-rooted devices.";
+      return false;
+    }
+    // CallChainJoiner joins callchains of the whole recording after recording.
+    allow_callchain_joiner_ = false;
+  }
+  if (live_report_) {
+    if (event_selection_set_.HasAuxTrace()) {
+      LOG(ERROR) << "--live-report can't be used with ETM recording.";
+      return false;
+    }
+    // Unwinding on the record thread and symbolizing on the live report thread would access
+    // dsos on two threads.
+    if (unwind_dwarf_callchain_) {
+      LOG(ERROR) << "--live-report can't be used with `--call-graph dwarf` without --no-unwind.";
+      return false;
+    }
+    // Starting a new segment loads symbols of dsos on the record thread, while the live report
+    // thread symbolizes samples using the same dsos.
+    if (IsSegmented()) {
+      LOG(ERROR) << "--live-report can't be used with --segment-size/--segment-duration.";
+      return false;
+    }
+    if (!app_package_name_.empty() && !IsRoot()) {
+      LOG(ERROR) << "--live-report can't be used with --app on non-rooted devices.";
+      return false;
+    }
+    write_record_file_ = record_file_requested;
+    if (!write_record_file_ && size_limit_in_bytes_ > 0) {
+      LOG(ERROR) << "--size-limit needs -o when used with --live-report.";
+      return false;
+    }
+    live_report_options_.accumulate_callchain = fp_callchain_sampling_ || dwarf_callchain_sampling_;
+  } else if (live_report_options_.snapshot_fd != -1) {
+    LOG(ERROR) << "--live-report-fd is only used with --live-report.";
+    return false;
+  }
+  if (adaptive_sampling) {
+    if (event_selection_set_.HasAuxTrace()) {
+      LOG(ERROR) << "--adaptive-sampling can't be used with ETM recording.";
+      return false;
+    }
+    sample_rate_governor_.reset(new SampleRateGovernor(cpu_time_max_percent_));
+  }
 
   if (fp_callchain_sampling_) {
     if (GetTargetArch() == ARCH_ARM) {
@@ -1394,9 +1686,12 @@ bool RecordCommand::CreateAndInitRecordFile() {
       ReplaceRegAndStackWithCallChain(attr.attr);
     }
   }
-  record_file_writer_ = CreateRecordFile(record_filename_, attrs);
-  if (record_file_writer_ == nullptr) {
-    return false;
+  if (write_record_file_) {
+    record_file_writer_ =
+        CreateRecordFile(IsSegmented() ? GetSegmentFilename() : record_filename_, attrs);
+    if (record_file_writer_ == nullptr) {
+      return false;
+    }
   }
   // Use first perf_event_attr and first event id to dump mmap and comm records.
   CHECK(!attrs.empty());
@@ -1405,10 +1700,48 @@ bool RecordCommand::CreateAndInitRecordFile() {
   map_record_reader_.emplace(dumping_attr_id_.attr, dumping_attr_id_.ids[0],
                              event_selection_set_.RecordNotExecutableMaps());
   map_record_reader_->SetCallback([this](Record* r) { return ProcessRecord(r); });
+  if (IsSegmented()) {
+    StartCollectingHitFileInfo();
+  }
 
   return DumpKernelSymbol() && DumpTracingData() && DumpMaps() && DumpAuxTraceInfo();
 }
 
+std::string RecordCommand::GetSegmentFilename() const {
+  return record_filename_ + "." + std::to_string(segment_index_);
+}
+
+// Finish the current segment and start a new one. To make each segment self-contained, the new
+// segment gets kernel symbols, tracing data, maps of monitored processes and JIT maps again.
+// In system wide recording, maps of a process are dumped again when needed by records. Hit files
+// are collected while writing a segment, so finishing it doesn't read it again.
+bool RecordCommand::StartNewSegment() {
+  uint64_t segment_size = record_file_writer_->GetDataSectionSize();
+  if (!DumpAdditionalFeatures(record_args_) || !record_file_writer_->Close()) {
+    return false;
+  }
+  LOG(INFO) << "Segment " << GetSegmentFilename() << " is finished.";
+  finished_segments_size_ += segment_size;
+  segment_index_++;
+  dumped_processes_.clear();
+  if (stack_delta_encoder_) {
+    stack_delta_encoder_.reset(new UserStackDeltaEncoder);
+  }
+  if (!CreateAndInitRecordFile()) {
+    return false;
+  }
+  if (jit_debug_reader_ && !ProcessJITDebugInfo(GetJITDebugInfoForSegment(), false)) {
+    return false;
+  }
+  if (sample_rate_governor_ && sample_rate_governor_->Divisor() > 1) {
+    SampleRateRecord record(last_record_timestamp_, sample_rate_governor_->Divisor());
+    if (!ProcessRecord(&record)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 std::unique_ptr<RecordFileWriter> RecordCommand::CreateRecordFile(const std::string& filename,
                                                                   const EventAttrIds& attrs) {
   std::unique_ptr<RecordFileWriter> writer = RecordFileWriter::CreateInstance(filename);
@@ -1491,6 +1824,7 @@ bool RecordCommand::DumpMaps() {
     if (!map_record_reader_->ReadProcessMaps(pid, tids, 0)) {
       return false;
     }
+    dumped_processes_.insert(pid);
   }
   return true;
 }
@@ -1501,7 +1835,7 @@ bool RecordCommand::ProcessRecord(Record* record) {
     return true;
   }
   if (size_limit_in_bytes_ > 0u) {
-    if (size_limit_in_bytes_ < record_file_writer_->GetDataSectionSize()) {
+    if (size_limit_in_bytes_ < finished_segments_size_ + record_file_writer_->GetDataSectionSize()) {
       return event_selection_set_.GetIOEventLoop()->ExitLoop();
     }
   }
@@ -1509,8 +1843,9 @@ bool RecordCommand::ProcessRecord(Record* record) {
     return false;
   }
   last_record_timestamp_ = std::max(last_record_timestamp_, record->Timestamp());
-  // In system wide recording, maps are dumped when they are needed by records.
-  if (system_wide_collection_ && !DumpMapsForRecord(record)) {
+  // In system wide recording, maps are dumped when they are needed by records. So are maps of
+  // processes not monitored from the start in segments after the first one.
+  if ((system_wide_collection_ || segment_index_ > 0) && !DumpMapsForRecord(record)) {
     return false;
   }
   // Record filter check should go after DumpMapsForRecord(). Otherwise, process/thread name
@@ -1519,6 +1854,8 @@ bool RecordCommand::ProcessRecord(Record* record) {
     if (!record_filter_.Check(static_cast<SampleRecord*>(record))) {
       return true;
     }
+  } else if (live_reporter_ && !live_reporter_->AddRecord(*record)) {
+    return false;
   }
   if (etm_branch_list_generator_) {
     bool consumed = false;
@@ -1538,6 +1875,43 @@ bool RecordCommand::ProcessRecord(Record* record) {
   return SaveRecordWithoutUnwinding(record);
 }
 
+bool RecordCommand::AdjustSampleRates() {
+  // The read thread keeps updating the stat, so get a copy from it.
+  RecordStat stat;
+  if (!event_selection_set_.GetRecordStatWhileReading(&stat)) {
+    return false;
+  }
+  uint64_t lost_records = stat.kernelspace_lost_records + stat.userspace_lost_samples +
+                          stat.userspace_lost_non_samples + stat.userspace_truncated_stack_samples;
+  uint64_t cpu_time = GetProcessCpuTime();
+  uint64_t wall_time = GetSystemClock();
+
+  SampleRateGovernor::Overhead overhead;
+  overhead.lost_records = lost_records - governor_lost_records_;
+  overhead.free_buffer_ratio = event_selection_set_.GetFreeRecordBufferRatio();
+  if (wall_time > governor_wall_time_) {
+    overhead.cpu_percent =
+        100.0 * (cpu_time - governor_cpu_time_) / (wall_time - governor_wall_time_);
+  }
+  governor_lost_records_ = lost_records;
+  governor_cpu_time_ = cpu_time;
+  governor_wall_time_ = wall_time;
+
+  uint64_t old_divisor = sample_rate_governor_->Divisor();
+  uint64_t divisor = sample_rate_governor_->Update(overhead);
+  if (divisor == old_divisor) {
+    return true;
+  }
+  LOG(DEBUG) << "Scale sample rates to 1/" << divisor << ", lost records "
+             << overhead.lost_records << ", free buffer ratio " << overhead.free_buffer_ratio
+             << ", cpu percent " << overhead.cpu_percent;
+  if (!event_selection_set_.ScaleDownSampleRates(divisor)) {
+    return false;
+  }
+  SampleRateRecord record(last_record_timestamp_, divisor);
+  return ProcessRecord(&record);
+}
+
 bool RecordCommand::DumpAuxTraceInfo() {
   if (event_selection_set_.HasAuxTrace()) {
     AuxTraceInfoRecord auxtrace_info = ETMRecorder::GetInstance().CreateAuxTraceInfoRecord();
@@ -1583,7 +1957,7 @@ bool RecordCommand::DumpMapsForRecord(Record* record) {
 }
 
 bool RecordCommand::SaveRecordForPostUnwinding(Record* record) {
-  if (!record_file_writer_->WriteRecord(*record)) {
+  if (!WriteRecordWithStackDelta(*record)) {
     LOG(ERROR) << "If there isn't enough space for storing profiling data, consider using "
                << "--no-post-unwind option.";
     return false;
@@ -1610,6 +1984,9 @@ bool RecordCommand::SaveRecordAfterUnwinding(Record* record) {
   } else {
     thread_tree_.Update(*record);
   }
+  if (segment_hit_file_info_) {
+    AddHitFileInfo(*record, &segment_hit_file_info_.value());
+  }
   return record_file_writer_->WriteRecord(*record);
 }
 
@@ -1624,8 +2001,35 @@ bool RecordCommand::SaveRecordWithoutUnwinding(Record* record) {
       return true;
     }
     sample_record_count_++;
+    if (live_reporter_) {
+      live_reporter_->AddSample(r);
+    }
   }
-  return record_file_writer_->WriteRecord(*record);
+  if (!record_file_writer_) {
+    // With --live-report and no record file, records are only used by the live report.
+    return true;
+  }
+  if (segment_hit_file_info_) {
+    if (record->type() != PERF_RECORD_SAMPLE) {
+      thread_tree_.Update(*record);
+    }
+    AddHitFileInfo(*record, &segment_hit_file_info_.value());
+  }
+  return WriteRecordWithStackDelta(*record);
+}
+
+bool RecordCommand::WriteRecordWithStackDelta(Record& record) {
+  if (stack_delta_encoder_) {
+    if (record.type() == PERF_RECORD_SAMPLE) {
+      auto delta = stack_delta_encoder_->Encode(static_cast<SampleRecord&>(record));
+      if (delta && !record_file_writer_->WriteRecord(*delta)) {
+        return false;
+      }
+    } else if (record.type() == PERF_RECORD_EXIT) {
+      stack_delta_encoder_->RemoveThread(static_cast<ExitRecord&>(record).data->tid);
+    }
+  }
+  return record_file_writer_->WriteRecord(record);
 }
 
 bool RecordCommand::ProcessJITDebugInfo(const std::vector<JITDebugInfo>& debug_info,
@@ -1653,6 +2057,9 @@ bool RecordCommand::ProcessJITDebugInfo(const std::vector<JITDebugInfo>& debug_i
         }
       }
       thread_tree_.AddDexFileOffset(info.file_path, info.dex_file_offset);
+      if (live_reporter_) {
+        live_reporter_->AddDexFileOffset(info.file_path, info.dex_file_offset);
+      }
     }
   }
   // We want to let samples see the most recent JIT maps generated before them, but no JIT maps
@@ -1665,6 +2072,62 @@ bool RecordCommand::ProcessJITDebugInfo(const std::vector<JITDebugInfo>& debug_i
   return true;
 }
 
+void RecordCommand::KeepJITDebugInfoForSegments(const std::vector<JITDebugInfo>& debug_info) {
+  for (const JITDebugInfo& info : debug_info) {
+    if (info.type == JITDebugInfo::JIT_DEBUG_JIT_CODE) {
+      // JIT code replaces old JIT code at overlapping addresses.
+      auto key = std::make_tuple(info.pid, static_cast<int>(info.type), info.jit_code_addr,
+                                 std::string());
+      auto it = jit_debug_infos_.lower_bound(key);
+      if (it != jit_debug_infos_.begin()) {
+        auto prev = std::prev(it);
+        const JITDebugInfo& prev_info = prev->second;
+        if (prev_info.pid == info.pid && prev_info.type == info.type &&
+            prev_info.jit_code_addr + prev_info.jit_code_len > info.jit_code_addr) {
+          jit_debug_infos_.erase(prev);
+        }
+      }
+      while (it != jit_debug_infos_.end() && it->second.pid == info.pid &&
+             it->second.type == info.type &&
+             it->second.jit_code_addr < info.jit_code_addr + info.jit_code_len) {
+        it = jit_debug_infos_.erase(it);
+      }
+      jit_debug_infos_.emplace(std::move(key), info);
+    } else {
+      auto key = std::make_tuple(info.pid, static_cast<int>(info.type), info.dex_file_offset,
+                                 info.file_path);
+      jit_debug_infos_.insert_or_assign(std::move(key), info);
+    }
+  }
+  if (jit_debug_infos_.size() > kMaxSegmentJITDebugInfos) {
+    // Drop the oldest quarter, so this doesn't run for every new info.
+    std::vector<uint64_t> timestamps;
+    timestamps.reserve(jit_debug_infos_.size());
+    for (const auto& [_, info] : jit_debug_infos_) {
+      timestamps.push_back(info.timestamp);
+    }
+    auto nth = timestamps.begin() + kMaxSegmentJITDebugInfos / 4;
+    std::nth_element(timestamps.begin(), nth, timestamps.end());
+    uint64_t min_timestamp = *nth;
+    for (auto it = jit_debug_infos_.begin(); it != jit_debug_infos_.end();) {
+      it = it->second.timestamp < min_timestamp ? jit_debug_infos_.erase(it) : std::next(it);
+    }
+  }
+}
+
+std::vector<JITDebugInfo> RecordCommand::GetJITDebugInfoForSegment() {
+  std::vector<JITDebugInfo> debug_info;
+  debug_info.reserve(jit_debug_infos_.size());
+  for (const auto& [_, info] : jit_debug_infos_) {
+    debug_info.push_back(info);
+  }
+  std::stable_sort(debug_info.begin(), debug_info.end(),
+                   [](const JITDebugInfo& a, const JITDebugInfo& b) {
+                     return a.timestamp < b.timestamp;
+                   });
+  return debug_info;
+}
+
 bool RecordCommand::ProcessControlCmd(IOEventLoop* loop) {
   char* line = nullptr;
   size_t line_length = 0;
@@ -1798,6 +2261,9 @@ bool RecordCommand::KeepFailedUnwindingResult(const SampleRecord& r,
                                               const std::vector<uint64_t>& sps) {
   auto& result = offline_unwinder_->GetUnwindingResult();
   if (result.error_code != unwindstack::ERROR_NONE) {
+    if (segment_hit_file_info_) {
+      segment_hit_file_info_->failed_unwinding_sample = true;
+    }
     if (keep_failed_unwinding_debug_info_) {
       return record_file_writer_->WriteRecord(UnwindingResultRecord(
           r.time_data.time, result, r.regs_user_data, r.stack_user_data, ips, sps));
@@ -1830,6 +2296,8 @@ std::unique_ptr<RecordFileReader> RecordCommand::MoveRecordFile(const std::strin
   if (!reader) {
     return nullptr;
   }
+  // Features aren't written yet, so tell the reader the stacks are delta encoded.
+  reader->SetUserStackDeltaEncoded(stack_delta_encoder_ != nullptr);
 
   record_file_writer_ = CreateRecordFile(record_filename_, reader->AttrSection());
   if (!record_file_writer_) {
@@ -1935,6 +2403,34 @@ bool RecordCommand::JoinCallChains() {
   return reader->ReadDataSection(record_callback);
 }
 
+bool RecordCommand::InternCallChains() {
+  callchain_dict_.reset(new CallChainDictionary);
+  // 1. Move records from record_filename_ to a temporary file.
+  auto tmp_file = ScopedTempFiles::CreateTempFile();
+  auto reader = MoveRecordFile(tmp_file->path);
+  if (!reader) {
+    return false;
+  }
+  // Stacks are decoded by the reader. Encode them again from the first sample.
+  if (stack_delta_encoder_) {
+    stack_delta_encoder_.reset(new UserStackDeltaEncoder);
+  }
+
+  // 2. Read records from the temporary file, and write records with interned callchains back
+  // to record_filename_.
+  auto record_callback = [&](std::unique_ptr<Record> r) {
+    if (r->type() == PERF_RECORD_SAMPLE) {
+      callchain_dict_->EncodeSample(*static_cast<SampleRecord*>(r.get()));
+    }
+    return WriteRecordWithStackDelta(*r);
+  };
+  if (!reader->ReadDataSection(record_callback)) {
+    return false;
+  }
+  LOG(DEBUG) << "interned callchains in " << callchain_dict_->NodeCount() << " nodes";
+  return true;
+}
+
 static void LoadSymbolMapFile(int pid, const std::string& package, ThreadTree* thread_tree) {
   // On Linux, symbol map files usually go to /tmp/perf-<pid>.map
   // On Android, there is no directory where any process can create files.
@@ -1950,44 +2446,69 @@ static void LoadSymbolMapFile(int pid, const std::string& package, ThreadTree* t
   }
 }
 
-bool RecordCommand::DumpAdditionalFeatures(const std::vector<std::string>& args) {
-  // Read data section of perf.data to collect hit file information.
-  thread_tree_.ClearThreadAndMap();
-  bool kernel_symbols_available = false;
+void RecordCommand::StartCollectingHitFileInfo() {
+  segment_hit_file_info_.emplace();
+  segment_kernel_symbols_available_ = false;
   std::string kallsyms;
   if (event_selection_set_.NeedKernelSymbol() && LoadKernelSymbols(&kallsyms)) {
     Dso::SetKallsyms(kallsyms);
-    kernel_symbols_available = true;
+    segment_kernel_symbols_available_ = true;
   }
-  std::unordered_set<int> loaded_symbol_maps;
+}
+
+// Called for records in the order they are written. thread_tree_ should already be updated.
+void RecordCommand::AddHitFileInfo(const Record& r, HitFileInfo* info) {
+  if (r.type() == PERF_RECORD_SAMPLE) {
+    auto& sample = static_cast<const SampleRecord&>(r);
+    // Symbol map files are written by the profiled process. Load one for the process at its
+    // first sample. When collecting while recording, a map file created later isn't used.
+    if (info->loaded_symbol_maps.insert(sample.tid_data.pid).second) {
+      LoadSymbolMapFile(sample.tid_data.pid, app_package_name_, &thread_tree_);
+    }
+    if (info->failed_unwinding_sample) {
+      info->failed_unwinding_sample = false;
+      CollectHitFileInfo(sample, &info->debug_unwinding_files);
+    } else {
+      CollectHitFileInfo(sample, nullptr);
+    }
+  } else if (r.type() == SIMPLE_PERF_RECORD_UNWINDING_RESULT) {
+    info->failed_unwinding_sample = true;
+  }
+}
+
+bool RecordCommand::DumpAdditionalFeatures(const std::vector<std::string>& args) {
+  bool kernel_symbols_available = false;
   std::vector<uint64_t> auxtrace_offset;
-  std::unordered_set<Dso*> debug_unwinding_files;
-  bool failed_unwinding_sample = false;
+  HitFileInfo read_hit_file_info;
+  HitFileInfo* hit_file_info = &read_hit_file_info;
 
-  auto callback = [&](const Record* r) {
-    thread_tree_.Update(*r);
-    if (r->type() == PERF_RECORD_SAMPLE) {
-      auto sample = reinterpret_cast<const SampleRecord*>(r);
-      // Symbol map files are available after recording. Load one for the process.
-      if (loaded_symbol_maps.insert(sample->tid_data.pid).second) {
-        LoadSymbolMapFile(sample->tid_data.pid, app_package_name_, &thread_tree_);
-      }
-      if (failed_unwinding_sample) {
-        failed_unwinding_sample = false;
-        CollectHitFileInfo(*sample, &debug_unwinding_files);
+  if (segment_hit_file_info_) {
+    hit_file_info = &segment_hit_file_info_.value();
+    kernel_symbols_available = segment_kernel_symbols_available_;
+  } else {
+    // Read data section of perf.data to collect hit file information.
+    thread_tree_.ClearThreadAndMap();
+    std::string kallsyms;
+    if (event_selection_set_.NeedKernelSymbol() && LoadKernelSymbols(&kallsyms)) {
+      Dso::SetKallsyms(kallsyms);
+      kernel_symbols_available = true;
+    }
+    auto callback = [&](const Record* r) {
+      thread_tree_.Update(*r);
+      if (r->type() == PERF_RECORD_AUXTRACE) {
+        auto auxtrace = static_cast<const AuxTraceRecord*>(r);
+        auxtrace_offset.emplace_back(auxtrace->location.file_offset - auxtrace->size());
       } else {
-        CollectHitFileInfo(*sample, nullptr);
+        AddHitFileInfo(*r, &read_hit_file_info);
       }
-    } else if (r->type() == PERF_RECORD_AUXTRACE) {
-      auto auxtrace = static_cast<const AuxTraceRecord*>(r);
-      auxtrace_offset.emplace_back(auxtrace->location.file_offset - auxtrace->size());
-    } else if (r->type() == SIMPLE_PERF_RECORD_UNWINDING_RESULT) {
-      failed_unwinding_sample = true;
+    };
+    if (!record_file_writer_->ReadDataSection(callback)) {
+      return false;
+    }
+    // Intern callchains after collecting hit files, which needs the original callchains.
+    if (intern_callchains_ && !InternCallChains()) {
+      return false;
     }
-  };
-
-  if (!record_file_writer_->ReadDataSection(callback)) {
-    return false;
   }
 
   size_t feature_count = 6;
@@ -2003,6 +2524,9 @@ bool RecordCommand::DumpAdditionalFeatures(const std::vector<std::string>& args)
   if (etm_branch_list_generator_) {
     feature_count++;
   }
+  if (callchain_dict_) {
+    feature_count++;
+  }
   if (!record_file_writer_->BeginWriteFeatures(feature_count)) {
     return false;
   }
@@ -2042,12 +2566,20 @@ bool RecordCommand::DumpAdditionalFeatures(const std::vector<std::string>& args)
   if (!auxtrace_offset.empty() && !record_file_writer_->WriteAuxTraceFeature(auxtrace_offset)) {
     return false;
   }
-  if (keep_failed_unwinding_debug_info_ && !DumpDebugUnwindFeature(debug_unwinding_files)) {
+  if (keep_failed_unwinding_debug_info_ &&
+      !DumpDebugUnwindFeature(hit_file_info->debug_unwinding_files)) {
     return false;
   }
   if (etm_branch_list_generator_ && !DumpETMBranchListFeature()) {
     return false;
   }
+  if (callchain_dict_) {
+    std::vector<char> data = callchain_dict_->ToBinary();
+    if (!record_file_writer_->WriteFeature(PerfFileFormat::FEAT_CALLCHAIN_NODES, data.data(),
+                                           data.size())) {
+      return false;
+    }
+  }
 
   if (!record_file_writer_->EndWriteFeatures()) {
     return false;
@@ -2094,6 +2626,9 @@ bool RecordCommand::DumpMetaInfoFeature(bool kernel_symbols_available) {
   info_map["simpleperf_version"] = GetSimpleperfVersion();
   info_map["system_wide_collection"] = system_wide_collection_ ? "true" : "false";
   info_map["trace_offcpu"] = trace_offcpu_ ? "true" : "false";
+  if (stack_delta_encoder_ && !post_unwind_) {
+    info_map["delta_encode_stack"] = "true";
+  }
   // By storing event types information in perf.data, the readers of perf.data have the same
   // understanding of event types, even if they are on another machine.
   info_map["event_type_info"] = ScopedEventTypes::BuildString(event_selection_set_.GetEvents());
@@ -2188,6 +2723,9 @@ void RecordCommand::CollectHitFileInfo(const SampleRecord& r, std::unordered_set
 }
 
 bool RecordCommand::DumpETMBranchListFeature() {
+  if (!etm_branch_list_generator_->Finish()) {
+    return false;
+  }
   BranchListBinaryMap binary_map = etm_branch_list_generator_->GetBranchListBinaryMap();
   std::string s;
   if (!BranchListBinaryMapToString(binary_map, s)) {
@@ -2290,6 +2828,24 @@ static bool ParseOneAddrFilter(const std::string& s, std::vector<AddrFilter>* fi
   return false;
 }
 
+uint64_t SampleRateGovernor::Update(const Overhead& overhead) {
+  if (overhead.lost_records > 0 || overhead.free_buffer_ratio < kLowFreeBufferRatio ||
+      overhead.cpu_percent > max_cpu_percent_) {
+    calm_periods_ = 0;
+    divisor_ = std::min(divisor_ * 2, kMaxDivisor);
+  } else if (divisor_ > 1 && overhead.cpu_percent * 4 < max_cpu_percent_) {
+    // Doubling sample rates roughly doubles the overhead. So only increase rates when the
+    // overhead is well below the limit, and has been so for a while.
+    if (++calm_periods_ == kCalmPeriodsToIncreaseRate) {
+      calm_periods_ = 0;
+      divisor_ /= 2;
+    }
+  } else {
+    calm_periods_ = 0;
+  }
+  return divisor_;
+}
+
 std::vector<AddrFilter> ParseAddrFilterOption(const std::string& s) {
   std::vector<AddrFilter> filters;
   for (const auto& str : android::base::Split(s, ",")) {
@@ -28,6 +28,39 @@ struct AddrFilter;
 
 std::vector<AddrFilter> ParseAddrFilterOption(const std::string& s);
 
+// Used by `record --adaptive-sampling`. SampleRateGovernor decides how much to scale down sample
+// rates, based on the recording overhead measured in each check period. It halves sample rates
+// when records are lost or truncated, the record buffer is filling up, or simpleperf uses more
+// cpu time than allowed. It doubles sample rates (up to the requested rates) after the overhead
+// stays low for several periods.
+class SampleRateGovernor {
+ public:
+  static constexpr uint64_t kMaxDivisor = 64;
+
+  struct Overhead {
+    // Records lost or samples truncated in the period.
+    uint64_t lost_records = 0;
+    // Free space ratio of the record buffer at the end of the period.
+    double free_buffer_ratio = 1.0;
+    // Cpu time used by simpleperf in the period, in percent of the wall time.
+    double cpu_percent = 0;
+  };
+
+  SampleRateGovernor(double max_cpu_percent) : max_cpu_percent_(max_cpu_percent) {}
+
+  // Return the new divisor of sample rates.
+  uint64_t Update(const Overhead& overhead);
+  uint64_t Divisor() const { return divisor_; }
+
+ private:
+  static constexpr double kLowFreeBufferRatio = 0.5;
+  static constexpr size_t kCalmPeriodsToIncreaseRate = 3;
+
+  const double max_cpu_percent_;
+  uint64_t divisor_ = 1;
+  size_t calm_periods_ = 0;
+};
+
 inline const OptionFormatMap& GetRecordCmdOptionFormats() {
   static OptionFormatMap option_formats;
   if (option_formats.empty()) {
@@ -36,6 +69,10 @@ inline const OptionFormatMap& GetRecordCmdOptionFormats() {
         {"--add-counter", {OptionValueType::STRING, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--add-meta-info",
          {OptionValueType::STRING, OptionType::MULTIPLE, AppRunnerType::ALLOWED}},
+        {"--adaptive-sampling",
+         {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
+        {"--adaptive-sampling-period",
+         {OptionValueType::DOUBLE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--addr-filter", {OptionValueType::STRING, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--app", {OptionValueType::STRING, OptionType::SINGLE, AppRunnerType::NOT_ALLOWED}},
         {"--aux-buffer-size", {OptionValueType::UINT, OptionType::SINGLE, AppRunnerType::ALLOWED}},
@@ -49,6 +86,10 @@ inline const OptionFormatMap& GetRecordCmdOptionFormats() {
         {"--cpu", {OptionValueType::STRING, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--cpu-percent", {OptionValueType::UINT, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--decode-etm", {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
+        {"--decode-etm-queue-size",
+         {OptionValueType::UINT, OptionType::SINGLE, AppRunnerType::ALLOWED}},
+        {"--delta-encode-stack",
+         {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--duration", {OptionValueType::DOUBLE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"-e", {OptionValueType::STRING, OptionType::ORDERED, AppRunnerType::ALLOWED}},
         {"--exclude-perf", {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
@@ -57,12 +98,21 @@ inline const OptionFormatMap& GetRecordCmdOptionFormats() {
         {"-g", {OptionValueType::NONE, OptionType::ORDERED, AppRunnerType::ALLOWED}},
         {"--group", {OptionValueType::STRING, OptionType::ORDERED, AppRunnerType::ALLOWED}},
         {"--in-app", {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
+        {"--intern-callchains",
+         {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"-j", {OptionValueType::STRING, OptionType::MULTIPLE, AppRunnerType::ALLOWED}},
         {"--keep-failed-unwinding-result",
          {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--keep-failed-unwinding-debug-info",
          {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::NOT_ALLOWED}},
         {"--kprobe", {OptionValueType::STRING, OptionType::MULTIPLE, AppRunnerType::NOT_ALLOWED}},
+        {"--live-report", {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
+        {"--live-report-fd", {OptionValueType::UINT, OptionType::SINGLE, AppRunnerType::CHECK_FD}},
+        {"--live-report-half-life",
+         {OptionValueType::DOUBLE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
+        {"--live-report-interval",
+         {OptionValueType::DOUBLE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
+        {"--live-report-top", {OptionValueType::UINT, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"-m", {OptionValueType::UINT, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--no-callchain-joiner",
          {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
@@ -79,6 +129,9 @@ inline const OptionFormatMap& GetRecordCmdOptionFormats() {
         {"--post-unwind=no", {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--post-unwind=yes", {OptionValueType::NONE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--user-buffer-size", {OptionValueType::UINT, OptionType::SINGLE, AppRunnerType::ALLOWED}},
+        {"--segment-duration",
+         {OptionValueType::DOUBLE, OptionType::SINGLE, AppRunnerType::ALLOWED}},
+        {"--segment-size", {OptionValueType::UINT, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--size-limit", {OptionValueType::UINT, OptionType::SINGLE, AppRunnerType::ALLOWED}},
         {"--start_profiling_fd",
          {OptionValueType::UINT, OptionType::SINGLE, AppRunnerType::CHECK_FD}},
@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <map>
 #include <memory>
@@ -293,6 +294,84 @@ TEST(record_cmd, post_unwind_option) {
   ASSERT_TRUE(RunRecordCmd({"-p", pid, "--call-graph", "dwarf", "--post-unwind=no"}));
 }
 
+// Check that user stacks in a recording made with --delta-encode-stack are decoded when read
+// back, and return the output of unwinding them with debug-unwind.
+static void CheckDeltaEncodedStacks(const std::string& record_file, std::string* unwind_output) {
+  std::unique_ptr<RecordFileReader> reader = RecordFileReader::CreateInstance(record_file);
+  ASSERT_TRUE(reader);
+  const auto& meta_info = reader->GetMetaInfoFeature();
+  auto it = meta_info.find("delta_encode_stack");
+  ASSERT_NE(it, meta_info.end());
+  ASSERT_EQ(it->second, "true");
+  ASSERT_TRUE(reader->ReadDataSection([&](std::unique_ptr<Record> r) {
+    if (r->type() == PERF_RECORD_SAMPLE && !r->InKernel()) {
+      auto sr = static_cast<SampleRecord*>(r.get());
+      EXPECT_GT(sr->stack_user_data.dyn_size, 0u);
+      EXPECT_LE(sr->stack_user_data.dyn_size, sr->stack_user_data.size);
+    }
+    return true;
+  }));
+  TemporaryFile tmpfile;
+  ASSERT_TRUE(CreateCommandInstance("debug-unwind")
+                  ->Run({"-i", record_file, "--unwind-sample", "-o", tmpfile.path}));
+  ASSERT_TRUE(android::base::ReadFileToString(tmpfile.path, unwind_output));
+}
+
+TEST(record_cmd, delta_encode_stack_option) {
+  OMIT_TEST_ON_NON_NATIVE_ABIS();
+  ASSERT_TRUE(IsDwarfCallChainSamplingSupported());
+  std::vector<std::unique_ptr<Workload>> workloads;
+  CreateProcesses(1, &workloads);
+  std::string pid = std::to_string(workloads[0]->GetPid());
+  auto record = [&](const std::string& record_file, std::vector<std::string> args) {
+    args.insert(args.end(), {"-o", record_file, "-p", pid, "--call-graph", "dwarf", "--no-unwind",
+                             "--duration", "1", "-e", GetDefaultEvent()});
+    return RecordCmd()->Run(args);
+  };
+
+  // Stacks unwound from a recording without --delta-encode-stack, for comparison.
+  TemporaryFile plain_file;
+  ASSERT_TRUE(record(plain_file.path, {}));
+  TemporaryFile plain_output;
+  ASSERT_TRUE(CreateCommandInstance("debug-unwind")
+                  ->Run({"-i", plain_file.path, "--unwind-sample", "-o", plain_output.path}));
+  std::string plain_unwind_output;
+  ASSERT_TRUE(android::base::ReadFileToString(plain_output.path, &plain_unwind_output));
+  bool plain_has_deep_callchain = plain_unwind_output.find("ip_2: ") != std::string::npos;
+
+  TemporaryFile tmpfile;
+  ASSERT_TRUE(record(tmpfile.path, {"--delta-encode-stack"}));
+  std::string unwind_output;
+  ASSERT_NO_FATAL_FAILURE(CheckDeltaEncodedStacks(tmpfile.path, &unwind_output));
+  ASSERT_NE(unwind_output.find("sample_time: "), std::string::npos);
+  if (plain_has_deep_callchain) {
+    ASSERT_NE(unwind_output.find("ip_2: "), std::string::npos);
+  }
+
+  // Stacks are encoded again after interning callchains.
+  ASSERT_TRUE(record(tmpfile.path, {"--delta-encode-stack", "--intern-callchains"}));
+  ASSERT_NO_FATAL_FAILURE(CheckDeltaEncodedStacks(tmpfile.path, &unwind_output));
+  if (plain_has_deep_callchain) {
+    ASSERT_NE(unwind_output.find("ip_2: "), std::string::npos);
+  }
+
+  // Each segment is encoded from scratch, so it can be decoded alone.
+  TemporaryDir tmpdir;
+  std::string record_file = std::string(tmpdir.path) + "/perf.data";
+  ASSERT_TRUE(record(record_file, {"--delta-encode-stack", "--segment-duration", "0.3"}));
+  size_t segment_count = 0;
+  for (; IsRegularFile(record_file + "." + std::to_string(segment_count)); segment_count++) {
+    ASSERT_NO_FATAL_FAILURE(CheckDeltaEncodedStacks(
+        record_file + "." + std::to_string(segment_count), &unwind_output));
+  }
+  ASSERT_GE(segment_count, 2u);
+
+  // The user's stack isn't kept without dwarf callchains or when unwinding while recording.
+  ASSERT_FALSE(RunRecordCmd({"--delta-encode-stack"}));
+  ASSERT_FALSE(RunRecordCmd({"--call-graph", "fp", "--delta-encode-stack"}));
+  ASSERT_FALSE(RunRecordCmd({"--call-graph", "dwarf", "--delta-encode-stack"}));
+}
+
 TEST(record_cmd, existing_processes) {
   std::vector<std::unique_ptr<Workload>> workloads;
   CreateProcesses(2, &workloads);
@@ -626,6 +705,34 @@ TEST(record_cmd, callchain_joiner_options) {
   ASSERT_TRUE(RunRecordCmd({"--callchain-joiner-min-matching-nodes", "2"}));
 }
 
+TEST(record_cmd, intern_callchains_option) {
+  TemporaryFile tmpfile;
+  ASSERT_TRUE(RunRecordCmd({"--call-graph", "fp", "--intern-callchains"}, tmpfile.path));
+  std::unique_ptr<RecordFileReader> reader = RecordFileReader::CreateInstance(tmpfile.path);
+  ASSERT_TRUE(reader);
+  ASSERT_TRUE(reader->HasFeature(PerfFileFormat::FEAT_CALLCHAIN_NODES));
+  const CallChainDictionary* dict = reader->GetCallChainDictionary();
+  ASSERT_TRUE(dict != nullptr);
+  // Samples are expanded by the reader.
+  size_t sample_count = 0;
+  ASSERT_TRUE(reader->ReadDataSection([&](std::unique_ptr<Record> r) {
+    if (r->type() == PERF_RECORD_SAMPLE) {
+      uint32_t node_id;
+      EXPECT_FALSE(
+          CallChainDictionary::GetEncodedNodeId(*static_cast<SampleRecord*>(r.get()), &node_id));
+      sample_count++;
+    }
+    return true;
+  }));
+  ASSERT_GT(sample_count, 0u);
+  // --intern-callchains needs call graphs.
+  ASSERT_FALSE(RunRecordCmd({"--intern-callchains"}));
+  // Interning callchains would move AUXTRACE records.
+  if (ETMRecorder::GetInstance().CheckEtmSupport().ok()) {
+    ASSERT_FALSE(RunRecordCmd({"-e", "cs-etm", "-g", "--intern-callchains"}));
+  }
+}
+
 TEST(record_cmd, dashdash) {
   TemporaryFile tmpfile;
   ASSERT_TRUE(RecordCmd()->Run({"-o", tmpfile.path, "-e", GetDefaultEvent(), "--", "sleep", "1"}));
@@ -645,6 +752,43 @@ TEST(record_cmd, size_limit_option) {
   ASSERT_FALSE(RunRecordCmd({"--size-limit", "0"}));
 }
 
+TEST(record_cmd, segment_options) {
+  std::vector<std::unique_ptr<Workload>> workloads;
+  CreateProcesses(1, &workloads);
+  std::string pid = std::to_string(workloads[0]->GetPid());
+  TemporaryDir tmpdir;
+  std::string record_file = std::string(tmpdir.path) + "/perf.data";
+  ASSERT_TRUE(RecordCmd()->Run({"-o", record_file, "-p", pid, "--segment-duration", "0.3",
+                                "--duration", "1", "-e", GetDefaultEvent()}));
+  ASSERT_FALSE(IsRegularFile(record_file));
+  size_t segment_count = 0;
+  for (; IsRegularFile(record_file + "." + std::to_string(segment_count)); segment_count++) {
+    // Each segment is a complete record file.
+    auto reader = RecordFileReader::CreateInstance(record_file + "." +
+                                                   std::to_string(segment_count));
+    ASSERT_TRUE(reader);
+    ASSERT_TRUE(reader->HasFeature(PerfFileFormat::FEAT_META_INFO));
+    bool has_mmap = false;
+    bool has_sample = false;
+    ASSERT_TRUE(reader->ReadDataSection([&](std::unique_ptr<Record> r) {
+      has_mmap |= r->type() == PERF_RECORD_MMAP || r->type() == PERF_RECORD_MMAP2;
+      has_sample |= r->type() == PERF_RECORD_SAMPLE;
+      return true;
+    }));
+    ASSERT_TRUE(has_mmap);
+    // Hit files are collected while writing the segment.
+    if (has_sample) {
+      uint64_t read_pos = 0;
+      FileFeature file;
+      bool error = false;
+      ASSERT_TRUE(reader->ReadFileFeature(read_pos, file, error));
+      ASSERT_FALSE(error);
+    }
+  }
+  ASSERT_GE(segment_count, 3u);
+  ASSERT_FALSE(RunRecordCmd({"--segment-size", "0"}));
+}
+
 TEST(record_cmd, support_mmap2) {
   // mmap2 is supported in kernel >= 3.16. If not supported, please cherry pick below kernel
   // patches:
@@ -714,6 +858,88 @@ TEST(record_cmd, cpu_percent_option) {
   ASSERT_FALSE(RunRecordCmd({"--cpu-percent", "101"}));
 }
 
+TEST(record_cmd, adaptive_sampling_option) {
+  ASSERT_TRUE(RunRecordCmd({"--adaptive-sampling"}));
+  ASSERT_FALSE(RunRecordCmd({"--adaptive-sampling", "--adaptive-sampling-period", "0"}));
+}
+
+TEST(record_cmd, adaptive_sampling_scales_sample_rates) {
+  OMIT_TEST_ON_NON_NATIVE_ABIS();
+  ASSERT_TRUE(IsDwarfCallChainSamplingSupported());
+  std::vector<std::unique_ptr<Workload>> workloads;
+  CreateProcesses(1, &workloads);
+  std::string pid = std::to_string(workloads[0]->GetPid());
+  // Copying and unwinding 64K user stacks at 10000 samples per second overloads the recording,
+  // so sample rates are scaled down in the first check periods.
+  const uint64_t kPeriod = 100000;
+  TemporaryFile tmpfile;
+  ASSERT_TRUE(RecordCmd()->Run({"-e", "cpu-clock", "-c", std::to_string(kPeriod), "-p", pid,
+                                "--call-graph", "dwarf", "--adaptive-sampling",
+                                "--adaptive-sampling-period", "0.1", "--duration", "2", "-o",
+                                tmpfile.path}));
+  std::unique_ptr<RecordFileReader> reader = RecordFileReader::CreateInstance(tmpfile.path);
+  ASSERT_TRUE(reader);
+  std::vector<uint64_t> divisors;
+  uint64_t max_period = 0;
+  ASSERT_TRUE(reader->ReadDataSection([&](std::unique_ptr<Record> r) {
+    if (r->type() == SIMPLE_PERF_RECORD_SAMPLE_RATE) {
+      divisors.push_back(static_cast<SampleRateRecord*>(r.get())->divisor);
+    } else if (r->type() == PERF_RECORD_SAMPLE) {
+      // Samples carry the scaled period.
+      uint64_t period = static_cast<SampleRecord*>(r.get())->period_data.period;
+      EXPECT_EQ(period % kPeriod, 0u);
+      max_period = std::max(max_period, period);
+    }
+    return true;
+  }));
+  ASSERT_FALSE(divisors.empty());
+  // Sample rates are halved at a time.
+  ASSERT_EQ(divisors[0], 2u);
+  for (uint64_t divisor : divisors) {
+    ASSERT_LE(divisor, SampleRateGovernor::kMaxDivisor);
+    ASSERT_EQ(divisor & (divisor - 1), 0u);
+  }
+  ASSERT_GT(max_period, kPeriod);
+  ASSERT_LE(max_period, kPeriod * *std::max_element(divisors.begin(), divisors.end()));
+}
+
+TEST(record_cmd, SampleRateGovernor) {
+  SampleRateGovernor governor(25);
+  SampleRateGovernor::Overhead overhead;
+  overhead.cpu_percent = 10;
+  ASSERT_EQ(governor.Update(overhead), 1u);
+
+  // Reduce sample rates when records are lost, the buffer is filling up, or using too much cpu.
+  overhead.lost_records = 5;
+  ASSERT_EQ(governor.Update(overhead), 2u);
+  overhead.lost_records = 0;
+  overhead.free_buffer_ratio = 0.1;
+  ASSERT_EQ(governor.Update(overhead), 4u);
+  overhead.free_buffer_ratio = 1.0;
+  overhead.cpu_percent = 30;
+  ASSERT_EQ(governor.Update(overhead), 8u);
+  for (int i = 0; i < 10; i++) {
+    governor.Update(overhead);
+  }
+  ASSERT_EQ(governor.Divisor(), SampleRateGovernor::kMaxDivisor);
+
+  // Keep sample rates when the overhead is moderate.
+  overhead.cpu_percent = 10;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(governor.Update(overhead), SampleRateGovernor::kMaxDivisor);
+  }
+
+  // Increase sample rates after the overhead stays low for a while.
+  overhead.cpu_percent = 1;
+  ASSERT_EQ(governor.Update(overhead), 64u);
+  ASSERT_EQ(governor.Update(overhead), 64u);
+  ASSERT_EQ(governor.Update(overhead), 32u);
+  for (int i = 0; i < 100; i++) {
+    governor.Update(overhead);
+  }
+  ASSERT_EQ(governor.Divisor(), 1u);
+}
+
 class RecordingAppHelper {
  public:
   bool InstallApk(const std::string& apk_path, const std::string& package_name) {
@@ -1071,6 +1297,8 @@ TEST(record_cmd, decode_etm_option) {
   }
   ASSERT_TRUE(RunRecordCmd({"-e", "cs-etm", "--decode-etm"}));
   ASSERT_TRUE(RunRecordCmd({"-e", "cs-etm", "--decode-etm", "--exclude-perf"}));
+  ASSERT_TRUE(RunRecordCmd({"-e", "cs-etm", "--decode-etm", "--decode-etm-queue-size", "0"}));
+  ASSERT_TRUE(RunRecordCmd({"-e", "cs-etm", "--decode-etm", "--decode-etm-queue-size", "1M"}));
 }
 
 TEST(record_cmd, binary_option) {
@@ -1199,6 +1427,35 @@ TEST(record_cmd, keep_failed_unwinding_result_option) {
       {"-p", pid, "-g", "--keep-failed-unwinding-result", "--keep-failed-unwinding-debug-info"}));
 }
 
+TEST(record_cmd, live_report_option) {
+  // Print text reports, and write a record file.
+  CaptureStdout capture;
+  ASSERT_TRUE(capture.Start());
+  ASSERT_TRUE(RunRecordCmd({"--live-report", "--live-report-interval", "0.2", "--live-report-top",
+                            "5", "--live-report-half-life", "1"}));
+  std::string output = capture.Finish();
+  ASSERT_NE(output.find("Live report at"), std::string::npos);
+  ASSERT_NE(output.find("Overhead"), std::string::npos);
+
+  // Write json snapshots without a record file.
+  TemporaryFile snapshot_file;
+  ASSERT_TRUE(RecordCmd()->Run({"-e", GetDefaultEvent(), "--call-graph", "fp", "--live-report",
+                                "--live-report-fd", std::to_string(snapshot_file.release()),
+                                "sleep", SLEEP_SEC}));
+  std::string data;
+  ASSERT_TRUE(android::base::ReadFileToString(snapshot_file.path, &data));
+  ASSERT_NE(data.find("{\"time_in_sec\":"), std::string::npos);
+  ASSERT_NE(data.find("\"children\":"), std::string::npos);
+
+  // Options conflicting with --live-report.
+  ASSERT_FALSE(RunRecordCmd({"--live-report", "--call-graph", "dwarf"}));
+  ASSERT_FALSE(RecordCmd()->Run({"--live-report", "--size-limit", "1000000", "sleep", SLEEP_SEC}));
+  ASSERT_FALSE(RunRecordCmd({"--live-report", "--segment-size", "1000000"}));
+  ASSERT_FALSE(RunRecordCmd({"--live-report", "--segment-duration", "1"}));
+  ASSERT_FALSE(RunRecordCmd({"--live-report-fd", "1"}));
+  ASSERT_FALSE(RunRecordCmd({"--live-report", "--live-report-top", "0"}));
+}
+
 TEST(record_cmd, kernel_address_warning) {
   TEST_REQUIRE_NON_ROOT();
   const std::string warning_msg = "Access to kernel symbol addresses is restricted.";
@@ -37,9 +37,11 @@
 #include "perf_regs.h"
 #include "record.h"
 #include "record_file.h"
+#include "report_diff.h"
+#include "report_exporter.h"
+#include "report_utils.h"
 #include "sample_tree.h"
 #include "thread_tree.h"
-#include "tracing.h"
 #include "utils.h"
 
 namespace simpleperf {
@@ -412,6 +414,29 @@ class ReportCommand : public Command {
 "              by the symbol, while Self column shows overhead for the symbol itself.\n"
 "--csv                     Report in csv format.\n"
 "--csv-separator <sep>     Set separator for csv columns. Default is ','.\n"
+"--diff <base_file>    Compare the record file set by -i with <base_file>. Samples of both files\n"
+"                      are aggregated by sort keys, and entries are matched by key values like\n"
+"                      dso paths and symbol names. For each entry, the report shows overhead in\n"
+"                      both files, the delta, and a z score of the sample count difference.\n"
+"                      Entries changed most are shown first. With -g, children overhead is\n"
+"                      compared, and direct callers or callees of each entry are shown. Only\n"
+"                      sort keys comm, pid, tid, dso and symbol are supported. The default\n"
+"                      sort keys are comm,dso,symbol. Sample filter options, --max-stack, -n,\n"
+"                      --no-demangle, --no-show-ip, -o, --percent-limit, --raw-period, --csv\n"
+"                      and --symfs are used with it.\n"
+"--folded-annotate-jit     Annotate JIT functions with _[j] in folded stacks.\n"
+"--folded-annotate-kernel  Annotate kernel functions with _[k] in folded stacks.\n"
+"--folded-event <event>    Only export samples of <event> in folded stacks. Default is the\n"
+"                          event of the first sample.\n"
+"--folded-pid              Include pid in thread names of folded stacks.\n"
+"--folded-tid              Include pid and tid in thread names of folded stacks.\n"
+"--format <format>     Set report format. Default is text. Other formats are read by other tools:\n"
+"                        pprof   -- gzip-compressed profile.proto read by pprof, like\n"
+"                                   pprof_proto_generator.py\n"
+"                        folded  -- folded stacks read by FlameGraph, like stackcollapse.py\n"
+"                      Samples aren't aggregated by sort keys in these formats. Only sample\n"
+"                      filter options, --kallsyms, --max-stack, --no-demangle, --no-show-ip,\n"
+"                      -o, --symfs and --vmlinux are used with them.\n"
 "--full-callgraph  Print full call graph. Used with -g option. By default,\n"
 "                  brief call graph is printed.\n"
 "-g [callee|caller]    Print call graph. If callee mode is used, the graph\n"
@@ -487,7 +512,15 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_REPORTING
   bool ReadSampleTreeFromRecordFile();
   bool ProcessRecord(std::unique_ptr<Record> record);
   void ProcessSampleRecordInTraceOffCpuMode(std::unique_ptr<Record> record, size_t attr_id);
-  bool ProcessTracingData(const std::vector<char>& data);
+  using ReportSampleCallback =
+      std::function<void(const SampleRecord&, const ThreadEntry&, const std::string& event_name,
+                         const std::vector<CallChainReportEntry>&)>;
+  bool ReadReportSamples(RecordFileReader& reader, ThreadTree& thread_tree,
+                         RecordFilter& record_filter, std::vector<std::string>& attr_names,
+                         const ReportSampleCallback& callback);
+  bool ParseRecordFilterOptions(OptionValueMap& options, RecordFilter& record_filter);
+  bool ExportSamples();
+  bool DiffSamples();
   bool PrintReport();
   void PrintReportContext(FILE* fp);
 
@@ -522,6 +555,12 @@ RECORD_FILTER_OPTION_HELP_MSG_FOR_REPORTING
   std::vector<std::string> sort_keys_;
   std::string report_filename_;
   RecordFilter record_filter_;
+  std::string report_format_ = "text";
+  ReportExporterOptions exporter_options_;
+  bool show_ip_for_unknown_symbol_ = true;
+  std::string diff_base_filename_;
+  // Used to initialize the RecordFilter for the base file of --diff.
+  OptionValueMap record_filter_options_;
 };
 
 bool ReportCommand::Run(const std::vector<std::string>& args) {
@@ -549,6 +588,12 @@ bool ReportCommand::Run(const std::vector<std::string>& args) {
     return false;
   }
   ScopedCurrentArch scoped_arch(record_file_arch_);
+  if (!diff_base_filename_.empty()) {
+    return DiffSamples();
+  }
+  if (report_format_ != "text") {
+    return ExportSamples();
+  }
   if (!ReadSampleTreeFromRecordFile()) {
     return false;
   }
@@ -569,7 +614,14 @@ bool ReportCommand::ParseOptions(const std::vector<std::string>& args) {
       {"--cpu", {OptionValueType::STRING, OptionType::MULTIPLE}},
       {"--csv", {OptionValueType::NONE, OptionType::SINGLE}},
       {"--csv-separator", {OptionValueType::STRING, OptionType::SINGLE}},
+      {"--diff", {OptionValueType::STRING, OptionType::SINGLE}},
       {"--dsos", {OptionValueType::STRING, OptionType::MULTIPLE}},
+      {"--folded-annotate-jit", {OptionValueType::NONE, OptionType::SINGLE}},
+      {"--folded-annotate-kernel", {OptionValueType::NONE, OptionType::SINGLE}},
+      {"--folded-event", {OptionValueType::STRING, OptionType::SINGLE}},
+      {"--folded-pid", {OptionValueType::NONE, OptionType::SINGLE}},
+      {"--folded-tid", {OptionValueType::NONE, OptionType::SINGLE}},
+      {"--format", {OptionValueType::STRING, OptionType::SINGLE}},
       {"--full-callgraph", {OptionValueType::NONE, OptionType::SINGLE}},
       {"-g", {OptionValueType::OPT_STRING, OptionType::SINGLE}},
       {"-i", {OptionValueType::STRING, OptionType::SINGLE}},
@@ -598,6 +650,10 @@ bool ReportCommand::ParseOptions(const std::vector<std::string>& args) {
     return false;
   }
 
+  if (options.values.count("--diff") != 0) {
+    record_filter_options_ = options;
+  }
+
   // Process options.
   use_branch_address_ = options.PullBoolValue("-b");
   accumulate_callchain_ = options.PullBoolValue("--children");
@@ -605,7 +661,7 @@ bool ReportCommand::ParseOptions(const std::vector<std::string>& args) {
     std::vector<std::string> strs = Split(*value.str_value, ",");
     sample_tree_builder_options_.comm_filter.insert(strs.begin(), strs.end());
   }
-  if (!record_filter_.ParseOptions(options)) {
+  if (!ParseRecordFilterOptions(options, record_filter_)) {
     return false;
   }
   for (const OptionValue& value : options.PullValues("--cpu")) {
@@ -617,10 +673,21 @@ bool ReportCommand::ParseOptions(const std::vector<std::string>& args) {
   }
   report_csv_ = options.PullBoolValue("--csv");
   options.PullStringValue("--csv-separator", &csv_separator_);
+  options.PullStringValue("--diff", &diff_base_filename_);
   for (const OptionValue& value : options.PullValues("--dsos")) {
     std::vector<std::string> strs = Split(*value.str_value, ",");
     sample_tree_builder_options_.dso_filter.insert(strs.begin(), strs.end());
   }
+  exporter_options_.annotate_jit = options.PullBoolValue("--folded-annotate-jit");
+  exporter_options_.annotate_kernel = options.PullBoolValue("--folded-annotate-kernel");
+  options.PullStringValue("--folded-event", &exporter_options_.event_filter);
+  exporter_options_.include_pid = options.PullBoolValue("--folded-pid");
+  exporter_options_.include_tid = options.PullBoolValue("--folded-tid");
+  options.PullStringValue("--format", &report_format_);
+  if (report_format_ != "text" && !ReportExporter::IsFormatSupported(report_format_)) {
+    LOG(ERROR) << "unsupported report format: " << report_format_;
+    return false;
+  }
   brief_callgraph_ = !options.PullBoolValue("--full-callgraph");
 
   if (auto value = options.PullValue("-g"); value) {
@@ -653,7 +720,8 @@ bool ReportCommand::ParseOptions(const std::vector<std::string>& args) {
 
   Dso::SetDemangle(!options.PullBoolValue("--no-demangle"));
 
-  if (!options.PullBoolValue("--no-show-ip")) {
+  show_ip_for_unknown_symbol_ = !options.PullBoolValue("--no-show-ip");
+  if (show_ip_for_unknown_symbol_) {
     thread_tree_.ShowIpForUnknownSymbol();
   }
 
@@ -662,26 +730,16 @@ bool ReportCommand::ParseOptions(const std::vector<std::string>& args) {
     return false;
   }
 
-  if (auto strs = options.PullStringValues("--pids"); !strs.empty()) {
-    if (auto pids = GetPidsFromStrings(strs, false, false); pids) {
-      record_filter_.AddPids(pids.value(), false);
-    } else {
-      return false;
-    }
-  }
   print_event_count_ = options.PullBoolValue("--print-event-count");
-  for (const OptionValue& value : options.PullValues("--tids")) {
-    if (auto tids = GetTidsFromString(*value.str_value, false); tids) {
-      record_filter_.AddTids(tids.value(), false);
-    } else {
-      return false;
-    }
-  }
   raw_period_ = options.PullBoolValue("--raw-period");
 
-  sort_keys_ = {"comm", "pid", "tid", "dso", "symbol"};
   if (auto value = options.PullValue("--sort"); value) {
     sort_keys_ = Split(*value->str_value, ",");
+  } else if (!diff_base_filename_.empty()) {
+    // Different recordings rarely share pids and tids, so don't match entries by them.
+    sort_keys_ = {"comm", "dso", "symbol"};
+  } else {
+    sort_keys_ = {"comm", "pid", "tid", "dso", "symbol"};
   }
 
   for (const OptionValue& value : options.PullValues("--symbols")) {
@@ -698,6 +756,41 @@ bool ReportCommand::ParseOptions(const std::vector<std::string>& args) {
     Dso::SetVmlinux(*value->str_value);
   }
   CHECK(options.values.empty());
+
+  if (!diff_base_filename_.empty()) {
+    if (report_format_ != "text" || use_branch_address_) {
+      LOG(ERROR) << "--diff can't be used with --format or -b";
+      return false;
+    }
+    for (const std::string& key : sort_keys_) {
+      if (!ReportDiffer::IsSortKeySupported(key)) {
+        LOG(ERROR) << "sort key '" << key << "' can't be used with --diff";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool ReportCommand::ParseRecordFilterOptions(OptionValueMap& options,
+                                             RecordFilter& record_filter) {
+  if (!record_filter.ParseOptions(options)) {
+    return false;
+  }
+  if (auto strs = options.PullStringValues("--pids"); !strs.empty()) {
+    if (auto pids = GetPidsFromStrings(strs, false, false); pids) {
+      record_filter.AddPids(pids.value(), false);
+    } else {
+      return false;
+    }
+  }
+  for (const OptionValue& value : options.PullValues("--tids")) {
+    if (auto tids = GetTidsFromString(*value.str_value, false); tids) {
+      record_filter.AddTids(tids.value(), false);
+    } else {
+      return false;
+    }
+  }
   return true;
 }
 
@@ -916,7 +1009,7 @@ bool ReportCommand::ReadFeaturesFromRecordFile() {
                                                  &tracing_data)) {
       return false;
     }
-    if (!ProcessTracingData(tracing_data)) {
+    if (!UpdateTracepointNames(tracing_data, *record_file_reader_, attr_names_)) {
       return false;
     }
   }
@@ -967,7 +1060,8 @@ bool ReportCommand::ProcessRecord(std::unique_ptr<Record> record) {
   } else if (record->type() == PERF_RECORD_TRACING_DATA ||
              record->type() == SIMPLE_PERF_RECORD_TRACING_DATA) {
     const auto& r = *static_cast<TracingDataRecord*>(record.get());
-    if (!ProcessTracingData(std::vector<char>(r.data, r.data + r.data_size))) {
+    if (!UpdateTracepointNames(std::vector<char>(r.data, r.data + r.data_size),
+                               *record_file_reader_, attr_names_)) {
       return false;
     }
   }
@@ -991,18 +1085,144 @@ void ReportCommand::ProcessSampleRecordInTraceOffCpuMode(std::unique_ptr<Record>
   }
 }
 
-bool ReportCommand::ProcessTracingData(const std::vector<char>& data) {
-  auto tracing = Tracing::Create(data);
-  if (!tracing) {
+bool ReportCommand::ReadReportSamples(RecordFileReader& reader, ThreadTree& thread_tree,
+                                      RecordFilter& record_filter,
+                                      std::vector<std::string>& attr_names,
+                                      const ReportSampleCallback& callback) {
+  CallChainReportBuilder callchain_report_builder(thread_tree);
+  const auto& filter = sample_tree_builder_options_;
+
+  auto process_record = [&](std::unique_ptr<Record> record) {
+    thread_tree.Update(*record);
+    if (record->type() == PERF_RECORD_TRACING_DATA ||
+        record->type() == SIMPLE_PERF_RECORD_TRACING_DATA) {
+      const auto& r = *static_cast<TracingDataRecord*>(record.get());
+      return UpdateTracepointNames(std::vector<char>(r.data, r.data + r.data_size), reader,
+                                   attr_names);
+    }
+    if (record->type() != PERF_RECORD_SAMPLE) {
+      return true;
+    }
+    const SampleRecord& r = *static_cast<SampleRecord*>(record.get());
+    if (!record_filter.Check(&r)) {
+      return true;
+    }
+    if (!filter.cpu_filter.empty() && filter.cpu_filter.count(r.cpu_data.cpu) == 0) {
+      return true;
+    }
+    const ThreadEntry* thread = thread_tree.FindThreadOrNew(r.tid_data.pid, r.tid_data.tid);
+    if (!filter.comm_filter.empty() && filter.comm_filter.count(thread->comm) == 0) {
+      return true;
+    }
+    size_t kernel_ip_count;
+    std::vector<uint64_t> ips = r.GetCallChain(&kernel_ip_count);
+    if (ips.empty()) {
+      return true;
+    }
+    // --max-stack limits frames called by the sampled frame.
+    if (ips.size() - 1 > callgraph_max_stack_) {
+      ips.resize(static_cast<size_t>(callgraph_max_stack_) + 1);
+      kernel_ip_count = std::min(kernel_ip_count, ips.size());
+    }
+    std::vector<CallChainReportEntry> callchain =
+        callchain_report_builder.Build(thread, ips, kernel_ip_count);
+    if (callchain.empty()) {
+      return true;
+    }
+    // Like other reports, dso and symbol filters are checked on the sampled frame.
+    if (!filter.dso_filter.empty() && filter.dso_filter.count(callchain[0].DsoName()) == 0) {
+      return true;
+    }
+    if (!filter.symbol_filter.empty() &&
+        filter.symbol_filter.count(callchain[0].symbol->DemangledName()) == 0) {
+      return true;
+    }
+    size_t attr_id = reader.GetAttrIndexOfRecord(&r);
+    callback(r, *thread, attr_names[attr_id], callchain);
+    return true;
+  };
+  return reader.ReadDataSection(process_record);
+}
+
+bool ReportCommand::ExportSamples() {
+  exporter_options_.record_cmdline = record_cmdline_;
+  exporter_options_.arch = GetArchString(record_file_arch_);
+  std::unique_ptr<ReportExporter> exporter =
+      ReportExporter::Create(report_format_, exporter_options_);
+  if (!exporter) {
     return false;
   }
-  for (size_t i = 0; i < event_attrs_.size(); i++) {
-    if (event_attrs_[i].type == PERF_TYPE_TRACEPOINT) {
-      uint64_t trace_event_id = event_attrs_[i].config;
-      attr_names_[i] = tracing->GetTracingEventNameHavingId(trace_event_id);
-    }
+  auto add_sample = [&](const SampleRecord& r, const ThreadEntry& thread,
+                        const std::string& event_name,
+                        const std::vector<CallChainReportEntry>& callchain) {
+    exporter->AddSample(thread, event_name, r.period_data.period, callchain);
+  };
+  if (!ReadReportSamples(*record_file_reader_, thread_tree_, record_filter_, attr_names_,
+                         add_sample)) {
+    return false;
   }
-  return true;
+  return exporter->Write(report_filename_);
+}
+
+bool ReportCommand::DiffSamples() {
+  if (trace_offcpu_) {
+    LOG(ERROR) << "--diff can't be used with record files recorded with --trace-offcpu";
+    return false;
+  }
+  ReportDiffOptions options;
+  options.base_filename = diff_base_filename_;
+  options.new_filename = record_filename_;
+  options.sort_keys = sort_keys_;
+  options.print_callgraph = print_callgraph_;
+  options.callgraph_show_callee = callgraph_show_callee_;
+  options.print_sample_count = print_sample_count_;
+  options.raw_period = raw_period_;
+  options.percent_limit = percent_limit_;
+  options.report_csv = report_csv_;
+  options.csv_separator = csv_separator_;
+  ReportDiffer differ(options);
+  auto add_sample_to = [&differ](ReportDiffer::Side side) {
+    return [&differ, side](const SampleRecord& r, const ThreadEntry& thread,
+                           const std::string& event_name,
+                           const std::vector<CallChainReportEntry>& callchain) {
+      differ.AddSample(side, thread, event_name, r.period_data.period, callchain);
+    };
+  };
+  if (!ReadReportSamples(*record_file_reader_, thread_tree_, record_filter_, attr_names_,
+                         add_sample_to(ReportDiffer::kNew))) {
+    return false;
+  }
+
+  // Read the base file with its own ThreadTree and RecordFilter, so threads, maps and symbols of
+  // the two files aren't mixed.
+  std::unique_ptr<RecordFileReader> reader = RecordFileReader::CreateInstance(diff_base_filename_);
+  if (!reader) {
+    return false;
+  }
+  if (auto it = reader->GetMetaInfoFeature().find("trace_offcpu");
+      it != reader->GetMetaInfoFeature().end() && it->second == "true") {
+    LOG(ERROR) << "--diff can't be used with record files recorded with --trace-offcpu";
+    return false;
+  }
+  ThreadTree thread_tree;
+  if (show_ip_for_unknown_symbol_) {
+    thread_tree.ShowIpForUnknownSymbol();
+  }
+  RecordFilter record_filter(thread_tree);
+  OptionValueMap filter_options = record_filter_options_;
+  if (!ParseRecordFilterOptions(filter_options, record_filter) ||
+      !record_filter.CheckClock(reader->GetClockId())) {
+    return false;
+  }
+  std::vector<std::string> attr_names;
+  if (!reader->LoadBuildIdAndFileFeatures(thread_tree) || !ReadEventNames(*reader, attr_names)) {
+    return false;
+  }
+  if (!ReadReportSamples(*reader, thread_tree, record_filter, attr_names,
+                         add_sample_to(ReportDiffer::kBase))) {
+    return false;
+  }
+  return differ.Write(report_filename_);
 }
 
 bool ReportCommand::PrintReport() {
@@ -0,0 +1,931 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <android-base/logging.h>
+#include <android-base/parseint.h>
+#include <android-base/strings.h>
+
+#include "RecordFilter.h"
+#include "command.h"
+#include "json_writer.h"
+#include "perf_regs.h"
+#include "record_file.h"
+#include "report_utils.h"
+#include "thread_tree.h"
+#include "utils.h"
+
+namespace simpleperf {
+namespace {
+
+// Same as MAX_CALLSTACK_LENGTH in report_html.py.
+constexpr size_t kMaxCallStackLength = 750;
+
+// Function id of the root node in call graphs.
+constexpr int32_t kRootFuncId = -1;
+
+// A hash map iterating items in insertion order, like the dicts used in report_html.py. The
+// order decides the order of items in the generated json.
+template <typename K, typename V>
+class OrderedMap {
+ public:
+  V& operator[](const K& key) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      return items_[it->second].second;
+    }
+    index_.emplace(key, items_.size());
+    items_.emplace_back(key, V());
+    return items_.back().second;
+  }
+
+  V* Find(const K& key) {
+    auto it = index_.find(key);
+    return it != index_.end() ? &items_[it->second].second : nullptr;
+  }
+
+  template <typename Pred>
+  void EraseIf(Pred pred) {
+    std::vector<std::pair<K, V>> items;
+    for (auto& item : items_) {
+      if (!pred(item.second)) {
+        items.emplace_back(std::move(item));
+      }
+    }
+    Clear();
+    for (auto& item : items) {
+      index_.emplace(item.first, items_.size());
+      items_.emplace_back(std::move(item));
+    }
+  }
+
+  void Clear() {
+    items_.clear();
+    index_.clear();
+  }
+
+  bool empty() const { return items_.empty(); }
+  std::vector<std::pair<K, V>>& items() { return items_; }
+  const std::vector<std::pair<K, V>>& items() const { return items_; }
+
+ private:
+  std::vector<std::pair<K, V>> items_;
+  std::unordered_map<K, size_t> index_;
+};
+
+std::string ModifyTextForHtml(std::string_view text) {
+  std::string result;
+  result.reserve(text.size());
+  for (char c : text) {
+    if (c == '>') {
+      result += "&gt;";
+    } else if (c == '<') {
+      result += "&lt;";
+    } else {
+      result.push_back(c);
+    }
+  }
+  return result;
+}
+
+// Nodes of a call graph are allocated in one vector and linked by indexes, so a call graph
+// doesn't need an allocation per node. Children of a node are found through a hash map keyed
+// by (parent index, function id), and kept in insertion order.
+class CallGraph {
+ public:
+  static constexpr uint32_t kNoNode = UINT32_MAX;
+  static constexpr uint32_t kRoot = 0;
+
+  struct Node {
+    int32_t func_id;
+    uint64_t event_count = 0;
+    uint64_t subtree_event_count = 0;
+    uint32_t first_child = kNoNode;
+    uint32_t last_child = kNoNode;
+    uint32_t next_sibling = kNoNode;
+
+    Node(int32_t func_id) : func_id(func_id) {}
+  };
+
+  CallGraph() { nodes_.emplace_back(kRootFuncId); }
+
+  uint32_t GetChild(uint32_t parent, int32_t func_id) {
+    uint64_t key = (static_cast<uint64_t>(parent) << 32) | static_cast<uint32_t>(func_id);
+    auto [it, inserted] = child_map_.try_emplace(key, static_cast<uint32_t>(nodes_.size()));
+    if (inserted) {
+      nodes_.emplace_back(func_id);
+      Node& p = nodes_[parent];
+      if (p.last_child == kNoNode) {
+        p.first_child = it->second;
+      } else {
+        nodes_[p.last_child].next_sibling = it->second;
+      }
+      p.last_child = it->second;
+    }
+    return it->second;
+  }
+
+  void AddEventCount(uint32_t node, uint64_t event_count) {
+    nodes_[node].event_count += event_count;
+  }
+
+  void Merge(const CallGraph& other) { MergeNode(kRoot, other, kRoot); }
+
+  uint64_t UpdateSubtreeEventCount(uint32_t node = kRoot) {
+    Node& n = nodes_[node];
+    uint64_t count = n.event_count;
+    for (uint32_t child = n.first_child; child != kNoNode; child = nodes_[child].next_sibling) {
+      count += UpdateSubtreeEventCount(child);
+    }
+    nodes_[node].subtree_event_count = count;
+    return count;
+  }
+
+  uint64_t SubtreeEventCount() const { return nodes_[kRoot].subtree_event_count; }
+
+  // Remove children having subtree_event_count < min_limit, and collect function ids of the
+  // remaining nodes.
+  void CutEdges(double min_limit, std::unordered_set<int32_t>& hit_func_ids,
+                uint32_t node = kRoot) {
+    hit_func_ids.insert(nodes_[node].func_id);
+    std::vector<uint32_t> children;
+    for (uint32_t child = nodes_[node].first_child; child != kNoNode;
+         child = nodes_[child].next_sibling) {
+      if (nodes_[child].subtree_event_count >= min_limit) {
+        children.push_back(child);
+        CutEdges(min_limit, hit_func_ids, child);
+      }
+    }
+    SetChildren(node, children);
+  }
+
+  template <typename GetName>
+  void SortByFunctionName(GetName get_name, uint32_t node = kRoot) {
+    std::vector<uint32_t> children;
+    for (uint32_t child = nodes_[node].first_child; child != kNoNode;
+         child = nodes_[child].next_sibling) {
+      children.push_back(child);
+    }
+    std::stable_sort(children.begin(), children.end(), [&](uint32_t n1, uint32_t n2) {
+      return get_name(nodes_[n1].func_id) < get_name(nodes_[n2].func_id);
+    });
+    SetChildren(node, children);
+    for (uint32_t child : children) {
+      SortByFunctionName(get_name, child);
+    }
+  }
+
+  void WriteJson(JsonWriter& writer, uint32_t node = kRoot) const {
+    const Node& n = nodes_[node];
+    writer.BeginObject();
+    writer.Key("e");
+    writer.Uint(n.event_count);
+    writer.Key("s");
+    writer.Uint(n.subtree_event_count);
+    writer.Key("f");
+    writer.Int(n.func_id);
+    writer.Key("c");
+    writer.BeginArray();
+    for (uint32_t child = n.first_child; child != kNoNode; child = nodes_[child].next_sibling) {
+      WriteJson(writer, child);
+    }
+    writer.EndArray();
+    writer.EndObject();
+  }
+
+ private:
+  void MergeNode(uint32_t node, const CallGraph& other, uint32_t other_node) {
+    nodes_[node].event_count += other.nodes_[other_node].event_count;
+    nodes_[node].subtree_event_count += other.nodes_[other_node].subtree_event_count;
+    for (uint32_t child = other.nodes_[other_node].first_child; child != kNoNode;
+         child = other.nodes_[child].next_sibling) {
+      MergeNode(GetChild(node, other.nodes_[child].func_id), other, child);
+    }
+  }
+
+  void SetChildren(uint32_t node, const std::vector<uint32_t>& children) {
+    Node& n = nodes_[node];
+    n.first_child = n.last_child = kNoNode;
+    for (uint32_t child : children) {
+      if (n.last_child == kNoNode) {
+        n.first_child = child;
+      } else {
+        nodes_[n.last_child].next_sibling = child;
+      }
+      n.last_child = child;
+    }
+    if (n.last_child != kNoNode) {
+      nodes_[n.last_child].next_sibling = kNoNode;
+    }
+  }
+
+  std::vector<Node> nodes_;
+  std::unordered_map<uint64_t, uint32_t> child_map_;
+};
+
+struct FunctionScope {
+  uint64_t sample_count = 0;
+  uint64_t event_count = 0;
+  uint64_t subtree_event_count = 0;
+
+  void Merge(const FunctionScope& other) {
+    sample_count += other.sample_count;
+    event_count += other.event_count;
+    subtree_event_count += other.subtree_event_count;
+  }
+};
+
+struct LibScope {
+  uint64_t event_count = 0;
+  OrderedMap<int32_t, FunctionScope> functions;
+
+  void Merge(LibScope& other) {
+    event_count += other.event_count;
+    for (auto& [func_id, function] : other.functions.items()) {
+      functions[func_id].Merge(function);
+    }
+  }
+};
+
+// A call stack item is (lib_id, func_id).
+using CallStack = std::vector<std::pair<int32_t, int32_t>>;
+
+struct ThreadScope {
+  int tid = 0;
+  std::string name;
+  uint64_t event_count = 0;
+  uint64_t sample_count = 0;
+  OrderedMap<int32_t, LibScope> libs;
+  CallGraph call_graph;
+  CallGraph reverse_call_graph;
+
+  // For each i > 0, callstack[i] calls callstack[i - 1].
+  void AddCallStack(uint64_t period, const CallStack& callstack,
+                    std::unordered_set<int32_t>& hit_func_ids) {
+    hit_func_ids.clear();
+    for (size_t i = 0; i < callstack.size(); i++) {
+      auto [lib_id, func_id] = callstack[i];
+      // When a callstack contains recursive functions, only add each function once.
+      if (!hit_func_ids.insert(func_id).second) {
+        continue;
+      }
+      LibScope& lib = libs[lib_id];
+      FunctionScope& function = lib.functions[func_id];
+      function.subtree_event_count += period;
+      if (i == 0) {
+        lib.event_count += period;
+        function.event_count += period;
+        function.sample_count++;
+      }
+    }
+    uint32_t node = CallGraph::kRoot;
+    for (auto it = callstack.rbegin(); it != callstack.rend(); ++it) {
+      node = call_graph.GetChild(node, it->second);
+    }
+    call_graph.AddEventCount(node, period);
+    node = CallGraph::kRoot;
+    for (const auto& item : callstack) {
+      node = reverse_call_graph.GetChild(node, item.second);
+    }
+    reverse_call_graph.AddEventCount(node, period);
+  }
+
+  void Merge(ThreadScope& other) {
+    event_count += other.event_count;
+    sample_count += other.sample_count;
+    for (auto& [lib_id, lib] : other.libs.items()) {
+      libs[lib_id].Merge(lib);
+    }
+    call_graph.Merge(other.call_graph);
+    reverse_call_graph.Merge(other.reverse_call_graph);
+  }
+
+  void LimitPercents(double min_func_limit, double min_callchain_percent,
+                     std::unordered_set<int32_t>& hit_func_ids) {
+    for (auto& [lib_id, lib] : libs.items()) {
+      lib.functions.EraseIf([&](const FunctionScope& function) {
+        return function.subtree_event_count < min_func_limit;
+      });
+      for (const auto& item : lib.functions.items()) {
+        hit_func_ids.insert(item.first);
+      }
+    }
+    double min_limit = min_callchain_percent * 0.01 * call_graph.SubtreeEventCount();
+    call_graph.CutEdges(min_limit, hit_func_ids);
+    reverse_call_graph.CutEdges(min_limit, hit_func_ids);
+  }
+};
+
+struct ProcessScope {
+  int pid = 0;
+  std::string name;
+  uint64_t event_count = 0;
+  OrderedMap<int, ThreadScope> threads;
+
+  ThreadScope& GetThread(int tid, const char* thread_name) {
+    ThreadScope& thread = threads[tid];
+    thread.tid = tid;
+    thread.name = thread_name;
+    if (pid == tid) {
+      name = thread_name;
+    }
+    return thread;
+  }
+
+  void MergeByThreadName(ProcessScope& other) {
+    event_count += other.event_count;
+    OrderedMap<std::string, ThreadScope> new_threads;
+    for (OrderedMap<int, ThreadScope>* map : {&threads, &other.threads}) {
+      for (auto& item : map->items()) {
+        ThreadScope& thread = item.second;
+        if (ThreadScope* cur_thread = new_threads.Find(thread.name); cur_thread != nullptr) {
+          cur_thread->Merge(thread);
+        } else {
+          std::string name = thread.name;
+          new_threads[name] = std::move(thread);
+        }
+      }
+    }
+    threads.Clear();
+    for (auto& item : new_threads.items()) {
+      threads[item.second.tid] = std::move(item.second);
+    }
+  }
+};
+
+struct EventScope {
+  uint64_t sample_count = 0;
+  uint64_t event_count = 0;
+  OrderedMap<int, ProcessScope> processes;
+
+  ProcessScope& GetProcess(int pid) {
+    ProcessScope& process = processes[pid];
+    process.pid = pid;
+    return process;
+  }
+};
+
+struct Function {
+  int32_t lib_id;
+  std::string name;
+};
+
+class ReportHtmlDataCommand : public Command {
+ public:
+  ReportHtmlDataCommand()
+      : Command("report-html-data", "generate json data used by report_html.js",
+                // clang-format off
+"Usage: simpleperf report-html-data [options]\n"
+"Aggregate samples in perf.data into the json data used by report_html.js. It is used by\n"
+"report_html.py.\n"
+"--aggregate-by-thread-name  Aggregate samples by thread name instead of thread id.\n"
+"--aggregate-threads thread_name_regex1,thread_name_regex2,...\n"
+"                            Aggregate threads with names matching the same regex.\n"
+"-i <file1>,<file2>,...      Set record files to report. Default is perf.data.\n"
+"--min-callchain-percent <percent>  Set min percentage of callchains shown in the report.\n"
+"                                   Default is 0.01.\n"
+"--min-func-percent <percent>       Set min percentage of functions shown in the report.\n"
+"                                   Default is 0.01.\n"
+"-o <file>                   Set output json file. Default is stdout.\n"
+"--proguard-mapping-file <file>  Add proguard mapping file to de-obfuscate symbols.\n"
+"--show-art-frames           Show frames of internal methods in the ART Java interpreter.\n"
+"--symfs <dir>               Look for files with symbols relative to this directory.\n"
+"\n"
+"Sample filter options:\n"
+RECORD_FILTER_OPTION_HELP_MSG_FOR_REPORTING
+                // clang-format on
+                ),
+        callchain_report_builder_(thread_tree_),
+        record_filter_(thread_tree_) {}
+
+  bool Run(const std::vector<std::string>& args) override;
+
+ private:
+  bool ParseOptions(const std::vector<std::string>& args);
+  bool LoadRecordFile(const std::string& filename);
+  void ProcessSampleRecord(const SampleRecord& r, const std::string& event_name);
+  int32_t GetLibId(const CallChainReportEntry& entry);
+  int32_t GetFuncId(int32_t lib_id, const CallChainReportEntry& entry);
+  void AggregateByThreadName();
+  void LimitPercents();
+  void SortCallGraphByFunctionName();
+  bool WriteJson();
+  void WriteSampleInfo(JsonWriter& writer);
+
+  std::vector<std::string> record_filenames_ = {"perf.data"};
+  std::string output_filename_;
+  bool aggregate_by_thread_name_ = false;
+  double min_func_percent_ = 0.01;
+  double min_callchain_percent_ = 0.01;
+  ThreadTree thread_tree_;
+  CallChainReportBuilder callchain_report_builder_;
+  ThreadReportBuilder thread_report_builder_;
+  RecordFilter record_filter_;
+
+  std::unordered_map<std::string, std::string> meta_info_;
+  std::string record_cmdline_;
+  std::string arch_;
+  uint64_t total_samples_ = 0;
+  OrderedMap<std::string, EventScope> events_;
+  std::vector<std::string> libs_;
+  std::unordered_map<std::string, int32_t> lib_ids_;
+  std::vector<Function> functions_;
+  std::map<std::pair<int32_t, std::string>, int32_t> func_ids_;
+  // Functions left after LimitPercents().
+  std::unordered_set<int32_t> hit_func_ids_;
+
+  // Caches valid while loading one record file.
+  std::unordered_map<const Dso*, int32_t> dso_lib_ids_;
+  std::unordered_map<const Symbol*, int32_t> symbol_func_ids_;
+  CallStack callstack_;
+  std::unordered_set<int32_t> callstack_func_ids_;
+};
+
+bool ReportHtmlDataCommand::Run(const std::vector<std::string>& args) {
+  if (!ParseOptions(args)) {
+    return false;
+  }
+  // If not showing ip for unknown symbols, the percent of the unknown symbol may be accumulated
+  // to very big, and ranks first in the sample table.
+  thread_tree_.ShowIpForUnknownSymbol();
+  for (const std::string& filename : record_filenames_) {
+    if (!LoadRecordFile(filename)) {
+      return false;
+    }
+  }
+  if (aggregate_by_thread_name_) {
+    AggregateByThreadName();
+  }
+  for (auto& event : events_.items()) {
+    for (auto& process : event.second.processes.items()) {
+      for (auto& thread : process.second.threads.items()) {
+        thread.second.call_graph.UpdateSubtreeEventCount();
+        thread.second.reverse_call_graph.UpdateSubtreeEventCount();
+      }
+    }
+  }
+  LimitPercents();
+  SortCallGraphByFunctionName();
+  return WriteJson();
+}
+
+bool ReportHtmlDataCommand::ParseOptions(const std::vector<std::string>& args) {
+  OptionFormatMap option_formats = {
+      {"--aggregate-by-thread-name", {OptionValueType::NONE, OptionType::SINGLE}},
+      {"--aggregate-threads", {OptionValueType::STRING, OptionType::MULTIPLE}},
+      {"-i", {OptionValueType::STRING, OptionType::MULTIPLE}},
+      {"--min-callchain-percent", {OptionValueType::DOUBLE, OptionType::SINGLE}},
+      {"--min-func-percent", {OptionValueType::DOUBLE, OptionType::SINGLE}},
+      {"-o", {OptionValueType::STRING, OptionType::SINGLE}},
+      {"--proguard-mapping-file", {OptionValueType::STRING, OptionType::MULTIPLE}},
+      {"--show-art-frames", {OptionValueType::NONE, OptionType::SINGLE}},
+      {"--symfs", {OptionValueType::STRING, OptionType::SINGLE}},
+  };
+  OptionFormatMap record_filter_options = GetRecordFilterOptionFormats(false);
+  option_formats.insert(record_filter_options.begin(), record_filter_options.end());
+  OptionValueMap options;
+  std::vector<std::pair<OptionName, OptionValue>> ordered_options;
+  if (!PreprocessOptions(args, option_formats, &options, &ordered_options, nullptr)) {
+    return false;
+  }
+  aggregate_by_thread_name_ = options.PullBoolValue("--aggregate-by-thread-name");
+  if (auto strs = options.PullStringValues("--aggregate-threads"); !strs.empty()) {
+    std::vector<std::string> regs;
+    for (const std::string& s : strs) {
+      std::vector<std::string> items = android::base::Split(s, ",");
+      regs.insert(regs.end(), items.begin(), items.end());
+    }
+    if (!thread_report_builder_.AggregateThreads(regs)) {
+      return false;
+    }
+  }
+  if (auto strs = options.PullStringValues("-i"); !strs.empty()) {
+    record_filenames_.clear();
+    for (const std::string& s : strs) {
+      std::vector<std::string> items = android::base::Split(s, ",");
+      record_filenames_.insert(record_filenames_.end(), items.begin(), items.end());
+    }
+  }
+  if (!options.PullDoubleValue("--min-callchain-percent", &min_callchain_percent_, 0, 100) ||
+      !options.PullDoubleValue("--min-func-percent", &min_func_percent_, 0, 100)) {
+    return false;
+  }
+  options.PullStringValue("-o", &output_filename_);
+  for (const OptionValue& value : options.PullValues("--proguard-mapping-file")) {
+    if (!callchain_report_builder_.AddProguardMappingFile(*value.str_value)) {
+      return false;
+    }
+  }
+  if (options.PullBoolValue("--show-art-frames")) {
+    callchain_report_builder_.SetRemoveArtFrame(false);
+  }
+  if (auto value = options.PullValue("--symfs"); value) {
+    if (!Dso::SetSymFsDir(*value->str_value)) {
+      return false;
+    }
+  }
+  if (!record_filter_.ParseOptions(options)) {
+    return false;
+  }
+  CHECK(options.values.empty());
+  return true;
+}
+
+bool ReportHtmlDataCommand::LoadRecordFile(const std::string& filename) {
+  std::unique_ptr<RecordFileReader> reader = RecordFileReader::CreateInstance(filename);
+  if (!reader) {
+    return false;
+  }
+  thread_tree_.ClearThreadAndMap();
+  dso_lib_ids_.clear();
+  symbol_func_ids_.clear();
+  if (!reader->LoadBuildIdAndFileFeatures(thread_tree_)) {
+    return false;
+  }
+  meta_info_ = reader->GetMetaInfoFeature();
+  if (auto it = meta_info_.find("trace_offcpu"); it != meta_info_.end() && it->second == "true") {
+    LOG(ERROR) << "report-html-data doesn't support " << filename
+               << " recorded with --trace-offcpu.";
+    return false;
+  }
+  if (!record_filter_.CheckClock(reader->GetClockId())) {
+    return false;
+  }
+  record_cmdline_ = android::base::Join(reader->ReadCmdlineFeature(), ' ');
+  arch_ = reader->ReadFeatureString(PerfFileFormat::FEAT_ARCH);
+  ArchType arch_type = arch_.empty() ? GetTargetArch() : GetArchType(arch_);
+  if (arch_type == ARCH_UNSUPPORTED) {
+    return false;
+  }
+  ScopedCurrentArch scoped_arch(arch_type);
+
+  std::vector<std::string> event_names;
+  if (!ReadEventNames(*reader, event_names)) {
+    return false;
+  }
+
+  auto process_record = [&](std::unique_ptr<Record> record) {
+    thread_tree_.Update(*record);
+    if (record->type() == PERF_RECORD_SAMPLE) {
+      const SampleRecord& r = *static_cast<SampleRecord*>(record.get());
+      if (record_filter_.Check(&r)) {
+        ProcessSampleRecord(r, event_names[reader->GetAttrIndexOfRecord(&r)]);
+      }
+    } else if (record->type() == PERF_RECORD_TRACING_DATA ||
+               record->type() == SIMPLE_PERF_RECORD_TRACING_DATA) {
+      const auto& r = *static_cast<TracingDataRecord*>(record.get());
+      return UpdateTracepointNames(std::vector<char>(r.data, r.data + r.data_size), *reader,
+                                   event_names);
+    }
+    return true;
+  };
+  return reader->ReadDataSection(process_record);
+}
+
+void ReportHtmlDataCommand::ProcessSampleRecord(const SampleRecord& r,
+                                                const std::string& event_name) {
+  size_t kernel_ip_count;
+  std::vector<uint64_t> ips = r.GetCallChain(&kernel_ip_count);
+  const ThreadEntry* thread_entry = thread_tree_.FindThreadOrNew(r.tid_data.pid, r.tid_data.tid);
+  std::vector<CallChainReportEntry> callchain =
+      callchain_report_builder_.Build(thread_entry, ips, kernel_ip_count);
+  if (callchain.empty()) {
+    return;
+  }
+  ThreadReport thread_report = thread_report_builder_.Build(*thread_entry);
+  uint64_t period = r.period_data.period;
+
+  total_samples_++;
+  EventScope& event = events_[event_name];
+  event.sample_count++;
+  event.event_count += period;
+  ProcessScope& process = event.GetProcess(thread_report.pid);
+  process.event_count += period;
+  ThreadScope& thread = process.GetThread(thread_report.tid, thread_report.thread_name);
+  thread.event_count += period;
+  thread.sample_count++;
+
+  callstack_.clear();
+  for (const CallChainReportEntry& entry : callchain) {
+    int32_t lib_id = GetLibId(entry);
+    callstack_.emplace_back(lib_id, GetFuncId(lib_id, entry));
+    if (callstack_.size() == kMaxCallStackLength) {
+      break;
+    }
+  }
+  thread.AddCallStack(period, callstack_, callstack_func_ids_);
+}
+
+int32_t ReportHtmlDataCommand::GetLibId(const CallChainReportEntry& entry) {
+  if (auto it = dso_lib_ids_.find(entry.dso); it != dso_lib_ids_.end()) {
+    return it->second;
+  }
+  auto [it, inserted] = lib_ids_.try_emplace(entry.DsoName(), static_cast<int32_t>(libs_.size()));
+  if (inserted) {
+    libs_.emplace_back(entry.DsoName());
+  }
+  dso_lib_ids_[entry.dso] = it->second;
+  return it->second;
+}
+
+int32_t ReportHtmlDataCommand::GetFuncId(int32_t lib_id, const CallChainReportEntry& entry) {
+  if (auto it = symbol_func_ids_.find(entry.symbol); it != symbol_func_ids_.end()) {
+    return it->second;
+  }
+  std::string name = entry.symbol->DemangledName();
+  auto [it, inserted] = func_ids_.try_emplace(std::make_pair(lib_id, name),
+                                              static_cast<int32_t>(functions_.size()));
+  if (inserted) {
+    functions_.emplace_back(Function{lib_id, std::move(name)});
+  }
+  symbol_func_ids_[entry.symbol] = it->second;
+  return it->second;
+}
+
+void ReportHtmlDataCommand::AggregateByThreadName() {
+  for (auto& event_item : events_.items()) {
+    EventScope& event = event_item.second;
+    OrderedMap<std::string, ProcessScope> new_processes;
+    for (auto& item : event.processes.items()) {
+      ProcessScope& process = item.second;
+      if (ProcessScope* cur_process = new_processes.Find(process.name); cur_process != nullptr) {
+        cur_process->MergeByThreadName(process);
+      } else {
+        std::string name = process.name;
+        new_processes[name] = std::move(process);
+      }
+    }
+    event.processes.Clear();
+    for (auto& item : new_processes.items()) {
+      event.processes[item.second.pid] = std::move(item.second);
+    }
+  }
+}
+
+void ReportHtmlDataCommand::LimitPercents() {
+  hit_func_ids_.clear();
+  for (auto& event_item : events_.items()) {
+    EventScope& event = event_item.second;
+    double min_limit = event.event_count * min_func_percent_ * 0.01;
+    for (auto& process_item : event.processes.items()) {
+      ProcessScope& process = process_item.second;
+      process.threads.EraseIf([&](const ThreadScope& thread) {
+        return thread.call_graph.SubtreeEventCount() < min_limit;
+      });
+      for (auto& thread_item : process.threads.items()) {
+        thread_item.second.LimitPercents(min_limit, min_callchain_percent_, hit_func_ids_);
+      }
+    }
+    event.processes.EraseIf([](const ProcessScope& process) { return process.threads.empty(); });
+  }
+}
+
+void ReportHtmlDataCommand::SortCallGraphByFunctionName() {
+  auto get_name = [this](int32_t func_id) -> const std::string& {
+    return functions_[func_id].name;
+  };
+  for (auto& event_item : events_.items()) {
+    for (auto& process_item : event_item.second.processes.items()) {
+      for (auto& thread_item : process_item.second.threads.items()) {
+        thread_item.second.call_graph.SortByFunctionName(get_name);
+        thread_item.second.reverse_call_graph.SortByFunctionName(get_name);
+      }
+    }
+  }
+}
+
+bool ReportHtmlDataCommand::WriteJson() {
+  std::unique_ptr<FILE, decltype(&fclose)> file_handler(nullptr, fclose);
+  FILE* fp = stdout;
+  if (!output_filename_.empty()) {
+    fp = fopen(output_filename_.c_str(), "w");
+    if (fp == nullptr) {
+      PLOG(ERROR) << "failed to open " << output_filename_;
+      return false;
+    }
+    file_handler.reset(fp);
+  }
+  JsonWriter writer(fp);
+  writer.BeginObject();
+
+  time_t t = time(nullptr);
+  if (auto it = meta_info_.find("timestamp"); it != meta_info_.end()) {
+    int64_t timestamp;
+    if (android::base::ParseInt(it->second, &timestamp)) {
+      t = static_cast<time_t>(timestamp);
+    }
+  }
+  char time_str[128] = {};
+  struct tm tm_value;
+#if defined(_WIN32)
+  localtime_s(&tm_value, &t);
+#else
+  localtime_r(&t, &tm_value);
+#endif
+  strftime(time_str, sizeof(time_str), "%Y-%m-%d (%A) %H:%M:%S", &tm_value);
+  writer.Key("recordTime");
+  writer.String(time_str);
+
+  std::string machine_type = arch_;
+  if (auto it = meta_info_.find("product_props"); it != meta_info_.end()) {
+    std::vector<std::string> props = android::base::Split(it->second, ":");
+    if (props.size() == 3) {
+      machine_type = props[1] + " (" + props[2] + ") by " + props[0] + ", arch " + arch_;
+    }
+  }
+  writer.Key("machineType");
+  writer.String(machine_type);
+  for (const auto& [key, meta_key] :
+       std::vector<std::pair<const char*, const char*>>{
+           {"androidVersion", "android_version"},
+           {"androidBuildFingerprint", "android_build_fingerprint"},
+           {"kernelVersion", "kernel_version"},
+       }) {
+    auto it = meta_info_.find(meta_key);
+    writer.Key(key);
+    writer.String(it != meta_info_.end() ? it->second : "");
+  }
+  writer.Key("recordCmdline");
+  writer.String(record_cmdline_);
+  writer.Key("totalSamples");
+  writer.Uint(total_samples_);
+
+  std::map<int, std::string> process_names;
+  std::map<int, std::string> thread_names;
+  for (auto& event_item : events_.items()) {
+    for (auto& process_item : event_item.second.processes.items()) {
+      process_names[process_item.first] = process_item.second.name;
+      for (auto& thread_item : process_item.second.threads.items()) {
+        thread_names[thread_item.first] = thread_item.second.name;
+      }
+    }
+  }
+  for (const auto& [key, names] : {std::make_pair("processNames", &process_names),
+                                   std::make_pair("threadNames", &thread_names)}) {
+    writer.Key(key);
+    writer.BeginObject();
+    for (const auto& [id, name] : *names) {
+      writer.Key(std::to_string(id));
+      writer.String(name);
+    }
+    writer.EndObject();
+  }
+
+  writer.Key("libList");
+  writer.BeginArray();
+  for (const std::string& lib : libs_) {
+    writer.String(ModifyTextForHtml(lib));
+  }
+  writer.EndArray();
+
+  writer.Key("functionMap");
+  writer.BeginObject();
+  for (size_t i = 0; i < functions_.size(); i++) {
+    if (hit_func_ids_.count(static_cast<int32_t>(i)) == 0) {
+      continue;
+    }
+    writer.Key(std::to_string(i));
+    writer.BeginObject();
+    writer.Key("l");
+    writer.Int(functions_[i].lib_id);
+    writer.Key("f");
+    writer.String(ModifyTextForHtml(functions_[i].name));
+    writer.EndObject();
+  }
+  writer.EndObject();
+
+  WriteSampleInfo(writer);
+
+  // Source code isn't collected by report-html-data.
+  writer.Key("sourceFiles");
+  writer.BeginArray();
+  writer.EndArray();
+  writer.EndObject();
+
+  fflush(fp);
+  if (ferror(fp) != 0) {
+    PLOG(ERROR) << "failed to write json data";
+    return false;
+  }
+  return true;
+}
+
+void ReportHtmlDataCommand::WriteSampleInfo(JsonWriter& writer) {
+  writer.Key("sampleInfo");
+  writer.BeginArray();
+  for (auto& [event_name, event] : events_.items()) {
+    writer.BeginObject();
+    writer.Key("eventName");
+    writer.String(event_name);
+    writer.Key("eventCount");
+    writer.Uint(event.event_count);
+    writer.Key("processes");
+    writer.BeginArray();
+    std::vector<ProcessScope*> processes;
+    for (auto& item : event.processes.items()) {
+      processes.push_back(&item.second);
+    }
+    std::stable_sort(processes.begin(), processes.end(),
+                     [](const ProcessScope* p1, const ProcessScope* p2) {
+                       return p1->event_count > p2->event_count;
+                     });
+    for (ProcessScope* process : processes) {
+      writer.BeginObject();
+      writer.Key("pid");
+      writer.Int(process->pid);
+      writer.Key("eventCount");
+      writer.Uint(process->event_count);
+      writer.Key("threads");
+      writer.BeginArray();
+      // Sorting threads by sample count is better for profiles recorded with --trace-offcpu.
+      std::vector<ThreadScope*> threads;
+      for (auto& item : process->threads.items()) {
+        threads.push_back(&item.second);
+      }
+      std::stable_sort(threads.begin(), threads.end(),
+                       [](const ThreadScope* t1, const ThreadScope* t2) {
+                         return t1->sample_count > t2->sample_count;
+                       });
+      for (ThreadScope* thread : threads) {
+        writer.BeginObject();
+        writer.Key("tid");
+        writer.Int(thread->tid);
+        writer.Key("eventCount");
+        writer.Uint(thread->event_count);
+        writer.Key("sampleCount");
+        writer.Uint(thread->sample_count);
+        writer.Key("libs");
+        writer.BeginArray();
+        for (auto& [lib_id, lib] : thread->libs.items()) {
+          writer.BeginObject();
+          writer.Key("libId");
+          writer.Int(lib_id);
+          writer.Key("eventCount");
+          writer.Uint(lib.event_count);
+          writer.Key("functions");
+          writer.BeginArray();
+          for (auto& [func_id, function] : lib.functions.items()) {
+            writer.BeginObject();
+            writer.Key("f");
+            writer.Int(func_id);
+            writer.Key("c");
+            writer.BeginArray();
+            writer.Uint(function.sample_count);
+            writer.Uint(function.event_count);
+            writer.Uint(function.subtree_event_count);
+            writer.EndArray();
+            writer.EndObject();
+          }
+          writer.EndArray();
+          writer.EndObject();
+        }
+        writer.EndArray();
+        writer.Key("g");
+        thread->call_graph.WriteJson(writer);
+        writer.Key("rg");
+        thread->reverse_call_graph.WriteJson(writer);
+        writer.EndObject();
+      }
+      writer.EndArray();
+      writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+  }
+  writer.EndArray();
+}
+
+}  // namespace
+
+void RegisterReportHtmlDataCommand() {
+  RegisterCommand("report-html-data",
+                  [] { return std::unique_ptr<Command>(new ReportHtmlDataCommand()); });
+}
+
+}  // namespace simpleperf
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string_view>
+
+#include <android-base/file.h>
+
+#include "command.h"
+#include "get_test_data.h"
+#include "test_util.h"
+
+using namespace simpleperf;
+
+static std::unique_ptr<Command> ReportHtmlDataCmd() {
+  return CreateCommandInstance("report-html-data");
+}
+
+static std::string GetJsonData(const std::vector<std::string>& args) {
+  TemporaryFile tmpfile;
+  close(tmpfile.release());
+  std::vector<std::string> cmd_args = {"-o", tmpfile.path};
+  cmd_args.insert(cmd_args.end(), args.begin(), args.end());
+  if (!ReportHtmlDataCmd()->Run(cmd_args)) {
+    return "";
+  }
+  std::string data;
+  if (!android::base::ReadFileToString(tmpfile.path, &data)) {
+    return "";
+  }
+  return data;
+}
+
+// A minimal json parser for checking the output. Numbers are parsed as integers.
+struct JsonValue {
+  uint64_t number = 0;
+  std::string str;
+  std::vector<JsonValue> array;
+  std::map<std::string, JsonValue> object;
+
+  const JsonValue& operator[](const std::string& key) const { return object.at(key); }
+};
+
+static bool ParseJson(std::string_view& s, JsonValue& value);
+
+static bool ParseJsonString(std::string_view& s, std::string& str) {
+  if (s.empty() || s[0] != '"') {
+    return false;
+  }
+  size_t i = 1;
+  for (; i < s.size() && s[i] != '"'; i++) {
+    if (s[i] == '\\') {
+      i++;
+    }
+    if (i < s.size()) {
+      str.push_back(s[i]);
+    }
+  }
+  if (i == s.size()) {
+    return false;
+  }
+  s.remove_prefix(i + 1);
+  return true;
+}
+
+static bool ParseJson(std::string_view& s, JsonValue& value) {
+  if (s.empty()) {
+    return false;
+  }
+  if (s[0] == '{' || s[0] == '[') {
+    bool is_object = s[0] == '{';
+    char end = is_object ? '}' : ']';
+    s.remove_prefix(1);
+    while (!s.empty() && s[0] != end) {
+      JsonValue* item;
+      if (is_object) {
+        std::string key;
+        if (!ParseJsonString(s, key) || s.empty() || s[0] != ':') {
+          return false;
+        }
+        s.remove_prefix(1);
+        item = &value.object[key];
+      } else {
+        item = &value.array.emplace_back();
+      }
+      if (!ParseJson(s, *item)) {
+        return false;
+      }
+      if (!s.empty() && s[0] == ',') {
+        s.remove_prefix(1);
+      }
+    }
+    if (s.empty()) {
+      return false;
+    }
+    s.remove_prefix(1);
+    return true;
+  }
+  if (s[0] == '"') {
+    return ParseJsonString(s, value.str);
+  }
+  size_t i = 0;
+  while (i < s.size() && s[i] != ',' && s[i] != '}' && s[i] != ']') {
+    if (isdigit(s[i])) {
+      value.number = value.number * 10 + (s[i] - '0');
+    }
+    i++;
+  }
+  s.remove_prefix(i);
+  return i > 0;
+}
+
+// Return the subtree event count of a call graph node after checking that it matches its
+// children.
+static uint64_t CheckSubtreeEventCount(const JsonValue& node) {
+  uint64_t count = node["e"].number;
+  for (const JsonValue& child : node["c"].array) {
+    count += CheckSubtreeEventCount(child);
+  }
+  EXPECT_EQ(node["s"].number, count);
+  return count;
+}
+
+TEST(report_html_data_cmd, smoke) {
+  std::string data = GetJsonData({"-i", GetTestData(CALLGRAPH_FP_PERF_DATA)});
+  ASSERT_FALSE(data.empty());
+  ASSERT_EQ(data.front(), '{');
+  ASSERT_EQ(data.back(), '}');
+  for (const char* key : {"\"recordTime\":", "\"recordCmdline\":", "\"processNames\":",
+                          "\"threadNames\":", "\"libList\":", "\"functionMap\":",
+                          "\"sampleInfo\":[{\"eventName\":", "\"g\":{\"e\":0,", "\"rg\":{",
+                          "\"sourceFiles\":[]"}) {
+    ASSERT_NE(data.find(key), std::string::npos) << key;
+  }
+}
+
+TEST(report_html_data_cmd, multiple_record_files) {
+  std::string record_file = GetTestData(CALLGRAPH_FP_PERF_DATA);
+  std::string data = GetJsonData({"-i", record_file + "," + record_file});
+  ASSERT_FALSE(data.empty());
+  std::string aggregated_data = GetJsonData({"-i", record_file, "-i", record_file,
+                                             "--aggregate-by-thread-name"});
+  ASSERT_FALSE(aggregated_data.empty());
+}
+
+TEST(report_html_data_cmd, limit_percents) {
+  std::string record_file = GetTestData(CALLGRAPH_FP_PERF_DATA);
+  std::string data = GetJsonData({"-i", record_file, "--min-func-percent", "0"});
+  std::string limited_data = GetJsonData({"-i", record_file, "--min-func-percent", "10",
+                                          "--min-callchain-percent", "10"});
+  ASSERT_FALSE(limited_data.empty());
+  ASSERT_LT(limited_data.size(), data.size());
+}
+
+TEST(report_html_data_cmd, subtree_event_count_after_aggregation) {
+  std::string record_file = GetTestData(CALLGRAPH_FP_PERF_DATA);
+  std::string data =
+      GetJsonData({"-i", record_file, "-i", record_file, "--aggregate-by-thread-name",
+                   "--min-func-percent", "0", "--min-callchain-percent", "0"});
+  std::string_view s = data;
+  JsonValue json;
+  ASSERT_TRUE(ParseJson(s, json));
+  size_t threads = 0;
+  for (const JsonValue& event : json["sampleInfo"].array) {
+    for (const JsonValue& process : event["processes"].array) {
+      for (const JsonValue& thread : process["threads"].array) {
+        // Each thread is merged from the same thread in both record files.
+        uint64_t event_count = thread["eventCount"].number;
+        ASSERT_EQ(CheckSubtreeEventCount(thread["g"]), event_count);
+        ASSERT_EQ(CheckSubtreeEventCount(thread["rg"]), event_count);
+        threads++;
+      }
+    }
+  }
+  ASSERT_GT(threads, 0u);
+}
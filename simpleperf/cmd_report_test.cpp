@@ -15,8 +15,11 @@
  */
 
 #include <gtest/gtest.h>
+#include <zlib.h>
 
+#include <algorithm>
 #include <set>
+#include <string_view>
 #include <unordered_map>
 
 #include <android-base/file.h>
@@ -29,6 +32,7 @@
 #include "get_test_data.h"
 #include "perf_regs.h"
 #include "read_apk.h"
+#include "report_diff.h"
 #include "test_util.h"
 
 using namespace simpleperf;
@@ -638,6 +642,261 @@ TEST_F(ReportCommandTest, filter_file_option) {
   ASSERT_NE(capture.str().find("doesn't match clock used in time filter"), std::string::npos);
 }
 
+TEST_F(ReportCommandTest, folded_format) {
+  Report(CALLGRAPH_FP_PERF_DATA, {"--format", "folded"});
+  ASSERT_TRUE(success);
+  bool found_leaf_func = false;
+  uint64_t total_period = 0;
+  uint64_t global_func_period = 0;
+  for (const auto& line : lines) {
+    // Each line is "<thread>;<root frame>;...;<sampled frame> <period>".
+    size_t pos = line.rfind(' ');
+    ASSERT_NE(pos, std::string::npos);
+    uint64_t period;
+    ASSERT_TRUE(android::base::ParseUint(line.substr(pos + 1), &period));
+    ASSERT_GT(period, 0u);
+    ASSERT_NE(line.find(';'), std::string::npos);
+    std::vector<std::string> frames = android::base::Split(line.substr(0, pos), ";");
+    ASSERT_GE(frames.size(), 2u);
+    if (frames.back() == "GlobalFunc" || frames.back() == "CalledFunc") {
+      found_leaf_func = true;
+    }
+    if (std::find(frames.begin(), frames.end(), "GlobalFunc") != frames.end()) {
+      global_func_period += period;
+    }
+    total_period += period;
+  }
+  ASSERT_TRUE(found_leaf_func);
+  // Every sample in perf_g_fp.data has GlobalFunc on its callchain.
+  ASSERT_EQ(total_period, 13028002u);
+  ASSERT_EQ(global_func_period, total_period);
+  Report(CALLGRAPH_FP_PERF_DATA, {"--format", "folded", "--folded-tid"});
+  ASSERT_TRUE(success);
+  auto regex = RegEx::Create(R"(^[^;]+-\d+/\d+;)");
+  ASSERT_TRUE(regex->Search(lines[0]));
+}
+
+// A minimal protobuf wire format reader, enough to check the profile written by --format pprof.
+class ProtoReader {
+ public:
+  ProtoReader(std::string_view data) : data_(data) {}
+
+  // Reads the next field. For varint fields, the value is stored in `value`. For length-delimited
+  // fields, the payload is stored in `bytes`.
+  bool ReadField(uint32_t* field, uint64_t* value, std::string_view* bytes) {
+    uint64_t key;
+    if (pos_ >= data_.size() || !ReadVarint(&key)) {
+      return false;
+    }
+    *field = static_cast<uint32_t>(key >> 3);
+    switch (key & 7) {
+      case 0:
+        return ReadVarint(value);
+      case 2: {
+        uint64_t size;
+        if (!ReadVarint(&size) || size > data_.size() - pos_) {
+          return false;
+        }
+        *bytes = data_.substr(pos_, size);
+        pos_ += size;
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+  bool ReadVarint(uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; pos_ < data_.size() && shift < 64; shift += 7) {
+      uint8_t c = static_cast<uint8_t>(data_[pos_++]);
+      *value |= static_cast<uint64_t>(c & 0x7f) << shift;
+      if ((c & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool End() const { return pos_ == data_.size(); }
+
+ private:
+  std::string_view data_;
+  size_t pos_ = 0;
+};
+
+static bool ReadGzipFile(const std::string& filename, std::string* data) {
+  gzFile fp = gzopen(filename.c_str(), "rb");
+  if (fp == nullptr) {
+    return false;
+  }
+  char buf[4096];
+  int n;
+  while ((n = gzread(fp, buf, sizeof(buf))) > 0) {
+    data->append(buf, n);
+  }
+  return gzclose(fp) == Z_OK && n == 0;
+}
+
+TEST_F(ReportCommandTest, pprof_format) {
+  TemporaryFile tmpfile;
+  ASSERT_TRUE(ReportCmd()->Run({"-i", GetTestData(CALLGRAPH_FP_PERF_DATA), "--symfs",
+                                GetTestDataDir(), "--format", "pprof", "-o", tmpfile.path}));
+  std::string data;
+  ASSERT_TRUE(ReadGzipFile(tmpfile.path, &data));
+
+  // Collect the fields needed to symbolize samples.
+  std::vector<std::string> strings;
+  std::vector<std::pair<uint64_t, uint64_t>> sample_types;
+  std::vector<std::vector<uint64_t>> sample_location_ids;
+  std::unordered_map<uint64_t, uint64_t> location_to_function;
+  std::unordered_map<uint64_t, uint64_t> function_to_name;
+  ProtoReader profile(data);
+  uint32_t field;
+  uint64_t value;
+  std::string_view bytes;
+  while (profile.ReadField(&field, &value, &bytes)) {
+    uint32_t sub_field;
+    uint64_t sub_value;
+    std::string_view sub_bytes;
+    ProtoReader message(bytes);
+    if (field == 1) {
+      uint64_t type = 0;
+      uint64_t unit = 0;
+      while (message.ReadField(&sub_field, &sub_value, &sub_bytes)) {
+        (sub_field == 1 ? type : unit) = sub_value;
+      }
+      sample_types.emplace_back(type, unit);
+    } else if (field == 2) {
+      std::vector<uint64_t> location_ids;
+      while (message.ReadField(&sub_field, &sub_value, &sub_bytes)) {
+        if (sub_field == 1) {
+          ProtoReader packed(sub_bytes);
+          while (!packed.End() && packed.ReadVarint(&sub_value)) {
+            location_ids.push_back(sub_value);
+          }
+        }
+      }
+      sample_location_ids.emplace_back(std::move(location_ids));
+    } else if (field == 4) {
+      uint64_t id = 0;
+      while (message.ReadField(&sub_field, &sub_value, &sub_bytes)) {
+        if (sub_field == 1) {
+          id = sub_value;
+        } else if (sub_field == 4) {
+          ProtoReader line(sub_bytes);
+          uint32_t line_field;
+          std::string_view line_bytes;
+          while (line.ReadField(&line_field, &sub_value, &line_bytes)) {
+            if (line_field == 1) {
+              location_to_function[id] = sub_value;
+            }
+          }
+        }
+      }
+    } else if (field == 5) {
+      uint64_t id = 0;
+      while (message.ReadField(&sub_field, &sub_value, &sub_bytes)) {
+        if (sub_field == 1) {
+          id = sub_value;
+        } else if (sub_field == 2) {
+          function_to_name[id] = sub_value;
+        }
+      }
+    } else if (field == 6) {
+      strings.emplace_back(bytes);
+    }
+  }
+  ASSERT_TRUE(profile.End());
+
+  ASSERT_FALSE(strings.empty());
+  ASSERT_EQ(strings[0], "");
+  auto get_string = [&](uint64_t id) { return id < strings.size() ? strings[id] : "<invalid>"; };
+  ASSERT_EQ(sample_types.size(), 2u);
+  ASSERT_EQ(get_string(sample_types[0].first), "cpu-cycles_samples");
+  ASSERT_EQ(get_string(sample_types[0].second), "samples");
+  ASSERT_EQ(get_string(sample_types[1].first), "cpu-cycles");
+  ASSERT_EQ(get_string(sample_types[1].second), "cpu-cycles");
+
+  ASSERT_FALSE(sample_location_ids.empty());
+  bool found_global_func = false;
+  for (const auto& location_ids : sample_location_ids) {
+    ASSERT_FALSE(location_ids.empty());
+    for (uint64_t location_id : location_ids) {
+      auto it = location_to_function.find(location_id);
+      if (it != location_to_function.end() &&
+          get_string(function_to_name[it->second]) == "GlobalFunc") {
+        found_global_func = true;
+      }
+    }
+  }
+  ASSERT_TRUE(found_global_func);
+
+  ASSERT_FALSE(ReportCmd()->Run({"-i", GetTestData(CALLGRAPH_FP_PERF_DATA), "--format", "xml"}));
+}
+
+TEST_F(ReportCommandTest, diff_option) {
+  auto row_regex = RegEx::Create(R"(^\d+\.\d+%\s+\d+\.\d+%\s+[+-]\d+\.\d+%\s+[+-]\d+\.\d+\s)");
+  auto zero_row_regex = RegEx::Create(R"(^\d+\.\d+%\s+\d+\.\d+%\s+\+0\.00%\s+\+0\.00\s)");
+  auto count_rows = [&](RegEx* regex) {
+    return std::count_if(lines.begin(), lines.end(),
+                         [&](const std::string& line) { return regex->Search(line); });
+  };
+
+  // Comparing a file with itself shows no difference.
+  Report(CALLGRAPH_FP_PERF_DATA, {"--diff", GetTestData(CALLGRAPH_FP_PERF_DATA)});
+  ASSERT_TRUE(success);
+  ASSERT_NE(content.find("Base: " + GetTestData(CALLGRAPH_FP_PERF_DATA)), std::string::npos);
+  ASSERT_NE(content.find("Delta"), std::string::npos);
+  ASSERT_GT(count_rows(row_regex.get()), 0);
+  ASSERT_EQ(count_rows(row_regex.get()), count_rows(zero_row_regex.get()));
+
+  // Compare files recorded for different programs.
+  Report(PERF_DATA, {"--diff", GetTestData(PERF_DATA_WITH_SYMBOLS), "--sort", "dso,symbol", "-n"});
+  ASSERT_TRUE(success);
+  ASSERT_NE(content.find("BaseSample"), std::string::npos);
+  ASSERT_GT(count_rows(row_regex.get()), count_rows(zero_row_regex.get()));
+
+  // Two recordings of the same program have different pids, but entries still match with the
+  // default sort keys.
+  Report("perf_merge1.data", {"--diff", GetTestData("perf_merge2.data")});
+  ASSERT_TRUE(success);
+  bool found_matched_entry = false;
+  for (const std::string& line : lines) {
+    double base_percent;
+    double new_percent;
+    if (line.find("sha256_block_armv8") != std::string::npos &&
+        sscanf(line.c_str(), "%lf%%%lf%%", &base_percent, &new_percent) == 2) {
+      found_matched_entry = base_percent > 0 && new_percent > 0;
+      break;
+    }
+  }
+  ASSERT_TRUE(found_matched_entry);
+
+  // Show callgraph diff.
+  Report(CALLGRAPH_FP_PERF_DATA, {"--diff", GetTestData(CALLGRAPH_FP_PERF_DATA), "-g"});
+  ASSERT_TRUE(success);
+  ASSERT_NE(content.find("BaseChildren"), std::string::npos);
+  ASSERT_NE(content.find("callees:"), std::string::npos);
+  Report(CALLGRAPH_FP_PERF_DATA, {"--diff", GetTestData(CALLGRAPH_FP_PERF_DATA), "-g", "callee"});
+  ASSERT_TRUE(success);
+  ASSERT_NE(content.find("callers:"), std::string::npos);
+
+  // Frames not in JIT caches are matched and reported by the paths of their dsos.
+  Report(CALLGRAPH_FP_PERF_DATA,
+         {"--diff", GetTestData(CALLGRAPH_FP_PERF_DATA), "-g", "--sort", "dso"});
+  ASSERT_TRUE(success);
+  ASSERT_NE(content.find("/elf"), std::string::npos);
+  ASSERT_EQ(count_rows(row_regex.get()), count_rows(zero_row_regex.get()));
+
+  ASSERT_FALSE(ReportCmd()->Run({"-i", GetTestData(PERF_DATA), "--diff", GetTestData(PERF_DATA),
+                                 "--sort", "vaddr_in_file"}));
+
+  ASSERT_EQ(ReportDiffer::ZScore(10, 100, 10, 100), 0.0);
+  ASSERT_GT(ReportDiffer::ZScore(10, 100, 30, 100), 2.0);
+  ASSERT_LT(ReportDiffer::ZScore(30, 100, 10, 100), -2.0);
+}
+
 #if defined(__linux__)
 #include "event_selection_set.h"
 
@@ -0,0 +1,689 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <android-base/logging.h>
+#include <android-base/parseint.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+
+#include "command.h"
+#include "dso.h"
+#include "event_attr.h"
+#include "perf_regs.h"
+#include "record.h"
+#include "record_file.h"
+#include "utils.h"
+
+namespace simpleperf {
+namespace {
+
+// Synthetic libraries are mapped from kLibMapStart, and JIT maps from kJitMapStart. Both are below
+// 4G, so they don't overlap maps of 64-bit processes copied by --dwarf-stacks-from.
+constexpr uint64_t kLibMapStart = 0x10000000;
+constexpr uint64_t kJitMapStart = 0xc0000000;
+constexpr uint64_t kJitMapSlotSize = 0x10000;
+constexpr size_t kJitMapSlots = 64;
+constexpr uint64_t kSymbolSize = 0x100;
+constexpr uint64_t kPageSize = 0x1000;
+constexpr const char* kJitMapName = "/memfd:jit-cache (deleted)";
+
+constexpr uint64_t kSamplePeriod = 1000000;
+constexpr uint64_t kTimeStepInNs = 10000;
+constexpr uint32_t kCpuCount = 8;
+constexpr size_t kMaxCallChainDepth = 512;
+// Child functions called by each function, which makes callchains share callers.
+constexpr uint64_t kCallFanout = 4;
+constexpr size_t kMaxDwarfSamples = 1000;
+
+constexpr uint64_t kCpuClockEventId = 1;
+constexpr uint64_t kTracepointEventId = 2;
+constexpr uint64_t kTracepointConfig = 1;
+constexpr const char* kTracepointName = "synthetic:event";
+
+class CallChainDepthDistribution {
+ public:
+  // spec is fixed:N, uniform:MIN:MAX or geometric:MEAN.
+  bool Parse(const std::string& spec) {
+    std::vector<std::string> strs = android::base::Split(spec, ":");
+    bool result = false;
+    if (strs[0] == "fixed" && strs.size() == 2) {
+      type_ = FIXED;
+      result = android::base::ParseUint(strs[1], &min_, kMaxCallChainDepth) && min_ > 0;
+      max_ = min_;
+    } else if (strs[0] == "uniform" && strs.size() == 3) {
+      type_ = UNIFORM;
+      result = android::base::ParseUint(strs[1], &min_, kMaxCallChainDepth) &&
+               android::base::ParseUint(strs[2], &max_, kMaxCallChainDepth) && min_ > 0 &&
+               min_ <= max_;
+    } else if (strs[0] == "geometric" && strs.size() == 2) {
+      type_ = GEOMETRIC;
+      min_ = 1;
+      max_ = kMaxCallChainDepth;
+      result = android::base::ParseUint(strs[1], &mean_, kMaxCallChainDepth) && mean_ > 0;
+    }
+    if (!result) {
+      LOG(ERROR) << "invalid callchain depth: " << spec;
+    }
+    return result;
+  }
+
+  size_t Generate(std::mt19937_64& rng) const {
+    if (type_ == UNIFORM) {
+      return min_ + rng() % (max_ - min_ + 1);
+    }
+    if (type_ == GEOMETRIC) {
+      // Only use integer operations, so the result doesn't depend on the C++ library.
+      size_t depth = 1;
+      while (depth < max_ && rng() % mean_ != 0) {
+        depth++;
+      }
+      return depth;
+    }
+    return min_;
+  }
+
+ private:
+  enum { FIXED, UNIFORM, GEOMETRIC } type_ = UNIFORM;
+  size_t min_ = 1;
+  size_t max_ = 32;
+  size_t mean_ = 1;
+};
+
+// Maps and samples taken from a recording made with `--call-graph dwarf --no-unwind`.
+struct DwarfStackSource {
+  perf_event_attr attr;
+  std::string arch;
+  std::unordered_map<std::string, std::string> meta_info;
+  std::vector<std::unique_ptr<Record>> maps;
+  std::vector<std::unique_ptr<SampleRecord>> samples;
+  std::vector<BuildIdRecord> build_ids;
+  std::vector<std::unique_ptr<FileFeature>> files;
+};
+
+struct SyntheticProcess {
+  uint32_t pid;
+  std::vector<uint32_t> tids;
+  // Live JIT maps, indexed by slot.
+  std::vector<std::pair<uint64_t, uint64_t>> jit_maps;
+  size_t next_jit_slot = 0;
+};
+
+static uint64_t Mix(uint64_t value) {
+  // splitmix64 finalizer.
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+class SynthesizeCommand : public Command {
+ public:
+  SynthesizeCommand()
+      : Command("synthesize", "generate a synthetic recording file for benchmarking",
+                // clang-format off
+"Usage: simpleperf synthesize [options]\n"
+"       Generate a deterministic recording file, which looks like one recorded by\n"
+"       `simpleperf record -e cpu-clock:u -g`. It is used to benchmark reading, reporting\n"
+"       and unwinding at scale. Processes map synthetic libraries, whose symbols are stored\n"
+"       in the file feature section.\n"
+"-o <file>                  Output file. Default is perf.data.\n"
+"--seed <n>                 Seed of the random generator. Default is 0.\n"
+"--samples <n>              Generate n samples. Default is 100000.\n"
+"--processes <n>            Generate n processes. Default is 1.\n"
+"--threads-per-process <n>  Generate n threads in each process. Default is 1.\n"
+"--maps-per-process <n>     Map n synthetic libraries in each process. Default is 16.\n"
+"--files <n>                Generate n synthetic libraries, shared by processes. Default is 64.\n"
+"--symbols-per-file <n>     Generate n symbols in each synthetic library. Default is 1000.\n"
+"--callchain-depth <spec>   Distribution of callchain depth, which is one of below:\n"
+"                             fixed:N            All callchains have N frames.\n"
+"                             uniform:MIN:MAX    Depth is uniformly distributed in [MIN, MAX].\n"
+"                             geometric:MEAN     Depth is geometric distributed with MEAN.\n"
+"                           Default is uniform:1:32.\n"
+"--map-churn <n>            Map a JIT code cache region in a random process every n samples.\n"
+"                           Leaf frames of samples can be in JIT maps. Default is 0, meaning\n"
+"                           no JIT maps.\n"
+"--tracepoint-percent <n>   Make n percent of samples come from a tracepoint event, with raw\n"
+"                           data. Default is 0.\n"
+"--dwarf-stacks-from <file> Copy maps, register values and stack data of samples in a\n"
+"                           recording made with `--call-graph dwarf --no-unwind` to each\n"
+"                           process. Then the output file looks like being recorded with\n"
+"                           `--call-graph dwarf --no-unwind`, and can be used by debug-unwind.\n"
+"--dwarf-percent <n>        Make n percent of samples use copied DWARF stacks. Default is 10.\n"
+"\n"
+"Examples:\n"
+"$ simpleperf synthesize -o perf.data --samples 100000000 --processes 100 \\\n"
+"    --threads-per-process 100 --maps-per-process 1000 --callchain-depth geometric:24\n"
+                // clang-format on
+                ),
+        rng_(0) {}
+
+  bool Run(const std::vector<std::string>& args) override;
+
+ private:
+  bool ParseOptions(const std::vector<std::string>& args);
+  bool ReadDwarfStackSource();
+  EventAttrIds CreateEventAttrs();
+  bool WriteProcesses();
+  bool WriteSamples();
+  bool WriteJitMap();
+  bool WriteSample(const perf_event_attr& attr, const SyntheticProcess& process, uint32_t tid);
+  bool WriteDwarfSample(const SyntheticProcess& process, uint32_t tid);
+  bool WriteSampleData(const perf_event_attr& attr, uint64_t id, uint64_t ip, uint32_t pid,
+                       uint32_t tid, const std::vector<uint64_t>& ips, const char* raw,
+                       uint32_t raw_size, const PerfSampleRegsUserType* regs,
+                       const PerfSampleStackUserType* stack);
+  void GenerateCallChain(const SyntheticProcess& process, std::vector<uint64_t>* ips);
+  bool WriteFeatures(const std::vector<std::string>& args);
+  bool WriteFileFeatures();
+
+  uint64_t Uniform(uint64_t n) { return rng_() % n; }
+  uint64_t NextTime() { return time_ += kTimeStepInNs; }
+  uint64_t LibMapSize() const {
+    return Align(kPageSize + symbols_per_file_ * kSymbolSize, kPageSize);
+  }
+
+  std::string output_filename_ = "perf.data";
+  uint64_t seed_ = 0;
+  uint64_t sample_count_ = 100000;
+  uint32_t process_count_ = 1;
+  uint32_t threads_per_process_ = 1;
+  uint32_t maps_per_process_ = 16;
+  uint32_t file_count_ = 64;
+  uint32_t symbols_per_file_ = 1000;
+  CallChainDepthDistribution callchain_depth_;
+  uint64_t map_churn_ = 0;
+  uint32_t tracepoint_percent_ = 0;
+  std::string dwarf_stack_file_;
+  uint32_t dwarf_percent_ = 10;
+
+  std::mt19937_64 rng_;
+  uint64_t time_ = 1000000000;
+  EventAttrIds attrs_;
+  std::unique_ptr<DwarfStackSource> dwarf_source_;
+  std::vector<SyntheticProcess> processes_;
+  std::unique_ptr<RecordFileWriter> writer_;
+  std::vector<char> sample_buf_;
+};
+
+bool SynthesizeCommand::Run(const std::vector<std::string>& args) {
+  // 1. Parse options.
+  if (!ParseOptions(args)) {
+    return false;
+  }
+  rng_.seed(seed_);
+  if (!dwarf_stack_file_.empty() && !ReadDwarfStackSource()) {
+    return false;
+  }
+
+  // 2. Write attr section and data section.
+  writer_ = RecordFileWriter::CreateInstance(output_filename_);
+  if (!writer_) {
+    return false;
+  }
+  attrs_ = CreateEventAttrs();
+  if (!writer_->WriteAttrSection(attrs_) || !WriteProcesses() || !WriteSamples()) {
+    return false;
+  }
+
+  // 3. Write feature section.
+  if (!WriteFeatures(args)) {
+    return false;
+  }
+  return writer_->Close();
+}
+
+bool SynthesizeCommand::ParseOptions(const std::vector<std::string>& args) {
+  const OptionFormatMap option_formats = {
+      {"--callchain-depth", {OptionValueType::STRING, OptionType::SINGLE}},
+      {"--dwarf-percent", {OptionValueType::UINT, OptionType::SINGLE}},
+      {"--dwarf-stacks-from", {OptionValueType::STRING, OptionType::SINGLE}},
+      {"--files", {OptionValueType::UINT, OptionType::SINGLE}},
+      {"--map-churn", {OptionValueType::UINT, OptionType::SINGLE}},
+      {"--maps-per-process", {OptionValueType::UINT, OptionType::SINGLE}},
+      {"-o", {OptionValueType::STRING, OptionType::SINGLE}},
+      {"--processes", {OptionValueType::UINT, OptionType::SINGLE}},
+      {"--samples", {OptionValueType::UINT, OptionType::SINGLE}},
+      {"--seed", {OptionValueType::UINT, OptionType::SINGLE}},
+      {"--symbols-per-file", {OptionValueType::UINT, OptionType::SINGLE}},
+      {"--threads-per-process", {OptionValueType::UINT, OptionType::SINGLE}},
+      {"--tracepoint-percent", {OptionValueType::UINT, OptionType::SINGLE}},
+  };
+  OptionValueMap options;
+  std::vector<std::pair<OptionName, OptionValue>> ordered_options;
+  if (!PreprocessOptions(args, option_formats, &options, &ordered_options)) {
+    return false;
+  }
+  if (auto value = options.PullValue("--callchain-depth"); value) {
+    if (!callchain_depth_.Parse(*value->str_value)) {
+      return false;
+    }
+  }
+  options.PullStringValue("--dwarf-stacks-from", &dwarf_stack_file_);
+  options.PullStringValue("-o", &output_filename_);
+  // Pids and tids are allocated from 10000, and should fit in int32_t.
+  if (!options.PullUintValue("--dwarf-percent", &dwarf_percent_, 0, 100) ||
+      !options.PullUintValue("--files", &file_count_, 1, 1000000) ||
+      !options.PullUintValue("--map-churn", &map_churn_) ||
+      !options.PullUintValue("--maps-per-process", &maps_per_process_, 1, 1000000) ||
+      !options.PullUintValue("--processes", &process_count_, 1, 1000000) ||
+      !options.PullUintValue("--samples", &sample_count_) ||
+      !options.PullUintValue("--seed", &seed_) ||
+      !options.PullUintValue("--symbols-per-file", &symbols_per_file_, 1, 1000000) ||
+      !options.PullUintValue("--threads-per-process", &threads_per_process_, 1, 1000000) ||
+      !options.PullUintValue("--tracepoint-percent", &tracepoint_percent_, 0, 100)) {
+    return false;
+  }
+  CHECK(options.values.empty());
+  if (static_cast<uint64_t>(process_count_) * threads_per_process_ > 100000000) {
+    LOG(ERROR) << "too many threads";
+    return false;
+  }
+  if (kLibMapStart + static_cast<uint64_t>(maps_per_process_) * LibMapSize() > kJitMapStart) {
+    LOG(ERROR) << "synthetic libraries don't fit in the address space, try fewer "
+               << "--maps-per-process or --symbols-per-file";
+    return false;
+  }
+  return true;
+}
+
+bool SynthesizeCommand::ReadDwarfStackSource() {
+  std::unique_ptr<RecordFileReader> reader = RecordFileReader::CreateInstance(dwarf_stack_file_);
+  if (!reader) {
+    return false;
+  }
+  auto source = std::make_unique<DwarfStackSource>();
+  source->attr = reader->AttrSection()[0].attr;
+  uint64_t required_sample_type = PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER;
+  if ((source->attr.sample_type & required_sample_type) != required_sample_type) {
+    LOG(ERROR) << dwarf_stack_file_ << " isn't recorded with --call-graph dwarf";
+    return false;
+  }
+  source->arch = reader->ReadFeatureString(PerfFileFormat::FEAT_ARCH);
+  source->meta_info = reader->GetMetaInfoFeature();
+  auto callback = [&](std::unique_ptr<Record> r) {
+    if (r->type() == PERF_RECORD_MMAP || r->type() == PERF_RECORD_MMAP2) {
+      if (!r->InKernel()) {
+        source->maps.emplace_back(std::move(r));
+      }
+    } else if (r->type() == PERF_RECORD_SAMPLE) {
+      auto sr = static_cast<SampleRecord*>(r.get());
+      if (source->samples.size() < kMaxDwarfSamples && sr->stack_user_data.size > 0 &&
+          sr->regs_user_data.abi != 0) {
+        r.release();
+        source->samples.emplace_back(sr);
+      }
+    }
+    return true;
+  };
+  if (!reader->ReadDataSection(callback)) {
+    return false;
+  }
+  if (source->samples.empty()) {
+    LOG(ERROR) << "no samples with stack data in " << dwarf_stack_file_;
+    return false;
+  }
+  source->build_ids = reader->ReadBuildIdFeature();
+  uint64_t read_pos = 0;
+  bool error = false;
+  while (true) {
+    auto file = std::make_unique<FileFeature>();
+    if (!reader->ReadFileFeature(read_pos, *file, error)) {
+      break;
+    }
+    for (const Symbol& symbol : file->symbols) {
+      file->symbol_ptrs.emplace_back(&symbol);
+    }
+    source->files.emplace_back(std::move(file));
+  }
+  if (error) {
+    return false;
+  }
+  dwarf_source_ = std::move(source);
+  return true;
+}
+
+EventAttrIds SynthesizeCommand::CreateEventAttrs() {
+  EventAttrIds attrs;
+  perf_event_attr attr = {};
+  attr.size = sizeof(perf_event_attr);
+  attr.type = PERF_TYPE_SOFTWARE;
+  attr.config = PERF_COUNT_SW_CPU_CLOCK;
+  attr.sample_period = kSamplePeriod;
+  attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_TIME | PERF_SAMPLE_ID |
+                     PERF_SAMPLE_CPU | PERF_SAMPLE_PERIOD | PERF_SAMPLE_CALLCHAIN;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING | PERF_FORMAT_ID;
+  attr.exclude_kernel = 1;
+  attr.mmap = 1;
+  attr.mmap2 = 1;
+  attr.comm = 1;
+  attr.task = 1;
+  attr.sample_id_all = 1;
+  if (dwarf_source_) {
+    // Samples not using DWARF stacks have empty regs and stack data.
+    attr.sample_type |= PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER;
+    attr.sample_regs_user = dwarf_source_->attr.sample_regs_user;
+    attr.sample_stack_user = dwarf_source_->attr.sample_stack_user;
+    attr.exclude_callchain_user = 1;
+  }
+  attrs.emplace_back(EventAttrWithId{attr, {kCpuClockEventId}});
+
+  if (tracepoint_percent_ > 0) {
+    attr.type = PERF_TYPE_TRACEPOINT;
+    attr.config = kTracepointConfig;
+    attr.sample_period = 1;
+    attr.sample_type &= ~(PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER);
+    attr.sample_type |= PERF_SAMPLE_RAW;
+    attr.sample_regs_user = 0;
+    attr.sample_stack_user = 0;
+    attr.exclude_callchain_user = 0;
+    attr.mmap = attr.mmap2 = attr.comm = attr.task = 0;
+    attrs.emplace_back(EventAttrWithId{attr, {kTracepointEventId}});
+  }
+  return attrs;
+}
+
+bool SynthesizeCommand::WriteProcesses() {
+  const perf_event_attr& attr = attrs_[0].attr;
+  uint32_t next_tid = 10000;
+  processes_.resize(process_count_);
+  for (uint32_t i = 0; i < process_count_; i++) {
+    SyntheticProcess& process = processes_[i];
+    process.pid = next_tid++;
+    process.tids.push_back(process.pid);
+    std::string comm = "process" + std::to_string(i);
+    if (!writer_->WriteRecord(
+            CommRecord(attr, process.pid, process.pid, comm, kCpuClockEventId, NextTime()))) {
+      return false;
+    }
+    for (uint32_t j = 1; j < threads_per_process_; j++) {
+      uint32_t tid = next_tid++;
+      process.tids.push_back(tid);
+      if (!writer_->WriteRecord(ForkRecord(attr, process.pid, tid, process.pid, process.pid,
+                                           kCpuClockEventId)) ||
+          !writer_->WriteRecord(CommRecord(attr, process.pid, tid, "thread" + std::to_string(j),
+                                           kCpuClockEventId, NextTime()))) {
+        return false;
+      }
+    }
+    for (uint32_t j = 0; j < maps_per_process_; j++) {
+      // Processes map different but overlapping sets of libraries.
+      uint32_t file_id = (i + j) % file_count_;
+      std::string filename = android::base::StringPrintf("/synthetic/lib%u.so", file_id);
+      if (!writer_->WriteRecord(Mmap2Record(attr, false, process.pid, process.pid,
+                                            kLibMapStart + j * LibMapSize(), LibMapSize(), 0,
+                                            PROT_READ | PROT_EXEC, filename, kCpuClockEventId,
+                                            NextTime()))) {
+        return false;
+      }
+    }
+    if (dwarf_source_) {
+      for (const auto& r : dwarf_source_->maps) {
+        bool result;
+        if (r->type() == PERF_RECORD_MMAP) {
+          auto& map = *static_cast<const MmapRecord*>(r.get());
+          result = writer_->WriteRecord(MmapRecord(attr, false, process.pid, process.pid,
+                                                   map.data->addr, map.data->len, map.data->pgoff,
+                                                   map.filename, kCpuClockEventId, NextTime()));
+        } else {
+          auto& map = *static_cast<const Mmap2Record*>(r.get());
+          result = writer_->WriteRecord(Mmap2Record(
+              attr, false, process.pid, process.pid, map.data->addr, map.data->len,
+              map.data->pgoff, map.data->prot, map.filename, kCpuClockEventId, NextTime()));
+        }
+        if (!result) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool SynthesizeCommand::WriteSamples() {
+  for (uint64_t i = 0; i < sample_count_; i++) {
+    if (map_churn_ != 0 && i % map_churn_ == 0 && !WriteJitMap()) {
+      return false;
+    }
+    const SyntheticProcess& process = processes_[Uniform(processes_.size())];
+    uint32_t tid = process.tids[Uniform(process.tids.size())];
+    uint64_t percent = Uniform(100);
+    bool result;
+    if (percent < tracepoint_percent_) {
+      result = WriteSample(attrs_[1].attr, process, tid);
+    } else if (dwarf_source_ && percent < tracepoint_percent_ + dwarf_percent_) {
+      result = WriteDwarfSample(process, tid);
+    } else {
+      result = WriteSample(attrs_[0].attr, process, tid);
+    }
+    if (!result) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SynthesizeCommand::WriteJitMap() {
+  SyntheticProcess& process = processes_[Uniform(processes_.size())];
+  // Reuse slots in a round-robin way. A new map replaces the old one in the same slot, like
+  // JIT code cache regions being released and mapped again.
+  size_t slot = process.next_jit_slot++ % kJitMapSlots;
+  uint64_t addr = kJitMapStart + slot * kJitMapSlotSize;
+  uint64_t len = kPageSize * (1 + Uniform(kJitMapSlotSize / kPageSize));
+  if (process.jit_maps.size() <= slot) {
+    process.jit_maps.resize(slot + 1);
+  }
+  process.jit_maps[slot] = std::make_pair(addr, len);
+  return writer_->WriteRecord(Mmap2Record(attrs_[0].attr, false, process.pid, process.pid, addr,
+                                          len, 0, PROT_READ | PROT_EXEC, kJitMapName,
+                                          kCpuClockEventId, NextTime()));
+}
+
+void SynthesizeCommand::GenerateCallChain(const SyntheticProcess& process,
+                                          std::vector<uint64_t>* ips) {
+  size_t depth = callchain_depth_.Generate(rng_);
+  ips->resize(depth + 1);
+  (*ips)[0] = PERF_CONTEXT_USER;
+  // Walk a call tree from the outermost caller. Each function calls kCallFanout functions, so
+  // callchains share callers like in real programs.
+  uint64_t function = Uniform(kCallFanout);
+  uint64_t lib_map_size = LibMapSize();
+  for (size_t i = depth; i > 0; i--) {
+    uint64_t value = Mix(function ^ seed_);
+    uint64_t map_id = value % maps_per_process_;
+    uint64_t symbol_id = (value >> 20) % symbols_per_file_;
+    uint64_t offset = ((value >> 40) % (kSymbolSize / 4)) * 4;
+    (*ips)[i] = kLibMapStart + map_id * lib_map_size + kPageSize + symbol_id * kSymbolSize + offset;
+    function = function * kCallFanout + 1 + Uniform(kCallFanout);
+  }
+  if (!process.jit_maps.empty() && Uniform(4) == 0) {
+    // Put the leaf frame in a JIT map.
+    const auto& [addr, len] = process.jit_maps[Uniform(process.jit_maps.size())];
+    (*ips)[1] = addr + Uniform(len / 4) * 4;
+  }
+}
+
+bool SynthesizeCommand::WriteSample(const perf_event_attr& attr, const SyntheticProcess& process,
+                                    uint32_t tid) {
+  std::vector<uint64_t> ips;
+  GenerateCallChain(process, &ips);
+  if (attr.type != PERF_TYPE_TRACEPOINT) {
+    return WriteSampleData(attr, kCpuClockEventId, ips[1], process.pid, tid, ips, nullptr, 0,
+                           nullptr, nullptr);
+  }
+  // Raw data of a tracepoint starts with common fields: common_type (u16), common_flags (u8),
+  // common_preempt_count (u8) and common_pid (i32). Its size + 4 should be aligned to 8.
+  char raw[20] = {};
+  char* p = raw;
+  MoveToBinaryFormat(static_cast<uint16_t>(kTracepointConfig), p);
+  p += 2;
+  MoveToBinaryFormat(tid, p);
+  MoveToBinaryFormat(rng_(), p);
+  return WriteSampleData(attr, kTracepointEventId, ips[1], process.pid, tid, ips, raw,
+                         sizeof(raw), nullptr, nullptr);
+}
+
+bool SynthesizeCommand::WriteDwarfSample(const SyntheticProcess& process, uint32_t tid) {
+  const SampleRecord& r = *dwarf_source_->samples[Uniform(dwarf_source_->samples.size())];
+  std::vector<uint64_t> ips(r.callchain_data.ips, r.callchain_data.ips + r.callchain_data.ip_nr);
+  return WriteSampleData(attrs_[0].attr, kCpuClockEventId, r.ip_data.ip, process.pid, tid, ips,
+                         nullptr, 0, &r.regs_user_data, &r.stack_user_data);
+}
+
+// Samples are encoded directly instead of using the SampleRecord constructor, which doesn't
+// support raw data, regs and stack data. It also avoids an allocation per sample.
+bool SynthesizeCommand::WriteSampleData(const perf_event_attr& attr, uint64_t id, uint64_t ip,
+                                        uint32_t pid, uint32_t tid,
+                                        const std::vector<uint64_t>& ips, const char* raw,
+                                        uint32_t raw_size, const PerfSampleRegsUserType* regs,
+                                        const PerfSampleStackUserType* stack) {
+  uint64_t sample_type = attr.sample_type;
+  // ip, pid/tid, time, id, cpu, period and callchain.
+  size_t size =
+      sizeof(perf_event_header) + sizeof(uint64_t) * 6 + sizeof(uint64_t) * (ips.size() + 1);
+  if (sample_type & PERF_SAMPLE_RAW) {
+    size += sizeof(uint32_t) + raw_size;
+  }
+  if (sample_type & PERF_SAMPLE_REGS_USER) {
+    size += sizeof(uint64_t) + (regs != nullptr ? regs->reg_nr * sizeof(uint64_t) : 0);
+  }
+  if (sample_type & PERF_SAMPLE_STACK_USER) {
+    size += sizeof(uint64_t) + (stack != nullptr ? stack->size + sizeof(uint64_t) : 0);
+  }
+  if (size > UINT16_MAX) {
+    LOG(ERROR) << "sample size " << size << " is too big";
+    return false;
+  }
+  sample_buf_.resize(size);
+  char* p = sample_buf_.data();
+  perf_event_header header;
+  header.type = PERF_RECORD_SAMPLE;
+  header.misc = PERF_RECORD_MISC_USER;
+  header.size = static_cast<uint16_t>(size);
+  MoveToBinaryFormat(header, p);
+  MoveToBinaryFormat(ip, p);
+  MoveToBinaryFormat(pid, p);
+  MoveToBinaryFormat(tid, p);
+  MoveToBinaryFormat(NextTime(), p);
+  MoveToBinaryFormat(id, p);
+  MoveToBinaryFormat(static_cast<uint32_t>(tid % kCpuCount), p);
+  MoveToBinaryFormat(static_cast<uint32_t>(0), p);
+  MoveToBinaryFormat(static_cast<uint64_t>(attr.sample_period), p);
+  MoveToBinaryFormat(static_cast<uint64_t>(ips.size()), p);
+  MoveToBinaryFormat(ips.data(), ips.size(), p);
+  if (sample_type & PERF_SAMPLE_RAW) {
+    MoveToBinaryFormat(raw_size, p);
+    MoveToBinaryFormat(raw, raw_size, p);
+  }
+  if (sample_type & PERF_SAMPLE_REGS_USER) {
+    if (regs != nullptr) {
+      MoveToBinaryFormat(regs->abi, p);
+      MoveToBinaryFormat(regs->regs, regs->reg_nr, p);
+    } else {
+      MoveToBinaryFormat(static_cast<uint64_t>(0), p);
+    }
+  }
+  if (sample_type & PERF_SAMPLE_STACK_USER) {
+    if (stack != nullptr) {
+      MoveToBinaryFormat(stack->size, p);
+      MoveToBinaryFormat(stack->data, stack->size, p);
+      MoveToBinaryFormat(stack->dyn_size, p);
+    } else {
+      MoveToBinaryFormat(static_cast<uint64_t>(0), p);
+    }
+  }
+  CHECK_EQ(p, sample_buf_.data() + size);
+  return writer_->WriteData(sample_buf_.data(), size);
+}
+
+bool SynthesizeCommand::WriteFeatures(const std::vector<std::string>& args) {
+  std::string arch = GetArchString(GetTargetArch());
+  std::unordered_map<std::string, std::string> meta_info;
+  std::vector<std::string> cmdline = {"simpleperf", "record", "-e", "cpu-clock:u", "-g"};
+  if (dwarf_source_) {
+    // Unwinding DWARF stacks needs the arch and meta info (like arm64 pac mask) of the source.
+    arch = dwarf_source_->arch;
+    meta_info = dwarf_source_->meta_info;
+    cmdline = {"simpleperf",   "record", "-e",    "cpu-clock:u",
+               "--call-graph", "dwarf",  "--no-unwind"};
+  }
+  std::string event_type_info =
+      android::base::StringPrintf("cpu-clock,%u,%u", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK);
+  if (tracepoint_percent_ > 0) {
+    event_type_info += android::base::StringPrintf("\n%s,%u,%" PRIu64, kTracepointName,
+                                                   PERF_TYPE_TRACEPOINT, kTracepointConfig);
+  }
+  meta_info["event_type_info"] = event_type_info;
+  meta_info["synthesize_cmdline"] = android::base::Join(args, " ");
+
+  size_t feature_count = dwarf_source_ ? 5 : 4;
+  if (!writer_->BeginWriteFeatures(feature_count) ||
+      !writer_->WriteFeatureString(PerfFileFormat::FEAT_ARCH, arch) ||
+      !writer_->WriteCmdlineFeature(cmdline) || !writer_->WriteMetaInfoFeature(meta_info) ||
+      !WriteFileFeatures()) {
+    return false;
+  }
+  if (dwarf_source_ && !writer_->WriteBuildIdFeature(dwarf_source_->build_ids)) {
+    return false;
+  }
+  return writer_->EndWriteFeatures();
+}
+
+bool SynthesizeCommand::WriteFileFeatures() {
+  for (uint32_t i = 0; i < file_count_; i++) {
+    FileFeature file;
+    file.path = android::base::StringPrintf("/synthetic/lib%u.so", i);
+    file.type = DSO_ELF_FILE;
+    file.min_vaddr = 0;
+    file.file_offset_of_min_vaddr = 0;
+    for (uint32_t j = 0; j < symbols_per_file_; j++) {
+      file.symbols.emplace_back(android::base::StringPrintf("lib%u_function%u", i, j),
+                                kPageSize + j * kSymbolSize, kSymbolSize);
+    }
+    for (const Symbol& symbol : file.symbols) {
+      file.symbol_ptrs.emplace_back(&symbol);
+    }
+    if (!writer_->WriteFileFeature(file)) {
+      return false;
+    }
+  }
+  if (dwarf_source_) {
+    for (const auto& file : dwarf_source_->files) {
+      if (!writer_->WriteFileFeature(*file)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void RegisterSynthesizeCommand() {
+  RegisterCommand("synthesize",
+                  [] { return std::unique_ptr<Command>(new SynthesizeCommand()); });
+}
+
+}  // namespace simpleperf
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include <android-base/file.h>
+
+#include "command.h"
+#include "get_test_data.h"
+#include "record.h"
+#include "record_file.h"
+#include "test_util.h"
+
+using namespace simpleperf;
+
+static std::unique_ptr<Command> SynthesizeCmd() {
+  return CreateCommandInstance("synthesize");
+}
+
+struct RecordCounts {
+  size_t samples = 0;
+  size_t tracepoint_samples = 0;
+  size_t samples_with_stack = 0;
+  size_t mmaps = 0;
+  std::set<uint32_t> tids;
+};
+
+static bool ReadRecordCounts(const std::string& path, RecordCounts* counts) {
+  std::unique_ptr<RecordFileReader> reader = RecordFileReader::CreateInstance(path);
+  if (!reader) {
+    return false;
+  }
+  return reader->ReadDataSection([&](std::unique_ptr<Record> r) {
+    if (r->type() == PERF_RECORD_SAMPLE) {
+      auto& sr = *static_cast<SampleRecord*>(r.get());
+      counts->samples++;
+      counts->tids.insert(sr.tid_data.tid);
+      if (sr.sample_type & PERF_SAMPLE_RAW) {
+        counts->tracepoint_samples++;
+      }
+      if ((sr.sample_type & PERF_SAMPLE_STACK_USER) && sr.stack_user_data.size > 0) {
+        counts->samples_with_stack++;
+      }
+    } else if (r->type() == PERF_RECORD_MMAP || r->type() == PERF_RECORD_MMAP2) {
+      counts->mmaps++;
+    }
+    return true;
+  });
+}
+
+TEST(synthesize_cmd, smoke) {
+  TemporaryFile tmpfile;
+  close(tmpfile.release());
+  ASSERT_TRUE(SynthesizeCmd()->Run({"-o", tmpfile.path, "--samples", "1000", "--processes", "2",
+                                    "--threads-per-process", "3", "--maps-per-process", "4",
+                                    "--map-churn", "100", "--tracepoint-percent", "20"}));
+  RecordCounts counts;
+  ASSERT_TRUE(ReadRecordCounts(tmpfile.path, &counts));
+  ASSERT_EQ(counts.samples, 1000u);
+  ASSERT_GT(counts.tracepoint_samples, 0u);
+  ASSERT_LT(counts.tracepoint_samples, 1000u);
+  ASSERT_EQ(counts.tids.size(), 6u);
+  // 4 library maps per process, and 10 JIT maps.
+  ASSERT_EQ(counts.mmaps, 2u * 4 + 10);
+
+  // Symbols of synthetic libraries are stored in the file feature section.
+  CaptureStdout capture;
+  ASSERT_TRUE(capture.Start());
+  ASSERT_TRUE(CreateCommandInstance("report")->Run({"-i", tmpfile.path, "--sort", "symbol"}));
+  std::string output = capture.Finish();
+  ASSERT_NE(output.find("_function"), std::string::npos);
+}
+
+TEST(synthesize_cmd, output_is_deterministic) {
+  TemporaryFile tmpfile1;
+  TemporaryFile tmpfile2;
+  TemporaryFile tmpfile3;
+  close(tmpfile1.release());
+  close(tmpfile2.release());
+  close(tmpfile3.release());
+  std::vector<std::string> args = {"--samples", "500", "--callchain-depth", "geometric:8",
+                                   "--map-churn", "50"};
+  auto run = [&](const char* path, const std::string& seed) {
+    std::vector<std::string> cmd_args = args;
+    cmd_args.insert(cmd_args.end(), {"-o", path, "--seed", seed});
+    return SynthesizeCmd()->Run(cmd_args);
+  };
+  ASSERT_TRUE(run(tmpfile1.path, "1"));
+  ASSERT_TRUE(run(tmpfile2.path, "1"));
+  ASSERT_TRUE(run(tmpfile3.path, "2"));
+  std::string data1;
+  std::string data2;
+  std::string data3;
+  ASSERT_TRUE(android::base::ReadFileToString(tmpfile1.path, &data1));
+  ASSERT_TRUE(android::base::ReadFileToString(tmpfile2.path, &data2));
+  ASSERT_TRUE(android::base::ReadFileToString(tmpfile3.path, &data3));
+  ASSERT_EQ(data1, data2);
+  ASSERT_NE(data1, data3);
+}
+
+TEST(synthesize_cmd, callchain_depth_option) {
+  TemporaryFile tmpfile;
+  close(tmpfile.release());
+  ASSERT_TRUE(SynthesizeCmd()->Run(
+      {"-o", tmpfile.path, "--samples", "100", "--callchain-depth", "fixed:5"}));
+  std::unique_ptr<RecordFileReader> reader = RecordFileReader::CreateInstance(tmpfile.path);
+  ASSERT_TRUE(reader);
+  ASSERT_TRUE(reader->ReadDataSection([&](std::unique_ptr<Record> r) {
+    if (r->type() == PERF_RECORD_SAMPLE) {
+      // PERF_CONTEXT_USER followed by 5 frames.
+      EXPECT_EQ(static_cast<SampleRecord*>(r.get())->callchain_data.ip_nr, 6u);
+    }
+    return true;
+  }));
+  ASSERT_FALSE(SynthesizeCmd()->Run({"-o", tmpfile.path, "--callchain-depth", "uniform:5:1"}));
+  ASSERT_FALSE(SynthesizeCmd()->Run({"-o", tmpfile.path, "--callchain-depth", "geometric:0"}));
+  ASSERT_FALSE(SynthesizeCmd()->Run({"-o", tmpfile.path, "--callchain-depth", "normal:3"}));
+}
+
+TEST(synthesize_cmd, dwarf_stacks_from_option) {
+  TemporaryFile tmpfile;
+  close(tmpfile.release());
+  ASSERT_TRUE(SynthesizeCmd()->Run({"-o", tmpfile.path, "--samples", "200", "--processes", "2",
+                                    "--dwarf-stacks-from", GetTestData(PERF_DATA_NO_UNWIND),
+                                    "--dwarf-percent", "50"}));
+  RecordCounts counts;
+  ASSERT_TRUE(ReadRecordCounts(tmpfile.path, &counts));
+  ASSERT_EQ(counts.samples, 200u);
+  ASSERT_GT(counts.samples_with_stack, 0u);
+  ASSERT_LT(counts.samples_with_stack, 200u);
+
+  // The output file can be used by debug-unwind.
+  CaptureStdout capture;
+  ASSERT_TRUE(capture.Start());
+  ASSERT_TRUE(CreateCommandInstance("debug-unwind")
+                  ->Run({"-i", tmpfile.path, "--unwind-sample", "--skip-sample-print"}));
+  std::string output = capture.Finish();
+  ASSERT_NE(output.find("unwinding_sample_count: " + std::to_string(counts.samples_with_stack)),
+            std::string::npos);
+}
@@ -190,6 +190,7 @@ void RegisterAllCommands() {
   RegisterKmemCommand();
   RegisterMergeCommand();
   RegisterReportCommand();
+  RegisterReportHtmlDataCommand();
   RegisterReportSampleCommand();
 #if defined(__linux__)
     RegisterListCommand();
@@ -201,6 +202,8 @@ void RegisterAllCommands() {
 #if defined(__ANDROID__)
     RegisterAPICommands();
     RegisterBootRecordCommand();
+#else
+    RegisterSynthesizeCommand();
 #endif
 #endif
 }
@@ -221,8 +221,10 @@ void RegisterKmemCommand();
 void RegisterMergeCommand();
 void RegisterRecordCommand();
 void RegisterReportCommand();
+void RegisterReportHtmlDataCommand();
 void RegisterReportSampleCommand();
 void RegisterStatCommand();
+void RegisterSynthesizeCommand();
 void RegisterDebugUnwindCommand();
 void RegisterTraceSchedCommand();
 void RegisterAPICommands();
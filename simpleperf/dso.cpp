@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string_view>
 #include <vector>
@@ -207,17 +208,53 @@ std::string DebugElfFileFinder::GetPathInSymFsDir(const std::string& path) {
 }
 }  // namespace simpleperf_dso_impl
 
+// Symbol names and demangled names are allocated by symbol_name_allocator, shared by all dsos.
+// Dsos may load symbols in different threads (like the record thread and the live report thread),
+// so the allocator and demangled_name_cache are guarded by symbol_name_mutex.
+static std::mutex symbol_name_mutex;
 static OneTimeFreeAllocator symbol_name_allocator;
 
+// To avoid taking symbol_name_mutex for each symbol, Dso::LoadSymbols() allocates names of the
+// loaded symbols in a batch allocator owned by the current thread, and then moves the batch to
+// symbol_name_allocator under one lock.
+static thread_local OneTimeFreeAllocator* symbol_name_batch = nullptr;
+
+class SymbolNameBatchScope {
+ public:
+  SymbolNameBatchScope() : prev_batch_(symbol_name_batch) { symbol_name_batch = &batch_; }
+
+  ~SymbolNameBatchScope() {
+    symbol_name_batch = prev_batch_;
+    std::lock_guard<std::mutex> lock(symbol_name_mutex);
+    symbol_name_allocator.MoveFrom(batch_);
+  }
+
+ private:
+  OneTimeFreeAllocator batch_;
+  OneTimeFreeAllocator* prev_batch_;
+};
+
+static const char* AllocateSymbolName(std::string_view name) {
+  if (symbol_name_batch != nullptr) {
+    return symbol_name_batch->AllocateString(name);
+  }
+  std::lock_guard<std::mutex> lock(symbol_name_mutex);
+  return symbol_name_allocator.AllocateString(name);
+}
+
 Symbol::Symbol(std::string_view name, uint64_t addr, uint64_t len)
     : addr(addr),
       len(len),
-      name_(symbol_name_allocator.AllocateString(name)),
+      name_(AllocateSymbolName(name)),
       demangled_name_(nullptr),
       dump_id_(UINT_MAX) {}
 
 const char* Symbol::DemangledName() const {
   if (demangled_name_ == nullptr) {
+    if (!Dso::demangle_) {
+      demangled_name_ = name_;
+      return demangled_name_;
+    }
     const std::string s = Dso::Demangle(name_);
     SetDemangledName(s);
   }
@@ -228,7 +265,7 @@ void Symbol::SetDemangledName(std::string_view name) const {
   if (name == name_) {
     demangled_name_ = name_;
   } else {
-    demangled_name_ = symbol_name_allocator.AllocateString(name);
+    demangled_name_ = AllocateSymbolName(name);
   }
 }
 
@@ -258,7 +295,7 @@ bool Dso::demangle_ = true;
 std::string Dso::vmlinux_;
 std::string Dso::kallsyms_;
 std::unordered_map<std::string, BuildId> Dso::build_id_map_;
-size_t Dso::dso_count_;
+std::atomic<size_t> Dso::dso_count_;
 uint32_t Dso::g_dump_id_;
 simpleperf_dso_impl::DebugElfFileFinder Dso::debug_elf_file_finder_;
 
@@ -266,6 +303,10 @@ void Dso::SetDemangle(bool demangle) {
   demangle_ = demangle;
 }
 
+// Map from mangled names to demangled names, shared by all dsos. Both keys and values are
+// allocated by symbol_name_allocator. It is guarded by symbol_name_mutex.
+static std::unordered_map<std::string_view, const char*> demangled_name_cache;
+
 extern "C" char* __cxa_demangle(const char* mangled_name, char* buf, size_t* n, int* status);
 #if defined(__linux__) || defined(__darwin__)
 extern "C" char* rustc_demangle(const char* mangled, char* out, size_t* len, int* status);
@@ -312,6 +353,73 @@ std::string Dso::Demangle(const std::string& name) {
   return name;
 }
 
+static bool MayNeedDemangle(std::string_view name) {
+  if (StartsWith(name, linker_prefix)) {
+    return true;
+  }
+  return name.size() > 1 && name[0] == '_' && (name[1] == 'Z' || name[1] == 'R');
+}
+
+void Dso::DemangleSymbols(std::vector<Symbol>& symbols) {
+  if (!demangle_) {
+    for (const Symbol& symbol : symbols) {
+      if (symbol.demangled_name_ == nullptr) {
+        symbol.demangled_name_ = symbol.name_;
+      }
+    }
+    return;
+  }
+  // Collect unique names not in demangled_name_cache.
+  std::vector<std::string_view> names;
+  std::unordered_map<std::string_view, size_t> name_to_index;
+  std::vector<std::pair<const Symbol*, size_t>> pending_symbols;
+  std::unique_lock<std::mutex> lock(symbol_name_mutex);
+  for (const Symbol& symbol : symbols) {
+    if (symbol.demangled_name_ != nullptr) {
+      continue;
+    }
+    std::string_view name = symbol.name_;
+    if (!MayNeedDemangle(name)) {
+      symbol.demangled_name_ = symbol.name_;
+    } else if (auto it = demangled_name_cache.find(name); it != demangled_name_cache.end()) {
+      symbol.demangled_name_ = it->second;
+    } else {
+      auto [name_it, inserted] = name_to_index.try_emplace(name, names.size());
+      if (inserted) {
+        names.emplace_back(name);
+      }
+      pending_symbols.emplace_back(&symbol, name_it->second);
+    }
+  }
+  lock.unlock();
+  if (names.empty()) {
+    return;
+  }
+
+  // __cxa_demangle() and rustc_demangle() are thread safe, while symbol_name_allocator isn't.
+  // So demangle names in parallel, and then store results in the main thread.
+  constexpr size_t kMinNamesPerJob = 2048;
+  std::vector<std::string> demangled_names(names.size());
+  RunInParallel(names.size(), kMinNamesPerJob, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      demangled_names[i] = Demangle(std::string(names[i]));
+    }
+  });
+  std::vector<const char*> results(names.size());
+  lock.lock();
+  for (size_t i = 0; i < names.size(); i++) {
+    if (demangled_names[i] == names[i]) {
+      results[i] = names[i].data();
+    } else {
+      results[i] = symbol_name_allocator.AllocateString(demangled_names[i]);
+    }
+    demangled_name_cache[names[i]] = results[i];
+  }
+  for (auto& [symbol, index] : pending_symbols) {
+    symbol->demangled_name_ = results[index];
+  }
+}
+
 bool Dso::SetSymFsDir(const std::string& symfs_dir) {
   return debug_elf_file_finder_.SetSymFsDir(symfs_dir);
 }
@@ -368,7 +476,11 @@ Dso::Dso(DsoType type, const std::string& path)
 Dso::~Dso() {
   if (--dso_count_ == 0) {
     // Clean up global variables when no longer used.
-    symbol_name_allocator.Clear();
+    {
+      std::lock_guard<std::mutex> lock(symbol_name_mutex);
+      demangled_name_cache.clear();
+      symbol_name_allocator.Clear();
+    }
     demangle_ = true;
     vmlinux_.clear();
     kallsyms_.clear();
@@ -419,7 +531,9 @@ void Dso::SetSymbols(std::vector<Symbol>* symbols) {
 }
 
 void Dso::AddUnknownSymbol(uint64_t vaddr_in_dso, const std::string& name) {
-  unknown_symbols_.insert(std::make_pair(vaddr_in_dso, Symbol(name, vaddr_in_dso, 1)));
+  auto it = unknown_symbols_.insert(std::make_pair(vaddr_in_dso, Symbol(name, vaddr_in_dso, 1)));
+  // Demangle now, so the symbol isn't changed when read later.
+  it.first->second.DemangledName();
 }
 
 bool Dso::IsForJavaMethod() const {
@@ -441,7 +555,11 @@ bool Dso::IsForJavaMethod() const {
 void Dso::LoadSymbols() {
   if (!is_loaded_) {
     is_loaded_ = true;
-    std::vector<Symbol> symbols = LoadSymbolsImpl();
+    std::vector<Symbol> symbols;
+    {
+      SymbolNameBatchScope batch_scope;
+      symbols = LoadSymbolsImpl();
+    }
     if (symbols_.empty()) {
       symbols_ = std::move(symbols);
     } else {
@@ -450,6 +568,7 @@ void Dso::LoadSymbols() {
                      std::back_inserter(merged_symbols), Symbol::CompareValueByAddr);
       symbols_ = std::move(merged_symbols);
     }
+    DemangleSymbols(symbols_);
   }
 }
 
@@ -471,7 +590,10 @@ static void ReportReadElfSymbolResult(
 }
 
 static void SortAndFixSymbols(std::vector<Symbol>& symbols) {
-  std::sort(symbols.begin(), symbols.end(), Symbol::CompareValueByAddr);
+  // Symbols read from dex files are already in address order.
+  if (!std::is_sorted(symbols.begin(), symbols.end(), Symbol::CompareValueByAddr)) {
+    std::sort(symbols.begin(), symbols.end(), Symbol::CompareValueByAddr);
+  }
   Symbol* prev_symbol = nullptr;
   for (auto& symbol : symbols) {
     if (prev_symbol != nullptr && prev_symbol->len == 0) {
@@ -514,25 +636,45 @@ class DexFileDso : public Dso {
       symbols.emplace_back(symbol->name, symbol->addr, symbol->size);
     };
     if (std::get<0>(tuple)) {
-      std::unique_ptr<ArchiveHelper> ahelper = ArchiveHelper::CreateInstance(std::get<1>(tuple));
-      ZipEntry entry;
+      const std::string& apk_path = std::get<1>(tuple);
+      const ApkEntry* apk_entry = nullptr;
+      if (const ApkIndex* index = ApkInspector::GetApkIndex(apk_path); index != nullptr) {
+        apk_entry = index->FindEntryByName(std::get<2>(tuple));
+      }
       std::vector<uint8_t> data;
-      if (ahelper && ahelper->FindEntry(std::get<2>(tuple), &entry) &&
-          ahelper->GetEntryData(entry, &data)) {
+      bool has_data = false;
+      if (apk_entry != nullptr && apk_entry->stored) {
+        // Read a stored entry directly, without opening the zip file again.
+        android::base::unique_fd fd = FileHelper::OpenReadOnly(apk_path);
+        data.resize(apk_entry->uncompressed_size);
+        has_data = fd != -1 && android::base::ReadFullyAtOffset(fd, data.data(), data.size(),
+                                                                apk_entry->offset);
+      } else if (apk_entry != nullptr) {
+        std::unique_ptr<ArchiveHelper> ahelper = ArchiveHelper::CreateInstance(apk_path);
+        ZipEntry entry;
+        has_data = ahelper && ahelper->FindEntry(std::get<2>(tuple), &entry) &&
+                   ahelper->GetEntryData(entry, &data);
+      }
+      if (has_data) {
         status = ReadSymbolsFromDexFileInMemory(data.data(), data.size(), debug_file_path,
                                                 dex_file_offsets_, symbol_callback);
       }
     } else {
       status = ReadSymbolsFromDexFile(debug_file_path, dex_file_offsets_, symbol_callback);
     }
+    // Symbols may still be read from other dex files when one of them fails.
+    SortAndFixSymbols(symbols);
     if (!status) {
       android::base::LogSeverity level =
           symbols_.empty() ? android::base::WARNING : android::base::DEBUG;
-      LOG(level) << "Failed to read symbols from dex_file " << debug_file_path;
+      if (symbols.empty()) {
+        LOG(level) << "Failed to read symbols from dex_file " << debug_file_path;
+      } else {
+        LOG(level) << "Read symbols from part of dex files in " << debug_file_path;
+      }
       return symbols;
     }
     LOG(VERBOSE) << "Read symbols from dex_file " << debug_file_path << " successfully";
-    SortAndFixSymbols(symbols);
     return symbols;
   }
 
@@ -17,6 +17,7 @@
 #ifndef SIMPLE_PERF_DSO_H_
 #define SIMPLE_PERF_DSO_H_
 
+#include <atomic>
 #include <memory>
 #include <optional>
 #include <string>
@@ -64,6 +65,11 @@ struct Symbol {
   Symbol(std::string_view name, uint64_t addr, uint64_t len);
   const char* Name() const { return name_; }
 
+  // DemangledName() demangles the name and caches the result on first call, so it isn't thread
+  // safe on a symbol not demangled yet. Symbols of a Dso are all demangled when loaded, and
+  // unknown symbols when added. So symbols returned by Dso::FindSymbol() can be read from
+  // multiple threads. SetDemangledName() changes the symbol, and should only be called by the
+  // thread using the Dso.
   const char* DemangledName() const;
   void SetDemangledName(std::string_view name) const;
   // Return function name without signature.
@@ -114,6 +120,9 @@ class Dso {
  public:
   static void SetDemangle(bool demangle);
   static std::string Demangle(const std::string& name);
+  // Demangle names of symbols not demangled yet, on multiple threads. Demangled names are shared
+  // by symbols in all dsos having the same mangled names.
+  static void DemangleSymbols(std::vector<Symbol>& symbols);
   // SymFsDir is used to provide an alternative root directory looking for files with symbols.
   // For example, if we are searching symbols for /system/lib/libc.so and SymFsDir is /data/symbols,
   // then we will also search file /data/symbols/system/lib/libc.so.
@@ -197,7 +206,9 @@ class Dso {
   static std::string vmlinux_;
   static std::string kallsyms_;
   static std::unordered_map<std::string, BuildId> build_id_map_;
-  static size_t dso_count_;
+  // Dsos can be created on different threads, like the record thread and the live report thread
+  // in `record --live-report`.
+  static std::atomic<size_t> dso_count_;
   static uint32_t g_dump_id_;
   static simpleperf_dso_impl::DebugElfFileFinder debug_elf_file_finder_;
 
@@ -224,6 +235,8 @@ class Dso {
   // Used to assign dump_id for symbols in current dso.
   uint32_t symbol_dump_id_;
   android::base::LogSeverity symbol_warning_loglevel_;
+
+  friend struct Symbol;
 };
 
 const char* DsoTypeToString(DsoType dso_type);
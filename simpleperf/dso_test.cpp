@@ -378,3 +378,28 @@ TEST(dso, demangle) {
   ASSERT_EQ(Dso::Demangle("_RNvC6_123foo3bar"), "123foo::bar");
 #endif
 }
+
+TEST(dso, DemangleSymbols) {
+  // Use enough symbols to demangle them on multiple threads.
+  std::vector<Symbol> symbols;
+  for (size_t i = 0; i < 10000; i++) {
+    // Mangled names like "_Z2ffv" for function "ff()".
+    size_t name_len = i % 10 + 1;
+    symbols.emplace_back("_Z" + std::to_string(name_len) + std::string(name_len, 'f') + "v", i, 1);
+    symbols.emplace_back("main", i, 1);
+  }
+  std::vector<Symbol> symbols2;
+  symbols2.emplace_back("_Z1fv", 0, 1);
+  symbols2.emplace_back("_Z1fv", 1, 1);
+  Dso::DemangleSymbols(symbols);
+  Dso::DemangleSymbols(symbols2);
+  for (size_t i = 0; i < symbols.size(); i += 2) {
+    ASSERT_STREQ(symbols[i].DemangledName(), Dso::Demangle(symbols[i].Name()).c_str());
+    ASSERT_EQ(symbols[i + 1].DemangledName(), symbols[i + 1].Name());
+  }
+  ASSERT_STREQ(symbols[0].DemangledName(), "f()");
+  // Symbols with the same mangled name share the demangled name.
+  ASSERT_EQ(symbols[0].DemangledName(), symbols[20].DemangledName());
+  ASSERT_EQ(symbols[0].DemangledName(), symbols2[0].DemangledName());
+  ASSERT_EQ(symbols2[0].DemangledName(), symbols2[1].DemangledName());
+}
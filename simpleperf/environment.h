@@ -143,6 +143,13 @@ static inline uint64_t GetSystemClock() {
   return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
+// Return cpu time used by all threads in the current process, in ns.
+static inline uint64_t GetProcessCpuTime() {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 #if defined(__ANDROID__)
 bool IsInAppUid();
 #endif
@@ -89,6 +89,9 @@ std::unique_ptr<EventFd> EventFd::OpenEventFile(const perf_event_attr& attr, pid
 }
 
 EventFd::~EventFd() {
+  if (counter_page_ != nullptr) {
+    munmap(const_cast<perf_event_mmap_page*>(counter_page_), counter_page_size_);
+  }
   DestroyMappedBuffer();
   DestroyAuxBuffer();
   close(perf_event_fd_);
@@ -123,6 +126,14 @@ bool EventFd::SetEnableEvent(bool enable) {
   return true;
 }
 
+bool EventFd::SetSampleRate(uint64_t freq_or_period) {
+  if (ioctl(perf_event_fd_, PERF_EVENT_IOC_PERIOD, &freq_or_period) < 0) {
+    PLOG(ERROR) << "ioctl(period) " << Name() << " failed";
+    return false;
+  }
+  return true;
+}
+
 bool EventFd::SetFilter(const std::string& filter) {
   bool success = ioctl(perf_event_fd_, PERF_EVENT_IOC_SET_FILTER, filter.c_str()) >= 0;
   if (!success) {
@@ -157,6 +168,115 @@ bool EventFd::ReadCounter(PerfCounter* counter) {
   return true;
 }
 
+bool EventFd::CreateCounterPage() {
+  CHECK(counter_page_ == nullptr);
+  size_t page_size = sysconf(_SC_PAGE_SIZE);
+  void* addr = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, perf_event_fd_, 0);
+  if (addr == MAP_FAILED) {
+    PLOG(DEBUG) << "mmap() counter page failed for " << Name();
+    return false;
+  }
+  counter_page_ = reinterpret_cast<perf_event_mmap_page*>(addr);
+  counter_page_size_ = page_size;
+  return true;
+}
+
+#if defined(__aarch64__) || defined(__x86_64__) || defined(__i386__)
+#define HAVE_USER_SPACE_COUNTER_READ 1
+
+// Read the hardware counter at index, which is perf_event_mmap_page.index - 1.
+static inline uint64_t ReadHardwareCounter(uint32_t index) {
+#if defined(__aarch64__)
+  uint64_t value;
+  if (index == 31) {
+    // The cycle counter.
+    asm volatile("mrs %0, pmccntr_el0" : "=r"(value));
+  } else {
+    asm volatile("msr pmselr_el0, %0" : : "r"(static_cast<uint64_t>(index)));
+    asm volatile("isb" : : : "memory");
+    asm volatile("mrs %0, pmxevcntr_el0" : "=r"(value));
+  }
+  return value;
+#else
+  uint32_t low;
+  uint32_t high;
+  asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(index));
+  return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+}
+
+// Read the clock used by cap_user_time.
+static inline uint64_t ReadTimestamp() {
+#if defined(__aarch64__)
+  uint64_t value;
+  asm volatile("isb" : : : "memory");
+  asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+  return value;
+#else
+  uint32_t low;
+  uint32_t high;
+  asm volatile("rdtsc" : "=a"(low), "=d"(high));
+  return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+}
+#endif  // defined(__aarch64__) || defined(__x86_64__) || defined(__i386__)
+
+bool EventFd::ReadCounterInUserSpace([[maybe_unused]] PerfCounter* counter) const {
+#if defined(HAVE_USER_SPACE_COUNTER_READ)
+  volatile perf_event_mmap_page* pc = counter_page_;
+  if (pc == nullptr) {
+    return false;
+  }
+  // The protocol is described in struct perf_event_mmap_page in linux/perf_event.h.
+  uint32_t seq;
+  uint32_t index;
+  uint64_t value;
+  uint64_t time_enabled;
+  uint64_t time_running;
+  uint64_t delta;
+  do {
+    seq = pc->lock;
+    std::atomic_signal_fence(std::memory_order_acq_rel);
+    if (!pc->cap_user_rdpmc || !pc->cap_user_time) {
+      return false;
+    }
+    index = pc->index;
+    if (index == 0) {
+      // The event isn't on a hardware counter now.
+      return false;
+    }
+    time_enabled = pc->time_enabled;
+    time_running = pc->time_running;
+    uint64_t cyc = ReadTimestamp();
+    uint16_t time_shift = pc->time_shift;
+    uint32_t time_mult = pc->time_mult;
+    uint64_t time_offset = pc->time_offset;
+    if (pc->cap_user_time_short) {
+      uint64_t time_cycles = pc->time_cycles;
+      cyc = time_cycles + ((cyc - time_cycles) & pc->time_mask);
+    }
+    uint64_t quot = cyc >> time_shift;
+    uint64_t rem = cyc & ((static_cast<uint64_t>(1) << time_shift) - 1);
+    delta = time_offset + quot * time_mult + ((rem * time_mult) >> time_shift);
+
+    int64_t pmc = ReadHardwareCounter(index - 1);
+    uint16_t width = pc->pmc_width;
+    pmc <<= 64 - width;
+    pmc >>= 64 - width;
+    value = pc->offset + pmc;
+    std::atomic_signal_fence(std::memory_order_acq_rel);
+  } while (pc->lock != seq);
+
+  counter->value = value;
+  counter->time_enabled = time_enabled + delta;
+  counter->time_running = time_running + delta;
+  counter->id = Id();
+  return true;
+#else
+  return false;
+#endif
+}
+
 bool EventFd::CreateMappedBuffer(size_t mmap_pages, bool report_error) {
   CHECK(IsPowerOfTwo(mmap_pages));
   size_t page_size = sysconf(_SC_PAGE_SIZE);
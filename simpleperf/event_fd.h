@@ -62,9 +62,21 @@ class EventFd {
   // this file.
   bool SetEnableEvent(bool enable);
   bool SetFilter(const std::string& filter);
+  // Change the sample frequency (if attr.freq is set) or the sample period of the event.
+  bool SetSampleRate(uint64_t freq_or_period);
 
   bool ReadCounter(PerfCounter* counter);
 
+  // Map the first page of the perf_event_file, which is used to read the counter in user space
+  // when a thread monitors itself.
+  bool CreateCounterPage();
+  bool HasCounterPage() const { return counter_page_ != nullptr; }
+  // Read the counter without a syscall, through the counter page and rdpmc-like instructions.
+  // It only works when called by the monitored thread. Return false if the counter can't be read
+  // in user space now (like not supported, or the event isn't on a hardware counter). Then
+  // ReadCounter() should be used.
+  bool ReadCounterInUserSpace(PerfCounter* counter) const;
+
   // Create mapped buffer used to receive records sent by the kernel.
   // mmap_pages should be power of 2.
   virtual bool CreateMappedBuffer(size_t mmap_pages, bool report_error);
@@ -147,6 +159,10 @@ class EventFd {
 
   IOEventRef ioevent_ref_;
 
+  // the first page of the perf_event_file mapped by CreateCounterPage()
+  volatile perf_event_mmap_page* counter_page_ = nullptr;
+  size_t counter_page_size_ = 0;
+
   // Used by atrace to generate value difference between two ReadCounter() calls.
   uint64_t last_counter_value_;
 
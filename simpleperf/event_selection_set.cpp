@@ -537,6 +537,22 @@ void EventSelectionSet::SetInherit(bool enable) {
   }
 }
 
+void EventSelectionSet::EnableUserSpaceCounterRead() {
+#if defined(__aarch64__)
+  // The arm64 PMU driver only allows user space access for events with config1 bit 1 set, and
+  // when sysctl kernel.perf_user_access is 1. The bit is only set for events of the core PMU.
+  // Other PMUs use config1 for their own fields.
+  for (auto& group : groups_) {
+    for (auto& selection : group.selections) {
+      uint32_t type = selection.event_attr.type;
+      if (type == PERF_TYPE_HARDWARE || type == PERF_TYPE_HW_CACHE || type == PERF_TYPE_RAW) {
+        selection.event_attr.config1 |= 2;
+      }
+    }
+  }
+#endif
+}
+
 void EventSelectionSet::SetClockId(int clock_id) {
   for (auto& group : groups_) {
     for (auto& selection : group.selections) {
@@ -639,8 +655,16 @@ bool EventSelectionSet::OpenEventFilesOnGroup(EventSelectionGroup& group, pid_t
   // successfully or all failed to open.
   EventFd* group_fd = nullptr;
   for (auto& selection : group.selections) {
+    perf_event_attr attr = selection.event_attr;
+    if (auto value = GetScaledSampleRate(attr, sample_rate_divisor_); value) {
+      if (attr.freq) {
+        attr.sample_freq = value.value();
+      } else {
+        attr.sample_period = value.value();
+      }
+    }
     std::unique_ptr<EventFd> event_fd = EventFd::OpenEventFile(
-        selection.event_attr, tid, cpu, group_fd, selection.event_type_modifier.name, false);
+        attr, tid, cpu, group_fd, selection.event_type_modifier.name, false);
     if (!event_fd) {
       *failed_event_type = selection.event_type_modifier.name;
       return false;
@@ -807,6 +831,47 @@ bool EventSelectionSet::ReadCounters(std::vector<CountersInfo>* counters) {
   return true;
 }
 
+bool EventSelectionSet::CreateCounterPages() {
+  for (auto& group : groups_) {
+    for (auto& selection : group.selections) {
+      for (auto& event_fd : selection.event_fds) {
+        if (!event_fd->HasCounterPage() && !event_fd->CreateCounterPage()) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool EventSelectionSet::ReadSelfCounters(std::vector<PerfCounter>* counters) {
+  counters->clear();
+  for (auto& group : groups_) {
+    for (auto& selection : group.selections) {
+      PerfCounter& sum = counters->emplace_back();
+      sum.value = 0;
+      sum.time_enabled = 0;
+      sum.time_running = 0;
+      sum.id = 0;
+      for (const CounterInfo& c : selection.hotplugged_counters) {
+        sum.value += c.counter.value;
+        sum.time_enabled += c.counter.time_enabled;
+        sum.time_running += c.counter.time_running;
+      }
+      for (auto& event_fd : selection.event_fds) {
+        PerfCounter counter;
+        if (!event_fd->ReadCounterInUserSpace(&counter) && !event_fd->ReadCounter(&counter)) {
+          return false;
+        }
+        sum.value += counter.value;
+        sum.time_enabled += counter.time_enabled;
+        sum.time_running += counter.time_running;
+      }
+    }
+  }
+  return true;
+}
+
 bool EventSelectionSet::MmapEventFiles(size_t min_mmap_pages, size_t max_mmap_pages,
                                        size_t aux_buffer_size, size_t record_buffer_size,
                                        bool allow_truncating_samples, bool exclude_perf) {
@@ -918,4 +983,55 @@ bool EventSelectionSet::SetEnableEvents(bool enable) {
   return true;
 }
 
+bool EventSelectionSet::ScaleDownSampleRates(uint64_t divisor) {
+  sample_rate_divisor_ = divisor;
+  for (auto& group : groups_) {
+    for (auto& sel : group.selections) {
+      auto value = GetScaledSampleRate(sel.event_attr, divisor);
+      if (!value) {
+        continue;
+      }
+      for (auto& fd : sel.event_fds) {
+        if (!fd->SetSampleRate(value.value())) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+std::optional<uint64_t> EventSelectionSet::GetScaledSampleRate(const perf_event_attr& attr,
+                                                               uint64_t divisor) {
+  if (attr.type == PERF_TYPE_TRACEPOINT) {
+    return std::nullopt;
+  }
+  if (attr.freq) {
+    return std::max<uint64_t>(attr.sample_freq / divisor, 1);
+  }
+  if (attr.sample_period <= 1 || attr.sample_period == INFINITE_SAMPLE_PERIOD) {
+    return std::nullopt;
+  }
+  // Keep the period below INFINITE_SAMPLE_PERIOD, so the event is still sampled.
+  uint64_t period;
+  if (__builtin_mul_overflow(attr.sample_period, divisor, &period) ||
+      period >= INFINITE_SAMPLE_PERIOD) {
+    period = INFINITE_SAMPLE_PERIOD - 1;
+  }
+  return period;
+}
+
+std::vector<uint64_t> EventSelectionSet::GetOpenedSampleRates() const {
+  std::vector<uint64_t> result;
+  for (const auto& group : groups_) {
+    for (const auto& sel : group.selections) {
+      if (!sel.event_fds.empty()) {
+        const perf_event_attr& attr = sel.event_fds[0]->attr();
+        result.push_back(attr.freq ? attr.sample_freq : attr.sample_period);
+      }
+    }
+  }
+  return result;
+}
+
 }  // namespace simpleperf
@@ -19,6 +19,7 @@
 
 #include <functional>
 #include <map>
+#include <optional>
 #include <set>
 #include <unordered_map>
 #include <vector>
@@ -129,6 +130,8 @@ class EventSelectionSet {
   bool EnableDwarfCallChainSampling(uint32_t dump_stack_size);
   void SetInherit(bool enable);
   void SetClockId(int clock_id);
+  // Allow reading hardware counters in user space. It is needed on arm64.
+  void EnableUserSpaceCounterRead();
   bool NeedKernelSymbol() const;
   void SetRecordNotExecutableMaps(bool record);
   bool RecordNotExecutableMaps() const;
@@ -165,6 +168,12 @@ class EventSelectionSet {
   // Otherwise, monitor on selected cpus, with a perf event file for each cpu.
   bool OpenEventFiles(const std::vector<int>& cpus);
   bool ReadCounters(std::vector<CountersInfo>* counters);
+  // Used when a thread monitors itself. Map a counter page for each event file, so counters can
+  // be read in user space by ReadSelfCounters().
+  bool CreateCounterPages();
+  // Read the counter of each event, in the order of adding events. Counters are read in user space
+  // when possible, otherwise by read() syscalls. It should only be called by the monitored thread.
+  bool ReadSelfCounters(std::vector<PerfCounter>* counters);
   bool MmapEventFiles(size_t min_mmap_pages, size_t max_mmap_pages, size_t aux_buffer_size,
                       size_t record_buffer_size, bool allow_truncating_samples, bool exclude_perf);
   bool PrepareToReadMmapEventData(const std::function<bool(Record*)>& callback);
@@ -173,12 +182,29 @@ class EventSelectionSet {
   void CloseEventFiles();
 
   const simpleperf::RecordStat& GetRecordStat() { return record_read_thread_->GetStat(); }
+  // Copy the record stat while the read thread is running.
+  bool GetRecordStatWhileReading(simpleperf::RecordStat* stat) {
+    return record_read_thread_->GetStatWhileReading(stat);
+  }
 
   // Stop profiling if all monitored processes/threads don't exist.
   bool StopWhenNoMoreTargets(
       double check_interval_in_sec = DEFAULT_PERIOD_TO_CHECK_MONITORED_TARGETS_IN_SEC);
 
   bool SetEnableEvents(bool enable);
+  // Reduce sample rates of sampling events to 1 / divisor of the rates used to open them. Event
+  // files opened later also use the reduced rates.
+  bool ScaleDownSampleRates(uint64_t divisor);
+  // Return the sample rate of attr reduced to 1 / divisor, or nullopt if the event shouldn't be
+  // scaled. Tracepoint events and events sampling every occurrence aren't scaled, because users
+  // like --trace-offcpu need every sample of them.
+  static std::optional<uint64_t> GetScaledSampleRate(const perf_event_attr& attr,
+                                                     uint64_t divisor);
+  // Return the sample rates used to open event files, in the order of GetEventAttrWithId().
+  // Events without opened files are skipped.
+  std::vector<uint64_t> GetOpenedSampleRates() const;
+  // Return the ratio of free space in the userspace record buffer, in range [0, 1].
+  double GetFreeRecordBufferRatio() const { return record_read_thread_->GetFreeBufferRatio(); }
 
  private:
   struct EventSelection {
@@ -224,6 +250,8 @@ class EventSelectionSet {
   bool has_aux_trace_ = false;
   std::vector<AddrFilter> addr_filters_;
   std::optional<SampleRate> sample_rate_;
+  // Set by ScaleDownSampleRates().
+  uint64_t sample_rate_divisor_ = 1;
 
   DISALLOW_COPY_AND_ASSIGN(EventSelectionSet);
 };
@@ -16,6 +16,9 @@
 
 #include <gtest/gtest.h>
 
+#include <unistd.h>
+
+#include "event_fd.h"
 #include "event_selection_set.h"
 
 using namespace simpleperf;
@@ -56,3 +59,39 @@ TEST(EventSelectionSet, add_event_with_sample_rate) {
   ASSERT_EQ(attrs[1].attr.freq, 0);
   ASSERT_EQ(attrs[1].attr.sample_period, 1);
 }
+
+TEST(EventSelectionSet, get_scaled_sample_rate) {
+  EventSelectionSet event_selection_set(false);
+  ASSERT_TRUE(event_selection_set.AddEventType("cpu-clock:u", SampleRate(4000, 0)));
+  ASSERT_TRUE(event_selection_set.AddEventType("page-faults:u", SampleRate(0, 100)));
+  ASSERT_TRUE(event_selection_set.AddEventType("context-switches:u", SampleRate(0, 1)));
+  ASSERT_TRUE(event_selection_set.AddEventType("sched:sched_switch", SampleRate(0, 100)));
+  EventAttrIds attrs = event_selection_set.GetEventAttrWithId();
+  ASSERT_EQ(attrs.size(), 4);
+  ASSERT_EQ(EventSelectionSet::GetScaledSampleRate(attrs[0].attr, 4), 1000);
+  ASSERT_EQ(EventSelectionSet::GetScaledSampleRate(attrs[1].attr, 4), 400);
+  // Events sampling every occurrence and tracepoint events aren't scaled.
+  ASSERT_FALSE(EventSelectionSet::GetScaledSampleRate(attrs[2].attr, 4));
+  ASSERT_FALSE(EventSelectionSet::GetScaledSampleRate(attrs[3].attr, 4));
+  // Scaled periods stay below INFINITE_SAMPLE_PERIOD.
+  perf_event_attr attr = attrs[1].attr;
+  attr.sample_period = INFINITE_SAMPLE_PERIOD - 2;
+  ASSERT_EQ(EventSelectionSet::GetScaledSampleRate(attr, 64), INFINITE_SAMPLE_PERIOD - 1);
+  attr.sample_period = UINT64_MAX / 2;
+  ASSERT_EQ(EventSelectionSet::GetScaledSampleRate(attr, 4), INFINITE_SAMPLE_PERIOD - 1);
+}
+
+TEST(EventSelectionSet, open_event_files_after_scaling_sample_rates) {
+  EventSelectionSet event_selection_set(false);
+  ASSERT_TRUE(event_selection_set.AddEventType("cpu-clock:u", SampleRate(4000, 0)));
+  if (!IsEventAttrSupported(event_selection_set.GetEventAttrWithId()[0].attr, "cpu-clock:u")) {
+    GTEST_LOG_(INFO) << "Skip this test as perf events can't be opened.";
+    return;
+  }
+  ASSERT_TRUE(event_selection_set.ScaleDownSampleRates(4));
+  event_selection_set.AddMonitoredProcesses({getpid()});
+  ASSERT_TRUE(event_selection_set.OpenEventFiles({-1}));
+  ASSERT_EQ(event_selection_set.GetOpenedSampleRates(), std::vector<uint64_t>{1000});
+  // The attrs saved in the record file keep the requested rate.
+  ASSERT_EQ(event_selection_set.GetEventAttrWithId()[0].attr.sample_freq, 4000);
+}
@@ -84,6 +84,9 @@ class SIMPLEPERF_EXPORT PerfEventSet {
   virtual bool StopCounters();
   // Read counter values. There is a value for each event. You don't need to stop counters before
   // reading them. The counter values are the accumulated value from the first StartCounters().
+  // When only the current thread is monitored (by MonitorCurrentThread()), reading counters from
+  // that thread doesn't need syscalls if the kernel allows reading hardware counters in user
+  // space. Otherwise, each event takes a read() syscall.
   virtual bool ReadCounters(std::vector<Counter>* counters);
 
  protected:
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <string_view>
+#include <vector>
+
+namespace simpleperf {
+
+// JsonWriter writes json values to a FILE as they are added, without building a document tree.
+class JsonWriter {
+ public:
+  JsonWriter(FILE* fp) : fp_(fp) {}
+
+  void BeginObject() {
+    BeforeValue();
+    fputc('{', fp_);
+    first_.push_back(true);
+  }
+
+  void EndObject() {
+    first_.pop_back();
+    fputc('}', fp_);
+  }
+
+  void BeginArray() {
+    BeforeValue();
+    fputc('[', fp_);
+    first_.push_back(true);
+  }
+
+  void EndArray() {
+    first_.pop_back();
+    fputc(']', fp_);
+  }
+
+  void Key(std::string_view key) {
+    BeforeValue();
+    WriteString(key);
+    fputc(':', fp_);
+    after_key_ = true;
+  }
+
+  void String(std::string_view value) {
+    BeforeValue();
+    WriteString(value);
+  }
+
+  void Int(int64_t value) {
+    BeforeValue();
+    fprintf(fp_, "%" PRId64, value);
+  }
+
+  void Uint(uint64_t value) {
+    BeforeValue();
+    fprintf(fp_, "%" PRIu64, value);
+  }
+
+  void Double(double value) {
+    BeforeValue();
+    fprintf(fp_, "%.6g", value);
+  }
+
+ private:
+  void BeforeValue() {
+    if (after_key_) {
+      after_key_ = false;
+    } else if (!first_.empty()) {
+      if (!first_.back()) {
+        fputc(',', fp_);
+      }
+      first_.back() = false;
+    }
+  }
+
+  void WriteString(std::string_view s) {
+    fputc('"', fp_);
+    for (char c : s) {
+      if (c == '"' || c == '\\') {
+        fputc('\\', fp_);
+        fputc(c, fp_);
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        fprintf(fp_, "\\u%04x", static_cast<unsigned char>(c));
+      } else {
+        fputc(c, fp_);
+      }
+    }
+    fputc('"', fp_);
+  }
+
+  FILE* fp_;
+  std::vector<bool> first_;
+  bool after_key_ = false;
+};
+
+}  // namespace simpleperf
@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "live_report.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <android-base/logging.h>
+#include <android-base/stringprintf.h>
+
+#include "event_type.h"
+#include "json_writer.h"
+
+namespace simpleperf {
+
+namespace {
+
+// Renormalize weights when the decay scale grows over this, to keep weights in double range.
+constexpr double kMaxDecayScale = 1e100;
+// When renormalizing, drop entries having less than this part of the total weight.
+constexpr double kMinEntryRatio = 1e-9;
+
+std::vector<std::string> SplitKey(const std::string& key) {
+  std::vector<std::string> values;
+  size_t start = 0;
+  while (true) {
+    size_t end = key.find('\0', start);
+    if (end == std::string::npos) {
+      values.emplace_back(key.substr(start));
+      break;
+    }
+    values.emplace_back(key.substr(start, end - start));
+    start = end + 1;
+  }
+  values.resize(3);
+  return values;
+}
+
+}  // namespace
+
+std::unique_ptr<LiveReporter> LiveReporter::Create(const LiveReportOptions& options,
+                                                   const EventAttrIds& attrs) {
+  CHECK(!attrs.empty());
+  FILE* snapshot_fp = nullptr;
+  if (options.snapshot_fd != -1) {
+    snapshot_fp = fdopen(options.snapshot_fd, "w");
+    if (snapshot_fp == nullptr) {
+      PLOG(ERROR) << "failed to open fd " << options.snapshot_fd;
+      return nullptr;
+    }
+  }
+  return std::unique_ptr<LiveReporter>(new LiveReporter(options, attrs, snapshot_fp));
+}
+
+LiveReporter::LiveReporter(const LiveReportOptions& options, const EventAttrIds& attrs,
+                           FILE* snapshot_fp)
+    : options_(options),
+      attr_(attrs[0].attr),
+      snapshot_fp_(snapshot_fp, fclose),
+      callchain_report_builder_(thread_tree_) {
+  thread_tree_.ShowIpForUnknownSymbol();
+  for (size_t i = 0; i < attrs.size(); i++) {
+    for (uint64_t id : attrs[i].ids) {
+      event_id_to_index_[id] = i;
+    }
+    events_.emplace_back();
+    events_.back().name = GetEventNameByAttr(attrs[i].attr);
+  }
+  start_time_ = decay_base_time_ = std::chrono::steady_clock::now();
+  report_thread_ = std::thread([this]() { ReportThreadMain(); });
+}
+
+LiveReporter::~LiveReporter() {
+  if (report_thread_.joinable()) {
+    Finish();
+  }
+}
+
+bool LiveReporter::AddRecord(const Record& r) {
+  switch (r.type()) {
+    case PERF_RECORD_MMAP:
+    case PERF_RECORD_MMAP2:
+    case PERF_RECORD_COMM:
+    case PERF_RECORD_FORK:
+    case PERF_RECORD_EXIT:
+      break;
+    default:
+      return true;
+  }
+  // Records passed by the record thread don't own their buffers. So copy them.
+  char* buf = new char[r.size()];
+  memcpy(buf, r.Binary(), r.size());
+  std::unique_ptr<Record> copy = ReadRecordFromBuffer(attr_, buf, buf + r.size());
+  if (!copy) {
+    delete[] buf;
+    return false;
+  }
+  copy->OwnBinary();
+  QueueEntry entry;
+  entry.type = QueueEntry::kRecord;
+  entry.record = std::move(copy);
+  Push(std::move(entry));
+  return true;
+}
+
+void LiveReporter::AddSample(const SampleRecord& r) {
+  QueueEntry entry;
+  entry.type = QueueEntry::kSample;
+  entry.pid = static_cast<pid_t>(r.tid_data.pid);
+  entry.tid = static_cast<pid_t>(r.tid_data.tid);
+  if (event_id_to_index_.size() > 1) {
+    if (auto it = event_id_to_index_.find(r.id_data.id); it != event_id_to_index_.end()) {
+      entry.event = it->second;
+    }
+  }
+  entry.period = r.period_data.period;
+  if (options_.accumulate_callchain) {
+    entry.ips = r.GetCallChain(&entry.kernel_ip_count);
+  } else {
+    entry.ips.push_back(r.ip_data.ip);
+    entry.kernel_ip_count = r.InKernel() ? 1 : 0;
+  }
+  Push(std::move(entry));
+}
+
+void LiveReporter::AddDexFileOffset(const std::string& file_path, uint64_t dex_file_offset) {
+  QueueEntry entry;
+  entry.type = QueueEntry::kDexFileOffset;
+  entry.dex_file_path = file_path;
+  entry.dex_file_offset = dex_file_offset;
+  Push(std::move(entry));
+}
+
+void LiveReporter::Push(QueueEntry&& entry) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entry.type == QueueEntry::kSample) {
+      // Drop samples instead of blocking the record thread. Other records are always kept, to
+      // keep the thread tree complete.
+      if (queued_samples_ >= options_.max_queued_samples) {
+        dropped_samples_++;
+        return;
+      }
+      queued_samples_++;
+    }
+    queue_.push_back(std::move(entry));
+  }
+  queue_cond_.notify_one();
+}
+
+bool LiveReporter::Finish() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  queue_cond_.notify_one();
+  report_thread_.join();
+  return !failed_;
+}
+
+void LiveReporter::ReportThreadMain() {
+  auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(options_.interval_in_sec));
+  auto next_report_time = start_time_ + interval;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    queue_cond_.wait_until(lock, next_report_time, [&]() { return stop_ || !queue_.empty(); });
+    std::deque<QueueEntry> entries;
+    entries.swap(queue_);
+    queued_samples_ = 0;
+    bool stop = stop_;
+    lock.unlock();
+
+    UpdateDecayScale();
+    for (QueueEntry& entry : entries) {
+      ProcessEntry(entry);
+    }
+    if (stop && entries.empty()) {
+      break;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next_report_time) {
+      failed_ |= !(snapshot_fp_ ? WriteSnapshot() : WriteTextReport());
+      while (next_report_time <= now) {
+        next_report_time += interval;
+      }
+    }
+    lock.lock();
+  }
+  failed_ |= !(snapshot_fp_ ? WriteSnapshot() : WriteTextReport());
+}
+
+void LiveReporter::ProcessEntry(QueueEntry& entry) {
+  switch (entry.type) {
+    case QueueEntry::kRecord:
+      thread_tree_.Update(*entry.record);
+      break;
+    case QueueEntry::kSample:
+      ProcessSample(entry);
+      break;
+    case QueueEntry::kDexFileOffset:
+      thread_tree_.AddDexFileOffset(entry.dex_file_path, entry.dex_file_offset);
+      break;
+  }
+}
+
+void LiveReporter::ProcessSample(const QueueEntry& sample) {
+  const ThreadEntry* thread = thread_tree_.FindThreadOrNew(sample.pid, sample.tid);
+  std::vector<CallChainReportEntry> callchain =
+      callchain_report_builder_.Build(thread, sample.ips, sample.kernel_ip_count);
+  if (callchain.empty()) {
+    return;
+  }
+  EventTable& table = events_[sample.event];
+  double weight = sample.period * decay_scale_;
+  table.samples++;
+  table.total += weight;
+  sample_id_++;
+  for (size_t i = 0; i < callchain.size(); i++) {
+    key_buf_ = thread->comm;
+    key_buf_.push_back('\0');
+    key_buf_ += callchain[i].DsoName();
+    key_buf_.push_back('\0');
+    key_buf_ += callchain[i].symbol->DemangledName();
+    auto it = table.entries.find(key_buf_);
+    if (it == table.entries.end()) {
+      it = table.entries.emplace(key_buf_, Entry()).first;
+    }
+    Entry& entry = it->second;
+    if (i == 0) {
+      entry.self += weight;
+    }
+    // For recursive functions, only the frame nearest to the sampled frame is counted.
+    if (entry.last_sample_id != sample_id_) {
+      entry.last_sample_id = sample_id_;
+      entry.children += weight;
+    }
+  }
+}
+
+// Instead of decaying all weights periodically, new samples get weights growing exponentially
+// with time. The ratios between weights are the same as those of decayed weights.
+void LiveReporter::UpdateDecayScale() {
+  if (options_.half_life_in_sec == 0) {
+    return;
+  }
+  auto now = std::chrono::steady_clock::now();
+  double elapsed_in_sec = std::chrono::duration<double>(now - decay_base_time_).count();
+  decay_scale_ = exp2(elapsed_in_sec / options_.half_life_in_sec);
+  if (decay_scale_ < kMaxDecayScale) {
+    return;
+  }
+  for (EventTable& table : events_) {
+    table.total /= decay_scale_;
+    for (auto it = table.entries.begin(); it != table.entries.end();) {
+      Entry& entry = it->second;
+      entry.self /= decay_scale_;
+      entry.children /= decay_scale_;
+      if (entry.children < table.total * kMinEntryRatio) {
+        it = table.entries.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  decay_base_time_ = now;
+  decay_scale_ = 1.0;
+}
+
+std::vector<std::pair<const std::string*, const LiveReporter::Entry*>> LiveReporter::GetTopEntries(
+    const EventTable& table) const {
+  std::vector<std::pair<const std::string*, const Entry*>> entries;
+  entries.reserve(table.entries.size());
+  for (const auto& [key, entry] : table.entries) {
+    if (entry.self > 0 || options_.accumulate_callchain) {
+      entries.emplace_back(&key, &entry);
+    }
+  }
+  bool use_children = options_.accumulate_callchain;
+  auto compare = [use_children](const auto& e1, const auto& e2) {
+    double w1 = use_children ? e1.second->children : e1.second->self;
+    double w2 = use_children ? e2.second->children : e2.second->self;
+    return w1 > w2 || (w1 == w2 && *e1.first < *e2.first);
+  };
+  size_t n = std::min(entries.size(), options_.top_n);
+  std::partial_sort(entries.begin(), entries.begin() + n, entries.end(), compare);
+  entries.resize(n);
+  return entries;
+}
+
+bool LiveReporter::WriteTextReport() {
+  FILE* fp = stdout;
+  double elapsed_in_sec =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+  fprintf(fp, "Live report at %.1f s, dropped samples: %" PRIu64 "\n", elapsed_in_sec,
+          dropped_samples_.load());
+  for (const EventTable& table : events_) {
+    fprintf(fp, "Event: %s, samples: %" PRIu64 "\n", table.name.c_str(), table.samples);
+    if (options_.accumulate_callchain) {
+      fprintf(fp, "%-9s %-9s ", "Children", "Self");
+    } else {
+      fprintf(fp, "%-9s ", "Overhead");
+    }
+    fprintf(fp, "%-16s %-32s %s\n", "Command", "Shared Object", "Symbol");
+    for (const auto& [key, entry] : GetTopEntries(table)) {
+      auto percent = [&](double weight) {
+        return android::base::StringPrintf("%.2f%%",
+                                           table.total > 0 ? weight * 100 / table.total : 0.0);
+      };
+      if (options_.accumulate_callchain) {
+        fprintf(fp, "%-9s ", percent(entry->children).c_str());
+      }
+      std::vector<std::string> values = SplitKey(*key);
+      fprintf(fp, "%-9s %-16s %-32s %s\n", percent(entry->self).c_str(), values[0].c_str(),
+              values[1].c_str(), values[2].c_str());
+    }
+  }
+  fprintf(fp, "\n");
+  fflush(fp);
+  if (ferror(fp) != 0) {
+    PLOG(ERROR) << "failed to write live report";
+    return false;
+  }
+  return true;
+}
+
+bool LiveReporter::WriteSnapshot() {
+  FILE* fp = snapshot_fp_.get();
+  double elapsed_in_sec =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+  JsonWriter writer(fp);
+  writer.BeginObject();
+  writer.Key("time_in_sec");
+  writer.Double(elapsed_in_sec);
+  writer.Key("dropped_samples");
+  writer.Uint(dropped_samples_);
+  writer.Key("events");
+  writer.BeginArray();
+  for (const EventTable& table : events_) {
+    writer.BeginObject();
+    writer.Key("name");
+    writer.String(table.name);
+    writer.Key("samples");
+    writer.Uint(table.samples);
+    // Event count with decay applied.
+    writer.Key("event_count");
+    writer.Double(table.total / decay_scale_);
+    writer.Key("entries");
+    writer.BeginArray();
+    for (const auto& [key, entry] : GetTopEntries(table)) {
+      std::vector<std::string> values = SplitKey(*key);
+      writer.BeginObject();
+      writer.Key("comm");
+      writer.String(values[0]);
+      writer.Key("dso");
+      writer.String(values[1]);
+      writer.Key("symbol");
+      writer.String(values[2]);
+      writer.Key("self");
+      writer.Double(table.total > 0 ? entry->self / table.total : 0.0);
+      if (options_.accumulate_callchain) {
+        writer.Key("children");
+        writer.Double(table.total > 0 ? entry->children / table.total : 0.0);
+      }
+      writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+  fputc('\n', fp);
+  fflush(fp);
+  if (ferror(fp) != 0) {
+    PLOG(ERROR) << "failed to write live report snapshot";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace simpleperf
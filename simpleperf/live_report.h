@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "event_attr.h"
+#include "record.h"
+#include "report_utils.h"
+#include "thread_tree.h"
+
+namespace simpleperf {
+
+struct LiveReportOptions {
+  // Write a report every interval.
+  double interval_in_sec = 1.0;
+  // Max entries of each event in a report.
+  size_t top_n = 20;
+  // If not zero, weights of samples are halved every half_life_in_sec, so reports focus on
+  // recent samples. Otherwise, reports show all samples since recording started.
+  double half_life_in_sec = 0;
+  // Also aggregate children overhead using callchains in samples.
+  bool accumulate_callchain = false;
+  // If not -1, write a json snapshot per line to this fd instead of printing text reports to
+  // stdout. The fd is closed by LiveReporter.
+  int snapshot_fd = -1;
+  // Max samples waiting for the report thread. When the queue is full, new samples are dropped.
+  size_t max_queued_samples = 65536;
+};
+
+// LiveReporter aggregates samples while recording, used by `record --live-report`.
+// The record thread passes samples and records changing threads and maps. A report thread keeps
+// its own ThreadTree, symbolizes samples, aggregates them by (comm, dso, symbol) of each event,
+// and periodically writes the top entries.
+class LiveReporter {
+ public:
+  static std::unique_ptr<LiveReporter> Create(const LiveReportOptions& options,
+                                              const EventAttrIds& attrs);
+  ~LiveReporter();
+
+  // Called on the record thread. Records other than mmap, comm, fork and exit records are
+  // ignored.
+  bool AddRecord(const Record& r);
+  void AddSample(const SampleRecord& r);
+  void AddDexFileOffset(const std::string& file_path, uint64_t dex_file_offset);
+  // Process queued records, write the last report, and stop the report thread.
+  bool Finish();
+
+  uint64_t DroppedSamples() const { return dropped_samples_; }
+
+ private:
+  struct QueueEntry {
+    enum Type {
+      kRecord,
+      kSample,
+      kDexFileOffset,
+    } type;
+    // For kRecord.
+    std::unique_ptr<Record> record;
+    // For kSample.
+    pid_t pid = 0;
+    pid_t tid = 0;
+    size_t event = 0;
+    uint64_t period = 0;
+    size_t kernel_ip_count = 0;
+    std::vector<uint64_t> ips;
+    // For kDexFileOffset.
+    std::string dex_file_path;
+    uint64_t dex_file_offset = 0;
+  };
+
+  struct Entry {
+    // Weights are scaled by decay_scale_ when added. Ratios between weights in the same event are
+    // the same as the decayed ratios.
+    double self = 0;
+    double children = 0;
+    uint64_t last_sample_id = 0;
+  };
+
+  struct EventTable {
+    std::string name;
+    uint64_t samples = 0;
+    double total = 0;
+    // Keys are comm, dso path and symbol name separated by '\0'.
+    std::unordered_map<std::string, Entry> entries;
+  };
+
+  LiveReporter(const LiveReportOptions& options, const EventAttrIds& attrs, FILE* snapshot_fp);
+  void Push(QueueEntry&& entry);
+  void ReportThreadMain();
+  void ProcessEntry(QueueEntry& entry);
+  void ProcessSample(const QueueEntry& sample);
+  void UpdateDecayScale();
+  std::vector<std::pair<const std::string*, const Entry*>> GetTopEntries(
+      const EventTable& table) const;
+  bool WriteTextReport();
+  bool WriteSnapshot();
+
+  const LiveReportOptions options_;
+  const perf_event_attr attr_;
+  std::unordered_map<uint64_t, size_t> event_id_to_index_;
+  std::unique_ptr<FILE, decltype(&fclose)> snapshot_fp_;
+  std::thread report_thread_;
+  std::chrono::steady_clock::time_point start_time_;
+
+  std::mutex mutex_;
+  // Notified when entries are added to the queue, or when stopping the report thread.
+  std::condition_variable queue_cond_;
+  std::deque<QueueEntry> queue_;
+  size_t queued_samples_ = 0;
+  bool stop_ = false;
+
+  // Written by the record thread, and read by the report thread.
+  std::atomic<uint64_t> dropped_samples_ = 0;
+
+  // Only accessed by the report thread.
+  ThreadTree thread_tree_;
+  CallChainReportBuilder callchain_report_builder_;
+  std::vector<EventTable> events_;
+  uint64_t sample_id_ = 0;
+  std::string key_buf_;
+  double decay_scale_ = 1.0;
+  std::chrono::steady_clock::time_point decay_base_time_;
+  bool failed_ = false;
+};
+
+}  // namespace simpleperf
@@ -18,16 +18,20 @@
 #include "read_apk.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
+#include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 #include <ziparchive/zip_archive.h>
 #include "read_elf.h"
@@ -35,9 +39,254 @@
 
 namespace simpleperf {
 
+// Format of an ApkIndex cache file:
+//   char magic[8] = "APKINDEX";
+//   uint32_t version;
+//   uint64_t apk_size;
+//   int64_t apk_mtime_ns;
+//   uint32_t apk_path_size;
+//   char apk_path[apk_path_size];
+//   uint32_t entry_count;
+//   struct {
+//     uint64_t offset;
+//     uint64_t compressed_size;
+//     uint64_t uncompressed_size;
+//     uint8_t stored;
+//     uint32_t name_size;
+//     char name[name_size];
+//   } entries[entry_count];
+static constexpr char kApkIndexMagic[8] = {'A', 'P', 'K', 'I', 'N', 'D', 'E', 'X'};
+static constexpr uint32_t kApkIndexVersion = 1;
+
+static bool GetApkSizeAndMtime(const std::string& apk_path, uint64_t* size, int64_t* mtime_ns) {
+  struct stat st;
+  if (stat(apk_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+  *size = st.st_size;
+#if defined(__APPLE__)
+  *mtime_ns =
+      static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+  *mtime_ns = static_cast<int64_t>(st.st_mtime) * 1000000000;
+#else
+  *mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+  return true;
+}
+
+std::unique_ptr<ApkIndex> ApkIndex::Build(const std::string& apk_path) {
+  uint64_t apk_size;
+  int64_t apk_mtime_ns;
+  if (!GetApkSizeAndMtime(apk_path, &apk_size, &apk_mtime_ns)) {
+    return nullptr;
+  }
+  std::unique_ptr<ArchiveHelper> ahelper = ArchiveHelper::CreateInstance(apk_path);
+  if (!ahelper) {
+    return nullptr;
+  }
+  std::unique_ptr<ApkIndex> index(new ApkIndex(apk_path, apk_size, apk_mtime_ns));
+  bool result = ahelper->IterateEntries([&](ZipEntry& entry, const std::string& name) {
+    index->entries_.emplace_back(ApkEntry{name, static_cast<uint64_t>(entry.offset),
+                                          entry.compressed_length, entry.uncompressed_length,
+                                          entry.method == kCompressStored});
+    return true;
+  });
+  if (!result) {
+    return nullptr;
+  }
+  index->Finish();
+  return index;
+}
+
+std::unique_ptr<ApkIndex> ApkIndex::LoadFromCacheFile(const std::string& apk_path,
+                                                      const std::string& cache_path) {
+  uint64_t apk_size;
+  int64_t apk_mtime_ns;
+  std::string data;
+  if (!GetApkSizeAndMtime(apk_path, &apk_size, &apk_mtime_ns) ||
+      !android::base::ReadFileToString(cache_path, &data)) {
+    return nullptr;
+  }
+  const char* p = data.data();
+  const char* end = data.data() + data.size();
+  auto read = [&](auto& value) {
+    if (end - p < static_cast<ptrdiff_t>(sizeof(value))) {
+      return false;
+    }
+    MoveFromBinaryFormat(value, p);
+    return true;
+  };
+  auto read_string = [&](std::string& s) {
+    uint32_t size;
+    if (!read(size) || static_cast<size_t>(end - p) < size) {
+      return false;
+    }
+    s.assign(p, size);
+    p += size;
+    return true;
+  };
+  char magic[sizeof(kApkIndexMagic)];
+  uint32_t version;
+  uint64_t size;
+  int64_t mtime_ns;
+  std::string path;
+  if (!read(magic) || memcmp(magic, kApkIndexMagic, sizeof(magic)) != 0 || !read(version) ||
+      version != kApkIndexVersion || !read(size) || !read(mtime_ns) || !read_string(path)) {
+    return nullptr;
+  }
+  if (size != apk_size || mtime_ns != apk_mtime_ns || path != apk_path) {
+    // The APK has changed.
+    return nullptr;
+  }
+  std::unique_ptr<ApkIndex> index(new ApkIndex(apk_path, apk_size, apk_mtime_ns));
+  uint32_t entry_count;
+  if (!read(entry_count)) {
+    return nullptr;
+  }
+  for (uint32_t i = 0; i < entry_count; i++) {
+    ApkEntry entry;
+    uint8_t stored;
+    if (!read(entry.offset) || !read(entry.compressed_size) || !read(entry.uncompressed_size) ||
+        !read(stored) || !read_string(entry.name)) {
+      LOG(DEBUG) << "invalid apk index cache file " << cache_path;
+      return nullptr;
+    }
+    entry.stored = stored != 0;
+    index->entries_.emplace_back(std::move(entry));
+  }
+  index->Finish();
+  return index;
+}
+
+bool ApkIndex::SaveToCacheFile(const std::string& cache_path) const {
+  std::string data;
+  auto write = [&](const auto& value) {
+    data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  auto write_string = [&](const std::string& s) {
+    write(static_cast<uint32_t>(s.size()));
+    data.append(s);
+  };
+  write(kApkIndexMagic);
+  write(kApkIndexVersion);
+  write(apk_size_);
+  write(apk_mtime_ns_);
+  write_string(apk_path_);
+  write(static_cast<uint32_t>(entries_.size()));
+  for (const ApkEntry& entry : entries_) {
+    write(entry.offset);
+    write(entry.compressed_size);
+    write(entry.uncompressed_size);
+    write(static_cast<uint8_t>(entry.stored ? 1 : 0));
+    write_string(entry.name);
+  }
+  // Write to a temporary file first, so other processes never read a partial cache file.
+  std::string tmp_path = cache_path + android::base::StringPrintf(".tmp%d", getpid());
+  if (!android::base::WriteStringToFile(data, tmp_path)) {
+    PLOG(DEBUG) << "failed to write " << tmp_path;
+    return false;
+  }
+#if defined(_WIN32)
+  // rename() doesn't replace existing files on Windows. Readers check the content of cache files,
+  // so it's fine that the cache file is missing for a short time.
+  unlink(cache_path.c_str());
+#endif
+  if (rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    PLOG(DEBUG) << "failed to rename " << tmp_path;
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void ApkIndex::Finish() {
+  std::sort(entries_.begin(), entries_.end(),
+            [](const ApkEntry& e1, const ApkEntry& e2) { return e1.offset < e2.offset; });
+  for (uint32_t i = 0; i < entries_.size(); i++) {
+    if (entries_[i].stored) {
+      stored_entries_.push_back(i);
+    }
+    name_map_.emplace(entries_[i].name, i);
+  }
+}
+
+const ApkEntry* ApkIndex::FindStoredEntryByOffset(uint64_t file_offset) const {
+  // Find the last stored entry starting at or before file_offset.
+  auto it = std::upper_bound(
+      stored_entries_.begin(), stored_entries_.end(), file_offset,
+      [&](uint64_t offset, uint32_t index) { return offset < entries_[index].offset; });
+  if (it == stored_entries_.begin()) {
+    return nullptr;
+  }
+  const ApkEntry& entry = entries_[*--it];
+  if (file_offset < entry.offset + entry.uncompressed_size) {
+    return &entry;
+  }
+  return nullptr;
+}
+
+const ApkEntry* ApkIndex::FindEntryByName(const std::string& name) const {
+  auto it = name_map_.find(name);
+  return it != name_map_.end() ? &entries_[it->second] : nullptr;
+}
+
 std::unordered_map<std::string, ApkInspector::ApkNode> ApkInspector::embedded_elf_cache_;
+std::unordered_map<std::string, std::unique_ptr<ApkIndex>> ApkInspector::apk_index_cache_;
+
+static std::string& IndexCacheDir() {
+  static std::string dir = [] {
+    const char* s = getenv("SIMPLEPERF_APK_INDEX_CACHE_DIR");
+    return std::string(s != nullptr ? s : "");
+  }();
+  return dir;
+}
+
+void ApkInspector::SetIndexCacheDir(const std::string& dir) {
+  IndexCacheDir() = dir;
+}
+
+static std::string GetIndexCachePath(const std::string& dir, const std::string& apk_path) {
+  // FNV-1a hash of the APK path, which is stable across runs.
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : apk_path) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+  }
+  return android::base::StringPrintf("%s/%016" PRIx64 ".apkindex", dir.c_str(), hash);
+}
+
+const ApkIndex* ApkInspector::GetApkIndex(const std::string& apk_path) {
+  // Indexes are shared by lookups of native libraries and dex files, which may run in different
+  // threads.
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = apk_index_cache_.find(apk_path);
+  if (it != apk_index_cache_.end()) {
+    return it->second.get();
+  }
+  const std::string& cache_dir = IndexCacheDir();
+  std::unique_ptr<ApkIndex> index;
+  std::string cache_path;
+  if (!cache_dir.empty()) {
+    cache_path = GetIndexCachePath(cache_dir, apk_path);
+    index = ApkIndex::LoadFromCacheFile(apk_path, cache_path);
+  }
+  if (!index) {
+    index = ApkIndex::Build(apk_path);
+    if (index && !cache_path.empty()) {
+      index->SaveToCacheFile(cache_path);
+    }
+  }
+  const ApkIndex* result = index.get();
+  apk_index_cache_[apk_path] = std::move(index);
+  return result;
+}
+
+// Protects embedded_elf_cache_. Offline unwinders in different threads may look up the same apk.
+static std::mutex embedded_elf_cache_mutex;
 
 EmbeddedElf* ApkInspector::FindElfInApkByOffset(const std::string& apk_path, uint64_t file_offset) {
+  std::lock_guard<std::mutex> lock(embedded_elf_cache_mutex);
   // Already in cache?
   ApkNode& node = embedded_elf_cache_[apk_path];
   auto it = node.offset_map.find(file_offset);
@@ -55,6 +304,7 @@ EmbeddedElf* ApkInspector::FindElfInApkByOffset(const std::string& apk_path, uin
 
 EmbeddedElf* ApkInspector::FindElfInApkByName(const std::string& apk_path,
                                               const std::string& entry_name) {
+  std::lock_guard<std::mutex> lock(embedded_elf_cache_mutex);
   ApkNode& node = embedded_elf_cache_[apk_path];
   auto it = node.name_map.find(entry_name);
   if (it != node.name_map.end()) {
@@ -71,55 +321,39 @@ EmbeddedElf* ApkInspector::FindElfInApkByName(const std::string& apk_path,
 
 std::unique_ptr<EmbeddedElf> ApkInspector::FindElfInApkByOffsetWithoutCache(
     const std::string& apk_path, uint64_t file_offset) {
-  std::unique_ptr<ArchiveHelper> ahelper = ArchiveHelper::CreateInstance(apk_path);
-  if (!ahelper) {
+  const ApkIndex* index = GetApkIndex(apk_path);
+  if (index == nullptr) {
     return nullptr;
   }
-
-  // Iterate through the zip file. Look for a zip entry corresponding
-  // to an uncompressed blob whose range intersects with the mmap
-  // offset we're interested in.
-  bool found = false;
-  ZipEntry found_entry;
-  std::string found_entry_name;
-  bool result = ahelper->IterateEntries([&](ZipEntry& entry, const std::string& name) {
-    if (entry.method == kCompressStored && file_offset >= static_cast<uint64_t>(entry.offset) &&
-        file_offset < static_cast<uint64_t>(entry.offset) + entry.uncompressed_length) {
-      found = true;
-      found_entry = entry;
-      found_entry_name = name;
-      return false;
-    }
-    return true;
-  });
-  if (!result || !found) {
+  // Look for a zip entry corresponding to an uncompressed blob whose range intersects with the
+  // mmap offset we're interested in.
+  const ApkEntry* entry = index->FindStoredEntryByOffset(file_offset);
+  if (entry == nullptr) {
     return nullptr;
   }
 
   // We found something in the zip file at the right spot. Is it an ELF?
-  if (IsValidElfFile(ahelper->GetFd(), found_entry.offset) != ElfStatus::NO_ERROR) {
+  android::base::unique_fd fd = FileHelper::OpenReadOnly(apk_path);
+  if (fd == -1 || IsValidElfFile(fd, entry->offset) != ElfStatus::NO_ERROR) {
     // Omit files that are not ELF files.
     return nullptr;
   }
-  return std::unique_ptr<EmbeddedElf>(new EmbeddedElf(
-      apk_path, found_entry_name, found_entry.offset, found_entry.uncompressed_length));
+  return std::unique_ptr<EmbeddedElf>(
+      new EmbeddedElf(apk_path, entry->name, entry->offset, entry->uncompressed_size));
 }
 
 std::unique_ptr<EmbeddedElf> ApkInspector::FindElfInApkByNameWithoutCache(
     const std::string& apk_path, const std::string& entry_name) {
-  std::unique_ptr<ArchiveHelper> ahelper = ArchiveHelper::CreateInstance(apk_path);
-  if (!ahelper) {
-    return nullptr;
-  }
-  ZipEntry zentry;
-  if (!ahelper->FindEntry(entry_name, &zentry)) {
+  const ApkIndex* index = GetApkIndex(apk_path);
+  if (index == nullptr) {
     return nullptr;
   }
-  if (zentry.method != kCompressStored || zentry.compressed_length != zentry.uncompressed_length) {
+  const ApkEntry* entry = index->FindEntryByName(entry_name);
+  if (entry == nullptr || !entry->stored || entry->compressed_size != entry->uncompressed_size) {
     return nullptr;
   }
   return std::unique_ptr<EmbeddedElf>(
-      new EmbeddedElf(apk_path, entry_name, zentry.offset, zentry.uncompressed_length));
+      new EmbeddedElf(apk_path, entry_name, entry->offset, entry->uncompressed_size));
 }
 
 // Refer file in apk in compliance with
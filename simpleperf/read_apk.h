@@ -21,8 +21,12 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <unordered_map>
+#include <vector>
+
+#include <android-base/macros.h>
 
 #include "read_elf.h"
 
@@ -59,12 +63,57 @@ class EmbeddedElf {
   uint32_t entry_size_;     // size of ELF file in zip
 };
 
+struct ApkEntry {
+  std::string name;
+  uint64_t offset;  // offset of entry data from start of the APK file
+  uint64_t compressed_size;
+  uint64_t uncompressed_size;
+  bool stored;  // true if the entry isn't compressed
+};
+
+// Index of entries in the central directory of an APK, sorted by offset. It is built once per
+// APK, and can be saved to a cache file to skip reading the central directory in later runs.
+// A cache file is only used when the size and mtime of the APK match the ones stored in it.
+class ApkIndex {
+ public:
+  static std::unique_ptr<ApkIndex> Build(const std::string& apk_path);
+  static std::unique_ptr<ApkIndex> LoadFromCacheFile(const std::string& apk_path,
+                                                     const std::string& cache_path);
+  bool SaveToCacheFile(const std::string& cache_path) const;
+
+  const std::string& ApkPath() const { return apk_path_; }
+  const std::vector<ApkEntry>& Entries() const { return entries_; }
+  // Find the stored entry whose data contains file_offset.
+  const ApkEntry* FindStoredEntryByOffset(uint64_t file_offset) const;
+  const ApkEntry* FindEntryByName(const std::string& name) const;
+
+ private:
+  ApkIndex(const std::string& apk_path, uint64_t apk_size, int64_t apk_mtime_ns)
+      : apk_path_(apk_path), apk_size_(apk_size), apk_mtime_ns_(apk_mtime_ns) {}
+  void Finish();
+
+  const std::string apk_path_;
+  const uint64_t apk_size_;
+  const int64_t apk_mtime_ns_;
+  std::vector<ApkEntry> entries_;
+  // Indexes of stored entries in entries_, sorted by offset.
+  std::vector<uint32_t> stored_entries_;
+  std::unordered_map<std::string_view, uint32_t> name_map_;
+
+  DISALLOW_COPY_AND_ASSIGN(ApkIndex);
+};
+
 // APK inspector helper class
 class ApkInspector {
  public:
   static EmbeddedElf* FindElfInApkByOffset(const std::string& apk_path, uint64_t file_offset);
   static EmbeddedElf* FindElfInApkByName(const std::string& apk_path,
                                          const std::string& entry_name);
+  // Return the index of an APK, or nullptr if it isn't a valid zip file.
+  static const ApkIndex* GetApkIndex(const std::string& apk_path);
+  // Set the directory to save ApkIndex cache files. By default it is read from environment
+  // variable SIMPLEPERF_APK_INDEX_CACHE_DIR. If empty, indexes are only kept in memory.
+  static void SetIndexCacheDir(const std::string& dir);
 
  private:
   static std::unique_ptr<EmbeddedElf> FindElfInApkByOffsetWithoutCache(const std::string& apk_path,
@@ -79,6 +128,7 @@ class ApkInspector {
     std::unordered_map<std::string, EmbeddedElf*> name_map;
   };
   static std::unordered_map<std::string, ApkNode> embedded_elf_cache_;
+  static std::unordered_map<std::string, std::unique_ptr<ApkIndex>> apk_index_cache_;
 };
 
 std::string GetUrlInApk(const std::string& apk_path, const std::string& elf_filename);
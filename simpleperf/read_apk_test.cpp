@@ -16,7 +16,13 @@
 
 #include "read_apk.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+
 #include <gtest/gtest.h>
+
+#include <android-base/file.h>
+
 #include "get_test_data.h"
 #include "test_util.h"
 
@@ -45,6 +51,66 @@ TEST(read_apk, FindElfInApkByName) {
   ASSERT_EQ(NATIVELIB_SIZE_IN_APK, ee->entry_size());
 }
 
+TEST(read_apk, ApkIndex) {
+  std::string apk_path = GetTestData(APK_FILE);
+  std::unique_ptr<ApkIndex> index = ApkIndex::Build(apk_path);
+  ASSERT_TRUE(index);
+  const ApkEntry* entry = index->FindEntryByName(NATIVELIB_IN_APK);
+  ASSERT_TRUE(entry != nullptr);
+  ASSERT_TRUE(entry->stored);
+  ASSERT_EQ(entry->offset, NATIVELIB_OFFSET_IN_APK);
+  ASSERT_EQ(entry->uncompressed_size, NATIVELIB_SIZE_IN_APK);
+  ASSERT_EQ(index->FindStoredEntryByOffset(NATIVELIB_OFFSET_IN_APK), entry);
+  ASSERT_EQ(index->FindStoredEntryByOffset(NATIVELIB_OFFSET_IN_APK + NATIVELIB_SIZE_IN_APK - 1),
+            entry);
+  ASSERT_NE(index->FindStoredEntryByOffset(NATIVELIB_OFFSET_IN_APK + NATIVELIB_SIZE_IN_APK),
+            entry);
+  ASSERT_TRUE(index->FindStoredEntryByOffset(0) == nullptr);
+  ASSERT_TRUE(index->FindEntryByName("not_exist") == nullptr);
+  ASSERT_TRUE(ApkIndex::Build("/dev/null") == nullptr);
+}
+
+TEST(read_apk, ApkIndex_cache_file) {
+  TemporaryDir tmpdir;
+  std::string apk_path = std::string(tmpdir.path) + "/base.apk";
+  std::string data;
+  ASSERT_TRUE(android::base::ReadFileToString(GetTestData(APK_FILE), &data));
+  ASSERT_TRUE(android::base::WriteStringToFile(data, apk_path));
+  std::unique_ptr<ApkIndex> index = ApkIndex::Build(apk_path);
+  ASSERT_TRUE(index);
+  std::string cache_path = std::string(tmpdir.path) + "/base.apkindex";
+  ASSERT_TRUE(index->SaveToCacheFile(cache_path));
+
+  std::unique_ptr<ApkIndex> loaded = ApkIndex::LoadFromCacheFile(apk_path, cache_path);
+  ASSERT_TRUE(loaded);
+  ASSERT_EQ(loaded->Entries().size(), index->Entries().size());
+  for (size_t i = 0; i < index->Entries().size(); i++) {
+    const ApkEntry& e1 = index->Entries()[i];
+    const ApkEntry& e2 = loaded->Entries()[i];
+    ASSERT_EQ(e1.name, e2.name);
+    ASSERT_EQ(e1.offset, e2.offset);
+    ASSERT_EQ(e1.compressed_size, e2.compressed_size);
+    ASSERT_EQ(e1.uncompressed_size, e2.uncompressed_size);
+    ASSERT_EQ(e1.stored, e2.stored);
+  }
+  const ApkEntry* entry = loaded->FindEntryByName(NATIVELIB_IN_APK);
+  ASSERT_TRUE(entry != nullptr);
+  ASSERT_EQ(entry->offset, NATIVELIB_OFFSET_IN_APK);
+
+  // The cache file isn't used for other APKs, or after the APK is modified.
+  ASSERT_FALSE(ApkIndex::LoadFromCacheFile(GetTestData(APK_FILE), cache_path));
+#if defined(__linux__)
+  struct timespec times[2] = {{0, UTIME_OMIT}, {12345, 0}};
+  ASSERT_EQ(utimensat(AT_FDCWD, apk_path.c_str(), times, 0), 0);
+  ASSERT_FALSE(ApkIndex::LoadFromCacheFile(apk_path, cache_path));
+#endif
+  ASSERT_TRUE(android::base::WriteStringToFile(data + "x", apk_path));
+  ASSERT_FALSE(ApkIndex::LoadFromCacheFile(apk_path, cache_path));
+  // An invalid cache file isn't used.
+  ASSERT_TRUE(android::base::WriteStringToFile("APKINDEX", cache_path));
+  ASSERT_FALSE(ApkIndex::LoadFromCacheFile(apk_path, cache_path));
+}
+
 TEST(read_apk, ParseExtractedInMemoryPath) {
   std::string zip_path;
   std::string entry_name;
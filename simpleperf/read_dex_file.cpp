@@ -46,28 +46,85 @@ static void ReadSymbols(art_api::dex::DexFile& dex_file, uint64_t file_offset,
   dex_file.ForEachMethod(callback);
 }
 
+namespace {
+
+// Symbols read from one dex file. Names are stored in one buffer to avoid an allocation per
+// symbol.
+struct DexFileSymbols {
+  struct Entry {
+    size_t name_offset;
+    size_t name_size;
+    uint64_t addr;
+    uint64_t size;
+  };
+
+  bool success = false;
+  std::string error;
+  std::string names;
+  std::vector<Entry> entries;
+};
+
+}  // namespace
+
+static void ReadSymbolsFromOneDexFile(uint8_t* addr, uint64_t size, uint64_t file_offset,
+                                      DexFileSymbols* result) {
+  size_t max_file_size;
+  if (__builtin_sub_overflow(size, file_offset, &max_file_size)) {
+    return;
+  }
+  std::unique_ptr<art_api::dex::DexFile> dex_file;
+  art_api::dex::DexFile::Error error_msg =
+      art_api::dex::DexFile::Create(addr + file_offset, max_file_size, nullptr, "", &dex_file);
+  if (dex_file == nullptr) {
+    result->error = error_msg.ToString();
+    return;
+  }
+  ReadSymbols(*dex_file, file_offset, [&](DexFileSymbol* symbol) {
+    result->entries.push_back(
+        {result->names.size(), symbol->name.size(), symbol->addr, symbol->size});
+    result->names.append(symbol->name);
+  });
+  auto less_addr = [](const DexFileSymbols::Entry& e1, const DexFileSymbols::Entry& e2) {
+    return e1.addr < e2.addr;
+  };
+  if (!std::is_sorted(result->entries.begin(), result->entries.end(), less_addr)) {
+    std::stable_sort(result->entries.begin(), result->entries.end(), less_addr);
+  }
+  result->success = true;
+}
+
 bool ReadSymbolsFromDexFileInMemory(void* addr, uint64_t size, const std::string& debug_filename,
                                     const std::vector<uint64_t>& dex_file_offsets,
                                     const std::function<void(DexFileSymbol*)>& symbol_callback) {
-  for (uint64_t file_offset : dex_file_offsets) {
-    size_t max_file_size;
-    if (__builtin_sub_overflow(size, file_offset, &max_file_size)) {
-      LOG(WARNING) << "failed to read dex file symbols from " << debug_filename << "(offset "
-                   << file_offset << ")";
-      return false;
+  // An apk or vdex file can contain many dex files. Parse them in parallel, then report symbols
+  // in the order of dex_file_offsets, each dex file sorted by address. So when dex_file_offsets
+  // is sorted, symbols are reported in address order.
+  std::vector<DexFileSymbols> results(dex_file_offsets.size());
+  RunInParallel(dex_file_offsets.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      ReadSymbolsFromOneDexFile(static_cast<uint8_t*>(addr), size, dex_file_offsets[i],
+                                &results[i]);
     }
-    uint8_t* file_addr = static_cast<uint8_t*>(addr) + file_offset;
-    std::unique_ptr<art_api::dex::DexFile> dex_file;
-    art_api::dex::DexFile::Error error_msg =
-        art_api::dex::DexFile::Create(file_addr, max_file_size, nullptr, "", &dex_file);
-    if (dex_file == nullptr) {
+  });
+  // A bad dex file doesn't stop reporting symbols of other dex files.
+  bool success = true;
+  for (size_t i = 0; i < results.size(); i++) {
+    const DexFileSymbols& result = results[i];
+    if (!result.success) {
       LOG(WARNING) << "failed to read dex file symbols from " << debug_filename << "(offset "
-                   << file_offset << "): " << error_msg.ToString();
-      return false;
+                   << dex_file_offsets[i] << ")"
+                   << (result.error.empty() ? "" : ": " + result.error);
+      success = false;
+      continue;
+    }
+    for (const DexFileSymbols::Entry& entry : result.entries) {
+      DexFileSymbol symbol{std::string_view(result.names.data() + entry.name_offset,
+                                            entry.name_size),
+                           entry.addr, entry.size};
+      symbol_callback(&symbol);
     }
-    ReadSymbols(*dex_file, file_offset, symbol_callback);
   }
-  return true;
+  return success;
 }
 
 bool ReadSymbolsFromDexFile(const std::string& file_path,
@@ -35,6 +35,8 @@ struct DexFileSymbol {
   uint64_t size;
 };
 
+// Report symbols of dex files at dex_file_offsets. Return false if any dex file can't be read.
+// Symbols of the other dex files are still reported in that case.
 bool ReadSymbolsFromDexFileInMemory(void* addr, uint64_t size, const std::string& debug_filename,
                                     const std::vector<uint64_t>& dex_file_offsets,
                                     const std::function<void(DexFileSymbol*)>& symbol_callback);
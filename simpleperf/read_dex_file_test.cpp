@@ -41,3 +41,29 @@ TEST(read_dex_file, smoke) {
   ASSERT_EQ(it->len, 0x16);
   ASSERT_STREQ(it->Name(), "com.example.simpleperf.simpleperfexamplewithnative.MixActivity$1.run");
 }
+
+TEST(read_dex_file, symbols_in_address_order) {
+  std::vector<uint64_t> addrs;
+  auto symbol_callback = [&](DexFileSymbol* symbol) { addrs.push_back(symbol->addr); };
+  ASSERT_TRUE(ReadSymbolsFromDexFile(GetTestData("base.vdex"), {0x28}, symbol_callback));
+  ASSERT_EQ(12435u, addrs.size());
+  ASSERT_TRUE(std::is_sorted(addrs.begin(), addrs.end()));
+  // Reading the same dex file twice reports symbols in the order of dex file offsets.
+  addrs.clear();
+  ASSERT_TRUE(ReadSymbolsFromDexFile(GetTestData("base.vdex"), {0x28, 0x28}, symbol_callback));
+  ASSERT_EQ(12435u * 2, addrs.size());
+  ASSERT_TRUE(std::is_sorted(addrs.begin(), addrs.begin() + 12435));
+  ASSERT_TRUE(std::equal(addrs.begin(), addrs.begin() + 12435, addrs.begin() + 12435));
+}
+
+TEST(read_dex_file, bad_dex_file_offset) {
+  std::vector<uint64_t> addrs;
+  auto symbol_callback = [&](DexFileSymbol* symbol) { addrs.push_back(symbol->addr); };
+  // A bad offset fails the read, but symbols of other dex files are still reported.
+  ASSERT_FALSE(ReadSymbolsFromDexFile(GetTestData("base.vdex"), {0x1, 0x28}, symbol_callback));
+  ASSERT_EQ(12435u, addrs.size());
+  ASSERT_TRUE(std::is_sorted(addrs.begin(), addrs.end()));
+  addrs.clear();
+  ASSERT_FALSE(ReadSymbolsFromDexFile(GetTestData("base.vdex"), {0x28, 0x1}, symbol_callback));
+  ASSERT_EQ(12435u, addrs.size());
+}
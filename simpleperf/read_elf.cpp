@@ -564,8 +564,8 @@ std::unique_ptr<ElfFile> ElfFile::Open(const std::string& filename,
       *status = ElfStatus::FILE_NOT_FOUND;
       return nullptr;
     }
-    *status =
-        OpenObjectFile(filename.substr(0, colon_pos), file_start, file_end - file_start, &wrapper);
+    std::string path = JITDebugReader::GetSymFileOpenPath(filename.substr(0, colon_pos));
+    *status = OpenObjectFile(path, file_start, file_end - file_start, &wrapper);
   } else {
     *status = OpenObjectFile(filename, 0, 0, &wrapper);
   }
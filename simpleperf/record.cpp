@@ -72,6 +72,8 @@ static std::string RecordTypeToString(int record_type) {
       {SIMPLE_PERF_RECORD_CALLCHAIN, "callchain"},
       {SIMPLE_PERF_RECORD_UNWINDING_RESULT, "unwinding_result"},
       {SIMPLE_PERF_RECORD_TRACING_DATA, "tracing_data"},
+      {SIMPLE_PERF_RECORD_STACK_DELTA, "stack_delta"},
+      {SIMPLE_PERF_RECORD_SAMPLE_RATE, "sample_rate"},
   };
 
   auto it = record_type_names.find(record_type);
@@ -787,6 +789,47 @@ void SampleRecord::UpdateUserCallChain(const std::vector<uint64_t>& user_ips) {
   BuildBinaryWithNewCallChain(new_size, user_ips);
 }
 
+void SampleRecord::ReplaceCallChain(const std::vector<uint64_t>& ips) {
+  CHECK(sample_type & PERF_SAMPLE_CALLCHAIN);
+  size_t ip_nr_pos = reinterpret_cast<char*>(callchain_data.ips) - binary_ - sizeof(uint64_t);
+  size_t suffix_pos = ip_nr_pos + sizeof(uint64_t) + callchain_data.ip_nr * sizeof(uint64_t);
+  size_t suffix_size = size() - suffix_pos;
+  uint32_t new_size = ip_nr_pos + sizeof(uint64_t) + ips.size() * sizeof(uint64_t) + suffix_size;
+  char* new_binary = new char[new_size];
+  memcpy(new_binary, binary_, ip_nr_pos);
+
+  char* p = new_binary + ip_nr_pos;
+  callchain_data.ip_nr = ips.size();
+  MoveToBinaryFormat(callchain_data.ip_nr, p);
+  callchain_data.ips = reinterpret_cast<uint64_t*>(p);
+  MoveToBinaryFormat(ips.data(), ips.size(), p);
+  memcpy(p, binary_ + suffix_pos, suffix_size);
+
+  // Fields after the callchain point to the old binary. Move them to the new binary.
+  const char* old_suffix = binary_ + suffix_pos;
+  auto move_to_new_binary = [&](auto*& ptr) {
+    using T = std::remove_reference_t<decltype(*ptr)>;
+    ptr = reinterpret_cast<T*>(p + (reinterpret_cast<const char*>(ptr) - old_suffix));
+  };
+  if ((sample_type & PERF_SAMPLE_RAW) && raw_data.size > 0) {
+    move_to_new_binary(raw_data.data);
+  }
+  if ((sample_type & PERF_SAMPLE_BRANCH_STACK) && branch_stack_data.stack_nr > 0) {
+    move_to_new_binary(branch_stack_data.stack);
+  }
+  if ((sample_type & PERF_SAMPLE_REGS_USER) && regs_user_data.reg_nr > 0) {
+    move_to_new_binary(regs_user_data.regs);
+  }
+  if ((sample_type & PERF_SAMPLE_STACK_USER) && stack_user_data.size > 0) {
+    move_to_new_binary(stack_user_data.data);
+  }
+
+  p = new_binary;
+  SetSize(new_size);
+  MoveToBinaryFormat(header, p);
+  UpdateBinary(new_binary);
+}
+
 void SampleRecord::BuildBinaryWithNewCallChain(uint32_t new_size,
                                                const std::vector<uint64_t>& ips) {
   size_t callchain_pos = reinterpret_cast<char*>(callchain_data.ips) - binary_ - sizeof(uint64_t);
@@ -846,6 +889,63 @@ void SampleRecord::BuildBinaryWithNewCallChain(uint32_t new_size,
   }
 }
 
+bool SampleRecord::IsUserStackAtEnd() const {
+  if (!(sample_type & PERF_SAMPLE_STACK_USER)) {
+    return false;
+  }
+  // PERF_SAMPLE_IDENTIFIER is placed at the start of a sample. Other sample types with a higher
+  // bit are placed after the user stack.
+  uint64_t types_after_stack = ~((PERF_SAMPLE_STACK_USER << 1) - 1) & ~PERF_SAMPLE_IDENTIFIER;
+  return (sample_type & types_after_stack) == 0;
+}
+
+void SampleRecord::ReplaceUserStack(const char* data, uint64_t stack_size,
+                                    uint64_t dyn_stack_size) {
+  uint32_t old_stack_field_size = stack_user_data.size == 0
+                                      ? sizeof(uint64_t)
+                                      : (stack_user_data.size + 2 * sizeof(uint64_t));
+  uint32_t new_stack_field_size =
+      stack_size == 0 ? sizeof(uint64_t) : (stack_size + 2 * sizeof(uint64_t));
+  CHECK_GE(size(), header_size() + old_stack_field_size);
+  uint32_t stack_pos = size() - old_stack_field_size;
+  uint32_t new_size = stack_pos + new_stack_field_size;
+  char* new_binary = new char[new_size];
+  memcpy(new_binary, binary_, stack_pos);
+
+  // Fields before the user stack point to the old binary. Move them to the new binary.
+  auto move_to_new_binary = [&](auto*& ptr) {
+    using T = std::remove_reference_t<decltype(*ptr)>;
+    ptr = reinterpret_cast<T*>(new_binary + (reinterpret_cast<const char*>(ptr) - binary_));
+  };
+  if (sample_type & PERF_SAMPLE_CALLCHAIN) {
+    move_to_new_binary(callchain_data.ips);
+  }
+  if ((sample_type & PERF_SAMPLE_RAW) && raw_data.size > 0) {
+    move_to_new_binary(raw_data.data);
+  }
+  if ((sample_type & PERF_SAMPLE_BRANCH_STACK) && branch_stack_data.stack_nr > 0) {
+    move_to_new_binary(branch_stack_data.stack);
+  }
+  if ((sample_type & PERF_SAMPLE_REGS_USER) && regs_user_data.reg_nr > 0) {
+    move_to_new_binary(regs_user_data.regs);
+  }
+
+  char* p = new_binary;
+  SetSize(new_size);
+  MoveToBinaryFormat(header, p);
+  p = new_binary + stack_pos;
+  stack_user_data.size = stack_size;
+  stack_user_data.dyn_size = stack_size == 0 ? 0 : dyn_stack_size;
+  MoveToBinaryFormat(stack_user_data.size, p);
+  if (stack_size > 0) {
+    MoveToBinaryFormat(data, stack_size, p);
+    stack_user_data.data = p - stack_size;
+    MoveToBinaryFormat(stack_user_data.dyn_size, p);
+  }
+  CHECK_EQ(p, new_binary + new_size);
+  UpdateBinary(new_binary);
+}
+
 void SampleRecord::DumpData(size_t indent) const {
   PrintIndented(indent, "sample_type: 0x%" PRIx64 "\n", sample_type);
   if (sample_type & PERF_SAMPLE_IP) {
@@ -1603,6 +1703,89 @@ void UnwindingResultRecord::DumpData(size_t indent) const {
   }
 }
 
+StackDeltaRecord::StackDeltaRecord(uint32_t pid, uint32_t tid, uint64_t stack_addr,
+                                   uint64_t stack_size, uint64_t dyn_stack_size,
+                                   uint64_t block_size, const std::vector<uint64_t>& reused_blocks) {
+  SetTypeAndMisc(SIMPLE_PERF_RECORD_STACK_DELTA, 0);
+  this->pid = pid;
+  this->tid = tid;
+  this->stack_addr = stack_addr;
+  this->stack_size = stack_size;
+  this->dyn_stack_size = dyn_stack_size;
+  this->block_size = block_size;
+  this->reused_blocks_nr = reused_blocks.size();
+  SetSize(header_size() + (6 + reused_blocks.size()) * sizeof(uint64_t));
+  char* new_binary = new char[size()];
+  char* p = new_binary;
+  MoveToBinaryFormat(header, p);
+  MoveToBinaryFormat(this->pid, p);
+  MoveToBinaryFormat(this->tid, p);
+  MoveToBinaryFormat(this->stack_addr, p);
+  MoveToBinaryFormat(this->stack_size, p);
+  MoveToBinaryFormat(this->dyn_stack_size, p);
+  MoveToBinaryFormat(this->block_size, p);
+  MoveToBinaryFormat(this->reused_blocks_nr, p);
+  this->reused_blocks = reinterpret_cast<uint64_t*>(p);
+  MoveToBinaryFormat(reused_blocks.data(), reused_blocks.size(), p);
+  UpdateBinary(new_binary);
+}
+
+bool StackDeltaRecord::Parse(const perf_event_attr&, char* p, char* end) {
+  if (!ParseHeader(p, end)) {
+    return false;
+  }
+  CHECK_SIZE_U64(p, end, 6);
+  MoveFromBinaryFormat(pid, p);
+  MoveFromBinaryFormat(tid, p);
+  MoveFromBinaryFormat(stack_addr, p);
+  MoveFromBinaryFormat(stack_size, p);
+  MoveFromBinaryFormat(dyn_stack_size, p);
+  MoveFromBinaryFormat(block_size, p);
+  MoveFromBinaryFormat(reused_blocks_nr, p);
+  CHECK_SIZE_U64(p, end, reused_blocks_nr);
+  reused_blocks = reinterpret_cast<uint64_t*>(p);
+  p += reused_blocks_nr * sizeof(uint64_t);
+  return p == end;
+}
+
+void StackDeltaRecord::DumpData(size_t indent) const {
+  PrintIndented(indent, "pid %u, tid %u\n", pid, tid);
+  PrintIndented(indent, "stack_addr 0x%" PRIx64 ", stack_size %" PRIu64 ", dyn_stack_size %" PRIu64
+                "\n", stack_addr, stack_size, dyn_stack_size);
+  PrintIndented(indent, "block_size %" PRIu64 "\n", block_size);
+  for (uint64_t i = 0; i < reused_blocks_nr; i++) {
+    PrintIndented(indent, "reused_blocks[%" PRIu64 "] 0x%" PRIx64 "\n", i, reused_blocks[i]);
+  }
+}
+
+SampleRateRecord::SampleRateRecord(uint64_t time, uint64_t divisor) {
+  SetTypeAndMisc(SIMPLE_PERF_RECORD_SAMPLE_RATE, 0);
+  this->time = time;
+  this->divisor = divisor;
+  SetSize(header_size() + 2 * sizeof(uint64_t));
+  char* new_binary = new char[size()];
+  char* p = new_binary;
+  MoveToBinaryFormat(header, p);
+  MoveToBinaryFormat(time, p);
+  MoveToBinaryFormat(divisor, p);
+  UpdateBinary(new_binary);
+}
+
+bool SampleRateRecord::Parse(const perf_event_attr&, char* p, char* end) {
+  if (!ParseHeader(p, end)) {
+    return false;
+  }
+  CHECK_SIZE_U64(p, end, 2);
+  MoveFromBinaryFormat(time, p);
+  MoveFromBinaryFormat(divisor, p);
+  return p == end;
+}
+
+void SampleRateRecord::DumpData(size_t indent) const {
+  PrintIndented(indent, "time %" PRIu64 "\n", time);
+  PrintIndented(indent, "divisor %" PRIu64 "\n", divisor);
+}
+
 bool UnknownRecord::Parse(const perf_event_attr&, char* p, char* end) {
   if (!ParseHeader(p, end)) {
     return false;
@@ -1677,6 +1860,12 @@ std::unique_ptr<Record> ReadRecordFromBuffer(const perf_event_attr& attr, uint32
     case SIMPLE_PERF_RECORD_TRACING_DATA:
       r.reset(new TracingDataRecord);
       break;
+    case SIMPLE_PERF_RECORD_STACK_DELTA:
+      r.reset(new StackDeltaRecord);
+      break;
+    case SIMPLE_PERF_RECORD_SAMPLE_RATE:
+      r.reset(new SampleRateRecord);
+      break;
     default:
       r.reset(new UnknownRecord);
       break;
@@ -56,6 +56,8 @@ enum user_record_type {
   SIMPLE_PERF_RECORD_CALLCHAIN,
   SIMPLE_PERF_RECORD_UNWINDING_RESULT,
   SIMPLE_PERF_RECORD_TRACING_DATA,
+  SIMPLE_PERF_RECORD_STACK_DELTA,
+  SIMPLE_PERF_RECORD_SAMPLE_RATE,
 };
 
 // perf_event_header uses u16 to store record size. However, that is not
@@ -415,6 +417,8 @@ struct SampleRecord : public Record {
   bool ExcludeKernelCallChain();
   bool HasUserCallChain() const;
   void UpdateUserCallChain(const std::vector<uint64_t>& user_ips);
+  // Replace the whole callchain with ips.
+  void ReplaceCallChain(const std::vector<uint64_t>& ips);
 
   uint64_t Timestamp() const override;
   uint32_t Cpu() const override;
@@ -427,6 +431,10 @@ struct SampleRecord : public Record {
 
   void AdjustCallChainGeneratedByKernel();
   std::vector<uint64_t> GetCallChain(size_t* kernel_ip_count) const;
+  // Return true if the user stack is the last field in the sample, which is needed by
+  // ReplaceUserStack().
+  bool IsUserStackAtEnd() const;
+  void ReplaceUserStack(const char* data, uint64_t stack_size, uint64_t dyn_stack_size);
 
  protected:
   void BuildBinaryWithNewCallChain(uint32_t new_size, const std::vector<uint64_t>& ips);
@@ -671,6 +679,54 @@ struct UnwindingResultRecord : public Record {
   void DumpData(size_t indent) const override;
 };
 
+// StackDeltaRecord is written right before a SampleRecord whose user stack is delta encoded
+// against the last encoded user stack of the same thread. The user stack [stack_addr,
+// stack_addr + stack_size) is split into blocks aligned to block_size by address. Blocks marked
+// in reused_blocks have the same content as in the last user stack, and are removed from the
+// sample. Other blocks are kept in the sample in address order.
+struct StackDeltaRecord : public Record {
+  uint32_t pid;
+  uint32_t tid;
+  uint64_t stack_addr;
+  uint64_t stack_size;
+  uint64_t dyn_stack_size;
+  uint64_t block_size;
+  uint64_t reused_blocks_nr;  // Size of the reused_blocks bitmap, in uint64_t.
+  const uint64_t* reused_blocks;
+
+  StackDeltaRecord() {}
+  StackDeltaRecord(uint32_t pid, uint32_t tid, uint64_t stack_addr, uint64_t stack_size,
+                   uint64_t dyn_stack_size, uint64_t block_size,
+                   const std::vector<uint64_t>& reused_blocks);
+
+  bool Parse(const perf_event_attr& attr, char* p, char* end) override;
+  bool IsBlockReused(size_t block_index) const {
+    size_t word = block_index / 64;
+    return word < reused_blocks_nr && (reused_blocks[word] >> (block_index % 64)) & 1;
+  }
+
+ protected:
+  void DumpData(size_t indent) const override;
+};
+
+// SampleRateRecord is written when `record --adaptive-sampling` scales sample rates of sampling
+// events (except tracepoint events and events with sample period 1) to 1 / divisor of the
+// requested rates. Samples carry the period used by the kernel, so they are weighted correctly in
+// reports without looking at this record.
+struct SampleRateRecord : public Record {
+  uint64_t time;
+  uint64_t divisor;
+
+  SampleRateRecord() {}
+  SampleRateRecord(uint64_t time, uint64_t divisor);
+
+  bool Parse(const perf_event_attr& attr, char* p, char* end) override;
+  uint64_t Timestamp() const override { return time; }
+
+ protected:
+  void DumpData(size_t indent) const override;
+};
+
 // UnknownRecord is used for unknown record types, it makes sure all unknown
 // records are not changed when modifying perf.data.
 struct UnknownRecord : public Record {
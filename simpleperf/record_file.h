@@ -29,6 +29,8 @@
 
 #include <android-base/macros.h>
 
+#include "CallChainDictionary.h"
+#include "UserStackDelta.h"
 #include "dso.h"
 #include "event_attr.h"
 #include "event_type.h"
@@ -186,6 +188,15 @@ class RecordFileReader {
   std::string GetClockId();
   std::optional<DebugUnwindFeature> ReadDebugUnwindFeature();
 
+  // Return the dictionary in callchain_nodes feature section, or nullptr if not available.
+  const CallChainDictionary* GetCallChainDictionary() const { return callchain_dict_.get(); }
+  // Callchains interned by `simpleperf record --intern-callchains` are expanded by ReadRecord()
+  // by default. Consumers handling node ids can disable it, and use GetCallChainDictionary().
+  void SetExpandInternedCallChains(bool enable) { expand_interned_callchains_ = enable; }
+  // User stacks recorded by `simpleperf record --delta-encode-stack` are decoded by ReadRecord().
+  // The encoding is found in the meta info feature. Files without features can set it here.
+  void SetUserStackDeltaEncoded(bool encoded) { user_stack_delta_encoded_ = encoded; }
+
   bool LoadBuildIdAndFileFeatures(ThreadTree& thread_tree);
 
   // Read aux data into buf.
@@ -211,10 +222,12 @@ class RecordFileReader {
   bool ReadFileV1Feature(uint64_t& read_pos, uint64_t max_size, FileFeature& file);
   bool ReadFileV2Feature(uint64_t& read_pos, uint64_t max_size, FileFeature& file);
   bool ReadMetaInfoFeature();
+  bool ReadCallChainNodesFeature();
   void UseRecordingEnvironment();
   std::unique_ptr<Record> ReadRecord();
   bool Read(void* buf, size_t len);
   void ProcessEventIdRecord(const EventIdRecord& r);
+  bool DecodeUserStack(std::unique_ptr<Record>& record);
   bool BuildAuxDataLocation();
 
   const std::string filename_;
@@ -230,6 +243,12 @@ class RecordFileReader {
   size_t event_id_reverse_pos_in_non_sample_records_;
 
   uint64_t read_record_size_;
+  bool user_stack_delta_encoded_ = false;
+  // Created when starting to read a delta encoded file, or when meeting the first stack delta
+  // record.
+  std::unique_ptr<UserStackDeltaDecoder> stack_delta_decoder_;
+  std::unique_ptr<CallChainDictionary> callchain_dict_;
+  bool expand_interned_callchains_ = true;
 
   std::unordered_map<std::string, std::string> meta_info_;
   std::unique_ptr<ScopedCurrentArch> scoped_arch_;
@@ -85,6 +85,18 @@ file2 feature section (used to replace file feature section):
 
 etm_branch_list feature section:
   ETMBranchList etm_branch_list;  // from etm_branch_list.proto
+
+callchain_nodes feature section (generated by `simpleperf record --intern-callchains`):
+  uint64_t node_count;
+  callchain_node nodes[node_count];  // node ids start from 1. Node 0 is the root.
+
+  struct callchain_node {
+    uint64_t ip;
+    uint32_t parent_id;  // less than the id of the node
+  };
+
+  The callchain of each sample is replaced by {PERF_CONTEXT_CALLCHAIN_NODE, leaf_node_id}.
+  The original callchain is the list of ips from the leaf node up to the root.
 */
 
 namespace simpleperf {
@@ -120,6 +132,7 @@ enum {
   FEAT_DEBUG_UNWIND_FILE,
   FEAT_FILE2,
   FEAT_ETM_BRANCH_LIST,
+  FEAT_CALLCHAIN_NODES,
   FEAT_MAX_NUM = 256,
 };
 
@@ -61,6 +61,7 @@ static const std::map<int, std::string> feature_name_map = {
     {FEAT_DEBUG_UNWIND_FILE, "debug_unwind_file"},
     {FEAT_FILE2, "file2"},
     {FEAT_ETM_BRANCH_LIST, "etm_branch_list"},
+    {FEAT_CALLCHAIN_NODES, "callchain_nodes"},
 };
 
 std::string GetFeatureName(int feature_id) {
@@ -88,7 +89,8 @@ std::unique_ptr<RecordFileReader> RecordFileReader::CreateInstance(const std::st
   }
   auto reader = std::unique_ptr<RecordFileReader>(new RecordFileReader(filename, fp));
   if (!reader->ReadHeader() || !reader->ReadAttrSection() ||
-      !reader->ReadFeatureSectionDescriptors() || !reader->ReadMetaInfoFeature()) {
+      !reader->ReadFeatureSectionDescriptors() || !reader->ReadMetaInfoFeature() ||
+      !reader->ReadCallChainNodesFeature()) {
     return nullptr;
   }
   reader->UseRecordingEnvironment();
@@ -284,9 +286,13 @@ bool RecordFileReader::ReadRecord(std::unique_ptr<Record>& record) {
       PLOG(ERROR) << "fseek() failed";
       return false;
     }
+    stack_delta_decoder_.reset();
+    if (user_stack_delta_encoded_) {
+      stack_delta_decoder_.reset(new UserStackDeltaDecoder);
+    }
   }
   record = nullptr;
-  if (read_record_size_ < header_.data.size) {
+  while (read_record_size_ < header_.data.size) {
     record = ReadRecord();
     if (record == nullptr) {
       return false;
@@ -294,6 +300,36 @@ bool RecordFileReader::ReadRecord(std::unique_ptr<Record>& record) {
     if (record->type() == SIMPLE_PERF_RECORD_EVENT_ID) {
       ProcessEventIdRecord(*static_cast<EventIdRecord*>(record.get()));
     }
+    if (!DecodeUserStack(record)) {
+      return false;
+    }
+    if (record) {
+      if (callchain_dict_ && expand_interned_callchains_ &&
+          record->type() == PERF_RECORD_SAMPLE &&
+          !callchain_dict_->DecodeSample(*static_cast<SampleRecord*>(record.get()))) {
+        return false;
+      }
+      break;
+    }
+  }
+  return true;
+}
+
+bool RecordFileReader::DecodeUserStack(std::unique_ptr<Record>& record) {
+  if (record->type() == SIMPLE_PERF_RECORD_STACK_DELTA) {
+    if (!stack_delta_decoder_) {
+      stack_delta_decoder_.reset(new UserStackDeltaDecoder);
+    }
+    std::unique_ptr<StackDeltaRecord> delta(static_cast<StackDeltaRecord*>(record.release()));
+    return stack_delta_decoder_->AddStackDelta(std::move(delta));
+  }
+  if (stack_delta_decoder_) {
+    if (record->type() == PERF_RECORD_SAMPLE) {
+      return stack_delta_decoder_->Decode(*static_cast<SampleRecord*>(record.get()));
+    }
+    if (record->type() == PERF_RECORD_EXIT) {
+      stack_delta_decoder_->RemoveThread(static_cast<ExitRecord*>(record.get())->data->tid);
+    }
   }
   return true;
 }
@@ -706,6 +742,24 @@ bool RecordFileReader::ReadMetaInfoFeature() {
       meta_info_[&s[key_start]] = &s[value_start];
       key_start = value_end + 1;
     }
+    if (auto it = meta_info_.find("delta_encode_stack"); it != meta_info_.end()) {
+      user_stack_delta_encoded_ = it->second == "true";
+    }
+  }
+  return true;
+}
+
+bool RecordFileReader::ReadCallChainNodesFeature() {
+  if (feature_section_descriptors_.count(FEAT_CALLCHAIN_NODES)) {
+    std::vector<char> buf;
+    if (!ReadFeatureSection(FEAT_CALLCHAIN_NODES, &buf)) {
+      return false;
+    }
+    callchain_dict_.reset(new CallChainDictionary);
+    if (!callchain_dict_->FromBinary(buf.data(), buf.size())) {
+      LOG(ERROR) << "failed to read callchain nodes in " << filename_;
+      return false;
+    }
   }
   return true;
 }
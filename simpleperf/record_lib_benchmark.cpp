@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "include/simpleperf.h"
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using namespace simpleperf;
+
+enum ReadCountersTarget {
+  kCurrentThread,
+  kCurrentProcess,
+};
+
+// Read cpu-cycles and instructions counters of the current thread or process, and report the
+// time per ReadCounters() call.
+static void BM_ReadCounters(benchmark::State& state) {
+  std::unique_ptr<PerfEventSet> perf(
+      PerfEventSet::CreateInstance(PerfEventSet::Type::kPerfForCounting));
+  if (!perf || !perf->AddEvent("cpu-cycles") || !perf->AddEvent("instructions")) {
+    state.SkipWithError("failed to add events");
+    return;
+  }
+  bool monitored = (state.range(0) == kCurrentThread) ? perf->MonitorCurrentThread()
+                                                      : perf->MonitorCurrentProcess();
+  if (!monitored || !perf->StartCounters()) {
+    state.SkipWithError("failed to start counters");
+    return;
+  }
+  std::vector<Counter> counters(2);
+  for (auto _ : state) {
+    if (!perf->ReadCounters(&counters)) {
+      state.SkipWithError("failed to read counters");
+      break;
+    }
+    benchmark::DoNotOptimize(counters.data());
+  }
+  perf->StopCounters();
+}
+BENCHMARK(BM_ReadCounters)->ArgName("process")->Arg(kCurrentThread)->Arg(kCurrentProcess);
@@ -20,6 +20,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <android-base/logging.h>
@@ -117,6 +118,7 @@ class PerfEventSetForCounting : public PerfEventSetImpl {
   bool CreateEventSelectionSet();
   void InitAccumulatedCounters();
   bool ReadRawCounters(std::vector<Counter>* counters);
+  bool ReadSelfCounters(std::vector<Counter>* counters);
   // Add counter b to a.
   void AddCounter(Counter& a, const Counter& b);
   // Sub counter b from a.
@@ -129,6 +131,10 @@ class PerfEventSetForCounting : public PerfEventSetImpl {
   // The accumulated counters of counting periods, excluding
   // the last one.
   std::vector<Counter> accumulated_counters_;
+  // When only the current thread is monitored, counters are read in user space if possible.
+  bool read_self_counters_ = false;
+  std::thread::id self_thread_id_;
+  std::vector<PerfCounter> self_counters_;
 };
 
 bool PerfEventSetForCounting::CreateEventSelectionSet() {
@@ -151,9 +157,17 @@ bool PerfEventSetForCounting::CreateEventSelectionSet() {
     }
     set->AddMonitoredThreads(threads_);
   }
+  bool monitor_self = !whole_process_ && threads_.size() == 1 && *threads_.begin() == gettid();
+  if (monitor_self) {
+    set->EnableUserSpaceCounterRead();
+  }
   if (!set->OpenEventFiles({-1})) {
     return false;
   }
+  if (monitor_self && set->CreateCounterPages()) {
+    read_self_counters_ = true;
+    self_thread_id_ = std::this_thread::get_id();
+  }
   event_selection_set_ = std::move(set);
   return true;
 }
@@ -171,6 +185,9 @@ void PerfEventSetForCounting::InitAccumulatedCounters() {
 
 bool PerfEventSetForCounting::ReadRawCounters(std::vector<Counter>* counters) {
   CHECK(event_selection_set_);
+  if (read_self_counters_ && std::this_thread::get_id() == self_thread_id_) {
+    return ReadSelfCounters(counters);
+  }
   std::vector<CountersInfo> s;
   if (!event_selection_set_->ReadCounters(&s)) {
     return false;
@@ -196,6 +213,23 @@ bool PerfEventSetForCounting::ReadRawCounters(std::vector<Counter>* counters) {
   return true;
 }
 
+bool PerfEventSetForCounting::ReadSelfCounters(std::vector<Counter>* counters) {
+  if (!event_selection_set_->ReadSelfCounters(&self_counters_)) {
+    return false;
+  }
+  CHECK_EQ(self_counters_.size(), event_names_.size());
+  counters->resize(self_counters_.size());
+  for (size_t i = 0; i < self_counters_.size(); ++i) {
+    Counter& counter = (*counters)[i];
+    // Assigning a string of the same size doesn't allocate memory.
+    counter.event = event_names_[i];
+    counter.value = self_counters_[i].value;
+    counter.time_enabled_in_ns = self_counters_[i].time_enabled;
+    counter.time_running_in_ns = self_counters_[i].time_running;
+  }
+  return true;
+}
+
 void PerfEventSetForCounting::AddCounter(Counter& a, const Counter& b) {
   a.value += b.value;
   a.time_enabled_in_ns += b.time_enabled_in_ns;
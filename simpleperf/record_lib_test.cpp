@@ -141,3 +141,60 @@ TEST(counter, no_change_after_stop) {
   ASSERT_EQ(counters[0].time_enabled_in_ns, prev_counter.time_enabled_in_ns);
   ASSERT_EQ(counters[0].time_running_in_ns, prev_counter.time_running_in_ns);
 }
+
+TEST(counter, read_current_thread_counters) {
+  std::unique_ptr<PerfEventSet> perf(
+      PerfEventSet::CreateInstance(PerfEventSet::Type::kPerfForCounting));
+  ASSERT_TRUE(perf);
+  ASSERT_TRUE(perf->AddEvent("cpu-cycles"));
+  ASSERT_TRUE(perf->AddEvent("instructions"));
+  ASSERT_TRUE(perf->MonitorCurrentThread());
+  ASSERT_TRUE(perf->StartCounters());
+  std::vector<Counter> counters;
+  std::vector<Counter> prev_counters;
+  for (size_t i = 0; i < 3; ++i) {
+    DoSomeWork();
+    ASSERT_TRUE(perf->ReadCounters(&counters));
+    ASSERT_EQ(counters.size(), 2u);
+    ASSERT_EQ(counters[0].event, "cpu-cycles");
+    ASSERT_EQ(counters[1].event, "instructions");
+    for (size_t j = 0; j < counters.size(); ++j) {
+      ASSERT_GT(counters[j].value, 0u);
+      ASSERT_LE(counters[j].time_running_in_ns, counters[j].time_enabled_in_ns);
+      if (i > 0) {
+        ASSERT_GT(counters[j].value, prev_counters[j].value);
+        ASSERT_GT(counters[j].time_enabled_in_ns, prev_counters[j].time_enabled_in_ns);
+      }
+    }
+    prev_counters = counters;
+  }
+  ASSERT_TRUE(perf->StopCounters());
+}
+
+TEST(counter, read_counters_monotonic) {
+  auto test_function = [](std::function<void(PerfEventSet*)> set_target_func) {
+    std::unique_ptr<PerfEventSet> perf(
+        PerfEventSet::CreateInstance(PerfEventSet::Type::kPerfForCounting));
+    ASSERT_TRUE(perf);
+    ASSERT_TRUE(perf->AddEvent("cpu-cycles"));
+    ASSERT_TRUE(perf->AddEvent("instructions"));
+    set_target_func(perf.get());
+    ASSERT_TRUE(perf->StartCounters());
+    // Counters read in user space never go backwards.
+    std::vector<Counter> counters;
+    std::vector<Counter> prev_counters;
+    for (size_t i = 0; i < 1000; ++i) {
+      ASSERT_TRUE(perf->ReadCounters(&counters));
+      ASSERT_EQ(counters.size(), 2u);
+      for (size_t j = 0; i > 0 && j < counters.size(); ++j) {
+        ASSERT_GE(counters[j].value, prev_counters[j].value);
+        ASSERT_GE(counters[j].time_enabled_in_ns, prev_counters[j].time_enabled_in_ns);
+        ASSERT_GE(counters[j].time_running_in_ns, prev_counters[j].time_running_in_ns);
+      }
+      prev_counters = counters;
+    }
+    ASSERT_TRUE(perf->StopCounters());
+  };
+  test_function([](PerfEventSet* perf) { ASSERT_TRUE(perf->MonitorCurrentThread()); });
+  test_function([](PerfEventSet* perf) { ASSERT_TRUE(perf->MonitorCurrentProcess()); });
+}
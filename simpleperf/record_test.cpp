@@ -140,6 +140,24 @@ TEST_F(RecordTest, SampleRecord_UpdateUserCallChain) {
   CheckRecordEqual(r, expected);
 }
 
+TEST_F(RecordTest, SampleRecord_ReplaceCallChain) {
+  event_attr.sample_type |= PERF_SAMPLE_CALLCHAIN | PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER;
+  std::vector<char> stack(64);
+  for (size_t i = 0; i < stack.size(); i++) {
+    stack[i] = static_cast<char>(i);
+  }
+  SampleRecord r(event_attr, 0, 1, 2, 3, 4, 5, 6, {}, {1, PERF_CONTEXT_USER, 2, 3}, stack, 10);
+  r.ReplaceCallChain({7, 8});
+  CheckRecordMatchBinary(r);
+  SampleRecord expected(event_attr, 0, 1, 2, 3, 4, 5, 6, {}, {7, 8}, stack, 10);
+  CheckRecordEqual(r, expected);
+  r.ReplaceCallChain({1, PERF_CONTEXT_USER, 2, 3, 4, 5});
+  CheckRecordMatchBinary(r);
+  SampleRecord expected2(event_attr, 0, 1, 2, 3, 4, 5, 6, {}, {1, PERF_CONTEXT_USER, 2, 3, 4, 5},
+                         stack, 10);
+  CheckRecordEqual(r, expected2);
+}
+
 TEST_F(RecordTest, SampleRecord_AdjustCallChainGeneratedByKernel) {
   event_attr.sample_type |= PERF_SAMPLE_CALLCHAIN | PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER;
   SampleRecord r(event_attr, 0, 1, 2, 3, 4, 5, 6, {}, {1, 5, 0, PERF_CONTEXT_USER, 6, 0}, {}, 0);
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+
+#include "command.h"
+#include "record.h"
+#include "record_file.h"
+
+using namespace simpleperf;
+
+// A recording generated once by the synthesize command, and shared by the benchmarks below.
+// 10 processes with 4 threads each, callchains of geometric depth and some JIT map churn.
+static const char* GetSynthesizedRecording() {
+  static TemporaryFile tmpfile;
+  static bool generated = false;
+  if (!generated) {
+    close(tmpfile.release());
+    CHECK(CreateCommandInstance("synthesize")
+              ->Run({"-o", tmpfile.path, "--samples", "100000", "--processes", "10",
+                     "--threads-per-process", "4", "--callchain-depth", "geometric:16",
+                     "--map-churn", "1000"}));
+    generated = true;
+  }
+  return tmpfile.path;
+}
+
+// Measures reading and parsing all records in the recording.
+static void BM_ReadRecords(benchmark::State& state) {
+  const char* path = GetSynthesizedRecording();
+  uint64_t samples = 0;
+  for (auto _ : state) {
+    std::unique_ptr<RecordFileReader> reader = RecordFileReader::CreateInstance(path);
+    CHECK(reader);
+    CHECK(reader->ReadDataSection([&](std::unique_ptr<Record> r) {
+      if (r->type() == PERF_RECORD_SAMPLE) {
+        samples++;
+      }
+      return true;
+    }));
+  }
+  state.SetItemsProcessed(samples);
+}
+BENCHMARK(BM_ReadRecords)->Unit(benchmark::kMillisecond);
+
+// Measures the report command on the recording, without (0) or with (1) call graphs.
+static void BM_Report(benchmark::State& state) {
+  const char* path = GetSynthesizedRecording();
+  TemporaryFile output;
+  std::vector<std::string> args = {"-i", path, "-o", output.path, "--sort",
+                                   "comm,pid,tid,dso,symbol"};
+  if (state.range(0) != 0) {
+    args.push_back("-g");
+  }
+  for (auto _ : state) {
+    CHECK(CreateCommandInstance("report")->Run(args));
+  }
+}
+BENCHMARK(BM_Report)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
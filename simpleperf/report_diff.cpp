@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "report_diff.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+
+#include <android-base/logging.h>
+#include <android-base/stringprintf.h>
+
+#include "SampleDisplayer.h"
+#include "dso.h"
+
+namespace simpleperf {
+
+namespace {
+
+double Percent(uint64_t value, uint64_t total) {
+  return total != 0 ? 100.0 * value / total : 0.0;
+}
+
+// Return the index-th value in a key of values separated by '\0'.
+std::string GetKeyValue(const std::string& key, size_t index) {
+  size_t start = 0;
+  for (size_t i = 0; i < index; i++) {
+    start = key.find('\0', start);
+    if (start == std::string::npos) {
+      return "";
+    }
+    start++;
+  }
+  size_t end = key.find('\0', start);
+  return key.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+}  // namespace
+
+bool ReportDiffer::IsSortKeySupported(const std::string& key) {
+  return key == "comm" || key == "pid" || key == "tid" || key == "dso" || key == "symbol";
+}
+
+double ReportDiffer::ZScore(uint64_t count1, uint64_t total1, uint64_t count2, uint64_t total2) {
+  if (total1 == 0 || total2 == 0) {
+    return 0.0;
+  }
+  double p1 = static_cast<double>(count1) / total1;
+  double p2 = static_cast<double>(count2) / total2;
+  double p = static_cast<double>(count1 + count2) / (total1 + total2);
+  double variance = p * (1 - p) * (1.0 / total1 + 1.0 / total2);
+  if (variance <= 0) {
+    return 0.0;
+  }
+  return (p2 - p1) / sqrt(variance);
+}
+
+ReportDiffer::ReportDiffer(const ReportDiffOptions& options) : options_(options) {
+  for (const std::string& key : options_.sort_keys) {
+    CHECK(IsSortKeySupported(key)) << key;
+    if (key == "comm") {
+      sort_keys_.push_back(SortKey::kComm);
+    } else if (key == "pid") {
+      sort_keys_.push_back(SortKey::kPid);
+    } else if (key == "tid") {
+      sort_keys_.push_back(SortKey::kTid);
+    } else if (key == "dso") {
+      sort_keys_.push_back(SortKey::kDso);
+    } else {
+      sort_keys_.push_back(SortKey::kSymbol);
+    }
+  }
+}
+
+void ReportDiffer::AddSample(Side side, const ThreadEntry& thread, const std::string& event_name,
+                             uint64_t period, const std::vector<CallChainReportEntry>& callchain) {
+  EventDiff& event = GetEventDiff(event_name);
+  event.total.Add(side, period);
+  sample_id_++;
+  GetEntry(event, thread, callchain[0]).self.Add(side, period);
+  if (!options_.print_callgraph) {
+    return;
+  }
+  for (size_t i = 0; i < callchain.size(); i++) {
+    DiffEntry& entry = GetEntry(event, thread, callchain[i]);
+    // For recursive functions, only the frame nearest to the sampled frame is counted.
+    if (entry.last_sample_id == sample_id_) {
+      continue;
+    }
+    entry.last_sample_id = sample_id_;
+    entry.children.Add(side, period);
+    const CallChainReportEntry* neighbor = nullptr;
+    if (options_.callgraph_show_callee) {
+      if (i + 1 < callchain.size()) {
+        neighbor = &callchain[i + 1];
+      }
+    } else if (i > 0) {
+      neighbor = &callchain[i - 1];
+    }
+    if (neighbor != nullptr) {
+      entry.neighbors[neighbor->symbol->DemangledName()].Add(side, period);
+    }
+  }
+}
+
+ReportDiffer::EventDiff& ReportDiffer::GetEventDiff(const std::string& event_name) {
+  auto it = event_map_.find(event_name);
+  if (it == event_map_.end()) {
+    it = event_map_.emplace(event_name, events_.size()).first;
+    events_.emplace_back();
+    events_.back().name = event_name;
+  }
+  return events_[it->second];
+}
+
+ReportDiffer::DiffEntry& ReportDiffer::GetEntry(EventDiff& event, const ThreadEntry& thread,
+                                                const CallChainReportEntry& frame) {
+  key_buf_.clear();
+  for (size_t i = 0; i < sort_keys_.size(); i++) {
+    if (i != 0) {
+      key_buf_.push_back('\0');
+    }
+    switch (sort_keys_[i]) {
+      case SortKey::kComm:
+        key_buf_ += thread.comm;
+        break;
+      case SortKey::kPid:
+        key_buf_ += std::to_string(thread.pid);
+        break;
+      case SortKey::kTid:
+        key_buf_ += std::to_string(thread.tid);
+        break;
+      case SortKey::kDso:
+        key_buf_ += frame.DsoName();
+        break;
+      case SortKey::kSymbol:
+        key_buf_ += frame.symbol->DemangledName();
+        break;
+    }
+  }
+  auto it = event.entry_map.find(key_buf_);
+  if (it == event.entry_map.end()) {
+    it = event.entry_map.emplace(key_buf_, event.entries.size()).first;
+    event.entries.emplace_back();
+    event.entries.back().key = key_buf_;
+  }
+  return event.entries[it->second];
+}
+
+bool ReportDiffer::Write(const std::string& filename) {
+  std::unique_ptr<FILE, decltype(&fclose)> file_handler(nullptr, fclose);
+  FILE* fp = stdout;
+  if (!filename.empty()) {
+    fp = fopen(filename.c_str(), "w");
+    if (fp == nullptr) {
+      PLOG(ERROR) << "failed to open file " << filename;
+      return false;
+    }
+    file_handler.reset(fp);
+  }
+  fprintf(fp, "Base: %s\n", options_.base_filename.c_str());
+  fprintf(fp, "New: %s\n", options_.new_filename.c_str());
+  for (const EventDiff& event : events_) {
+    fprintf(fp, "\n");
+    WriteEvent(fp, event);
+  }
+  fflush(fp);
+  if (ferror(fp) != 0) {
+    PLOG(ERROR) << "print report failed";
+    return false;
+  }
+  return true;
+}
+
+void ReportDiffer::WriteEvent(FILE* fp, const EventDiff& event) {
+  const Counter& total = event.total;
+  fprintf(fp, "Event: %s\n", event.name.c_str());
+  fprintf(fp, "Base samples: %" PRIu64 ", event count: %" PRIu64 "\n", total.samples[kBase],
+          total.period[kBase]);
+  fprintf(fp, "New samples: %" PRIu64 ", event count: %" PRIu64 "\n\n", total.samples[kNew],
+          total.period[kNew]);
+
+  // With -g, entries are compared by children overhead, like report sorts them.
+  bool use_children = options_.print_callgraph;
+  auto main_counter = [use_children](const DiffEntry* entry) -> const Counter& {
+    return use_children ? entry->children : entry->self;
+  };
+  auto delta_percent = [&](const Counter& counter) {
+    return Percent(counter.period[kNew], total.period[kNew]) -
+           Percent(counter.period[kBase], total.period[kBase]);
+  };
+
+  using Displayer = SampleDisplayer<DiffEntry, EventDiff>;
+  Displayer displayer;
+  displayer.SetInfo(&event);
+  displayer.SetReportFormat(options_.report_csv, options_.csv_separator);
+  auto add_counter_columns = [&](const std::string& suffix, bool children, bool with_delta) {
+    auto counter = [children](const DiffEntry* entry) -> const Counter& {
+      return children ? entry->children : entry->self;
+    };
+    for (Side side : {kBase, kNew}) {
+      std::string name = (side == kBase ? "Base" : "New") + suffix;
+      if (options_.raw_period) {
+        displayer.AddDisplayFunction(name, [=](const DiffEntry* entry) {
+          return std::to_string(counter(entry).period[side]);
+        });
+      } else {
+        displayer.AddDisplayFunction(name, [=, &total](const DiffEntry* entry) {
+          return android::base::StringPrintf(
+              "%.2f%%", Percent(counter(entry).period[side], total.period[side]));
+        });
+      }
+    }
+    if (!with_delta) {
+      return;
+    }
+    if (options_.raw_period) {
+      displayer.AddDisplayFunction("Delta", [=](const DiffEntry* entry) {
+        const Counter& c = counter(entry);
+        int64_t delta = static_cast<int64_t>(c.period[kNew] - c.period[kBase]);
+        return android::base::StringPrintf("%+" PRId64, delta);
+      });
+    } else {
+      displayer.AddDisplayFunction("Delta", [=](const DiffEntry* entry) {
+        return android::base::StringPrintf("%+.2f%%", delta_percent(counter(entry)));
+      });
+    }
+    displayer.AddDisplayFunction("Z", [=, &total](const DiffEntry* entry) {
+      const Counter& c = counter(entry);
+      return android::base::StringPrintf(
+          "%+.2f", ZScore(c.samples[kBase], total.samples[kBase], c.samples[kNew],
+                          total.samples[kNew]));
+    });
+  };
+  if (use_children) {
+    add_counter_columns("Children", true, true);
+    add_counter_columns("Self", false, false);
+  } else {
+    add_counter_columns("", false, true);
+  }
+  if (options_.print_sample_count) {
+    displayer.AddDisplayFunction("BaseSample", [=](const DiffEntry* entry) {
+      return std::to_string(main_counter(entry).samples[kBase]);
+    });
+    displayer.AddDisplayFunction("NewSample", [=](const DiffEntry* entry) {
+      return std::to_string(main_counter(entry).samples[kNew]);
+    });
+  }
+  for (size_t i = 0; i < options_.sort_keys.size(); i++) {
+    const std::string& key = options_.sort_keys[i];
+    std::string name = key == "comm"  ? "Command"
+                       : key == "pid" ? "Pid"
+                       : key == "tid" ? "Tid"
+                       : key == "dso" ? "Shared Object"
+                                      : "Symbol";
+    displayer.AddDisplayFunction(
+        name, [i](const DiffEntry* entry) { return GetKeyValue(entry->key, i); });
+  }
+  if (use_children && !options_.report_csv) {
+    displayer.AddExclusiveDisplayFunction(
+        [this, &event](FILE* fp, const DiffEntry* entry) { WriteCallgraph(fp, event, *entry); });
+  }
+  if (options_.percent_limit != 0.0) {
+    displayer.SetFilterFunction([&](const DiffEntry* entry, const EventDiff*) {
+      const Counter& c = main_counter(entry);
+      return std::max(Percent(c.period[kBase], total.period[kBase]),
+                      Percent(c.period[kNew], total.period[kNew])) >= options_.percent_limit;
+    });
+  }
+
+  // Show entries changed most first.
+  std::vector<std::pair<double, const DiffEntry*>> entries;
+  entries.reserve(event.entries.size());
+  for (const DiffEntry& entry : event.entries) {
+    if (use_children || entry.self.samples[kBase] + entry.self.samples[kNew] != 0) {
+      entries.emplace_back(fabs(delta_percent(main_counter(&entry))), &entry);
+    }
+  }
+  std::sort(entries.begin(), entries.end(), [](const auto& e1, const auto& e2) {
+    return std::tie(e2.first, e1.second->key) < std::tie(e1.first, e2.second->key);
+  });
+  for (const auto& p : entries) {
+    displayer.AdjustWidth(p.second);
+  }
+  displayer.PrintNames(fp);
+  for (const auto& p : entries) {
+    displayer.PrintSample(fp, p.second);
+  }
+}
+
+void ReportDiffer::WriteCallgraph(FILE* fp, const EventDiff& event, const DiffEntry& entry) {
+  const Counter& total = event.total;
+  std::vector<std::tuple<double, double, double, const std::string*>> neighbors;
+  for (const auto& [name, counter] : entry.neighbors) {
+    double base = Percent(counter.period[kBase], total.period[kBase]);
+    double new_percent = Percent(counter.period[kNew], total.period[kNew]);
+    if (std::max(base, new_percent) < options_.percent_limit) {
+      continue;
+    }
+    neighbors.emplace_back(fabs(new_percent - base), base, new_percent, &name);
+  }
+  if (neighbors.empty()) {
+    return;
+  }
+  std::sort(neighbors.begin(), neighbors.end(), [](const auto& n1, const auto& n2) {
+    return std::tie(std::get<0>(n2), *std::get<3>(n1)) <
+           std::tie(std::get<0>(n1), *std::get<3>(n2));
+  });
+  fprintf(fp, "       |-- %s:\n", options_.callgraph_show_callee ? "callers" : "callees");
+  for (const auto& [abs_delta, base, new_percent, name] : neighbors) {
+    fprintf(fp, "       |     %+.2f%%  %.2f%% -> %.2f%%  %s\n", new_percent - base, base,
+            new_percent, name->c_str());
+  }
+  fprintf(fp, "\n");
+}
+
+}  // namespace simpleperf
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "report_utils.h"
+#include "thread_tree.h"
+
+namespace simpleperf {
+
+struct ReportDiffOptions {
+  std::string base_filename;
+  std::string new_filename;
+  // Keys used to aggregate samples. Only comm, pid, tid, dso and symbol are supported.
+  std::vector<std::string> sort_keys;
+  // Also aggregate children overhead and direct callers (callee mode) or callees (caller mode)
+  // of each entry.
+  bool print_callgraph = false;
+  bool callgraph_show_callee = false;
+  bool print_sample_count = false;
+  bool raw_period = false;
+  double percent_limit = 0;
+  bool report_csv = false;
+  std::string csv_separator = ",";
+};
+
+// ReportDiffer compares samples in a base record file and a new record file. Samples of each file
+// are aggregated in one pass by hashing their sort key values, which are strings like thread
+// names, dso paths and symbol names. So entries of the two files are aligned even if symbol
+// addresses change between builds. Sample trees aren't built for either file.
+// For each entry, the report shows overhead in both files, the delta, and a z score of the
+// difference between sample proportions in the two files. A z score with absolute value above 2
+// is unlikely to be caused by sampling noise.
+class ReportDiffer {
+ public:
+  enum Side {
+    kBase = 0,
+    kNew = 1,
+  };
+
+  static bool IsSortKeySupported(const std::string& key);
+
+  explicit ReportDiffer(const ReportDiffOptions& options);
+  // callchain[0] is the sampled frame, followed by its callers.
+  void AddSample(Side side, const ThreadEntry& thread, const std::string& event_name,
+                 uint64_t period, const std::vector<CallChainReportEntry>& callchain);
+  // Write the report to filename. If filename is empty, write to stdout.
+  bool Write(const std::string& filename);
+
+  // Return the z score of the difference between proportions count1 / total1 and
+  // count2 / total2.
+  static double ZScore(uint64_t count1, uint64_t total1, uint64_t count2, uint64_t total2);
+
+ private:
+  enum class SortKey {
+    kComm,
+    kPid,
+    kTid,
+    kDso,
+    kSymbol,
+  };
+
+  struct Counter {
+    uint64_t samples[2] = {0, 0};
+    uint64_t period[2] = {0, 0};
+
+    void Add(Side side, uint64_t sample_period) {
+      samples[side]++;
+      period[side] += sample_period;
+    }
+  };
+
+  struct DiffEntry {
+    // Sort key values separated by '\0'.
+    std::string key;
+    Counter self;
+    Counter children;
+    // Map from names of direct callers (callee mode) or callees (caller mode) to their counters.
+    std::unordered_map<std::string, Counter> neighbors;
+    // Set when adding a sample, to count each entry once per sample for children.
+    uint64_t last_sample_id = 0;
+  };
+
+  struct EventDiff {
+    std::string name;
+    Counter total;
+    std::unordered_map<std::string, size_t> entry_map;
+    std::vector<DiffEntry> entries;
+  };
+
+  EventDiff& GetEventDiff(const std::string& event_name);
+  DiffEntry& GetEntry(EventDiff& event, const ThreadEntry& thread,
+                      const CallChainReportEntry& frame);
+  void WriteEvent(FILE* fp, const EventDiff& event);
+  void WriteCallgraph(FILE* fp, const EventDiff& event, const DiffEntry& entry);
+
+  const ReportDiffOptions options_;
+  std::vector<SortKey> sort_keys_;
+  std::vector<EventDiff> events_;
+  std::map<std::string, size_t> event_map_;
+  uint64_t sample_id_ = 0;
+  std::string key_buf_;
+};
+
+}  // namespace simpleperf
@@ -0,0 +1,568 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "report_exporter.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+
+#include <android-base/logging.h>
+#include <android-base/stringprintf.h>
+
+#include "RegEx.h"
+#include "build_id.h"
+#include "dso.h"
+#include "utils.h"
+
+namespace simpleperf {
+
+namespace {
+
+struct IdVectorHash {
+  size_t operator()(const std::vector<uint64_t>& ids) const {
+    size_t seed = 0;
+    for (uint64_t id : ids) {
+      HashCombine(seed, id);
+    }
+    return seed;
+  }
+};
+
+struct TupleHash {
+  template <typename... T>
+  size_t operator()(const std::tuple<T...>& key) const {
+    size_t seed = 0;
+    std::apply([&seed](const auto&... values) { (HashCombine(seed, values), ...); }, key);
+    return seed;
+  }
+};
+
+// Interns strings. Ids are indexes in strings().
+class StringTable {
+ public:
+  uint64_t GetId(std::string_view s) {
+    auto it = ids_.find(s);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+    uint64_t id = strings_.size();
+    strings_.emplace_back(new std::string(s));
+    ids_.emplace(*strings_.back(), id);
+    return id;
+  }
+
+  size_t size() const { return strings_.size(); }
+  const std::string& Get(uint64_t id) const { return *strings_[id]; }
+
+ private:
+  // Strings are allocated separately, so keys in ids_ stay valid when strings_ grows.
+  std::vector<std::unique_ptr<std::string>> strings_;
+  std::unordered_map<std::string_view, uint64_t> ids_;
+};
+
+class FoldedExporter : public ReportExporter {
+ public:
+  FoldedExporter(const ReportExporterOptions& options)
+      : options_(options), event_filter_(options.event_filter) {}
+
+  void AddSample(const ThreadEntry& thread, const std::string& event_name, uint64_t period,
+                 const std::vector<CallChainReportEntry>& callchain) override {
+    if (event_filter_.empty()) {
+      event_filter_ = event_name;
+    }
+    if (event_name != event_filter_) {
+      if (options_.event_filter.empty() && !event_warning_shown_) {
+        LOG(WARNING) << "Input has multiple event types. Filtering for the first event type seen: "
+                     << event_filter_;
+        event_warning_shown_ = true;
+      }
+      return;
+    }
+    // A stack is stored as [thread_name_id, frame_name_id...], from the root to the leaf.
+    stack_.clear();
+    stack_.push_back(GetThreadNameId(thread));
+    for (auto it = callchain.rbegin(); it != callchain.rend(); ++it) {
+      stack_.push_back(GetFrameNameId(*it));
+    }
+    stacks_[stack_] += period;
+  }
+
+  bool Write(const std::string& filename) override {
+    std::vector<std::pair<std::string, uint64_t>> lines;
+    lines.reserve(stacks_.size());
+    for (const auto& [stack, period] : stacks_) {
+      std::string line;
+      for (size_t i = 0; i < stack.size(); i++) {
+        if (i != 0) {
+          line.push_back(';');
+        }
+        line += names_.Get(stack[i]);
+      }
+      lines.emplace_back(std::move(line), period);
+    }
+    std::sort(lines.begin(), lines.end());
+
+    std::unique_ptr<FILE, decltype(&fclose)> file_handler(nullptr, fclose);
+    FILE* fp = stdout;
+    if (!filename.empty()) {
+      fp = fopen(filename.c_str(), "w");
+      if (fp == nullptr) {
+        PLOG(ERROR) << "failed to open file " << filename;
+        return false;
+      }
+      file_handler.reset(fp);
+    }
+    for (const auto& [line, period] : lines) {
+      fprintf(fp, "%s %" PRIu64 "\n", line.c_str(), period);
+    }
+    fflush(fp);
+    if (ferror(fp) != 0) {
+      PLOG(ERROR) << "failed to write folded stacks";
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  uint64_t GetThreadNameId(const ThreadEntry& thread) {
+    std::string name = thread.comm;
+    if (options_.include_tid) {
+      name += android::base::StringPrintf("-%d/%d", thread.pid, thread.tid);
+    } else if (options_.include_pid) {
+      name += android::base::StringPrintf("-%d", thread.pid);
+    }
+    return names_.GetId(name);
+  }
+
+  uint64_t GetFrameNameId(const CallChainReportEntry& entry) {
+    if (auto it = frame_ids_.find(entry.symbol); it != frame_ids_.end()) {
+      return it->second;
+    }
+    std::string name = entry.symbol->DemangledName();
+    if (options_.annotate_kernel &&
+        (entry.dso->type() == DSO_KERNEL || entry.dso->type() == DSO_KERNEL_MODULE)) {
+      name += "_[k]";
+    }
+    if (options_.annotate_jit && entry.execution_type == CallChainExecutionType::JIT_JVM_METHOD) {
+      name += "_[j]";
+    }
+    uint64_t id = names_.GetId(name);
+    frame_ids_[entry.symbol] = id;
+    return id;
+  }
+
+  const ReportExporterOptions options_;
+  std::string event_filter_;
+  bool event_warning_shown_ = false;
+  StringTable names_;
+  std::unordered_map<const Symbol*, uint64_t> frame_ids_;
+  std::vector<uint64_t> stack_;
+  std::unordered_map<std::vector<uint64_t>, uint64_t, IdVectorHash> stacks_;
+};
+
+// Encodes protobuf messages in wire format. It only supports field types used in profile.proto
+// (https://github.com/google/pprof/blob/main/proto/profile.proto), so we don't need to build the
+// proto file.
+class ProtoEncoder {
+ public:
+  // Like proto3, fields with a zero value are omitted.
+  void AddUint(uint32_t field, uint64_t value) {
+    if (value != 0) {
+      AddVarint(static_cast<uint64_t>(field) << 3);
+      AddVarint(value);
+    }
+  }
+
+  void AddBytes(uint32_t field, std::string_view value) {
+    AddVarint((static_cast<uint64_t>(field) << 3) | 2);
+    AddVarint(value.size());
+    data_.append(value.data(), value.size());
+  }
+
+  void AddPacked(uint32_t field, const std::vector<uint64_t>& values) {
+    if (values.empty()) {
+      return;
+    }
+    ProtoEncoder packed;
+    for (uint64_t value : values) {
+      packed.AddVarint(value);
+    }
+    AddMessage(field, packed);
+  }
+
+  void AddMessage(uint32_t field, const ProtoEncoder& message) { AddBytes(field, message.data_); }
+
+  const std::string& data() const { return data_; }
+  void Clear() { data_.clear(); }
+
+ private:
+  void AddVarint(uint64_t value) {
+    while (value >= 0x80) {
+      data_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    data_.push_back(static_cast<char>(value));
+  }
+
+  std::string data_;
+};
+
+class GzipWriter {
+ public:
+  ~GzipWriter() {
+    if (fp_ != nullptr) {
+      gzclose(fp_);
+    }
+  }
+
+  bool Open(const std::string& filename) {
+    fp_ = filename.empty() ? gzdopen(dup(STDOUT_FILENO), "wb") : gzopen(filename.c_str(), "wb");
+    if (fp_ == nullptr) {
+      PLOG(ERROR) << "failed to open " << (filename.empty() ? "stdout" : filename);
+      return false;
+    }
+    return true;
+  }
+
+  bool Write(const std::string& data) {
+    if (!data.empty() && gzwrite(fp_, data.data(), data.size()) != static_cast<int>(data.size())) {
+      LOG(ERROR) << "failed to write gzip data";
+      return false;
+    }
+    return true;
+  }
+
+  bool Close() {
+    int ret = gzclose(fp_);
+    fp_ = nullptr;
+    if (ret != Z_OK) {
+      LOG(ERROR) << "failed to close gzip file";
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  gzFile fp_ = nullptr;
+};
+
+class PprofExporter : public ReportExporter {
+ public:
+  PprofExporter(const ReportExporterOptions& options) : options_(options) {
+    // string_table[0] should be an empty string.
+    strings_.GetId("");
+  }
+
+  void AddSample(const ThreadEntry& thread, const std::string& event_name, uint64_t period,
+                 const std::vector<CallChainReportEntry>& callchain) override {
+    // A sample key is stored as [labels_id, location_id...].
+    sample_key_.clear();
+    sample_key_.push_back(GetLabelsId(thread));
+    for (const CallChainReportEntry& entry : callchain) {
+      sample_key_.push_back(GetLocationId(entry));
+    }
+    size_t sample_type_index = GetSampleTypeIndex(event_name);
+    auto it = sample_map_.find(sample_key_);
+    if (it == sample_map_.end()) {
+      it = sample_map_.emplace(sample_key_, samples_.size()).first;
+      samples_.emplace_back();
+    }
+    std::vector<uint64_t>& values = samples_[it->second];
+    if (values.size() < sample_type_index + 2) {
+      values.resize(sample_type_index + 2, 0);
+    }
+    values[sample_type_index]++;
+    values[sample_type_index + 1] += period;
+  }
+
+  bool Write(const std::string& filename) override {
+    std::vector<uint64_t> comments = {
+        strings_.GetId("Simpleperf Record Command:\n" + options_.record_cmdline),
+        strings_.GetId("Converted to pprof with:\nsimpleperf report --format pprof"),
+        strings_.GetId("Architecture:\n" + options_.arch),
+    };
+
+    // Write the profile one field at a time, to avoid holding the whole profile in memory.
+    GzipWriter writer;
+    if (!writer.Open(filename)) {
+      return false;
+    }
+    ProtoEncoder profile;
+    ProtoEncoder message;
+    auto flush = [&]() {
+      bool result = writer.Write(profile.data());
+      profile.Clear();
+      return result;
+    };
+    for (const auto& [type_id, unit_id] : sample_types_) {
+      message.Clear();
+      message.AddUint(1, type_id);
+      message.AddUint(2, unit_id);
+      profile.AddMessage(1, message);
+    }
+    std::vector<uint64_t> values;
+    for (const auto& [key, index] : sample_map_) {
+      message.Clear();
+      message.AddPacked(1, std::vector<uint64_t>(key.begin() + 1, key.end()));
+      values = samples_[index];
+      values.resize(sample_types_.size(), 0);
+      message.AddPacked(2, values);
+      const Labels& labels = labels_[key[0]];
+      for (const auto& [label_key, label_value] : labels) {
+        ProtoEncoder label;
+        label.AddUint(1, label_key);
+        label.AddUint(2, label_value);
+        message.AddMessage(3, label);
+      }
+      profile.AddMessage(2, message);
+      if (profile.data().size() >= kFlushSize && !flush()) {
+        return false;
+      }
+    }
+    for (size_t i = 0; i < mappings_.size(); i++) {
+      const Mapping& mapping = mappings_[i];
+      message.Clear();
+      message.AddUint(1, i + 1);
+      message.AddUint(2, mapping.start);
+      message.AddUint(3, mapping.limit);
+      message.AddUint(4, mapping.file_offset);
+      message.AddUint(5, mapping.filename_id);
+      message.AddUint(6, mapping.build_id_id);
+      message.AddUint(7, 1);  // has_functions
+      profile.AddMessage(3, message);
+      if (profile.data().size() >= kFlushSize && !flush()) {
+        return false;
+      }
+    }
+    for (size_t i = 0; i < locations_.size(); i++) {
+      const Location& location = locations_[i];
+      message.Clear();
+      message.AddUint(1, i + 1);
+      message.AddUint(2, location.mapping_id);
+      message.AddUint(3, location.address);
+      if (location.function_id != 0) {
+        ProtoEncoder line;
+        line.AddUint(1, location.function_id);
+        message.AddMessage(4, line);
+      }
+      profile.AddMessage(4, message);
+      if (profile.data().size() >= kFlushSize && !flush()) {
+        return false;
+      }
+    }
+    for (size_t i = 0; i < functions_.size(); i++) {
+      const Function& function = functions_[i];
+      message.Clear();
+      message.AddUint(1, i + 1);
+      message.AddUint(2, function.name_id);
+      message.AddUint(3, function.name_id);
+      message.AddUint(4, function.filename_id);
+      profile.AddMessage(5, message);
+      if (profile.data().size() >= kFlushSize && !flush()) {
+        return false;
+      }
+    }
+    for (size_t i = 0; i < strings_.size(); i++) {
+      profile.AddBytes(6, strings_.Get(i));
+      if (profile.data().size() >= kFlushSize && !flush()) {
+        return false;
+      }
+    }
+    for (uint64_t comment : comments) {
+      profile.AddUint(13, comment);
+    }
+    return flush() && writer.Close();
+  }
+
+ private:
+  static constexpr size_t kFlushSize = 64 * 1024;
+
+  struct Mapping {
+    uint64_t start;
+    uint64_t limit;
+    uint64_t file_offset;
+    uint64_t filename_id;
+    uint64_t build_id_id;
+  };
+
+  struct Location {
+    uint64_t mapping_id;
+    uint64_t address;
+    uint64_t function_id;
+  };
+
+  struct Function {
+    uint64_t name_id;
+    uint64_t filename_id;
+  };
+
+  // pairs of (key string id, value string id)
+  using Labels = std::vector<std::pair<uint64_t, uint64_t>>;
+
+  size_t GetSampleTypeIndex(const std::string& event_name) {
+    auto it = sample_type_indexes_.find(event_name);
+    if (it != sample_type_indexes_.end()) {
+      return it->second;
+    }
+    static const std::unordered_map<std::string, std::string> event_units = {
+        {"cpu-clock", "nanoseconds"},
+        {"cpu-cycles", "cpu-cycles"},
+        {"instructions", "instructions"},
+        {"task-clock", "nanoseconds"},
+    };
+    size_t index = sample_types_.size();
+    sample_types_.emplace_back(strings_.GetId(event_name + "_samples"), strings_.GetId("samples"));
+    auto unit_it = event_units.find(event_name);
+    sample_types_.emplace_back(
+        strings_.GetId(event_name),
+        strings_.GetId(unit_it != event_units.end() ? unit_it->second : "count"));
+    sample_type_indexes_[event_name] = index;
+    return index;
+  }
+
+  uint64_t GetLabelsId(const ThreadEntry& thread) {
+    // Comms are stored in ThreadTree, so the comm pointer changes when a thread changes its comm.
+    auto key = std::make_tuple(thread.pid, thread.tid, thread.comm);
+    auto it = labels_ids_.find(key);
+    if (it != labels_ids_.end()) {
+      return it->second;
+    }
+    // Threadpools doing similar work are often named as name-1, name-2, name-3. Combine them
+    // into one label "name-%d" if they only differ by a number.
+    static const std::unique_ptr<RegEx> numbers_re = RegEx::Create("\\d+");
+    std::string threadpool = numbers_re->Replace(thread.comm, "%d").value_or(thread.comm);
+    Labels labels = {
+        {strings_.GetId("thread"), strings_.GetId(thread.comm)},
+        {strings_.GetId("threadpool"), strings_.GetId(threadpool)},
+        {strings_.GetId("pid"), strings_.GetId(std::to_string(thread.pid))},
+        {strings_.GetId("tid"), strings_.GetId(std::to_string(thread.tid))},
+    };
+    uint64_t id = labels_.size();
+    labels_.emplace_back(std::move(labels));
+    labels_ids_[key] = id;
+    return id;
+  }
+
+  uint64_t GetLocationId(const CallChainReportEntry& entry) {
+    auto key = std::make_tuple(entry.map, entry.symbol, entry.ip);
+    auto it = location_ids_.find(key);
+    if (it != location_ids_.end()) {
+      return it->second;
+    }
+    Location location;
+    location.mapping_id = GetMappingId(entry);
+    location.address = entry.ip;
+    location.function_id = GetFunctionId(entry);
+    locations_.push_back(location);
+    // location_id starts from 1.
+    uint64_t id = locations_.size();
+    location_ids_[key] = id;
+    return id;
+  }
+
+  uint64_t GetMappingId(const CallChainReportEntry& entry) {
+    auto it = mapping_ids_.find(entry.map);
+    if (it != mapping_ids_.end()) {
+      return it->second;
+    }
+    Mapping mapping;
+    mapping.start = entry.map->start_addr;
+    mapping.limit = entry.map->get_end_addr();
+    mapping.file_offset = entry.map->pgoff;
+    mapping.filename_id = strings_.GetId(entry.DsoName());
+    mapping.build_id_id = strings_.GetId(GetBuildIdString(entry.dso->Path()));
+    mappings_.push_back(mapping);
+    // mapping_id starts from 1.
+    uint64_t id = mappings_.size();
+    mapping_ids_[entry.map] = id;
+    return id;
+  }
+
+  uint64_t GetFunctionId(const CallChainReportEntry& entry) {
+    auto it = function_ids_.find(entry.symbol);
+    if (it != function_ids_.end()) {
+      return it->second;
+    }
+    std::string_view name = entry.symbol->DemangledName();
+    uint64_t id = 0;
+    if (name != "unknown") {
+      functions_.push_back(Function{strings_.GetId(name), strings_.GetId(entry.DsoName())});
+      // function_id starts from 1.
+      id = functions_.size();
+    }
+    function_ids_[entry.symbol] = id;
+    return id;
+  }
+
+  std::string GetBuildIdString(const std::string& path) {
+    BuildId build_id = Dso::FindExpectedBuildIdForPath(path);
+    if (build_id.IsEmpty()) {
+      return "";
+    }
+    // The build ids in perf.data are padded to 20 bytes, but pprof needs them without padding.
+    std::string s = build_id.ToString().substr(2);
+    while (s.size() >= 8 && s.compare(s.size() - 8, 8, "00000000") == 0) {
+      s.resize(s.size() - 8);
+    }
+    return s;
+  }
+
+  const ReportExporterOptions options_;
+  StringTable strings_;
+  // pairs of (type string id, unit string id)
+  std::vector<std::pair<uint64_t, uint64_t>> sample_types_;
+  std::unordered_map<std::string, size_t> sample_type_indexes_;
+  std::vector<Labels> labels_;
+  std::unordered_map<std::tuple<int, int, const char*>, uint64_t, TupleHash> labels_ids_;
+  std::vector<Mapping> mappings_;
+  std::unordered_map<const MapEntry*, uint64_t> mapping_ids_;
+  std::vector<Location> locations_;
+  std::unordered_map<std::tuple<const MapEntry*, const Symbol*, uint64_t>, uint64_t, TupleHash>
+      location_ids_;
+  std::vector<Function> functions_;
+  std::unordered_map<const Symbol*, uint64_t> function_ids_;
+  std::vector<uint64_t> sample_key_;
+  std::unordered_map<std::vector<uint64_t>, size_t, IdVectorHash> sample_map_;
+  // values of each sample, indexed by sample_map_ values
+  std::vector<std::vector<uint64_t>> samples_;
+};
+
+}  // namespace
+
+bool ReportExporter::IsFormatSupported(const std::string& format) {
+  return format == "pprof" || format == "folded";
+}
+
+std::unique_ptr<ReportExporter> ReportExporter::Create(const std::string& format,
+                                                       const ReportExporterOptions& options) {
+  if (format == "pprof") {
+    return std::make_unique<PprofExporter>(options);
+  }
+  if (format == "folded") {
+    return std::make_unique<FoldedExporter>(options);
+  }
+  LOG(ERROR) << "unsupported report format: " << format;
+  return nullptr;
+}
+
+}  // namespace simpleperf
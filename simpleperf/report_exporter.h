@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "report_utils.h"
+#include "thread_tree.h"
+
+namespace simpleperf {
+
+struct ReportExporterOptions {
+  // Used by the folded format. Prefix each stack with "comm-pid" or "comm-pid/tid" instead of
+  // "comm".
+  bool include_pid = false;
+  bool include_tid = false;
+  // Used by the folded format. Annotate kernel functions with "_[k]", and JIT functions with
+  // "_[j]".
+  bool annotate_kernel = false;
+  bool annotate_jit = false;
+  // Used by the folded format. Only samples of this event are exported. If empty, use the event
+  // of the first sample.
+  std::string event_filter;
+
+  // Used by the pprof format, stored as comments in the profile.
+  std::string record_cmdline;
+  std::string arch;
+};
+
+// ReportExporter converts samples to formats read by other tools, without building a SampleTree.
+// Supported formats are:
+//   pprof: a gzip-compressed profile.proto used by pprof, like pprof_proto_generator.py.
+//   folded: Brendan Gregg's folded stacks used by FlameGraph, like stackcollapse.py.
+// Frames, stacks and threads are interned while adding samples, so samples are aggregated in one
+// pass, and the output is written from the interned tables.
+class ReportExporter {
+ public:
+  static std::unique_ptr<ReportExporter> Create(const std::string& format,
+                                                const ReportExporterOptions& options);
+  static bool IsFormatSupported(const std::string& format);
+
+  virtual ~ReportExporter() {}
+  // callchain[0] is the sampled frame, followed by its callers.
+  virtual void AddSample(const ThreadEntry& thread, const std::string& event_name, uint64_t period,
+                         const std::vector<CallChainReportEntry>& callchain) = 0;
+  // Write the report to filename. If filename is empty, write to stdout.
+  virtual bool Write(const std::string& filename) = 0;
+};
+
+}  // namespace simpleperf
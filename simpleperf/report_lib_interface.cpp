@@ -171,7 +171,10 @@ class ReportLib {
         record_filename_("perf.data"),
         current_thread_(nullptr),
         callchain_report_builder_(thread_tree_),
-        record_filter_(thread_tree_) {}
+        record_filter_(thread_tree_) {
+    // Pointers in the current sample are only valid until the next call of GetNextSample().
+    thread_tree_.EnableStorageReclaim();
+  }
 
   bool SetLogSeverity(const char* log_level);
 
@@ -476,11 +479,7 @@ void ReportLib::SetCurrentSample(const SampleRecord& r) {
     callchain_entries_.resize(callchain_entries_.size() + 1);
     CallChainEntry& entry = callchain_entries_.back();
     entry.ip = report_entry.ip;
-    if (report_entry.dso_name != nullptr) {
-      entry.symbol.dso_name = report_entry.dso_name;
-    } else {
-      entry.symbol.dso_name = report_entry.dso->GetReportPath().data();
-    }
+    entry.symbol.dso_name = report_entry.DsoName();
     entry.symbol.vaddr_in_file = report_entry.vaddr_in_file;
     entry.symbol.symbol_name = report_entry.symbol->DemangledName();
     entry.symbol.symbol_addr = report_entry.symbol->addr;
@@ -17,12 +17,14 @@
 #include "report_utils.h"
 
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include <android-base/parsebool.h>
-#include <android-base/scopeguard.h>
 #include <android-base/strings.h>
 
 #include "JITDebugReader.h"
+#include "event_attr.h"
+#include "tracing.h"
 #include "utils.h"
 
 namespace simpleperf {
@@ -32,43 +34,113 @@ bool ProguardMappingRetrace::AddProguardMappingFile(std::string_view mapping_fil
   // https://www.guardsquare.com/en/products/proguard/manual/retrace.
   // Additional info provided by R8 is described in
   // https://r8.googlesource.com/r8/+/refs/heads/main/doc/retrace.md.
-  line_reader_.reset(new LineReader(mapping_file));
-  android::base::ScopeGuard g([&]() { line_reader_ = nullptr; });
-
-  if (!line_reader_->Ok()) {
+  std::string path(mapping_file);
+  android::base::unique_fd fd = FileHelper::OpenReadOnly(path);
+  if (fd == -1) {
     PLOG(ERROR) << "failed to read " << mapping_file;
     return false;
   }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    PLOG(ERROR) << "failed to stat " << mapping_file;
+    return false;
+  }
+  if (st.st_size == 0) {
+    return true;
+  }
+  auto map = android::base::MappedFile::FromFd(fd, 0, st.st_size, PROT_READ);
+  if (!map) {
+    PLOG(ERROR) << "failed to mmap " << mapping_file;
+    return false;
+  }
+  IndexClasses(std::string_view(map->data(), map->size()));
+  mapped_files_.emplace_back(std::move(map));
+  return true;
+}
+
+// Split the mapping file into class ranges in one pass, without parsing method lines.
+void ProguardMappingRetrace::IndexClasses(std::string_view data) {
+  IndexedClass* cur_class = nullptr;
+  size_t class_start = 0;
+  size_t line_start = 0;
+
+  auto finish_class = [&](size_t end) {
+    if (cur_class != nullptr) {
+      cur_class->ranges.emplace_back(data.substr(class_start, end - class_start));
+      // The class has new lines, so it needs to be parsed again on next lookup.
+      cur_class->mapping_class.reset();
+      cur_class = nullptr;
+    }
+  };
+
+  while (line_start < data.size()) {
+    size_t line_end = data.find('\n', line_start);
+    size_t next_line_start = (line_end == data.npos) ? data.size() : line_end + 1;
+    std::string_view s = data.substr(line_start, next_line_start - line_start);
+    if (!s.empty() && s.back() == '\n') {
+      s.remove_suffix(1);
+    }
+
+    // Match class line "original_classname -> obfuscated_classname:". Other lines (method
+    // lines, comments and unknown lines) belong to the current class range, and are checked
+    // when parsing the class.
+    if (!s.empty() && s[0] != ' ' && s[0] != '#') {
+      if (auto arrow_pos = s.find(" -> "); arrow_pos != s.npos) {
+        finish_class(line_start);
+        auto arrow_end_pos = arrow_pos + strlen(" -> ");
+        if (auto colon_pos = s.find(':', arrow_end_pos); colon_pos != s.npos) {
+          std::string_view obfuscated_classname =
+              s.substr(arrow_end_pos, colon_pos - arrow_end_pos);
+          cur_class = &class_map_[obfuscated_classname];
+          class_start = line_start;
+        }
+      }
+    }
+    line_start = next_line_start;
+  }
+  finish_class(data.size());
+}
+
+const ProguardMappingRetrace::MappingClass* ProguardMappingRetrace::GetMappingClass(
+    std::string_view obfuscated_classname) {
+  auto it = class_map_.find(obfuscated_classname);
+  if (it == class_map_.end()) {
+    return nullptr;
+  }
+  IndexedClass& indexed_class = it->second;
+  if (!indexed_class.mapping_class) {
+    indexed_class.mapping_class.reset(new MappingClass);
+    for (std::string_view range : indexed_class.ranges) {
+      unparsed_data_ = range;
+      ParseClass(*indexed_class.mapping_class);
+    }
+  }
+  return indexed_class.mapping_class.get();
+}
 
+void ProguardMappingRetrace::ParseClass(MappingClass& mapping_class) {
   MoveToNextLine();
   while (cur_line_.type != LineType::LINE_EOF) {
     if (cur_line_.type == LineType::CLASS_LINE) {
       // Match line "original_classname -> obfuscated_classname:".
       std::string_view s = cur_line_.data;
       auto arrow_pos = s.find(" -> ");
-      auto arrow_end_pos = arrow_pos + strlen(" -> ");
-      if (auto colon_pos = s.find(':', arrow_end_pos); colon_pos != s.npos) {
-        std::string_view original_classname = s.substr(0, arrow_pos);
-        std::string obfuscated_classname(s.substr(arrow_end_pos, colon_pos - arrow_end_pos));
-        MappingClass& cur_class = class_map_[obfuscated_classname];
-        cur_class.original_classname = original_classname;
+      mapping_class.original_classname = s.substr(0, arrow_pos);
+      MoveToNextLine();
+      if (cur_line_.type == LineType::SYNTHESIZED_COMMENT) {
+        mapping_class.synthesized = true;
         MoveToNextLine();
-        if (cur_line_.type == LineType::SYNTHESIZED_COMMENT) {
-          cur_class.synthesized = true;
-          MoveToNextLine();
-        }
+      }
 
-        while (cur_line_.type == LineType::METHOD_LINE) {
-          ParseMethod(cur_class);
-        }
-        continue;
+      while (cur_line_.type == LineType::METHOD_LINE) {
+        ParseMethod(mapping_class);
       }
+      continue;
     }
 
     // Skip unparsed line.
     MoveToNextLine();
   }
-  return true;
 }
 
 void ProguardMappingRetrace::ParseMethod(MappingClass& mapping_class) {
@@ -118,9 +190,11 @@ void ProguardMappingRetrace::ParseMethod(MappingClass& mapping_class) {
 }
 
 void ProguardMappingRetrace::MoveToNextLine() {
-  std::string* line;
-  while ((line = line_reader_->ReadLine()) != nullptr) {
-    std::string_view s = *line;
+  while (!unparsed_data_.empty()) {
+    size_t line_end = unparsed_data_.find('\n');
+    std::string_view s = unparsed_data_.substr(0, line_end);
+    unparsed_data_.remove_prefix(line_end == unparsed_data_.npos ? unparsed_data_.size()
+                                                                  : line_end + 1);
     if (s.empty()) {
       continue;
     }
@@ -152,10 +226,10 @@ void ProguardMappingRetrace::MoveToNextLine() {
 bool ProguardMappingRetrace::DeObfuscateJavaMethods(std::string_view obfuscated_name,
                                                     std::string* original_name, bool* synthesized) {
   if (auto split_pos = obfuscated_name.rfind('.'); split_pos != obfuscated_name.npos) {
-    std::string obfuscated_classname(obfuscated_name.substr(0, split_pos));
+    std::string_view obfuscated_classname = obfuscated_name.substr(0, split_pos);
 
-    if (auto it = class_map_.find(obfuscated_classname); it != class_map_.end()) {
-      const MappingClass& mapping_class = it->second;
+    if (const MappingClass* p = GetMappingClass(obfuscated_classname); p != nullptr) {
+      const MappingClass& mapping_class = *p;
       const auto& method_map = mapping_class.method_map;
       std::string obfuscated_methodname(obfuscated_name.substr(split_pos + 1));
 
@@ -432,4 +506,33 @@ void ThreadReportBuilder::ModifyReportToAggregateThreads(ThreadReport& report) {
   }
 }
 
+bool UpdateTracepointNames(const std::vector<char>& tracing_data, const RecordFileReader& reader,
+                           std::vector<std::string>& attr_names) {
+  auto tracing = Tracing::Create(tracing_data);
+  if (!tracing) {
+    return false;
+  }
+  const EventAttrIds& attrs = reader.AttrSection();
+  for (size_t i = 0; i < attrs.size() && i < attr_names.size(); i++) {
+    if (attrs[i].attr.type == PERF_TYPE_TRACEPOINT) {
+      attr_names[i] = tracing->GetTracingEventNameHavingId(attrs[i].attr.config);
+    }
+  }
+  return true;
+}
+
+bool ReadEventNames(RecordFileReader& reader, std::vector<std::string>& attr_names) {
+  for (const EventAttrWithId& attr_with_id : reader.AttrSection()) {
+    attr_names.emplace_back(GetEventNameByAttr(attr_with_id.attr));
+  }
+  if (reader.HasFeature(PerfFileFormat::FEAT_TRACING_DATA)) {
+    std::vector<char> tracing_data;
+    if (!reader.ReadFeatureSection(PerfFileFormat::FEAT_TRACING_DATA, &tracing_data) ||
+        !UpdateTracepointNames(tracing_data, reader, attr_names)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace simpleperf
@@ -18,18 +18,25 @@
 
 #include <inttypes.h>
 
+#include <memory>
 #include <string>
 #include <string_view>
 #include <unordered_map>
 #include <vector>
 
+#include <android-base/mapped_file.h>
+
 #include "RegEx.h"
 #include "dso.h"
+#include "record_file.h"
 #include "thread_tree.h"
 #include "utils.h"
 
 namespace simpleperf {
 
+// ProguardMappingRetrace de-obfuscates java methods using R8 mapping files. Mapping files can be
+// hundreds of MBs, so they are mmapped and only indexed by obfuscated class names when added.
+// Method lines of a class are parsed the first time the class is looked up.
 class ProguardMappingRetrace {
  public:
   // Add proguard mapping.txt to de-obfuscate minified symbols.
@@ -52,6 +59,14 @@ class ProguardMappingRetrace {
     std::unordered_map<std::string, MappingMethod> method_map;
   };
 
+  struct IndexedClass {
+    // Lines of the class (the class line and the following method lines) in mapped files.
+    // A class can appear in more than one mapping file, so ranges are kept in the order of adding.
+    std::vector<std::string_view> ranges;
+    // Parsed from ranges on first lookup.
+    std::unique_ptr<MappingClass> mapping_class;
+  };
+
   enum LineType {
     SYNTHESIZED_COMMENT,
     CLASS_LINE,
@@ -64,12 +79,17 @@ class ProguardMappingRetrace {
     std::string_view data;
   };
 
+  void IndexClasses(std::string_view data);
+  const MappingClass* GetMappingClass(std::string_view obfuscated_classname);
+  void ParseClass(MappingClass& mapping_class);
   void ParseMethod(MappingClass& mapping_class);
   void MoveToNextLine();
 
-  // Map from obfuscated class names to ProguardMappingClass.
-  std::unordered_map<std::string, MappingClass> class_map_;
-  std::unique_ptr<LineReader> line_reader_;
+  std::vector<std::unique_ptr<android::base::MappedFile>> mapped_files_;
+  // Map from obfuscated class names to IndexedClass. Keys point to data in mapped_files_.
+  std::unordered_map<std::string_view, IndexedClass> class_map_;
+  // Data not parsed yet in the current class range.
+  std::string_view unparsed_data_;
   LineInfo cur_line_;
 };
 
@@ -89,6 +109,12 @@ struct CallChainReportEntry {
   uint64_t vaddr_in_file = 0;
   const MapEntry* map = nullptr;
   CallChainExecutionType execution_type = CallChainExecutionType::NATIVE_METHOD;
+
+  // dso_name is only set for frames reported with a common name (like JIT frames). Other frames
+  // are reported with the path of their dso.
+  const char* DsoName() const {
+    return dso_name != nullptr ? dso_name : dso->GetReportPath().data();
+  }
 };
 
 class CallChainReportBuilder {
@@ -156,4 +182,10 @@ class ThreadReportBuilder {
   std::unordered_map<std::string, int> thread_map_;
 };
 
+// Set names of tracepoint events in attr_names, which are indexed like reader.AttrSection().
+bool UpdateTracepointNames(const std::vector<char>& tracing_data, const RecordFileReader& reader,
+                           std::vector<std::string>& attr_names);
+// Read names of events in reader.AttrSection(), including tracepoint names in tracing data.
+bool ReadEventNames(RecordFileReader& reader, std::vector<std::string>& attr_names);
+
 }  // namespace simpleperf
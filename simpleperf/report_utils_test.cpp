@@ -68,6 +68,45 @@ TEST(ProguardMappingRetrace, smoke) {
   ASSERT_TRUE(synthesized);
 }
 
+TEST(ProguardMappingRetrace, multiple_mapping_files) {
+  TemporaryFile tmpfile1;
+  close(tmpfile1.release());
+  ASSERT_TRUE(android::base::WriteStringToFile("original.class.A -> A:\n"
+                                               "    void method_a() -> a\n"
+                                               "invalid.class.line -> B\n"
+                                               "    void method_b() -> b\n"
+                                               "original.class.C -> C:\n"
+                                               "    void method_c() -> c",
+                                               tmpfile1.path));
+  TemporaryFile tmpfile2;
+  close(tmpfile2.release());
+  ASSERT_TRUE(android::base::WriteStringToFile("original.class.A -> A:\n"
+                                               "    void method_b() -> b\n",
+                                               tmpfile2.path));
+  TemporaryFile empty_file;
+  close(empty_file.release());
+  ProguardMappingRetrace retrace;
+  ASSERT_TRUE(retrace.AddProguardMappingFile(tmpfile1.path));
+  std::string original_name;
+  bool synthesized;
+  // Look up class A before adding the second mapping file, to check it is parsed again.
+  ASSERT_TRUE(retrace.DeObfuscateJavaMethods("A.b", &original_name, &synthesized));
+  ASSERT_EQ(original_name, "original.class.A.b");
+  ASSERT_TRUE(retrace.AddProguardMappingFile(tmpfile2.path));
+  ASSERT_TRUE(retrace.AddProguardMappingFile(empty_file.path));
+  ASSERT_FALSE(retrace.AddProguardMappingFile("/dev/null/not_exist"));
+
+  ASSERT_TRUE(retrace.DeObfuscateJavaMethods("A.a", &original_name, &synthesized));
+  ASSERT_EQ(original_name, "original.class.A.method_a");
+  ASSERT_TRUE(retrace.DeObfuscateJavaMethods("A.b", &original_name, &synthesized));
+  ASSERT_EQ(original_name, "original.class.A.method_b");
+  // Method lines after an invalid class line don't belong to any class.
+  ASSERT_FALSE(retrace.DeObfuscateJavaMethods("B.b", &original_name, &synthesized));
+  // The last line doesn't end with a newline.
+  ASSERT_TRUE(retrace.DeObfuscateJavaMethods("C.c", &original_name, &synthesized));
+  ASSERT_EQ(original_name, "original.class.C.method_c");
+}
+
 class CallChainReportBuilderTest : public testing::Test {
  protected:
   virtual void SetUp() {
@@ -25,13 +25,17 @@ import json
 import logging
 import os
 from pathlib import Path
+import shutil
+import subprocess
 import sys
+import tempfile
 from typing import Any, Callable, Dict, Iterator, List, Optional, Set, Tuple, Union
 
 from simpleperf_report_lib import ReportLib, SymbolStruct
 from simpleperf_utils import (
-    Addr2Nearestline, AddrRange, BaseArgumentParser, BinaryFinder, Disassembly, get_script_dir,
-    log_exit, Objdump, open_report_in_browser, ReadElf, ReportLibOptions, SourceFileSearcher)
+    Addr2Nearestline, AddrRange, BaseArgumentParser, BinaryFinder, Disassembly,
+    get_host_binary_path, get_script_dir, log_exit, Objdump, open_report_in_browser, ReadElf,
+    ReportLibOptions, SourceFileSearcher)
 
 MAX_CALLSTACK_LENGTH = 750
 
@@ -39,7 +43,7 @@ MAX_CALLSTACK_LENGTH = 750
 class HtmlWriter(object):
 
     def __init__(self, output_path: Union[Path, str]):
-        self.fh = open(output_path, 'w')
+        self.fh = open(output_path, 'w', encoding='utf-8')
         self.tag_stack = []
 
     def close(self):
@@ -960,6 +964,7 @@ class ReportGenerator(object):
         self.hw = HtmlWriter(html_path)
         self.hw.open_tag('html')
         self.hw.open_tag('head')
+        self.hw.open_tag('meta', charset='utf-8').close_tag()
         for css in ['bootstrap4-css', 'dataTable-css']:
             self.hw.open_tag('link', rel='stylesheet', type='text/css', href=URLS[css]).close_tag()
         for js in ['jquery', 'bootstrap4-popper', 'bootstrap4', 'dataTable', 'dataTable-bootstrap4',
@@ -985,6 +990,12 @@ class ReportGenerator(object):
         self.hw.add(json.dumps(record_data))
         self.hw.close_tag()
 
+    def write_record_data_file(self, record_data_path: Union[Path, str]):
+        self.hw.open_tag('script', id='record_data', type='application/json')
+        with open(record_data_path, 'r', encoding='utf-8') as f:
+            shutil.copyfileobj(f, self.hw.fh)
+        self.hw.close_tag()
+
     def write_script(self):
         self.hw.open_tag('script').add_file('report_html.js').close_tag()
 
@@ -994,6 +1005,63 @@ class ReportGenerator(object):
         self.hw.close()
 
 
+def gen_record_data_natively(
+        args: argparse.Namespace, binary_cache_path: Optional[str], json_path: str) -> bool:
+    """ Generate record data with `simpleperf report-html-data`, which aggregates samples much
+        faster than RecordData. It doesn't collect source code or disassembly. Return False if
+        the simpleperf binary doesn't have the command.
+    """
+    options: ReportLibOptions = args.report_lib_options
+    simpleperf_path = get_host_binary_path('simpleperf')
+    if subprocess.call([simpleperf_path, 'help', 'report-html-data'], stdout=subprocess.DEVNULL,
+                       stderr=subprocess.DEVNULL) != 0:
+        logging.warning('%s has no report-html-data command, aggregate samples in python instead',
+                        simpleperf_path)
+        return False
+    cmd = [simpleperf_path, 'report-html-data', '-i', ','.join(args.record_file), '-o', json_path,
+           '--min-func-percent', str(args.min_func_percent),
+           '--min-callchain-percent', str(args.min_callchain_percent)]
+    if binary_cache_path:
+        cmd += ['--symfs', binary_cache_path]
+    if args.aggregate_by_thread_name:
+        cmd.append('--aggregate-by-thread-name')
+    if options.aggregate_threads:
+        cmd += ['--aggregate-threads', ','.join(options.aggregate_threads)]
+    for mapping_file in options.proguard_mapping_files or []:
+        cmd += ['--proguard-mapping-file', mapping_file]
+    if options.show_art_frames:
+        cmd.append('--show-art-frames')
+    cmd += options.sample_filters
+    if subprocess.call(cmd) != 0:
+        log_exit('simpleperf report-html-data failed')
+    return True
+
+
+def gen_record_info_in_python(
+        args: argparse.Namespace, binary_cache_path: Optional[str], ndk_path: Optional[str],
+        build_addr_hit_map: bool) -> Dict[str, Any]:
+    record_data = RecordData(binary_cache_path, ndk_path, build_addr_hit_map)
+    for record_file in args.record_file:
+        record_data.load_record_file(record_file, args.report_lib_options)
+    if args.aggregate_by_thread_name:
+        record_data.aggregate_by_thread_name()
+    record_data.limit_percents(args.min_func_percent, args.min_callchain_percent)
+    record_data.sort_call_graph_by_function_name()
+
+    def filter_lib(lib_name: str) -> bool:
+        if not args.binary_filter:
+            return True
+        for binary in args.binary_filter:
+            if binary in lib_name:
+                return True
+        return False
+    if args.add_source_code:
+        record_data.add_source_code(args.source_dirs, filter_lib, args.jobs)
+    if args.add_disassembly:
+        record_data.add_disassembly(filter_lib, args.jobs)
+    return record_data.gen_record_info()
+
+
 def get_args() -> argparse.Namespace:
     parser = BaseArgumentParser(description='report profiling data')
     parser.add_argument('-i', '--record_file', nargs='+', default=['perf.data'], help="""
@@ -1046,33 +1114,26 @@ def main():
     if args.jobs < 1:
         log_exit('Invalid --jobs option.')
 
-    # 2. Produce record data.
-    record_data = RecordData(binary_cache_path, ndk_path, build_addr_hit_map)
-    for record_file in args.record_file:
-        record_data.load_record_file(record_file, args.report_lib_options)
-    if args.aggregate_by_thread_name:
-        record_data.aggregate_by_thread_name()
-    record_data.limit_percents(args.min_func_percent, args.min_callchain_percent)
-    record_data.sort_call_graph_by_function_name()
-
-    def filter_lib(lib_name: str) -> bool:
-        if not args.binary_filter:
-            return True
-        for binary in args.binary_filter:
-            if binary in lib_name:
-                return True
-        return False
-    if args.add_source_code:
-        record_data.add_source_code(args.source_dirs, filter_lib, args.jobs)
-    if args.add_disassembly:
-        record_data.add_disassembly(filter_lib, args.jobs)
-
-    # 3. Generate report html.
-    report_generator = ReportGenerator(args.report_path)
-    report_generator.write_script()
-    report_generator.write_content_div()
-    report_generator.write_record_data(record_data.gen_record_info())
-    report_generator.finish()
+    # 2. Produce record data. Source code and disassembly need addr hit maps, which are only built
+    # by RecordData, so samples are aggregated in python for them. So are samples in
+    # --trace-offcpu modes, which `simpleperf report-html-data` doesn't support.
+    with tempfile.TemporaryDirectory() as tmpdir:
+        json_path = os.path.join(tmpdir, 'record_data.json')
+        record_info = None
+        use_python = build_addr_hit_map or args.report_lib_options.trace_offcpu
+        if use_python or not gen_record_data_natively(args, binary_cache_path, json_path):
+            record_info = gen_record_info_in_python(
+                args, binary_cache_path, ndk_path, build_addr_hit_map)
+
+        # 3. Generate report html.
+        report_generator = ReportGenerator(args.report_path)
+        report_generator.write_script()
+        report_generator.write_content_div()
+        if record_info is None:
+            report_generator.write_record_data_file(json_path)
+        else:
+            report_generator.write_record_data(record_info)
+        report_generator.finish()
 
     if not args.no_browser:
         open_report_in_browser(args.report_path)
@@ -18,6 +18,7 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <limits>
 
 #include <android-base/logging.h>
@@ -44,8 +45,7 @@ std::string GetSymbolMapDsoName(int pid) {
 void ThreadTree::SetThreadName(int pid, int tid, const std::string& comm) {
   ThreadEntry* thread = FindThreadOrNew(pid, tid);
   if (comm != thread->comm) {
-    thread_comm_storage_.push_back(std::unique_ptr<std::string>(new std::string(comm)));
-    thread->comm = thread_comm_storage_.back()->c_str();
+    thread->comm = thread_comm_storage_.insert(comm).first->c_str();
   }
 }
 
@@ -99,6 +99,7 @@ ThreadEntry* ThreadTree::CreateThread(int pid, int tid) {
   if (pid == tid) {
     comm = "unknown";
     maps.reset(new MapSet);
+    maps->reclaim_generation = reclaim_generation_;
   } else {
     // Share maps among threads in the same thread group.
     ThreadEntry* process = FindThreadOrNew(pid, pid);
@@ -358,6 +359,47 @@ void ThreadTree::ClearThreadAndMap() {
   thread_comm_storage_.clear();
   kernel_maps_.maps.clear();
   map_storage_.clear();
+  kernel_maps_.reclaim_generation = ++reclaim_generation_;
+}
+
+void ThreadTree::ReclaimStorage() {
+  std::unordered_set<const MapEntry*> used_maps;
+  std::unordered_set<const char*> used_comms;
+  std::unordered_set<MapSet*> map_sets;
+  map_sets.insert(&kernel_maps_);
+  for (auto& p : thread_tree_) {
+    map_sets.insert(p.second->maps.get());
+    used_comms.insert(p.second->comm);
+  }
+  reclaim_generation_++;
+  for (MapSet* map_set : map_sets) {
+    for (auto& p : map_set->maps) {
+      used_maps.insert(p.second);
+    }
+    map_set->reclaim_generation = reclaim_generation_;
+  }
+  map_storage_.erase(std::remove_if(map_storage_.begin(), map_storage_.end(),
+                                    [&](const std::unique_ptr<MapEntry>& map) {
+                                      return used_maps.count(map.get()) == 0;
+                                    }),
+                     map_storage_.end());
+  for (auto it = thread_comm_storage_.begin(); it != thread_comm_storage_.end();) {
+    if (used_comms.count(it->c_str()) == 0) {
+      it = thread_comm_storage_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ThreadTree::ReclaimStorageIfNeeded() {
+  if (map_storage_.size() + thread_comm_storage_.size() < storage_reclaim_threshold_) {
+    return;
+  }
+  ReclaimStorage();
+  // Reclaim again when the storage doubles, so the cost is amortized over added entries.
+  storage_reclaim_threshold_ = std::max(
+      kMinStorageReclaimThreshold, 2 * (map_storage_.size() + thread_comm_storage_.size()));
 }
 
 bool ThreadTree::AddDsoInfo(FileFeature& file) {
@@ -419,6 +461,9 @@ void ThreadTree::Update(const Record& record) {
     const auto& r = *static_cast<const KernelSymbolRecord*>(&record);
     Dso::SetKallsyms(std::string(r.kallsyms, r.kallsyms_size));
   }
+  if (storage_reclaim_enabled_) {
+    ReclaimStorageIfNeeded();
+  }
 }
 
 std::vector<Dso*> ThreadTree::GetAllDsos() const {
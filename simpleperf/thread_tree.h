@@ -23,6 +23,7 @@
 #include <map>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "dso.h"
 
@@ -70,6 +71,9 @@ struct MapEntry {
 struct MapSet {
   std::map<uint64_t, const MapEntry*> maps;  // Map from start_addr to a MapEntry.
   uint64_t version = 0u;                     // incremented each time changing maps
+  // Incremented each time ThreadTree::ReclaimStorage() frees MapEntries. Users caching
+  // MapEntry pointers of old versions should drop them when it changes.
+  uint64_t reclaim_generation = 0u;
 
   const MapEntry* FindMapByAddr(uint64_t addr) const;
 };
@@ -92,6 +96,7 @@ class ThreadTree {
       : show_ip_for_unknown_symbol_(false),
         show_mark_for_unknown_symbol_(false),
         unknown_symbol_("unknown", 0, std::numeric_limits<unsigned long long>::max()) {
+    unknown_symbol_.DemangledName();
     unknown_dso_ = Dso::CreateDso(DSO_UNKNOWN_FILE, "unknown");
     unknown_map_ =
         MapEntry(0, std::numeric_limits<unsigned long long>::max(), 0, unknown_dso_.get(), false);
@@ -128,6 +133,7 @@ class ThreadTree {
   void ShowMarkForUnknownSymbol() {
     show_mark_for_unknown_symbol_ = true;
     unknown_symbol_ = Symbol("*unknown", 0, ULLONG_MAX);
+    unknown_symbol_.DemangledName();
   }
   // Clear thread and map information, but keep loaded dso information. It saves
   // the time to reload dso information.
@@ -138,6 +144,15 @@ class ThreadTree {
   // Update thread tree with information provided by record.
   void Update(const Record& record);
 
+  // MapEntries and thread names are kept after maps are replaced or threads exit, because users
+  // may hold pointers to them. If all pointers are only used before the next call to Update(),
+  // enable storage reclaim to free unused ones in Update() when the storage doubles.
+  void EnableStorageReclaim() { storage_reclaim_enabled_ = true; }
+  // Free MapEntries and thread names not used by any thread or the kernel maps.
+  void ReclaimStorage();
+  size_t GetMapStorageSize() const { return map_storage_.size(); }
+  size_t GetThreadCommStorageSize() const { return thread_comm_storage_.size(); }
+
   std::vector<Dso*> GetAllDsos() const;
   Dso* FindUserDsoOrNew(const std::string& filename, uint64_t start_addr = 0,
                         DsoType dso_type = DSO_ELF_FILE);
@@ -154,11 +169,18 @@ class ThreadTree {
   // Add thread maps to cover symbols in dso.
   void AddThreadMapsForDsoSymbols(ThreadEntry* thread, Dso* dso);
 
+  void ReclaimStorageIfNeeded();
+
   std::unordered_map<int, std::unique_ptr<ThreadEntry>> thread_tree_;
-  std::vector<std::unique_ptr<std::string>> thread_comm_storage_;
+  // Thread names are interned. So threads with the same name share one string.
+  std::unordered_set<std::string> thread_comm_storage_;
 
   MapSet kernel_maps_;
   std::vector<std::unique_ptr<MapEntry>> map_storage_;
+  bool storage_reclaim_enabled_ = false;
+  size_t storage_reclaim_threshold_ = kMinStorageReclaimThreshold;
+  uint64_t reclaim_generation_ = 0;
+  static constexpr size_t kMinStorageReclaimThreshold = 4096;
   MapEntry unknown_map_;
 
   std::unique_ptr<Dso> kernel_dso_;
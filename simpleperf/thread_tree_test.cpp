@@ -16,8 +16,13 @@
 
 #include "thread_tree.h"
 
+#include <algorithm>
+#include <string>
+
 #include <gtest/gtest.h>
 
+#include "event_attr.h"
+#include "event_type.h"
 #include "read_symbol_map.h"
 
 using namespace simpleperf;
@@ -150,3 +155,50 @@ TEST_F(ThreadTreeTest, invalid_fork) {
   // pid != tid && pid != ppid
   ASSERT_FALSE(thread_tree_.ForkThread(1, 2, 3, 1));
 }
+
+TEST_F(ThreadTreeTest, reclaim_storage) {
+  AddMap(0, 5, "0");
+  AddMap(10, 15, "1");
+  // Replace maps many times, like JIT symfile maps.
+  for (int i = 0; i < 100; i++) {
+    AddMap(1, 6, "2");
+    AddMap(0, 5, "0");
+  }
+  // Threads with the same name share the string.
+  for (int tid = 1; tid <= 10; tid++) {
+    thread_tree_.SetThreadName(0, tid, "worker");
+  }
+  thread_tree_.SetThreadName(1, 1, "exited");
+  thread_tree_.ExitThread(1, 1);
+  ASSERT_EQ(thread_tree_.GetThreadCommStorageSize(), 3u);
+  size_t map_storage_size = thread_tree_.GetMapStorageSize();
+  ASSERT_GT(map_storage_size, 200u);
+
+  ThreadEntry* thread = thread_tree_.FindThreadOrNew(0, 0);
+  uint64_t generation = thread->maps->reclaim_generation;
+  thread_tree_.ReclaimStorage();
+  ASSERT_EQ(thread_tree_.GetMapStorageSize(), 3u);
+  // "swapper" and "worker" are still used.
+  ASSERT_EQ(thread_tree_.GetThreadCommStorageSize(), 2u);
+  ASSERT_STREQ(thread_tree_.FindThreadOrNew(0, 10)->comm, "worker");
+  ASSERT_NE(thread->maps->reclaim_generation, generation);
+  CheckMaps();
+}
+
+TEST_F(ThreadTreeTest, storage_reclaim_in_update) {
+  const EventType* event_type = FindEventTypeByName("cpu-clock");
+  ASSERT_TRUE(event_type != nullptr);
+  perf_event_attr attr = CreateDefaultPerfEventAttr(*event_type);
+  thread_tree_.EnableStorageReclaim();
+  // A long recording replacing JIT maps in 10 threads. Each thread keeps 2 maps.
+  size_t max_storage_size = 0;
+  for (uint64_t i = 0; i < 100000; i++) {
+    uint32_t tid = 100 + i % 10;
+    uint64_t addr = 0x1000 * (i % 2 + 1);
+    MmapRecord r(attr, false, tid, tid, addr, 0x1000, 0, "jit_" + std::to_string(i), 0);
+    thread_tree_.Update(r);
+    max_storage_size = std::max(max_storage_size, thread_tree_.GetMapStorageSize());
+  }
+  // Without reclaim, the map storage would keep all 100000 MapEntries.
+  ASSERT_LE(max_storage_size, 4096u);
+}
@@ -28,6 +28,7 @@
 #include <algorithm>
 #include <map>
 #include <string>
+#include <thread>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
@@ -74,6 +75,13 @@ const char* OneTimeFreeAllocator::AllocateString(std::string_view s) {
   return result;
 }
 
+void OneTimeFreeAllocator::MoveFrom(OneTimeFreeAllocator& other) {
+  v_.insert(v_.end(), other.v_.begin(), other.v_.end());
+  other.v_.clear();
+  other.cur_ = nullptr;
+  other.end_ = nullptr;
+}
+
 android::base::unique_fd FileHelper::OpenReadOnly(const std::string& filename) {
   int fd = TEMP_FAILURE_RETRY(open(filename.c_str(), O_RDONLY | O_BINARY));
   return android::base::unique_fd(fd);
@@ -511,4 +519,25 @@ std::string ReadableCount(uint64_t count) {
   return s;
 }
 
+void RunInParallel(size_t count, size_t min_count_per_job,
+                   const std::function<void(size_t, size_t)>& job) {
+  size_t max_jobs = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  size_t jobs = std::min(max_jobs, count / std::max<size_t>(min_count_per_job, 1));
+  if (jobs <= 1) {
+    if (count > 0) {
+      job(0, count);
+    }
+    return;
+  }
+  size_t count_per_job = (count + jobs - 1) / jobs;
+  std::vector<std::thread> threads;
+  for (size_t begin = count_per_job; begin < count; begin += count_per_job) {
+    threads.emplace_back(job, begin, std::min(begin + count_per_job, count));
+  }
+  job(0, count_per_job);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 }  // namespace simpleperf
@@ -68,6 +68,8 @@ class OneTimeFreeAllocator {
 
   void Clear();
   const char* AllocateString(std::string_view s);
+  // Take over memory allocated by other. Strings allocated by other stay valid until Clear().
+  void MoveFrom(OneTimeFreeAllocator& other);
 
  private:
   const size_t unit_size_;
@@ -292,6 +294,12 @@ void OverflowSafeAdd(uint64_t& dest, uint64_t add);
 
 std::string ReadableCount(uint64_t count);
 
+// Split [0, count) into contiguous ranges of at least min_count_per_job items, and call
+// job(begin, end) for each range on up to hardware_concurrency threads. The calling thread runs
+// the first range. Return when all ranges are processed.
+void RunInParallel(size_t count, size_t min_count_per_job,
+                   const std::function<void(size_t, size_t)>& job);
+
 }  // namespace simpleperf
 
 #endif  // SIMPLE_PERF_UTILS_H_
@@ -112,3 +112,18 @@ TEST(utils, ReadableCount) {
   ASSERT_EQ(ReadableCount(1000), "1,000");
   ASSERT_EQ(ReadableCount(123456789), "123,456,789");
 }
+
+TEST(utils, RunInParallel) {
+  for (size_t count : {0, 1, 100, 10000}) {
+    std::vector<int> visited(count, 0);
+    RunInParallel(count, 10, [&](size_t begin, size_t end) {
+      ASSERT_LT(begin, end);
+      for (size_t i = begin; i < end; i++) {
+        visited[i]++;
+      }
+    });
+    for (int n : visited) {
+      ASSERT_EQ(n, 1);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <vector>
+
+#include <android-base/logging.h>
+#include <benchmark/benchmark.h>
+#include <openssl/evp.h>
+
+#include "verity/hash_tree_builder.h"
+
+constexpr size_t kBlockSize = 4096;
+// 256MB of data, large enough for the hash tree to have 3 levels.
+constexpr size_t kDataSize = 65536 * kBlockSize;
+
+static const std::vector<unsigned char>& GetData() {
+  static std::vector<unsigned char> data = []() {
+    std::vector<unsigned char> data(kDataSize);
+    srand(0);
+    for (auto& c : data) {
+      c = rand();
+    }
+    return data;
+  }();
+  return data;
+}
+
+// Measures the throughput of building the hash tree of kDataSize bytes, with
+// the thread count as the argument.
+static void BM_BuildHashTree(benchmark::State& state) {
+  const std::vector<unsigned char>& data = GetData();
+  std::vector<unsigned char> salt(32, 0xa5);
+  for (auto _ : state) {
+    HashTreeBuilder builder(kBlockSize, EVP_sha256(), state.range(0));
+    CHECK(builder.Initialize(data.size(), salt));
+    CHECK(builder.Update(data.data(), data.size()));
+    CHECK(builder.BuildHashTree());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_BuildHashTree)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
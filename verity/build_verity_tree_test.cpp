@@ -205,3 +205,31 @@ TEST_F(BuildVerityTreeTest, SHA1MultipleBlocks) {
   ASSERT_EQ("7ea287e6167929988810077abaafbc313b2b8593000000000000000000000000",
             HashTreeBuilder::BytesArrayToString(builder->root_hash()));
 }
+
+TEST_F(BuildVerityTreeTest, MultipleThreads) {
+  // Enough blocks to be split across threads at the base level.
+  std::vector<unsigned char> data(4096 * 4096);
+  for (size_t i = 0; i < data.size() / 4096; i++) {
+    std::fill_n(data.begin() + i * 4096, 4096, i * 7);
+  }
+
+  GenerateHashTree(data, salt_hex);
+  std::vector<std::vector<unsigned char>> expected_tree = verity_tree();
+  std::vector<unsigned char> expected_root_hash = builder->root_hash();
+
+  for (size_t thread_count : {2, 3, 8}) {
+    builder.reset(new HashTreeBuilder(4096, EVP_sha256(), thread_count));
+    // Streams data in pieces not aligned with the split of threads.
+    ASSERT_TRUE(builder->Initialize(data.size(), salt_hex));
+    size_t offset = 0;
+    while (offset < data.size()) {
+      size_t data_length =
+          std::min<size_t>(1000 * 4096 + 100, data.size() - offset);
+      ASSERT_TRUE(builder->Update(data.data() + offset, data_length));
+      offset += data_length;
+    }
+    ASSERT_TRUE(builder->BuildHashTree());
+    ASSERT_EQ(expected_tree, verity_tree());
+    ASSERT_EQ(expected_root_hash, builder->root_hash());
+  }
+}
@@ -21,6 +21,7 @@ extern "C" {
     #include <fec.h>
 }
 
+#include <algorithm>
 #include <assert.h>
 #include <android-base/file.h>
 #include <errno.h>
@@ -60,6 +61,18 @@ void image_free(image *ctx)
         delete[] ctx->fec;
     }
 
+    for (size_t i = 0; i < ctx->num_sources; ++i) {
+        close(ctx->sources[i].fd);
+    }
+
+    if (ctx->sources) {
+        delete[] ctx->sources;
+    }
+
+    if (ctx->encoder) {
+        rs_encoder_free(ctx->encoder);
+    }
+
     image_init(ctx);
 }
 
@@ -142,7 +155,8 @@ static void file_image_load(const std::vector<int>& fds, image *ctx)
     }
 }
 
-bool image_load(const std::vector<std::string>& filenames, image *ctx)
+static std::vector<int> open_files(const std::vector<std::string>& filenames,
+        image *ctx)
 {
     assert(ctx->roots > 0 && ctx->roots < FEC_RSM);
     ctx->rs_n = FEC_RSM - ctx->roots;
@@ -165,7 +179,12 @@ bool image_load(const std::vector<std::string>& filenames, image *ctx)
         fds.push_back(fd);
     }
 
-    file_image_load(fds, ctx);
+    return fds;
+}
+
+bool image_load(const std::vector<std::string>& filenames, image *ctx)
+{
+    file_image_load(open_files(filenames, ctx), ctx);
 
     return true;
 }
@@ -289,7 +308,8 @@ bool image_ecc_load(const std::string& filename, image *ctx)
     return true;
 }
 
-bool image_ecc_save(image *ctx)
+/* writes the padding and the header following ECC data */
+static void write_ecc_tail(int fd, const uint8_t *hash, image *ctx)
 {
     assert(2 * sizeof(fec_header) <= FEC_BLOCKSIZE);
 
@@ -304,26 +324,12 @@ bool image_ecc_save(image *ctx)
     f->fec_size = ctx->fec_size;
     f->inp_size = ctx->inp_size;
 
-    SHA256(ctx->fec, ctx->fec_size, f->hash);
+    memcpy(f->hash, hash, SHA256_DIGEST_LENGTH);
 
     /* store a copy of the fec_header at the end of the header block */
     memcpy(&header[sizeof(header) - sizeof(fec_header)], header,
         sizeof(fec_header));
 
-    assert(ctx->fec_filename);
-
-    int fd = TEMP_FAILURE_RETRY(open(ctx->fec_filename,
-                O_WRONLY | O_CREAT | O_TRUNC, 0666));
-
-    if (fd < 0) {
-        FATAL("failed to open file '%s': %s\n", ctx->fec_filename,
-            strerror(errno));
-    }
-
-    if (!android::base::WriteFully(fd, ctx->fec, ctx->fec_size)) {
-        FATAL("failed to write to output: %s\n", strerror(errno));
-    }
-
     if (ctx->padding > 0) {
         uint8_t padding[FEC_BLOCKSIZE] = {0};
 
@@ -337,7 +343,28 @@ bool image_ecc_save(image *ctx)
     if (!android::base::WriteFully(fd, header, sizeof(header))) {
         FATAL("failed to write to header: %s\n", strerror(errno));
     }
+}
+
+bool image_ecc_save(image *ctx)
+{
+    uint8_t hash[SHA256_DIGEST_LENGTH];
+    SHA256(ctx->fec, ctx->fec_size, hash);
+
+    assert(ctx->fec_filename);
+
+    int fd = TEMP_FAILURE_RETRY(open(ctx->fec_filename,
+                O_WRONLY | O_CREAT | O_TRUNC, 0666));
 
+    if (fd < 0) {
+        FATAL("failed to open file '%s': %s\n", ctx->fec_filename,
+            strerror(errno));
+    }
+
+    if (!android::base::WriteFully(fd, ctx->fec, ctx->fec_size)) {
+        FATAL("failed to write to output: %s\n", strerror(errno));
+    }
+
+    write_ecc_tail(fd, hash, ctx);
     close(fd);
 
     return true;
@@ -350,7 +377,9 @@ static void * process(void *cookie)
     return nullptr;
 }
 
-bool image_process(image_proc_func func, image *ctx)
+/* processes RS codewords [first, last) */
+static bool process_range(image_proc_func func, image *ctx, uint64_t first,
+        uint64_t last)
 {
     int threads = ctx->threads;
 
@@ -363,9 +392,12 @@ bool image_process(image_proc_func func, image *ctx)
     }
 
     assert(ctx->rounds > 0);
+    assert(first < last);
+
+    uint64_t rounds = fec_div_round_up(last - first, FEC_BLOCKSIZE);
 
-    if ((uint64_t)threads > ctx->rounds) {
-        threads = (int)ctx->rounds;
+    if ((uint64_t)threads > rounds) {
+        threads = (int)rounds;
     }
     if (threads > IMAGE_MAX_THREADS) {
         threads = IMAGE_MAX_THREADS;
@@ -379,10 +411,10 @@ bool image_process(image_proc_func func, image *ctx)
     pthread_t pthreads[threads];
     image_proc_ctx args[threads];
 
-    uint64_t current = 0;
-    uint64_t end = ctx->rounds * ctx->rs_n * FEC_BLOCKSIZE;
+    uint64_t current = first;
+    uint64_t end = last * ctx->rs_n;
     uint64_t rs_blocks_per_thread =
-        fec_div_round_up(ctx->rounds * FEC_BLOCKSIZE, threads);
+        fec_div_round_up(last - first, threads);
 
     if (ctx->verbose) {
         INFO("computing %" PRIu64 " codes per thread\n", rs_blocks_per_thread);
@@ -442,3 +474,193 @@ bool image_process(image_proc_func func, image *ctx)
 
     return true;
 }
+
+bool image_process(image_proc_func func, image *ctx)
+{
+    return process_range(func, ctx, 0, ctx->rounds * FEC_BLOCKSIZE);
+}
+
+static int create_temp_file()
+{
+    const char *tmpdir = getenv("TMPDIR");
+    std::string path = std::string(tmpdir ? tmpdir : "/tmp") + "/fec-XXXXXX";
+    int fd = mkstemp(&path[0]);
+
+    if (fd < 0) {
+        FATAL("failed to create temporary file '%s': %s\n", path.c_str(),
+            strerror(errno));
+    }
+
+    unlink(path.c_str());
+    return fd;
+}
+
+static void stream_open_file(int fd, image *ctx, image_source *source)
+{
+    struct sparse_file *file = sparse_file_import(fd, false, false);
+
+    if (!file) {
+        if (ctx->sparse) {
+            FATAL("failed to read sparse file\n");
+        }
+
+        off64_t size = lseek64(fd, 0, SEEK_END);
+
+        if (size < 0) {
+            FATAL("failed to get input size: %s\n", strerror(errno));
+        }
+
+        source->fd = fd;
+        source->size = size;
+        return;
+    }
+
+    /* expand sparse images to a temporary file, which can be read by
+       windows */
+    source->fd = create_temp_file();
+    source->size = sparse_file_len(file, false, false);
+
+    if (ctx->verbose) {
+        INFO("expanding %" PRIu64 " bytes of sparse input\n", source->size);
+    }
+
+    if (sparse_file_write(file, source->fd, false, false, false) < 0) {
+        FATAL("failed to expand sparse file\n");
+    }
+
+    sparse_file_destroy(file);
+    close(fd);
+}
+
+bool image_stream_load(const std::vector<std::string>& filenames, image *ctx)
+{
+    std::vector<int> fds = open_files(filenames, ctx);
+    uint64_t size = 0;
+
+    ctx->sources = new image_source[fds.size()];
+    ctx->num_sources = fds.size();
+
+    for (size_t i = 0; i < fds.size(); ++i) {
+        stream_open_file(fds[i], ctx, &ctx->sources[i]);
+        size += ctx->sources[i].size;
+    }
+
+    calculate_rounds(size, ctx);
+    ctx->fec_size = ctx->rounds * ctx->roots * FEC_BLOCKSIZE;
+
+    /* each RS codeword in a window takes rs_n bytes of input and roots bytes
+       of ECC data */
+    ctx->window_size = ctx->memory_limit / FEC_RSM / FEC_BLOCKSIZE *
+        FEC_BLOCKSIZE;
+
+    if (ctx->window_size == 0) {
+        FATAL("memory limit must be at least %u bytes\n",
+            FEC_RSM * FEC_BLOCKSIZE);
+    }
+
+    if (ctx->window_size > ctx->rounds * FEC_BLOCKSIZE) {
+        ctx->window_size = ctx->rounds * FEC_BLOCKSIZE;
+    }
+
+    if (ctx->verbose) {
+        INFO("allocating %" PRIu64 " bytes of memory for windows\n",
+            ctx->window_size * FEC_RSM);
+    }
+
+    ctx->input = new uint8_t[ctx->window_size * ctx->rs_n];
+    ctx->output = ctx->input;
+    ctx->fec = new uint8_t[ctx->window_size * ctx->roots];
+
+    return true;
+}
+
+/* reads len bytes at offset of the concatenated input files, and fills bytes
+   past the end of input with zeros */
+static void stream_read(image *ctx, uint64_t offset, uint64_t len,
+        uint8_t *buf)
+{
+    uint64_t source_start = 0;
+
+    memset(buf, 0, len);
+
+    for (size_t i = 0; i < ctx->num_sources && len > 0; ++i) {
+        const image_source& source = ctx->sources[i];
+        uint64_t source_end = source_start + source.size;
+
+        if (offset < source_end) {
+            uint64_t n = std::min(len, source_end - offset);
+
+            for (uint64_t done = 0; done < n; ) {
+                ssize_t rc = TEMP_FAILURE_RETRY(pread64(source.fd,
+                            buf + done, n - done,
+                            offset - source_start + done));
+
+                if (rc < 0) {
+                    FATAL("failed to read input: %s\n", strerror(errno));
+                } else if (rc == 0) {
+                    /* an expanded sparse image may end with a hole */
+                    break;
+                }
+
+                done += rc;
+            }
+
+            buf += n;
+            offset += n;
+            len -= n;
+        }
+
+        source_start = source_end;
+    }
+}
+
+bool image_stream_encode(image_proc_func func, const std::string& filename,
+        image *ctx)
+{
+    assert(ctx->window_size > 0); /* image_stream_load should be called first */
+
+    ctx->fec_filename = filename.c_str();
+
+    int fd = TEMP_FAILURE_RETRY(open(ctx->fec_filename,
+                O_WRONLY | O_CREAT | O_TRUNC, 0666));
+
+    if (fd < 0) {
+        FATAL("failed to open file '%s': %s\n", ctx->fec_filename,
+            strerror(errno));
+    }
+
+    SHA256_CTX sha;
+    SHA256_Init(&sha);
+
+    uint64_t stripe_size = ctx->rounds * FEC_BLOCKSIZE;
+
+    for (ctx->window_start = 0; ctx->window_start < stripe_size;
+            ctx->window_start += ctx->window_size) {
+        uint64_t len = std::min(ctx->window_size,
+                stripe_size - ctx->window_start);
+
+        for (int j = 0; j < ctx->rs_n; ++j) {
+            stream_read(ctx, j * stripe_size + ctx->window_start, len,
+                &ctx->input[j * ctx->window_size]);
+        }
+
+        if (!process_range(func, ctx, ctx->window_start,
+                    ctx->window_start + len)) {
+            return false;
+        }
+
+        if (!android::base::WriteFully(fd, ctx->fec, len * ctx->roots)) {
+            FATAL("failed to write to output: %s\n", strerror(errno));
+        }
+
+        SHA256_Update(&sha, ctx->fec, len * ctx->roots);
+    }
+
+    uint8_t hash[SHA256_DIGEST_LENGTH];
+    SHA256_Final(hash, &sha);
+
+    write_ecc_tail(fd, hash, ctx);
+    close(fd);
+
+    return true;
+}
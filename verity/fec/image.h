@@ -22,6 +22,7 @@
 #include <vector>
 #include <fec/io.h>
 #include <fec/ecc.h>
+#include "rs_encoder.h"
 
 #define IMAGE_MIN_THREADS     1
 #define IMAGE_MAX_THREADS     128
@@ -35,6 +36,12 @@
 
 #define unlikely(x)    __builtin_expect(!!(x), 0)
 
+/* an input file read by windows when streaming */
+struct image_source {
+    int fd;
+    uint64_t size;
+};
+
 struct image {
     /* if true, decode file in place instead of creating a new output file */
     bool inplace;
@@ -61,6 +68,18 @@ struct image {
     uint8_t *fec;
     uint8_t *input;
     uint8_t *output;
+    /* if not zero, encode the input by windows using at most this many bytes
+       of memory for input and ECC data */
+    uint64_t memory_limit;
+    /* when streaming, input holds window_size bytes of each of the rs_n
+       interleaved stripes starting from window_start, and fec holds the ECC
+       data of the window */
+    uint64_t window_start;
+    uint64_t window_size;
+    image_source *sources;
+    size_t num_sources;
+    /* computes RS parity when encoding, shared by all threads */
+    rs_encoder *encoder;
 };
 
 struct image_proc_ctx;
@@ -86,6 +105,11 @@ extern bool image_ecc_save(image *ctx);
 
 extern bool image_process(image_proc_func f, image *ctx);
 
+extern bool image_stream_load(const std::vector<std::string>& filenames,
+        image *ctx);
+extern bool image_stream_encode(image_proc_func f,
+        const std::string& filename, image *ctx);
+
 extern void image_init(image *ctx);
 extern void image_free(image *ctx);
 
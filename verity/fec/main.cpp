@@ -20,6 +20,7 @@ extern "C" {
 
 #undef NDEBUG
 
+#include <algorithm>
 #include <assert.h>
 #include <errno.h>
 #include <getopt.h>
@@ -39,23 +40,50 @@ enum {
     MODE_GETVERITYSTART
 };
 
+/* encodes RS codewords in batches. A batch doesn't cross a block boundary,
+   so each byte j of the codewords in a batch is either in one block of the
+   input, or past the end of it */
 static void encode_rs(struct image_proc_ctx *ctx)
 {
-    struct image *fcx = ctx->ctx;
-    int j;
-    uint8_t data[fcx->rs_n];
-    uint64_t i;
+    static const uint8_t zero[FEC_BLOCKSIZE] = {0};
 
-    for (i = ctx->start; i < ctx->end; i += fcx->rs_n) {
-        for (j = 0; j < fcx->rs_n; ++j) {
-            data[j] = image_get_interleaved_byte(i + j, fcx);
+    struct image *fcx = ctx->ctx;
+    const uint8_t *rows[fcx->rs_n];
+    uint64_t stripe_size = fcx->rounds * FEC_BLOCKSIZE;
+    uint64_t i = ctx->start / fcx->rs_n;
+    uint64_t end = ctx->end / fcx->rs_n;
+
+    while (i < end) {
+        uint64_t block_end = (i / FEC_BLOCKSIZE + 1) * FEC_BLOCKSIZE;
+        uint64_t count = std::min(end, block_end) - i;
+
+        for (int j = 0; j < fcx->rs_n; ++j) {
+            uint64_t offset = j * stripe_size + i;
+            rows[j] = offset < fcx->inp_size ? &fcx->input[offset] : zero;
         }
 
-        encode_rs_char(ctx->rs, data, &fcx->fec[ctx->fec_pos]);
-        ctx->fec_pos += fcx->roots;
+        rs_encode(fcx->encoder, rows, count, &fcx->fec[ctx->fec_pos]);
+        ctx->fec_pos += count * fcx->roots;
+        i += count;
     }
 }
 
+static void encode_rs_window(struct image_proc_ctx *ctx)
+{
+    struct image *fcx = ctx->ctx;
+    const uint8_t *rows[fcx->rs_n];
+    uint64_t i = ctx->start / fcx->rs_n - fcx->window_start;
+    uint64_t count = ctx->end / fcx->rs_n - fcx->window_start - i;
+    /* fcx->fec only holds ECC data of the current window */
+    uint64_t fec_pos = ctx->fec_pos - fcx->window_start * fcx->roots;
+
+    for (int j = 0; j < fcx->rs_n; ++j) {
+        rows[j] = &fcx->input[j * fcx->window_size + i];
+    }
+
+    rs_encode(fcx->encoder, rows, count, &fcx->fec[fec_pos]);
+}
+
 static void decode_rs(struct image_proc_ctx *ctx)
 {
     struct image *fcx = ctx->ctx;
@@ -108,6 +136,8 @@ static int usage()
            "  -S                                treat data as a sparse file\n"
            "encoding options:\n"
            "  -p, --padding=<bytes>             add padding after ECC data\n"
+           "  -m, --memory-limit=<bytes>        read input by windows, using at most\n"
+           "                                    <bytes> of memory for data\n"
            "decoding options:\n"
            "  -i, --inplace                     correct <data> in place\n"
         );
@@ -176,12 +206,24 @@ static int encode(image& ctx, const std::vector<std::string>& inp_filenames,
         FATAL("invalid parameters: inplace can only used when decoding\n");
     }
 
-    if (!image_load(inp_filenames, &ctx)) {
-        FATAL("failed to read input\n");
+    if (ctx.memory_limit) {
+        if (!image_stream_load(inp_filenames, &ctx)) {
+            FATAL("failed to read input\n");
+        }
+    } else {
+        if (!image_load(inp_filenames, &ctx)) {
+            FATAL("failed to read input\n");
+        }
+
+        if (!image_ecc_new(fec_filename, &ctx)) {
+            FATAL("failed to allocate ecc\n");
+        }
     }
 
-    if (!image_ecc_new(fec_filename, &ctx)) {
-        FATAL("failed to allocate ecc\n");
+    ctx.encoder = rs_encoder_new(ctx.roots, rs_encoder_best_isa());
+
+    if (!ctx.encoder) {
+        FATAL("failed to initialize encoder\n");
     }
 
     INFO("encoding RS(255, %d) to '%s' for input files:\n", ctx.rs_n,
@@ -199,12 +241,18 @@ static int encode(image& ctx, const std::vector<std::string>& inp_filenames,
         INFO("\trounds: %" PRIu64 "\n", ctx.rounds);
     }
 
-    if (!image_process(encode_rs, &ctx)) {
-        FATAL("failed to process input\n");
-    }
+    if (ctx.memory_limit) {
+        if (!image_stream_encode(encode_rs_window, fec_filename, &ctx)) {
+            FATAL("failed to process input\n");
+        }
+    } else {
+        if (!image_process(encode_rs, &ctx)) {
+            FATAL("failed to process input\n");
+        }
 
-    if (!image_ecc_save(&ctx)) {
-        FATAL("failed to write output\n");
+        if (!image_ecc_save(&ctx)) {
+            FATAL("failed to write output\n");
+        }
     }
 
     image_free(&ctx);
@@ -225,6 +273,11 @@ static int decode(image& ctx, const std::vector<std::string>& inp_filenames,
         FATAL("invalid parameters: padding is only relevant when encoding\n");
     }
 
+    if (ctx.memory_limit) {
+        FATAL("invalid parameters: memory limit is only supported when "
+            "encoding\n");
+    }
+
     if (!image_ecc_load(fec_filename, &ctx) ||
             !image_load(inp_filenames, &ctx)) {
         FATAL("failed to read input\n");
@@ -290,10 +343,11 @@ int main(int argc, char **argv)
             {"get-ecc-start", required_argument, nullptr, 'E'},
             {"get-verity-start", required_argument, nullptr, 'V'},
             {"padding", required_argument, nullptr, 'p'},
+            {"memory-limit", required_argument, nullptr, 'm'},
             {"verbose", no_argument, nullptr, 'v'},
             {nullptr, 0, nullptr, 0}
         };
-        int c = getopt_long(argc, argv, "hedSr:ij:s:E:V:p:v", long_options, nullptr);
+        int c = getopt_long(argc, argv, "hedSr:ij:s:E:V:p:m:v", long_options, nullptr);
         if (c < 0) {
             break;
         }
@@ -351,6 +405,9 @@ int main(int argc, char **argv)
                 FATAL("padding must be multiple of %u\n", FEC_BLOCKSIZE);
             }
             break;
+        case 'm':
+            ctx.memory_limit = parse_arg(optarg, "memory-limit", UINT64_MAX);
+            break;
         case 'v':
             ctx.verbose = true;
             break;
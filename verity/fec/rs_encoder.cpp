@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rs_encoder.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include <fec/ecc.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+    #include <immintrin.h>
+    #define RS_ENCODER_X86
+#elif defined(__aarch64__)
+    #include <arm_neon.h>
+    #define RS_ENCODER_NEON
+#endif
+
+/* field generator polynomial in FEC_PARAMS */
+#define GF_POLY 0x11d
+
+/*
+ * The encoder is the LFSR of encode_rs_char(). For each data byte d, with
+ * feedback f = d ^ parity[0], parity byte k becomes parity[k + 1] ^ f * coef[k]
+ * (and f * coef[roots - 1] for the last one).
+ *
+ * Vector versions encode one codeword per byte lane. As byte j of consecutive
+ * codewords is contiguous in rows[j], no transposition of the input is needed.
+ * Multiplying f by coef[k] is done with two 16-entry table lookups, for the
+ * low and high nibbles of f.
+ */
+struct rs_encoder {
+    int roots;
+    int rs_n;
+    rs_encoder_isa isa;
+    /* mul[k * 256 + x] is coef[k] * x */
+    std::vector<uint8_t> mul;
+    /* nibbles[k * 32 + x] is coef[k] * x, and nibbles[k * 32 + 16 + x] is
+       coef[k] * (x << 4), for x in [0, 16) */
+    std::vector<uint8_t> nibbles;
+};
+
+static uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    uint8_t p = 0;
+
+    while (b) {
+        if (b & 1) {
+            p ^= a;
+        }
+
+        a = (uint8_t)((a << 1) ^ ((a & 0x80) ? GF_POLY : 0));
+        b >>= 1;
+    }
+
+    return p;
+}
+
+/* returns the coefficients of the generator polynomial, lowest degree first,
+   with roots alpha^i for i in [0, roots) */
+static std::vector<uint8_t> generator_poly(int roots)
+{
+    std::vector<uint8_t> g(roots + 1, 0);
+    uint8_t root = 1;
+
+    g[0] = 1;
+
+    for (int i = 0; i < roots; ++i) {
+        g[i + 1] = 1;
+
+        for (int j = i; j > 0; --j) {
+            g[j] = g[j - 1] ^ gf_mul(g[j], root);
+        }
+
+        g[0] = gf_mul(g[0], root);
+        root = gf_mul(root, 2);
+    }
+
+    return g;
+}
+
+/* writes lanes codewords of parity, where parity byte k of lane l is
+   state[k * lanes + l] */
+static void store_parity(const uint8_t *state, int roots, size_t lanes,
+        uint8_t *parity)
+{
+    for (size_t l = 0; l < lanes; ++l) {
+        for (int k = 0; k < roots; ++k) {
+            parity[l * roots + k] = state[k * lanes + l];
+        }
+    }
+}
+
+static void encode_scalar(const rs_encoder *rs, const uint8_t *const *rows,
+        size_t i, uint8_t *parity)
+{
+    uint8_t bb[FEC_RSM] = {0};
+    int last = rs->roots - 1;
+
+    for (int j = 0; j < rs->rs_n; ++j) {
+        uint8_t f = rows[j][i] ^ bb[0];
+        const uint8_t *mul = &rs->mul[f];
+
+        for (int k = 0; k < last; ++k) {
+            bb[k] = bb[k + 1] ^ mul[k * 256];
+        }
+
+        bb[last] = mul[last * 256];
+    }
+
+    memcpy(parity, bb, rs->roots);
+}
+
+#if defined(RS_ENCODER_X86)
+
+__attribute__((target("ssse3")))
+static void encode_ssse3(const rs_encoder *rs, const uint8_t *const *rows,
+        size_t i, uint8_t *parity)
+{
+    __m128i bb[FEC_RSM];
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    int last = rs->roots - 1;
+
+    for (int k = 0; k <= last; ++k) {
+        bb[k] = _mm_setzero_si128();
+    }
+
+    for (int j = 0; j < rs->rs_n; ++j) {
+        __m128i f = _mm_xor_si128(
+                _mm_loadu_si128((const __m128i *)&rows[j][i]), bb[0]);
+        __m128i lo = _mm_and_si128(f, mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi64(f, 4), mask);
+        const uint8_t *t = rs->nibbles.data();
+
+        for (int k = 0; k <= last; ++k, t += 32) {
+            __m128i p = _mm_xor_si128(
+                    _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)t), lo),
+                    _mm_shuffle_epi8(
+                        _mm_loadu_si128((const __m128i *)(t + 16)), hi));
+
+            bb[k] = k < last ? _mm_xor_si128(bb[k + 1], p) : p;
+        }
+    }
+
+    store_parity((const uint8_t *)bb, rs->roots, 16, parity);
+}
+
+__attribute__((target("avx2")))
+static void encode_avx2(const rs_encoder *rs, const uint8_t *const *rows,
+        size_t i, uint8_t *parity)
+{
+    __m256i bb[FEC_RSM];
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    int last = rs->roots - 1;
+
+    for (int k = 0; k <= last; ++k) {
+        bb[k] = _mm256_setzero_si256();
+    }
+
+    for (int j = 0; j < rs->rs_n; ++j) {
+        __m256i f = _mm256_xor_si256(
+                _mm256_loadu_si256((const __m256i *)&rows[j][i]), bb[0]);
+        __m256i lo = _mm256_and_si256(f, mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi64(f, 4), mask);
+        const uint8_t *t = rs->nibbles.data();
+
+        for (int k = 0; k <= last; ++k, t += 32) {
+            /* vpshufb looks up each 128-bit lane separately, so both lanes
+               need a copy of the table */
+            __m256i t_lo = _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128((const __m128i *)t));
+            __m256i t_hi = _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128((const __m128i *)(t + 16)));
+            __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(t_lo, lo),
+                    _mm256_shuffle_epi8(t_hi, hi));
+
+            bb[k] = k < last ? _mm256_xor_si256(bb[k + 1], p) : p;
+        }
+    }
+
+    store_parity((const uint8_t *)bb, rs->roots, 32, parity);
+}
+
+#elif defined(RS_ENCODER_NEON)
+
+static void encode_neon(const rs_encoder *rs, const uint8_t *const *rows,
+        size_t i, uint8_t *parity)
+{
+    uint8x16_t bb[FEC_RSM];
+    const uint8x16_t mask = vdupq_n_u8(0x0f);
+    int last = rs->roots - 1;
+
+    for (int k = 0; k <= last; ++k) {
+        bb[k] = vdupq_n_u8(0);
+    }
+
+    for (int j = 0; j < rs->rs_n; ++j) {
+        uint8x16_t f = veorq_u8(vld1q_u8(&rows[j][i]), bb[0]);
+        uint8x16_t lo = vandq_u8(f, mask);
+        uint8x16_t hi = vshrq_n_u8(f, 4);
+        const uint8_t *t = rs->nibbles.data();
+
+        for (int k = 0; k <= last; ++k, t += 32) {
+            uint8x16_t p = veorq_u8(vqtbl1q_u8(vld1q_u8(t), lo),
+                    vqtbl1q_u8(vld1q_u8(t + 16), hi));
+
+            bb[k] = k < last ? veorq_u8(bb[k + 1], p) : p;
+        }
+    }
+
+    store_parity((const uint8_t *)bb, rs->roots, 16, parity);
+}
+
+#endif
+
+bool rs_encoder_isa_supported(rs_encoder_isa isa)
+{
+    switch (isa) {
+    case RS_ISA_SCALAR:
+        return true;
+#if defined(RS_ENCODER_X86)
+    case RS_ISA_SSSE3:
+        return __builtin_cpu_supports("ssse3");
+    case RS_ISA_AVX2:
+        return __builtin_cpu_supports("avx2");
+#elif defined(RS_ENCODER_NEON)
+    case RS_ISA_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+rs_encoder_isa rs_encoder_best_isa()
+{
+    for (rs_encoder_isa isa : {RS_ISA_AVX2, RS_ISA_SSSE3, RS_ISA_NEON}) {
+        if (rs_encoder_isa_supported(isa)) {
+            return isa;
+        }
+    }
+
+    return RS_ISA_SCALAR;
+}
+
+rs_encoder *rs_encoder_new(int roots, rs_encoder_isa isa)
+{
+    if (roots <= 0 || roots >= FEC_RSM || !rs_encoder_isa_supported(isa)) {
+        return nullptr;
+    }
+
+    rs_encoder *rs = new rs_encoder;
+    std::vector<uint8_t> g = generator_poly(roots);
+
+    rs->roots = roots;
+    rs->rs_n = FEC_RSM - roots;
+    rs->isa = isa;
+    rs->mul.resize(roots * 256);
+    rs->nibbles.resize(roots * 32);
+
+    for (int k = 0; k < roots; ++k) {
+        uint8_t coef = g[roots - 1 - k];
+
+        for (int x = 0; x < 256; ++x) {
+            rs->mul[k * 256 + x] = gf_mul(coef, (uint8_t)x);
+        }
+
+        for (int x = 0; x < 16; ++x) {
+            rs->nibbles[k * 32 + x] = rs->mul[k * 256 + x];
+            rs->nibbles[k * 32 + 16 + x] = rs->mul[k * 256 + (x << 4)];
+        }
+    }
+
+    return rs;
+}
+
+void rs_encoder_free(rs_encoder *rs)
+{
+    delete rs;
+}
+
+void rs_encode(const rs_encoder *rs, const uint8_t *const *rows,
+        size_t count, uint8_t *parity)
+{
+    size_t i = 0;
+
+    switch (rs->isa) {
+#if defined(RS_ENCODER_X86)
+    case RS_ISA_AVX2:
+        for (; i + 32 <= count; i += 32) {
+            encode_avx2(rs, rows, i, &parity[i * rs->roots]);
+        }
+        /* cpus supporting AVX2 also support SSSE3 */
+        [[fallthrough]];
+    case RS_ISA_SSSE3:
+        for (; i + 16 <= count; i += 16) {
+            encode_ssse3(rs, rows, i, &parity[i * rs->roots]);
+        }
+        break;
+#elif defined(RS_ENCODER_NEON)
+    case RS_ISA_NEON:
+        for (; i + 16 <= count; i += 16) {
+            encode_neon(rs, rows, i, &parity[i * rs->roots]);
+        }
+        break;
+#endif
+    default:
+        break;
+    }
+
+    for (; i < count; ++i) {
+        encode_scalar(rs, rows, i, &parity[i * rs->roots]);
+    }
+}
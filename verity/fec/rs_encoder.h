@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RS_ENCODER_H__
+#define __RS_ENCODER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* instruction sets used to encode multiple codewords at a time */
+enum rs_encoder_isa {
+    RS_ISA_SCALAR,
+    RS_ISA_SSSE3,
+    RS_ISA_AVX2,
+    RS_ISA_NEON,
+};
+
+struct rs_encoder;
+
+/* returns true if the cpu supports isa */
+extern bool rs_encoder_isa_supported(rs_encoder_isa isa);
+/* returns the fastest instruction set supported by the cpu */
+extern rs_encoder_isa rs_encoder_best_isa();
+
+/* creates an encoder computing the same parity as encode_rs_char() with
+   FEC_PARAMS(roots), returns nullptr if isa isn't supported */
+extern rs_encoder *rs_encoder_new(int roots, rs_encoder_isa isa);
+extern void rs_encoder_free(rs_encoder *rs);
+
+/* encodes count codewords of FEC_RSM - roots data bytes. Byte j of codeword
+   i is rows[j][i], and parity byte k of codeword i is written to
+   parity[i * roots + k]. An encoder can be used by multiple threads. */
+extern void rs_encode(const rs_encoder *rs, const uint8_t *const *rows,
+        size_t count, uint8_t *parity);
+
+#endif // __RS_ENCODER_H__
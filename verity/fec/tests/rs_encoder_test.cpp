@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include <fec/ecc.h>
+#include <gtest/gtest.h>
+
+extern "C" {
+#include <fec.h>
+}
+
+#include "../rs_encoder.h"
+
+// Compares rs_encode() with encode_rs_char() for all supported roots, on each
+// instruction set supported by the cpu.
+TEST(RsEncoderTest, MatchesEncodeRsChar) {
+    // Not a multiple of the vector sizes, to also test the scalar path.
+    constexpr size_t kCount = 77;
+
+    srand(0);
+
+    for (int roots = 1; roots < FEC_RSM; ++roots) {
+        int rs_n = FEC_RSM - roots;
+        std::vector<std::vector<uint8_t>> rows(rs_n,
+                                               std::vector<uint8_t>(kCount));
+        std::vector<const uint8_t *> row_ptrs;
+
+        for (auto &row : rows) {
+            for (auto &c : row) {
+                c = rand();
+            }
+            row_ptrs.push_back(row.data());
+        }
+
+        void *rs = init_rs_char(FEC_PARAMS(roots));
+        ASSERT_NE(nullptr, rs);
+        std::vector<uint8_t> expected(kCount * roots);
+
+        for (size_t i = 0; i < kCount; ++i) {
+            uint8_t data[FEC_RSM];
+
+            for (int j = 0; j < rs_n; ++j) {
+                data[j] = rows[j][i];
+            }
+            encode_rs_char(rs, data, &expected[i * roots]);
+        }
+        free_rs_char(rs);
+
+        for (rs_encoder_isa isa :
+             {RS_ISA_SCALAR, RS_ISA_SSSE3, RS_ISA_AVX2, RS_ISA_NEON}) {
+            if (!rs_encoder_isa_supported(isa)) {
+                continue;
+            }
+            rs_encoder *encoder = rs_encoder_new(roots, isa);
+            ASSERT_NE(nullptr, encoder);
+            std::vector<uint8_t> parity(kCount * roots);
+            rs_encode(encoder, row_ptrs.data(), kCount, parity.data());
+            rs_encoder_free(encoder);
+            ASSERT_EQ(expected, parity) << "roots " << roots << ", isa " << isa;
+        }
+    }
+}
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <functional>
 #include <memory>
+#include <thread>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
@@ -29,6 +30,10 @@
 
 #include "build_verity_tree_utils.h"
 
+// Only split blocks across threads when each thread gets at least this many
+// blocks, so thread creation is cheap compared to hashing.
+static constexpr size_t kMinBlocksPerThread = 256;
+
 const EVP_MD* HashTreeBuilder::HashFunction(const std::string& hash_name) {
   if (android::base::EqualsIgnoreCase(hash_name, "sha1")) {
     return EVP_sha1();
@@ -50,8 +55,12 @@ const EVP_MD* HashTreeBuilder::HashFunction(const std::string& hash_name) {
   return nullptr;
 }
 
-HashTreeBuilder::HashTreeBuilder(size_t block_size, const EVP_MD* md)
-    : block_size_(block_size), data_size_(0), md_(md) {
+HashTreeBuilder::HashTreeBuilder(size_t block_size, const EVP_MD* md,
+                                 size_t thread_count)
+    : block_size_(block_size),
+      data_size_(0),
+      md_(md),
+      thread_count_(std::max<size_t>(thread_count, 1)) {
   CHECK(md_ != nullptr) << "Failed to initialize md";
 
   hash_size_raw_ = EVP_MD_size(md_);
@@ -62,6 +71,14 @@ HashTreeBuilder::HashTreeBuilder(size_t block_size, const EVP_MD* md)
     hash_size_ = hash_size_ << 1;
   }
   CHECK_LT(hash_size_ * 2, block_size_);
+  InitSaltedContext();
+}
+
+void HashTreeBuilder::InitSaltedContext() {
+  int ret = 1;
+  ret &= EVP_DigestInit_ex(salted_ctx_.get(), md_, nullptr);
+  ret &= EVP_DigestUpdate(salted_ctx_.get(), salt_.data(), salt_.size());
+  CHECK_EQ(1, ret);
 }
 
 std::string HashTreeBuilder::BytesArrayToString(
@@ -115,6 +132,7 @@ bool HashTreeBuilder::Initialize(int64_t expected_data_size,
                                  const std::vector<unsigned char>& salt) {
   data_size_ = expected_data_size;
   salt_ = salt;
+  InitSaltedContext();
 
   if (data_size_ % block_size_ != 0) {
     LOG(ERROR) << "file size " << data_size_
@@ -132,23 +150,19 @@ bool HashTreeBuilder::Initialize(int64_t expected_data_size,
   // Save the hash of the zero block to avoid future recalculation.
   std::vector<unsigned char> zero_block(block_size_, 0);
   zero_block_hash_.resize(hash_size_);
-  HashBlock(zero_block.data(), zero_block_hash_.data());
+  HashBlock(ctx_.get(), zero_block.data(), zero_block_hash_.data());
 
   return true;
 }
 
-bool HashTreeBuilder::HashBlock(const unsigned char* block,
-                                unsigned char* out) {
+bool HashTreeBuilder::HashBlock(EVP_MD_CTX* ctx, const unsigned char* block,
+                                unsigned char* out) const {
   unsigned int s;
   int ret = 1;
 
-  EVP_MD_CTX* mdctx = EVP_MD_CTX_create();
-  CHECK(mdctx != nullptr);
-  ret &= EVP_DigestInit_ex(mdctx, md_, nullptr);
-  ret &= EVP_DigestUpdate(mdctx, salt_.data(), salt_.size());
-  ret &= EVP_DigestUpdate(mdctx, block, block_size_);
-  ret &= EVP_DigestFinal_ex(mdctx, out, &s);
-  EVP_MD_CTX_destroy(mdctx);
+  ret &= EVP_MD_CTX_copy_ex(ctx, salted_ctx_.get());
+  ret &= EVP_DigestUpdate(ctx, block, block_size_);
+  ret &= EVP_DigestFinal_ex(ctx, out, &s);
 
   CHECK_EQ(1, ret);
   CHECK_EQ(hash_size_raw_, s);
@@ -172,16 +186,44 @@ bool HashTreeBuilder::HashBlocks(const unsigned char* data, size_t len,
     return true;
   }
 
-  for (size_t i = 0; i < len; i += block_size_) {
-    unsigned char hash_buffer[hash_size_];
-    if (!HashBlock(data + i, hash_buffer)) {
-      return false;
+  // Hashes are written to their final positions in |output_vector|, so the
+  // output doesn't depend on how blocks are split across threads.
+  size_t blocks = len / block_size_;
+  size_t output_offset = output_vector->size();
+  output_vector->resize(output_offset + blocks * hash_size_);
+  unsigned char* output = output_vector->data() + output_offset;
+
+  auto hash_range = [&](EVP_MD_CTX* ctx, size_t start, size_t end) {
+    for (size_t i = start; i < end; i++) {
+      if (!HashBlock(ctx, data + i * block_size_, output + i * hash_size_)) {
+        return false;
+      }
     }
-    output_vector->insert(output_vector->end(), hash_buffer,
-                          hash_buffer + hash_size_);
+    return true;
+  };
+
+  size_t threads = std::min(thread_count_, blocks / kMinBlocksPerThread);
+  if (threads <= 1) {
+    return hash_range(ctx_.get(), 0, blocks);
   }
 
-  return true;
+  size_t blocks_per_thread = (blocks + threads - 1) / threads;
+  std::vector<std::thread> workers;
+  std::vector<char> results(threads, 1);
+  for (size_t i = 1; i < threads; i++) {
+    size_t start = std::min(blocks, i * blocks_per_thread);
+    size_t end = std::min(blocks, start + blocks_per_thread);
+    workers.emplace_back([&, i, start, end]() {
+      bssl::ScopedEVP_MD_CTX ctx;
+      results[i] = hash_range(ctx.get(), start, end);
+    });
+  }
+  results[0] = hash_range(ctx_.get(), 0, blocks_per_thread);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return std::all_of(results.begin(), results.end(),
+                     [](char result) { return result != 0; });
 }
 
 bool HashTreeBuilder::Update(const unsigned char* data, size_t len) {
@@ -31,9 +31,11 @@
 // the total data size should be know in advance. Once all the data is ready,
 // appropriate functions can be called to build the upper levels of the hash
 // tree and output the tree to a file.
+// Blocks can be hashed by |thread_count| threads. The output doesn't depend on
+// the thread count.
 class HashTreeBuilder {
  public:
-  HashTreeBuilder(size_t block_size, const EVP_MD* md);
+  HashTreeBuilder(size_t block_size, const EVP_MD* md, size_t thread_count = 1);
   // Returns the size of the verity tree in bytes given the input data size.
   uint64_t CalculateSize(uint64_t input_size) const {
       return CalculateSize(input_size, block_size_, hash_size_);
@@ -76,9 +78,12 @@ class HashTreeBuilder {
 
  private:
   friend class BuildVerityTreeTest;
-  // Calculates the hash of one single block. Write the result to |out|, a
-  // buffer allocated by the caller.
-  bool HashBlock(const unsigned char* block, unsigned char* out);
+  // Initializes |salted_ctx_| with the hash function and |salt_|.
+  void InitSaltedContext();
+  // Calculates the hash of one single block using |ctx|. Write the result to
+  // |out|, a buffer allocated by the caller.
+  bool HashBlock(EVP_MD_CTX* ctx, const unsigned char* block,
+                 unsigned char* out) const;
   // Calculates the hash of |len| bytes of data starting from |data|. Append the
   // result to |output_vector|.
   bool HashBlocks(const unsigned char* data, size_t len,
@@ -96,6 +101,13 @@ class HashTreeBuilder {
   size_t hash_size_raw_;
   // Hash size rounded up to the next power of 2. (e.g. 20 -> 32)
   size_t hash_size_;
+  // Number of threads used to hash blocks.
+  size_t thread_count_;
+  // A context which has digested the salt. It's copied instead of digesting
+  // the salt again for each block.
+  bssl::ScopedEVP_MD_CTX salted_ctx_;
+  // Context used to hash blocks on the calling thread.
+  bssl::ScopedEVP_MD_CTX ctx_;
 
   // Pre-calculated hash of a zero block.
   std::vector<unsigned char> zero_block_hash_;